@@ -0,0 +1,288 @@
+// src/admin/AdminServer.cpp
+
+#include "AdminServer.hpp"
+#include "BlockedSignals.hpp"
+#include "configs.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace nm = nlohmann;
+
+namespace {
+// Longest request line accepted from a client
+constexpr size_t MAX_REQUEST_SIZE = 64 * 1024;
+
+// Clients served at the same time, further connections are refused
+constexpr size_t MAX_CLIENTS = 8;
+
+constexpr const char *BURST_MODES[] = {"auto", "on", "off"};
+
+uint32_t parseLink(const nm::json &request) {
+  std::string name = request.at("link").get<std::string>();
+  auto it = std::find(std::begin(LINK_SECTIONS), std::end(LINK_SECTIONS), name);
+  if (it == std::end(LINK_SECTIONS)) {
+    throw std::runtime_error("unknown link '" + name + "'");
+  }
+  return static_cast<uint32_t>(it - std::begin(LINK_SECTIONS));
+}
+
+nm::json describeLink(const Config &config, uint32_t link) {
+  nm::json values = nm::json::object();
+  for (const LinkField &field : LINK_FIELDS) {
+    values[field.name] = config.link(link).*field.member;
+  }
+  auto burst = static_cast<size_t>(config.forced_bursts[link]);
+  return {{"ok", true},
+          {"link", LINK_SECTIONS[link]},
+          {"burst", BURST_MODES[burst]},
+          {"values", values}};
+}
+
+nm::json error(const std::string &message) {
+  return {{"ok", false}, {"error", message}};
+}
+} // namespace
+
+AdminServer::AdminServer(ConfigManager &config_manager,
+                         const std::string &socket_path, Hooks hooks)
+    : config_manager_(config_manager), socket_path_(socket_path),
+      hooks_(std::move(hooks)) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socket_path_.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("Admin socket path too long: " + socket_path_);
+  }
+  std::memcpy(address.sun_path, socket_path_.c_str(), socket_path_.size());
+
+  // Only a leftover socket is removed, never a regular file
+  struct stat existing{};
+  if (lstat(socket_path_.c_str(), &existing) == 0) {
+    if (!S_ISSOCK(existing.st_mode)) {
+      throw std::runtime_error("Admin socket path exists and is not a "
+                               "socket: " +
+                               socket_path_);
+    }
+    unlink(socket_path_.c_str());
+  }
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (listen_fd_ < 0) {
+    throw std::runtime_error("Failed to create admin socket: " +
+                             std::string(std::strerror(errno)));
+  }
+  if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&address),
+           sizeof(address)) < 0 ||
+      listen(listen_fd_, static_cast<int>(MAX_CLIENTS)) < 0) {
+    int bind_error = errno;
+    close(listen_fd_);
+    throw std::runtime_error("Failed to bind admin socket " + socket_path_ +
+                             ": " + std::strerror(bind_error));
+  }
+  // owner and group only, the socket can change impairments
+  chmod(socket_path_.c_str(), 0660);
+
+  wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wake_fd_ < 0) {
+    close(listen_fd_);
+    unlink(socket_path_.c_str());
+    throw std::runtime_error("Failed to create admin wake fd: " +
+                             std::string(std::strerror(errno)));
+  }
+}
+
+AdminServer::~AdminServer() {
+  stop();
+  for (const Client &client : clients_) {
+    close(client.fd);
+  }
+  close(wake_fd_);
+  close(listen_fd_);
+  unlink(socket_path_.c_str());
+}
+
+void AdminServer::start() {
+  if (running_)
+    return;
+  running_ = true;
+  BlockedSignals guard;
+  thread_ = std::thread(&AdminServer::loop, this);
+}
+
+void AdminServer::stop() {
+  running_ = false;
+  uint64_t one = 1;
+  if (write(wake_fd_, &one, sizeof(one)) < 0) {
+    // the counter is already non-zero, the loop wakes up anyway
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void AdminServer::loop() {
+  std::vector<pollfd> fds;
+  while (running_) {
+    fds.clear();
+    fds.push_back({wake_fd_, POLLIN, 0});
+    fds.push_back({listen_fd_, POLLIN, 0});
+    for (const Client &client : clients_) {
+      fds.push_back({client.fd, POLLIN, 0});
+    }
+
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "Warning: admin socket poll failed: "
+                << std::strerror(errno) << "\n";
+      break;
+    }
+
+    // Clients first, accepting below changes clients_
+    for (size_t i = clients_.size(); i-- > 0;) {
+      if (fds[i + 2].revents != 0 && !serve(clients_[i])) {
+        close(clients_[i].fd);
+        clients_.erase(clients_.begin() + static_cast<long>(i));
+      }
+    }
+
+    if (fds[1].revents & POLLIN) {
+      int fd = accept4(listen_fd_, nullptr, nullptr,
+                       SOCK_CLOEXEC | SOCK_NONBLOCK);
+      if (fd >= 0 && clients_.size() >= MAX_CLIENTS) {
+        close(fd);
+      } else if (fd >= 0) {
+        clients_.push_back({fd, {}});
+      }
+    }
+  }
+}
+
+bool AdminServer::serve(Client &client) {
+  char buffer[4096];
+  ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+  if (received <= 0) {
+    return received < 0 && (errno == EAGAIN || errno == EINTR);
+  }
+  client.input.append(buffer, static_cast<size_t>(received));
+
+  size_t end;
+  while ((end = client.input.find('\n')) != std::string::npos) {
+    std::string response = handle(client.input.substr(0, end)) + "\n";
+    client.input.erase(0, end + 1);
+
+    // responses are small, one that doesn't fit the socket buffer means
+    // the client stopped reading
+    ssize_t sent = send(client.fd, response.data(), response.size(),
+                        MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent != static_cast<ssize_t>(response.size())) {
+      return false;
+    }
+  }
+  return client.input.size() <= MAX_REQUEST_SIZE;
+}
+
+std::string AdminServer::handle(const std::string &line) {
+  nm::json response;
+  try {
+    nm::json request = nm::json::parse(line);
+    std::string command = request.at("cmd").get<std::string>();
+
+    if (command == "get_link") {
+      uint32_t link = parseLink(request);
+      response = describeLink(*config_manager_.getSnapshot(), link);
+
+    } else if (command == "set_link") {
+      uint32_t link = parseLink(request);
+      const nm::json &values = request.at("values");
+      if (!values.is_object() || values.empty()) {
+        throw std::runtime_error("values must be a non-empty object");
+      }
+
+      // Validate everything before anything is installed
+      std::vector<std::pair<double Config::LinkProperties::*, double>> changes;
+      for (const auto &[name, value] : values.items()) {
+        auto field = std::find_if(
+            std::begin(LINK_FIELDS), std::end(LINK_FIELDS),
+            [&name](const LinkField &f) { return name == f.name; });
+        if (field == std::end(LINK_FIELDS)) {
+          throw std::runtime_error("unknown field '" + name + "'");
+        }
+        double number = value.get<double>();
+        if (!std::isfinite(number) || number < 0) {
+          throw std::runtime_error(name + " must be a non-negative number");
+        }
+        changes.emplace_back(field->member, number);
+      }
+
+      // Only the requested fields, on top of whatever was installed since
+      config_manager_.update([link, &changes](Config &config) {
+        for (const auto &[member, number] : changes) {
+          config.link(link).*member = number;
+        }
+      });
+      response = describeLink(*config_manager_.getSnapshot(), link);
+
+    } else if (command == "force_burst") {
+      uint32_t link = parseLink(request);
+      std::string mode = request.at("mode").get<std::string>();
+      auto it = std::find(std::begin(BURST_MODES), std::end(BURST_MODES), mode);
+      if (it == std::end(BURST_MODES)) {
+        throw std::runtime_error("mode must be on, off or auto");
+      }
+      auto force =
+          static_cast<Config::BurstForce>(it - std::begin(BURST_MODES));
+      config_manager_.update([link, force](Config &config) {
+        config.forced_bursts[link] = force;
+      });
+      response = describeLink(*config_manager_.getSnapshot(), link);
+
+    } else if (command == "counters") {
+      nm::json counters = nm::json::object();
+      if (hooks_.counters) {
+        for (const auto &[name, value] : hooks_.counters()) {
+          counters[name] = value;
+        }
+      }
+      response = {{"ok", true}, {"counters", counters}};
+
+    } else if (command == "log_level") {
+      if (request.contains("level")) {
+        setLogLevel(parseLogLevel(request["level"].get<std::string>()));
+      }
+      response = {{"ok", true}, {"level", logLevelName(g_log_level.load())}};
+
+    } else if (command == "reload") {
+      bool reloaded = hooks_.reload ? hooks_.reload()
+                                    : config_manager_.reloadConfig();
+      response = reloaded ? nm::json{{"ok", true}}
+                          : error("config file did not load, see the log");
+
+    } else {
+      response = error("unknown command '" + command + "'");
+    }
+  } catch (const std::exception &failure) {
+    response = error(failure.what());
+  }
+
+  if (logEnabled(LogLevel::DEBUG)) {
+    std::cout << "Admin: " << line << " => " << response.dump() << "\n";
+  }
+  return response.dump();
+}
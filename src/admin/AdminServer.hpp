@@ -0,0 +1,97 @@
+// src/admin/AdminServer.hpp
+
+// ---- AdminServer Usage ---- //
+
+// AdminServer is the local control socket of the running daemon. It
+// listens on a Unix stream socket and speaks JSON lines: one request object
+// per line in, one response object per line out.
+
+// Example:
+// AdminServer::Hooks hooks;
+// hooks.counters = [&] { return AdminServer::Counters{{"packets", n}}; };
+// hooks.reload = [&] { return config_manager.reloadConfig(); };
+// AdminServer admin(config_manager, "/run/lunar-network-daemon.sock", hooks);
+// admin.start();
+
+// $ echo '{"cmd": "get_link", "link": "earth_to_moon"}' |
+//       socat - UNIX-CONNECT:/run/lunar-network-daemon.sock
+// {"ok":true,"link":"earth_to_moon","burst":"auto","values":{...}}
+
+// Commands:
+// {"cmd": "get_link", "link": "<section>"}
+// {"cmd": "set_link", "link": "<section>", "values": {"<field>": 1e-5}}
+// {"cmd": "force_burst", "link": "<section>", "mode": "on|off|auto"}
+// {"cmd": "counters"}
+// {"cmd": "log_level"} or {"cmd": "log_level", "level": "debug"}
+// {"cmd": "reload"}
+// Failures answer {"ok": false, "error": "..."}.
+
+// Requests are handled on the server's own thread. Link changes and forced
+// bursts go through ConfigManager::update(), so packet threads pick up a
+// new immutable snapshot on their next version check and never wait for
+// the admin socket.
+
+// A client that doesn't read its responses, or sends a line longer than
+// MAX_REQUEST_SIZE, is disconnected.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ConfigManager.hpp"
+
+class AdminServer {
+public:
+  using Counters = std::vector<std::pair<std::string, uint64_t>>;
+
+  // Daemon parts the server doesn't own, both may be left empty
+  struct Hooks {
+    std::function<Counters()> counters;
+    std::function<bool()> reload; // returns false if the reload failed
+  };
+
+  // Creates and binds the socket, throws std::runtime_error on failure.
+  // A stale socket file at socket_path is replaced.
+  AdminServer(ConfigManager &config_manager, const std::string &socket_path,
+              Hooks hooks);
+  ~AdminServer();
+
+  AdminServer(const AdminServer &) = delete;
+  AdminServer &operator=(const AdminServer &) = delete;
+
+  void start();
+  void stop();
+
+  // Handles one request line and returns the response line (without the
+  // newline). Used by the server thread, public for tests.
+  std::string handle(const std::string &line);
+
+private:
+  struct Client {
+    int fd;
+    std::string input;
+  };
+
+  void loop();
+
+  // Reads what the client sent and answers every complete line, returns
+  // false once the client should be closed
+  bool serve(Client &client);
+
+  ConfigManager &config_manager_;
+  std::string socket_path_;
+  Hooks hooks_;
+
+  int listen_fd_ = -1;
+  int wake_fd_ = -1; // eventfd, wakes the poll loop on stop()
+  std::vector<Client> clients_;
+
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
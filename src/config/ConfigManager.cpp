@@ -1,10 +1,18 @@
 // src/config/ConfigManager.cpp
 
 #include "ConfigManager.hpp"
+#include "Probes.hpp"
+#include "ScenarioTimeline.hpp"
 #include "configs.hpp"
+#include <algorithm>
+#include <cmath>
+#include <arpa/inet.h>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <mutex>
+#include <tuple>
+#include <net/if.h>
 #include <nlohmann/json.hpp>
 
 // Anonymous namespace (to avoid cluttering global namespace)
@@ -20,61 +28,219 @@ void loadLinkProperties(const nm::json &j, Config::LinkProperties &props,
 void loadSection(const nm::json &j, const std::string &sectionName,
                  Config::LinkProperties &target,
                  const Config::LinkProperties &defaults);
+uint32_t parseNode(const std::string &ip);
+uint32_t linkForNodes(uint32_t src_node, uint32_t dst_node);
+Config::ProfileOverride parseOverride(const nm::json &j, uint32_t link,
+                                      uint32_t node_a, uint32_t node_b);
+void loadOverrides(const nm::json &j, Config &config);
+void loadSimulation(const nm::json &j, Config::Simulation &simulation);
+void loadEphemeris(const nm::json &j, Config::Ephemeris &ephemeris);
+void loadPipeline(const nm::json &j, Config::Pipeline &pipeline);
+void loadQueue(const nm::json &j, Config::Queue &queue);
+void loadFlows(const nm::json &j, Config::Flows &flows);
+void loadAdmin(const nm::json &j, Config::Admin &admin);
+void loadImpairment(const nm::json &j, Config::Impairment &impairment);
+void loadDecisionLog(const nm::json &j, Config::DecisionLog &decision_log);
+void loadFidelity(const nm::json &j, Config::Fidelity &fidelity);
+void loadShards(const nm::json &j, Config::Shards &shards);
+void loadInterfaces(const nm::json &j, Config &config);
+bool validInterfaceName(const std::string &name);
+void loadXdp(const nm::json &j, Config &config);
+void loadOffload(const nm::json &j, Config &config);
+void loadShedding(const nm::json &j, Config::Shedding &shedding);
+void applyRuntimeProfile(const std::string &profile, Config::Runtime &runtime);
+void loadRuntime(const nm::json &j, const std::string &profile_override,
+                 Config::Runtime &runtime);
+void loadScenario(const nm::json &j, Config::Scenario &scenario);
+void applyOverride(Config::LinkProperties &props,
+                   const Config::ProfileOverride &entry);
+// Override combination a profile is resolved from: the interface whose
+// link overrides apply (UINT32_MAX for none), the link and the node and pair
+// overrides applied on top
+using ProfileKey = std::tuple<uint32_t, uint32_t, std::vector<uint32_t>>;
+using ProfileIds = std::map<ProfileKey, uint16_t>;
+ProfileIds resolveProfiles(Config &config, const ProfileIds *base = nullptr);
+void compileScenario(Config &config, const ProfileIds &base);
+
 } // namespace
 
-ConfigManager::ConfigManager(const std::string &config_file)
-    : config_file_(config_file) {
+Config::FaultPlan Config::FaultPlan::compile(const LinkProperties &props) {
+  FaultPlan plan{};
+  plan.ber_mean = props.base_bit_error_rate;
+  plan.ber_stddev = props.bit_error_rate_stddev;
+  plan.ber_log1m = std::log1p(-std::min(plan.ber_mean, 1.0));
+  plan.rate_bps = props.throughput_limit_mbps * 1e6;
+  plan.bucket_bits = plan.rate_bps * THROUGHPUT_BUCKET_MS / 1000.0;
+  plan.corrupts = props.base_bit_error_rate > 0;
+  plan.bursts = props.base_packet_loss_burst_freq_per_minute > 0;
+  return plan;
+}
+
+uint16_t Config::profileFor(uint32_t src_ip, uint32_t dst_ip,
+                            uint32_t interface) const {
+  return profile_index[profileCell(src_ip, dst_ip, interface)];
+}
+
+size_t Config::profileCell(uint32_t src_ip, uint32_t dst_ip,
+                           uint32_t interface) const {
+  size_t plane = interface < interfaces.size() ? interface : 0;
+  return (plane * NODE_SLOTS + nodeIndex(src_ip)) * NODE_SLOTS +
+         nodeIndex(dst_ip);
+}
+
+Config::LinkProperties Config::interfaceLink(uint32_t interface,
+                                             uint32_t index) const {
+  LinkProperties props = link(index);
+  if (interface < interfaces.size()) {
+    for (const auto &entry : interfaces[interface].overrides) {
+      if (entry.link == index) {
+        applyOverride(props, entry);
+      }
+    }
+  }
+  return props;
+}
+
+Config::LinkProperties &Config::link(uint32_t index) {
+  switch (index) {
+  case LINK_EARTH_TO_EARTH:
+    return earth_to_earth;
+  case LINK_EARTH_TO_MOON:
+    return earth_to_moon;
+  case LINK_MOON_TO_EARTH:
+    return moon_to_earth;
+  case LINK_MOON_TO_MOON:
+    return moon_to_moon;
+  default:
+    throw std::out_of_range("Unknown link index.");
+  }
+}
+
+const Config::LinkProperties &Config::link(uint32_t index) const {
+  return const_cast<Config *>(this)->link(index);
+}
+
+uint32_t Config::userspaceLinks() const {
+  if (impairment.chain == Impairment::Chain::MARK_ONLY) {
+    return 0;
+  }
+  bool corrupts = impairment.chain == Impairment::Chain::FULL;
+
+  uint32_t links = 0;
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    if (forced_bursts[link] == BurstForce::ON) {
+      links |= 1u << link;
+    }
+  }
+  // the feed's bit error rate is applied per packet
+  if (!ephemeris.csv.empty()) {
+    links |= ephemeris.link_mask;
+  }
+  // events that only move the latency are netem's
+  for (const ScenarioEvent &event : scenario.events) {
+    if (event.outage || (event.field_mask & ~LATENCY_FIELD_MASK) != 0) {
+      links |= event.link_mask;
+    }
+  }
+  // Every node pair of every interface, an override that impairs one node
+  // keeps its whole link in userspace
+  for (size_t cell = 0; cell < profile_index.size(); ++cell) {
+    uint32_t dst_node = static_cast<uint32_t>(cell % NODE_SLOTS);
+    uint32_t src_node = static_cast<uint32_t>(cell / NODE_SLOTS % NODE_SLOTS);
+    if (src_node == NO_NODE || dst_node == NO_NODE) {
+      continue;
+    }
+    const FaultPlan &plan = plans[profile_index[cell]];
+    if (plan.bursts || plan.rate_bps > 0 || (corrupts && plan.corrupts)) {
+      links |= 1u << linkForNodes(src_node, dst_node);
+    }
+  }
+  // tc netem impairs these by itself
+  return links & ~offload.link_mask;
+}
+
+ConfigManager::ConfigManager(const std::string &config_file,
+                             const std::string &runtime_profile)
+    : config_file_(config_file), runtime_profile_(runtime_profile) {
   try {
-    loadConfig();
+    config_ = loadConfig();
   } catch (const std::exception &error) {
     std::cerr << "No previous configuration available: " << error.what()
               << "\nUsing default configuration.\n";
-    loadDefaultConfig();
+    config_ = loadDefaultConfig();
   }
 }
 
 Config ConfigManager::getConfig() const {
   // shared lock, multiple threads can read concurrently
   std::shared_lock<std::shared_mutex> lock(config_mutex_);
+  return *config_;
+}
+
+std::shared_ptr<const Config> ConfigManager::getSnapshot() const {
+  // shared lock only guards the pointer copy, not the config itself
+  std::shared_lock<std::shared_mutex> lock(config_mutex_);
   return config_;
 }
 
+uint64_t ConfigManager::version() const {
+  return version_.load(std::memory_order_acquire);
+}
+
 Config::LinkProperties ConfigManager::getEToEConfig() {
   // shared lock, multiple threads can read concurrently
   std::shared_lock<std::shared_mutex> lock(config_mutex_);
-  return config_.earth_to_earth;
+  return config_->earth_to_earth;
 }
 
 Config::LinkProperties ConfigManager::getEToMConfig() {
   // shared lock, multiple threads can read concurrently
   std::shared_lock<std::shared_mutex> lock(config_mutex_);
-  return config_.earth_to_moon;
+  return config_->earth_to_moon;
 }
 
 Config::LinkProperties ConfigManager::getMToEConfig() {
   // shared lock, multiple threads can read concurrently
   std::shared_lock<std::shared_mutex> lock(config_mutex_);
-  return config_.moon_to_earth;
+  return config_->moon_to_earth;
 }
 
 Config::LinkProperties ConfigManager::getMToMConfig() {
   // shared lock, multiple threads can read concurrently
   std::shared_lock<std::shared_mutex> lock(config_mutex_);
-  return config_.moon_to_moon;
+  return config_->moon_to_moon;
 }
 
-void ConfigManager::reloadConfig() {
-  // Use an exclusive lock while updating the configuration.
-  std::unique_lock<std::shared_mutex> lock(config_mutex_);
+bool ConfigManager::reloadConfig() {
+  std::lock_guard<std::mutex> writer(update_mutex_);
   try {
-    loadConfig();
+    // Parse and resolve outside the lock, readers keep the old snapshot
+    install(loadConfig());
+    return true;
   } catch (const std::exception &error) {
     std::cerr << "Reload failed: " << error.what()
               << "\nKeeping previous configuration.\n";
+    return false;
   }
 }
 
-void ConfigManager::loadConfig() {
+void ConfigManager::update(const std::function<void(Config &)> &change) {
+  std::lock_guard<std::mutex> writer(update_mutex_);
+  auto config = std::make_shared<Config>(*getSnapshot());
+  change(*config);
+  compileScenario(*config, resolveProfiles(*config));
+  install(std::move(config));
+}
+
+void ConfigManager::install(std::shared_ptr<const Config> config) {
+  // Use an exclusive lock while swapping the configuration.
+  std::unique_lock<std::shared_mutex> lock(config_mutex_);
+  config_ = std::move(config);
+  uint64_t version = version_.fetch_add(1, std::memory_order_release) + 1;
+  LND_PROBE1(config_reloaded, version);
+}
+
+std::shared_ptr<const Config> ConfigManager::loadConfig() const {
   std::ifstream infile(config_file_);
   if (!infile) {
     std::cerr << "Error opening config file: " << config_file_
@@ -86,13 +252,38 @@ void ConfigManager::loadConfig() {
     nm::json j;
     infile >> j;
 
-    loadSection(j, "earth_to_earth", config_.earth_to_earth,
+    auto config = std::make_shared<Config>();
+    loadSection(j, "earth_to_earth", config->earth_to_earth,
                 DEFAULT_EARTH_TO_EARTH);
-    loadSection(j, "earth_to_moon", config_.earth_to_moon,
+    loadSection(j, "earth_to_moon", config->earth_to_moon,
                 DEFAULT_EARTH_TO_MOON);
-    loadSection(j, "moon_to_earth", config_.moon_to_earth,
+    loadSection(j, "moon_to_earth", config->moon_to_earth,
                 DEFAULT_MOON_TO_EARTH);
-    loadSection(j, "moon_to_moon", config_.moon_to_moon, DEFAULT_MOON_TO_MOON);
+    loadSection(j, "moon_to_moon", config->moon_to_moon, DEFAULT_MOON_TO_MOON);
+    loadOverrides(j, *config);
+    loadSimulation(j, config->simulation);
+    loadEphemeris(j, config->ephemeris);
+    loadPipeline(j, config->pipeline);
+    loadQueue(j, config->queue);
+    loadFlows(j, config->flows);
+    loadAdmin(j, config->admin);
+    loadImpairment(j, config->impairment);
+    loadDecisionLog(j, config->decision_log);
+    loadFidelity(j, config->fidelity);
+    loadShards(j, config->shards);
+    loadInterfaces(j, *config);
+    loadXdp(j, *config);
+    loadOffload(j, *config);
+    loadScenario(j, config->scenario);
+    loadShedding(j, config->shedding);
+    loadRuntime(j, runtime_profile_, config->runtime);
+    if (j.contains("log_level")) {
+      config->log_level = parseLogLevel(j["log_level"].get<std::string>());
+    }
+    config->stats_interval_s =
+        j.value("stats_interval_s", config->stats_interval_s);
+    compileScenario(*config, resolveProfiles(*config));
+    return config;
   } catch (const std::exception &error) {
     std::cerr << "Error parsing config file: " << error.what()
               << ".\nUsing previous configuration if available.\n"
@@ -102,11 +293,17 @@ void ConfigManager::loadConfig() {
   }
 }
 
-void ConfigManager::loadDefaultConfig() {
-  config_.earth_to_earth = DEFAULT_EARTH_TO_EARTH;
-  config_.earth_to_moon = DEFAULT_EARTH_TO_MOON;
-  config_.moon_to_earth = DEFAULT_MOON_TO_EARTH;
-  config_.moon_to_moon = DEFAULT_MOON_TO_MOON;
+std::shared_ptr<const Config> ConfigManager::loadDefaultConfig() const {
+  auto config = std::make_shared<Config>();
+  loadRuntime(nm::json::object(), runtime_profile_, config->runtime);
+  loadShedding(nm::json::object(), config->shedding);
+  config->earth_to_earth = DEFAULT_EARTH_TO_EARTH;
+  config->earth_to_moon = DEFAULT_EARTH_TO_MOON;
+  config->moon_to_earth = DEFAULT_MOON_TO_EARTH;
+  config->moon_to_moon = DEFAULT_MOON_TO_MOON;
+  loadInterfaces(nm::json::object(), *config);
+  resolveProfiles(*config);
+  return config;
 }
 
 // ---- Helper function implementations ---- //
@@ -159,6 +356,11 @@ void loadLinkProperties(const nm::json &j, Config::LinkProperties &props,
   props.base_packet_loss_burst_duration_stddev =
       getDoubleWithLog(j, "base_packet_loss_burst_duration_stddev",
                        defaults.base_packet_loss_burst_duration_stddev);
+  props.throughput_limit_mbps = j.value("throughput_limit_mbps",
+                                        defaults.throughput_limit_mbps);
+  if (props.throughput_limit_mbps < 0) {
+    throw std::runtime_error("throughput_limit_mbps must not be negative.");
+  }
 }
 
 // Helper function: Load a configuration section
@@ -172,4 +374,745 @@ void loadSection(const nm::json &j, const std::string &sectionName,
     throw std::runtime_error(sectionName + " section missing in config file.");
   }
 }
+
+// Helper function: Convert a dotted IPv4 string into a dense node index
+uint32_t parseNode(const std::string &ip) {
+  in_addr addr{};
+  if (inet_pton(AF_INET, ip.c_str(), &addr) != 1) {
+    throw std::runtime_error("Invalid node address '" + ip + "'.");
+  }
+  uint32_t node = nodeIndex(ntohl(addr.s_addr));
+  if (node == NO_NODE) {
+    throw std::runtime_error("Node address '" + ip +
+                             "' is outside the rover and base ranges.");
+  }
+  return node;
+}
+
+// Helper function: Link section implied by the endpoints of a node pair
+uint32_t linkForNodes(uint32_t src_node, uint32_t dst_node) {
+  if (isRoverNode(src_node))
+    return isRoverNode(dst_node) ? LINK_MOON_TO_MOON : LINK_MOON_TO_EARTH;
+  return isRoverNode(dst_node) ? LINK_EARTH_TO_MOON : LINK_EARTH_TO_EARTH;
+}
+
+// Helper function: Collect the fields present in an override object
+Config::ProfileOverride parseOverride(const nm::json &j, uint32_t link,
+                                      uint32_t node_a, uint32_t node_b) {
+  Config::ProfileOverride entry{link, node_a, node_b, 0, {}};
+  for (size_t i = 0; i < std::size(LINK_FIELDS); ++i) {
+    if (j.contains(LINK_FIELDS[i].name)) {
+      entry.field_mask |= 1u << i;
+      entry.values.*LINK_FIELDS[i].member =
+          j[LINK_FIELDS[i].name].get<double>();
+    }
+  }
+  return entry;
+}
+
+// Helper function: Load the optional node_overrides and pair_overrides
+// sections. node_overrides is keyed by node address then link section,
+// pair_overrides is a list of objects with "src" and "dst" addresses.
+void loadOverrides(const nm::json &j, Config &config) {
+  if (j.contains("node_overrides")) {
+    for (auto &[ip, sections] : j["node_overrides"].items()) {
+      uint32_t node = parseNode(ip);
+      for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+        if (sections.contains(LINK_SECTIONS[link])) {
+          config.overrides.push_back(parseOverride(
+              sections[LINK_SECTIONS[link]], link, node, NO_NODE));
+        }
+      }
+    }
+  }
+
+  if (j.contains("pair_overrides")) {
+    for (auto &pair : j["pair_overrides"]) {
+      uint32_t src = parseNode(pair.at("src").get<std::string>());
+      uint32_t dst = parseNode(pair.at("dst").get<std::string>());
+      config.overrides.push_back(
+          parseOverride(pair, linkForNodes(src, dst), src, dst));
+    }
+  }
+}
+
+// Helper function: Load the optional simulation section, missing keys keep
+// the real-time defaults
+void loadSimulation(const nm::json &j, Config::Simulation &simulation) {
+  if (!j.contains("simulation"))
+    return;
+  auto &sec = j["simulation"];
+  simulation.deterministic =
+      sec.value("deterministic", simulation.deterministic);
+  simulation.seed = sec.value("seed", simulation.seed);
+  simulation.time_scale = sec.value("time_scale", simulation.time_scale);
+  if (simulation.time_scale <= 0) {
+    throw std::runtime_error("simulation.time_scale must be positive.");
+  }
+}
+
+// Helper function: Load the optional ephemeris section, the table itself is
+// compiled and mapped by EphemerisTable
+void loadEphemeris(const nm::json &j, Config::Ephemeris &ephemeris) {
+  if (!j.contains("ephemeris"))
+    return;
+  auto &sec = j["ephemeris"];
+  ephemeris.csv = sec.value("csv", ephemeris.csv);
+
+  std::vector<std::string> links =
+      sec.value("links", std::vector<std::string>{"earth_to_moon",
+                                                  "moon_to_earth"});
+  ephemeris.link_mask = 0;
+  for (const auto &link : links) {
+    auto it = std::find(std::begin(LINK_SECTIONS), std::end(LINK_SECTIONS),
+                        link);
+    if (it == std::end(LINK_SECTIONS)) {
+      throw std::runtime_error("Unknown ephemeris link '" + link + "'.");
+    }
+    ephemeris.link_mask |= 1u << (it - std::begin(LINK_SECTIONS));
+  }
+
+  ephemeris.start_time = sec.value("start_time", ephemeris.start_time);
+  ephemeris.step_s = sec.value("step_s", ephemeris.step_s);
+  ephemeris.update_interval_s =
+      sec.value("update_interval_s", ephemeris.update_interval_s);
+  ephemeris.reference_range_km =
+      sec.value("reference_range_km", ephemeris.reference_range_km);
+  ephemeris.reference_ebn0_db =
+      sec.value("reference_ebn0_db", ephemeris.reference_ebn0_db);
+  ephemeris.zenith_loss_db =
+      sec.value("zenith_loss_db", ephemeris.zenith_loss_db);
+  ephemeris.min_elevation_deg =
+      sec.value("min_elevation_deg", ephemeris.min_elevation_deg);
+  ephemeris.processing_delay_ms =
+      sec.value("processing_delay_ms", ephemeris.processing_delay_ms);
+  ephemeris.max_bit_error_rate =
+      sec.value("max_bit_error_rate", ephemeris.max_bit_error_rate);
+}
+
+// Helper function: Load the optional pipeline section
+void loadPipeline(const nm::json &j, Config::Pipeline &pipeline) {
+  if (!j.contains("pipeline"))
+    return;
+  auto &sec = j["pipeline"];
+  pipeline.workers = sec.value("workers", pipeline.workers);
+  pipeline.ring_size = sec.value("ring_size", pipeline.ring_size);
+  pipeline.slot_size = sec.value("slot_size", pipeline.slot_size);
+  pipeline.verdict_batch = sec.value("verdict_batch", pipeline.verdict_batch);
+  if (pipeline.ring_size == 0 || pipeline.slot_size < 64 ||
+      pipeline.verdict_batch == 0) {
+    throw std::runtime_error("Invalid pipeline section.");
+  }
+}
+
+// Helper function: Load the optional queue section
+void loadQueue(const nm::json &j, Config::Queue &queue) {
+  if (!j.contains("queue"))
+    return;
+  auto &sec = j["queue"];
+  queue.backend = sec.value("backend", queue.backend);
+  queue.gso = sec.value("gso", queue.gso);
+  queue.segment_mtu = sec.value("segment_mtu", queue.segment_mtu);
+  queue.fail_open = sec.value("fail_open", queue.fail_open);
+  queue.max_len = sec.value("max_len", queue.max_len);
+  queue.no_enobufs = sec.value("no_enobufs", queue.no_enobufs);
+  queue.kernel_timestamps =
+      sec.value("kernel_timestamps", queue.kernel_timestamps);
+  queue.compensate_delay =
+      sec.value("compensate_delay", queue.compensate_delay);
+  queue.kernel_bypass = sec.value("kernel_bypass", queue.kernel_bypass);
+  queue.socket_buffer = sec.value("socket_buffer", queue.socket_buffer);
+  queue.max_socket_buffer =
+      sec.value("max_socket_buffer", queue.max_socket_buffer);
+  if (queue.backend != "library" && queue.backend != "netlink") {
+    throw std::runtime_error("queue.backend must be library or netlink.");
+  }
+  if (queue.segment_mtu < 576) {
+    throw std::runtime_error("queue.segment_mtu must be at least 576.");
+  }
+  // the kernel doubles the size into an int
+  if (queue.socket_buffer < 65536 ||
+      queue.max_socket_buffer < queue.socket_buffer ||
+      queue.max_socket_buffer > (1u << 30)) {
+    throw std::runtime_error("queue.socket_buffer must be at least 65536 and "
+                             "at most max_socket_buffer, at most 1 GiB.");
+  }
+}
+
+// Helper function: Load the optional flows section
+void loadFlows(const nm::json &j, Config::Flows &flows) {
+  if (!j.contains("flows"))
+    return;
+  auto &sec = j["flows"];
+  flows.enabled = sec.value("enabled", flows.enabled);
+  flows.capacity = sec.value("capacity", flows.capacity);
+  flows.idle_timeout_s = sec.value("idle_timeout_s", flows.idle_timeout_s);
+  flows.top_n = sec.value("top_n", flows.top_n);
+  if (flows.capacity == 0 || flows.capacity > (1u << 24) ||
+      flows.idle_timeout_s <= 0) {
+    throw std::runtime_error("Invalid flows section.");
+  }
+}
+
+// Helper function: Load the optional admin section
+void loadAdmin(const nm::json &j, Config::Admin &admin) {
+  if (!j.contains("admin"))
+    return;
+  auto &sec = j["admin"];
+  admin.enabled = sec.value("enabled", admin.enabled);
+  admin.socket_path = sec.value("socket_path", admin.socket_path);
+  if (admin.enabled && admin.socket_path.empty()) {
+    throw std::runtime_error("admin.socket_path must not be empty.");
+  }
+}
+
+// Helper function: Load the optional impairment section
+void loadImpairment(const nm::json &j, Config::Impairment &impairment) {
+  if (!j.contains("impairment"))
+    return;
+  auto &sec = j["impairment"];
+  if (!sec.contains("chain"))
+    return;
+  std::string name = sec["chain"].get<std::string>();
+  auto it = std::find(std::begin(IMPAIRMENT_CHAINS),
+                      std::end(IMPAIRMENT_CHAINS), name);
+  if (it == std::end(IMPAIRMENT_CHAINS)) {
+    throw std::runtime_error("Unknown impairment chain '" + name + "'.");
+  }
+  impairment.chain = static_cast<Config::Impairment::Chain>(
+      it - std::begin(IMPAIRMENT_CHAINS));
+}
+
+// Helper function: Load the optional decision_log section
+void loadDecisionLog(const nm::json &j, Config::DecisionLog &decision_log) {
+  if (!j.contains("decision_log"))
+    return;
+  auto &sec = j["decision_log"];
+  decision_log.enabled = sec.value("enabled", decision_log.enabled);
+  decision_log.directory = sec.value("directory", decision_log.directory);
+  decision_log.segment_mb = sec.value("segment_mb", decision_log.segment_mb);
+  decision_log.max_segments =
+      sec.value("max_segments", decision_log.max_segments);
+  if (decision_log.directory.empty() || decision_log.segment_mb == 0 ||
+      decision_log.segment_mb > 4096) {
+    throw std::runtime_error("Invalid decision_log section.");
+  }
+}
+
+// Helper function: Load the optional fidelity section
+void loadFidelity(const nm::json &j, Config::Fidelity &fidelity) {
+  if (!j.contains("fidelity"))
+    return;
+  auto &sec = j["fidelity"];
+  fidelity.enabled = sec.value("enabled", fidelity.enabled);
+  fidelity.tolerance = sec.value("tolerance", fidelity.tolerance);
+  fidelity.min_samples = sec.value("min_samples", fidelity.min_samples);
+  if (fidelity.tolerance <= 0) {
+    throw std::runtime_error("fidelity.tolerance must be positive.");
+  }
+}
+
+// Helper function: Load the optional shards section. The shared memory name
+// is a single "/name" component, see shm_open(3).
+void loadShards(const nm::json &j, Config::Shards &shards) {
+  if (!j.contains("shards"))
+    return;
+  auto &sec = j["shards"];
+  shards.count = sec.value("count", shards.count);
+  shards.shm_name = sec.value("shm_name", shards.shm_name);
+  shards.restart_delay_ms =
+      sec.value("restart_delay_ms", shards.restart_delay_ms);
+  if (shards.count > MAX_SHARDS || shards.shm_name.size() < 2 ||
+      shards.shm_name[0] != '/' ||
+      shards.shm_name.find('/', 1) != std::string::npos) {
+    throw std::runtime_error("Invalid shards section.");
+  }
+}
+
+// Helper function: Load the optional interfaces list, one interface
+// WG_INTERFACE on QUEUE_NUM without it. queue defaults to the one after the
+// previous interface's queues. With shards every interface takes
+// shards.count queues from its queue on, these ranges must not overlap.
+void loadInterfaces(const nm::json &j, Config &config) {
+  config.interfaces.clear();
+  if (!j.contains("interfaces")) {
+    config.interfaces.push_back({WG_INTERFACE, QUEUE_NUM, {}});
+    return;
+  }
+
+  uint32_t queues = std::max<uint32_t>(config.shards.count, 1);
+  for (const auto &entry : j["interfaces"]) {
+    Config::Interface interface;
+    interface.name = entry.at("name").get<std::string>();
+    // by default right behind the queues of the previous interface
+    uint32_t queue = entry.value(
+        "queue", QUEUE_NUM + static_cast<uint32_t>(config.interfaces.size()) *
+                                 queues);
+    if (!validInterfaceName(interface.name) ||
+        queue + queues - 1 > UINT16_MAX) {
+      throw std::runtime_error("Invalid interface '" + interface.name +
+                               "'.");
+    }
+    interface.queue = static_cast<uint16_t>(queue);
+
+    for (const auto &other : config.interfaces) {
+      if (other.name == interface.name) {
+        throw std::runtime_error("Interface '" + interface.name +
+                                 "' listed twice.");
+      }
+      if (interface.queue < other.queue + queues &&
+          other.queue < interface.queue + queues) {
+        throw std::runtime_error("Interfaces '" + other.name + "' and '" +
+                                 interface.name + "' share NFQUEUE numbers.");
+      }
+    }
+
+    if (entry.contains("links")) {
+      const auto &sections = entry["links"];
+      for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+        if (sections.contains(LINK_SECTIONS[link])) {
+          interface.overrides.push_back(parseOverride(
+              sections[LINK_SECTIONS[link]], link, NO_NODE, NO_NODE));
+        }
+      }
+    }
+    config.interfaces.push_back(std::move(interface));
+  }
+
+  if (config.interfaces.empty() ||
+      config.interfaces.size() > MAX_INTERFACES) {
+    throw std::runtime_error("interfaces must list 1 to " +
+                             std::to_string(MAX_INTERFACES) + " interfaces.");
+  }
+}
+
+// Helper function: Interface names end up in tc and iptables command
+// lines, only interface name characters are accepted
+bool validInterfaceName(const std::string &name) {
+  return !name.empty() && name.size() < IFNAMSIZ &&
+         name.find_first_not_of(
+             "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+             "_.-") == std::string::npos;
+}
+
+// Helper function: Load the optional xdp section. The frame size must be a
+// power of two the kernel accepts as UMEM chunk size, and there have to be
+// enough frames to keep both fill rings full while others are delayed.
+void loadXdp(const nm::json &j, Config &config) {
+  if (!j.contains("xdp"))
+    return;
+  auto &sec = j["xdp"];
+  Config::Xdp &xdp = config.xdp;
+  xdp.enabled = sec.value("enabled", xdp.enabled);
+  xdp.ports = sec.value("ports", xdp.ports);
+  xdp.queue_id = sec.value("queue_id", xdp.queue_id);
+  xdp.frames = sec.value("frames", xdp.frames);
+  xdp.frame_size = sec.value("frame_size", xdp.frame_size);
+  xdp.ring_size = sec.value("ring_size", xdp.ring_size);
+  xdp.mode = sec.value("mode", xdp.mode);
+  xdp.zero_copy = sec.value("zero_copy", xdp.zero_copy);
+  xdp.batch = sec.value("batch", xdp.batch);
+  if (!xdp.enabled)
+    return;
+
+  if (xdp.ports.size() != 2 || xdp.ports[0] == xdp.ports[1] ||
+      !validInterfaceName(xdp.ports[0]) || !validInterfaceName(xdp.ports[1])) {
+    throw std::runtime_error("xdp.ports must name two interfaces.");
+  }
+  if ((xdp.frame_size != 2048 && xdp.frame_size != 4096) ||
+      xdp.ring_size < 64 || (xdp.ring_size & (xdp.ring_size - 1)) != 0 ||
+      xdp.frames < 4 * xdp.ring_size || xdp.batch == 0 ||
+      xdp.batch > xdp.ring_size ||
+      (xdp.mode != "generic" && xdp.mode != "native")) {
+    throw std::runtime_error("Invalid xdp section.");
+  }
+  if (config.shards.count > 0) {
+    throw std::runtime_error("xdp does not run sharded, set shards.count "
+                             "to 0.");
+  }
+}
+
+// Helper function: Load the optional offload section. Offloaded packets
+// must not reach the queue as well, they would be impaired twice.
+void loadOffload(const nm::json &j, Config &config) {
+  if (!j.contains("offload"))
+    return;
+  auto &sec = j["offload"];
+  Config::Offload &offload = config.offload;
+  offload.distribution = sec.value("distribution", offload.distribution);
+  offload.packet_rate_pps =
+      sec.value("packet_rate_pps", offload.packet_rate_pps);
+  offload.packet_bytes = sec.value("packet_bytes", offload.packet_bytes);
+
+  offload.link_mask = 0;
+  for (const std::string &name :
+       sec.value("links", std::vector<std::string>{})) {
+    auto section = std::find(std::begin(LINK_SECTIONS),
+                             std::end(LINK_SECTIONS), name);
+    if (section == std::end(LINK_SECTIONS)) {
+      throw std::runtime_error("Unknown link '" + name + "' in offload.");
+    }
+    offload.link_mask |= 1u << (section - std::begin(LINK_SECTIONS));
+  }
+
+  if ((offload.distribution != "normal" && offload.distribution != "pareto" &&
+       offload.distribution != "paretonormal") ||
+      offload.packet_rate_pps <= 0 || offload.packet_bytes < 20) {
+    throw std::runtime_error("Invalid offload section.");
+  }
+  if (offload.link_mask != 0 &&
+      (!config.queue.kernel_bypass || config.xdp.enabled)) {
+    throw std::runtime_error("offload.links need queue.kernel_bypass and tc "
+                             "netem, not xdp.");
+  }
+}
+
+// Helper function: Load the optional scenario section and the event file
+// it names. An event targets "link" (one section name) or "links" (a list,
+// default all) and optionally one "node" address, and either "set"s link
+// fields, forces an "outage", or both.
+void loadScenario(const nm::json &j, Config::Scenario &scenario) {
+  if (!j.contains("scenario"))
+    return;
+  scenario.file = j["scenario"].value("file", scenario.file);
+  if (scenario.file.empty())
+    return;
+
+  std::ifstream infile(scenario.file);
+  if (!infile) {
+    throw std::runtime_error("Cannot open scenario file " + scenario.file);
+  }
+  nm::json file;
+  infile >> file;
+
+  for (const auto &entry : file.at("events")) {
+    Config::ScenarioEvent event{};
+    event.name = entry.value("name", "event " + std::to_string(
+                                                    scenario.events.size()));
+    event.at_s = entry.at("at_s").get<double>();
+    event.duration_s = entry.value("duration_s", HUGE_VAL);
+    if (event.at_s < 0 || event.duration_s <= 0) {
+      throw std::runtime_error("Scenario event '" + event.name +
+                               "' needs at_s >= 0 and duration_s > 0.");
+    }
+
+    std::vector<std::string> links;
+    if (entry.contains("link")) {
+      links.push_back(entry["link"].get<std::string>());
+    } else {
+      links = entry.value("links", std::vector<std::string>(
+                                       std::begin(LINK_SECTIONS),
+                                       std::end(LINK_SECTIONS)));
+    }
+    for (const auto &link : links) {
+      auto it = std::find(std::begin(LINK_SECTIONS), std::end(LINK_SECTIONS),
+                          link);
+      if (it == std::end(LINK_SECTIONS)) {
+        throw std::runtime_error("Unknown scenario link '" + link + "'.");
+      }
+      event.link_mask |= 1u << (it - std::begin(LINK_SECTIONS));
+    }
+
+    event.node = entry.contains("node")
+                     ? parseNode(entry["node"].get<std::string>())
+                     : NO_NODE;
+    if (entry.contains("set")) {
+      Config::ProfileOverride fields =
+          parseOverride(entry["set"], 0, NO_NODE, NO_NODE);
+      event.field_mask = fields.field_mask;
+      event.values = fields.values;
+    }
+    event.outage = entry.value("outage", false);
+    if (event.field_mask == 0 && !event.outage) {
+      throw std::runtime_error("Scenario event '" + event.name +
+                               "' neither sets fields nor forces an outage.");
+    }
+    scenario.events.push_back(std::move(event));
+  }
+}
+
+// Helper function: Load the optional shedding section, by default only
+// earth to earth traffic is ever shed
+void loadShedding(const nm::json &j, Config::Shedding &shedding) {
+  const nm::json sec =
+      j.contains("shedding") ? j["shedding"] : nm::json::object();
+  shedding.enabled = sec.value("enabled", shedding.enabled);
+  shedding.backlog_watermark =
+      sec.value("backlog_watermark", shedding.backlog_watermark);
+  shedding.overload_ms = sec.value("overload_ms", shedding.overload_ms);
+  shedding.recover_ms = sec.value("recover_ms", shedding.recover_ms);
+
+  std::vector<std::string> order = sec.value(
+      "shed_order", std::vector<std::string>{LINK_SECTIONS[0]});
+  shedding.shed_order.clear();
+  for (const std::string &name : order) {
+    auto section = std::find(std::begin(LINK_SECTIONS),
+                             std::end(LINK_SECTIONS), name);
+    if (section == std::end(LINK_SECTIONS)) {
+      throw std::runtime_error("Unknown link '" + name + "' in shed_order.");
+    }
+    shedding.shed_order.push_back(
+        static_cast<uint32_t>(section - std::begin(LINK_SECTIONS)));
+  }
+}
+
+// Helper function: Fill in the preset values of a runtime profile
+void applyRuntimeProfile(const std::string &profile, Config::Runtime &runtime) {
+  if (profile == "default") {
+    runtime.realtime_priority = 0;
+    runtime.lock_memory = false;
+    runtime.busy_poll_us = 0;
+    runtime.spin_us = 0;
+    runtime.jitter_probe_ms = 0;
+  } else if (profile == "low_jitter") {
+    runtime.realtime_priority = 50;
+    runtime.lock_memory = true;
+    runtime.busy_poll_us = 50;
+    runtime.spin_us = 200;
+    runtime.jitter_probe_ms = 1.0;
+  } else {
+    throw std::runtime_error("Unknown runtime profile '" + profile + "'.");
+  }
+  runtime.profile = profile;
+}
+
+// Helper function: Load the optional runtime section, a profile given on the
+// command line replaces the one in the file
+void loadRuntime(const nm::json &j, const std::string &profile_override,
+                 Config::Runtime &runtime) {
+  const nm::json sec =
+      j.contains("runtime") ? j["runtime"] : nm::json::object();
+  std::string profile = profile_override.empty()
+                            ? sec.value("profile", runtime.profile)
+                            : profile_override;
+  applyRuntimeProfile(profile, runtime);
+
+  runtime.receive_cpu = sec.value("receive_cpu", runtime.receive_cpu);
+  runtime.worker_cpus = sec.value("worker_cpus", runtime.worker_cpus);
+  runtime.verdict_cpu = sec.value("verdict_cpu", runtime.verdict_cpu);
+  runtime.timer_cpu = sec.value("timer_cpu", runtime.timer_cpu);
+  runtime.realtime_priority =
+      sec.value("realtime_priority", runtime.realtime_priority);
+  runtime.lock_memory = sec.value("lock_memory", runtime.lock_memory);
+  runtime.busy_poll_us = sec.value("busy_poll_us", runtime.busy_poll_us);
+  runtime.spin_us = sec.value("spin_us", runtime.spin_us);
+  runtime.jitter_probe_ms =
+      sec.value("jitter_probe_ms", runtime.jitter_probe_ms);
+  if (runtime.realtime_priority < 0 || runtime.realtime_priority > 99) {
+    throw std::runtime_error("runtime.realtime_priority must be in 0..99.");
+  }
+}
+
+// Helper function: Replace the fields of props flagged in the override
+void applyOverride(Config::LinkProperties &props,
+                   const Config::ProfileOverride &entry) {
+  for (size_t f = 0; f < std::size(LINK_FIELDS); ++f) {
+    if (entry.field_mask & (1u << f)) {
+      props.*LINK_FIELDS[f].member = entry.values.*LINK_FIELDS[f].member;
+    }
+  }
+}
+
+// Helper function: Flatten link sections and overrides into config.profiles
+// and config.profile_index. Per-node overrides of the source apply first, then
+// the destination, then directed pair overrides, later ones win per field.
+// Every interface gets its own plane, its link overrides apply before all
+// of those. Cells sharing the same override combination share one profile.
+// Combinations of base keep their id, resolved from this config's sections,
+// new ones are numbered after them. Returns the ids of all combinations.
+ProfileIds resolveProfiles(Config &config, const ProfileIds *base) {
+  const Config::LinkProperties *sections[NUM_LINKS] = {
+      &config.earth_to_earth, &config.earth_to_moon, &config.moon_to_earth,
+      &config.moon_to_moon};
+
+  config.profiles.clear();
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    config.profiles.push_back(*sections[link]);
+  }
+
+  constexpr size_t PLANE = NODE_SLOTS * NODE_SLOTS;
+  size_t planes = std::max<size_t>(config.interfaces.size(), 1);
+  config.profile_index.assign(planes * PLANE, LINK_EARTH_TO_EARTH);
+
+  std::vector<std::vector<uint32_t>> node_overrides(NUM_NODES);
+  std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>>
+      pair_overrides;
+  for (uint32_t i = 0; i < config.overrides.size(); ++i) {
+    const auto &entry = config.overrides[i];
+    if (entry.node_b == NO_NODE) {
+      node_overrides[entry.node_a].push_back(i);
+    } else {
+      pair_overrides[{entry.node_a, entry.node_b}].push_back(i);
+    }
+  }
+
+  auto resolve = [&](const ProfileKey &key) {
+    const auto &[interface, link, applied] = key;
+    Config::LinkProperties props = *sections[link];
+    if (interface != UINT32_MAX) {
+      for (const auto &entry : config.interfaces[interface].overrides) {
+        if (entry.link == link)
+          applyOverride(props, entry);
+      }
+    }
+    for (uint32_t i : applied) {
+      applyOverride(props, config.overrides[i]);
+    }
+    return props;
+  };
+
+  ProfileIds combinations;
+  if (base) {
+    config.profiles.resize(NUM_LINKS + base->size());
+    for (const auto &[key, id] : *base) {
+      combinations.emplace(key, id);
+      config.profiles[id] = resolve(key);
+    }
+  }
+  auto profileOf = [&](uint32_t interface, uint32_t link,
+                       const std::vector<uint32_t> &applied) {
+    auto [it, inserted] =
+        combinations.try_emplace({interface, link, applied},
+                                 static_cast<uint16_t>(config.profiles.size()));
+    if (inserted) {
+      if (config.profiles.size() > UINT16_MAX) {
+        throw std::runtime_error("Too many distinct link profiles.");
+      }
+      config.profiles.push_back(resolve(it->first));
+    }
+    return it->second;
+  };
+
+  std::vector<uint32_t> applied;
+  for (uint32_t plane = 0; plane < planes; ++plane) {
+    // Links this interface changes, and their profile without node or pair
+    // overrides
+    uint32_t own_links = 0;
+    if (plane < config.interfaces.size()) {
+      for (const auto &entry : config.interfaces[plane].overrides) {
+        own_links |= 1u << entry.link;
+      }
+    }
+    uint16_t base[NUM_LINKS];
+    for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+      base[link] = (own_links >> link & 1u)
+                       ? profileOf(plane, link, {})
+                       : static_cast<uint16_t>(link);
+    }
+
+    // Unclassified traffic uses earth to earth
+    uint16_t *cells = config.profile_index.data() + plane * PLANE;
+    std::fill(cells, cells + PLANE, base[LINK_EARTH_TO_EARTH]);
+
+    for (uint32_t src = 0; src < NUM_NODES; ++src) {
+      for (uint32_t dst = 0; dst < NUM_NODES; ++dst) {
+        uint32_t link = linkForNodes(src, dst);
+        uint16_t &cell = cells[src * NODE_SLOTS + dst];
+        cell = base[link];
+
+        applied.clear();
+        for (uint32_t i : node_overrides[src]) {
+          if (config.overrides[i].link == link)
+            applied.push_back(i);
+        }
+        if (dst != src) {
+          for (uint32_t i : node_overrides[dst]) {
+            if (config.overrides[i].link == link)
+              applied.push_back(i);
+          }
+        }
+        if (auto it = pair_overrides.find({src, dst});
+            it != pair_overrides.end()) {
+          applied.insert(applied.end(), it->second.begin(), it->second.end());
+        }
+        if (applied.empty())
+          continue;
+
+        cell = profileOf((own_links >> link & 1u) ? plane : UINT32_MAX, link,
+                         applied);
+      }
+    }
+  }
+
+  config.plans.clear();
+  for (const auto &props : config.profiles) {
+    config.plans.push_back(Config::FaultPlan::compile(props));
+  }
+  return combinations;
+}
+
+// Helper function: Cut the scenario into epochs at every event start and
+// end and resolve the profiles of each epoch with its events applied. Node
+// events become per-node overrides, link wide events change the sections.
+// Profiles keep the ids of base, the combinations of config, so burst and
+// rate limit state keyed by profile id carries over between epochs.
+void compileScenario(Config &config, const ProfileIds &base) {
+  config.timeline = nullptr;
+  const auto &events = config.scenario.events;
+  if (events.empty())
+    return;
+
+  std::vector<double> cuts;
+  for (const auto &event : events) {
+    cuts.push_back(event.at_s);
+    if (std::isfinite(event.duration_s)) {
+      cuts.push_back(event.at_s + event.duration_s);
+    }
+  }
+  std::sort(cuts.begin(), cuts.end());
+  cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+  std::vector<ScenarioTimeline::Epoch> epochs;
+  epochs.push_back({INT64_MIN});
+  for (double cut : cuts) {
+    ScenarioTimeline::Epoch epoch{static_cast<int64_t>(cut * 1e9)};
+    Config resolved = config;
+    bool changes_fields = false;
+
+    for (const auto &event : events) {
+      if (cut < event.at_s || cut >= event.at_s + event.duration_s)
+        continue;
+      epoch.active.push_back(event.name);
+
+      if (event.outage && event.node == NO_NODE) {
+        epoch.outage_links |= event.link_mask;
+      } else if (event.outage) {
+        epoch.outage_nodes.resize(NODE_SLOTS, 0);
+        epoch.outage_nodes[event.node] |=
+            static_cast<uint8_t>(event.link_mask);
+      }
+      if (event.field_mask == 0)
+        continue;
+
+      changes_fields = true;
+      epoch.override_links |= event.link_mask;
+      for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+        if (!(event.link_mask >> link & 1u))
+          continue;
+        if (event.node != NO_NODE) {
+          resolved.overrides.push_back(
+              {link, event.node, NO_NODE, event.field_mask, event.values});
+          continue;
+        }
+        for (size_t f = 0; f < std::size(LINK_FIELDS); ++f) {
+          if (event.field_mask & (1u << f)) {
+            resolved.link(link).*LINK_FIELDS[f].member =
+                event.values.*LINK_FIELDS[f].member;
+          }
+        }
+      }
+    }
+
+    if (changes_fields) {
+      resolveProfiles(resolved, &base);
+      epoch.profiles = std::move(resolved.profiles);
+      epoch.plans = std::move(resolved.plans);
+      if (resolved.profile_index != config.profile_index) {
+        epoch.profile_index = std::move(resolved.profile_index);
+      }
+    }
+    epochs.push_back(std::move(epoch));
+  }
+  config.timeline = std::make_shared<ScenarioTimeline>(std::move(epochs));
+}
 } // namespace
@@ -16,15 +16,59 @@
 // Example:
 // Config::LinkProperties m_to_e = mgr.getMToEConfig();
 
+// getSnapshot() is the cheap getter for the packet path, it returns a shared
+// pointer to the current immutable config instead of copying it.
+// Example:
+// auto config = mgr.getSnapshot();
+// const auto &props = config->profiles[config->profileFor(src_ip, dst_ip)];
+
+// version() changes whenever a new snapshot is installed, packet threads can
+// keep their snapshot and only call getSnapshot() again when it moves.
+
+// Per-node and per-node-pair overrides ("node_overrides" and
+// "pair_overrides" in the JSON file) are resolved at load time into a flat
+// profile array. profiles[0..3] are the four link sections in LinkType order,
+// resolved override combinations follow. Link overrides of an entry in
+// "interfaces" apply to that interface's traffic only, each interface has
+// its own plane of the profile index.
+// Example:
+// uint16_t profile = config->profileFor(src_ip, dst_ip, interface);
+
+// The runtime profile can also be forced from the command line, it then
+// replaces "runtime.profile" from the file.
+// Example:
+// ConfigManager mgr("config/config.json", "low_jitter");
+
 // reloadConfig() can be called when the user wants to update
-// the config values from the JSON file during runtime.
+// the config values from the JSON file during runtime. It returns false and
+// keeps the old config if the file doesn't parse.
 // Example:
 // mgr.reloadConfig();
 
+// update() changes a copy of the current config and installs it the same
+// way, for runtime changes that don't come from the file. A later reload
+// replaces them with the file's values again.
+// Example:
+// mgr.update([](Config &config) {
+//   config.earth_to_moon.base_bit_error_rate = 1e-4;
+// });
+
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <string>
+#include <vector>
+
+#include "Log.hpp"
+
+class ScenarioTimeline;
 
 struct Config {
   struct LinkProperties {
@@ -43,35 +87,387 @@ struct Config {
     double base_packet_loss_burst_duration_ms;
     double base_packet_loss_burst_duration_stddev;
 
+    // Token bucket limit applied in userspace (Mbit/s), 0 => unlimited
+    double throughput_limit_mbps;
+
     auto operator<=>(const LinkProperties &) const = default;
   };
 
+  // Partial LinkProperties for one node or one directed node pair.
+  // Only the fields flagged in field_mask replace the link section's values,
+  // the bit order follows the field order of LinkProperties.
+  struct ProfileOverride {
+    uint32_t link;   // LINK_* index of the link section it applies to
+    uint32_t node_a; // dense node index, see nodeIndex() in configs.hpp
+    uint32_t node_b; // NO_NODE for a per-node override
+    uint32_t field_mask;
+    LinkProperties values;
+  };
+
+  // Optional "simulation" section
+  struct Simulation {
+    // fixed seed from config instead of a random one per run
+    bool deterministic = false;
+    uint64_t seed = 0;
+    // simulated seconds per wall-clock second, see SimClock
+    double time_scale = 1.0;
+  };
+
+  // Optional "ephemeris" section, time-varying latency and BER from a
+  // precomputed range/elevation time series, see EphemerisTable
+  struct Ephemeris {
+    std::string csv; // empty => disabled, static LinkProperties are used
+    uint32_t link_mask = 0; // bit per LINK_* index the table feeds
+    double start_time = 0;  // unix seconds at daemon start, 0 => now
+    double step_s = 1.0;    // resampling step of the compiled table
+    double update_interval_s = 1.0; // how often netem delay is refreshed
+
+    // link budget parameters
+    double reference_range_km = 384400.0;
+    double reference_ebn0_db = 10.0;
+    double zenith_loss_db = 0.5;
+    double min_elevation_deg = 5.0;
+    double processing_delay_ms = 0.0;
+    double max_bit_error_rate = 1e-3;
+  };
+
+  // Optional "pipeline" section, workers == 0 processes packets inline on
+  // the receive thread
+  struct Pipeline {
+    uint32_t workers = 0;
+    uint32_t ring_size = 1024;    // slots in flight across all stages
+    uint32_t slot_size = 2048;    // larger packets are processed inline
+    uint32_t verdict_batch = 64;  // verdicts sent per verdict thread pass
+  };
+
+  // Optional "queue" section. With gso the kernel queues GSO/GRO packets
+  // unsegmented, impairments are then applied per segment_mtu sized
+  // logical segment. backend "netlink" skips libnetfilter_queue and batches
+  // verdicts itself. fail_open lets the kernel accept packets instead of
+  // dropping them when the queue is full. kernel_timestamps times every
+  // packet from when the kernel received it, compensate_delay then takes the
+  // measured time spent queued and in the daemon off the netem delay.
+  // kernel_bypass marks and accepts the links userspaceLinks() leaves out
+  // in iptables, they never reach the queue.
+  struct Queue {
+    std::string backend = "library"; // or "netlink", see NfqSocket
+    bool gso = true;
+    uint32_t segment_mtu = 1420; // wg0 default MTU
+    bool fail_open = true;
+    uint32_t max_len = 4096;  // packets waiting for a verdict in the kernel
+    bool no_enobufs = false;  // NETLINK_NO_ENOBUFS, overflows go unreported
+    bool kernel_timestamps = true;
+    bool compensate_delay = true;
+    bool kernel_bypass = true; // links without userspace work skip the queue
+    // receive buffer of the netlink socket, grown up to max_socket_buffer
+    // when queue messages get lost, see SocketBuffer
+    uint32_t socket_buffer = 1 << 20;
+    uint32_t max_socket_buffer = 64 << 20;
+  };
+
+  // Optional "flows" section. Each processing thread keeps a table of
+  // capacity 5-tuple flows (rounded up to a power of two), flows idle for
+  // idle_timeout_s are reused. top_n flows by drops are printed with the
+  // stats line. The capacity is fixed at startup.
+  struct Flows {
+    bool enabled = true;
+    uint32_t capacity = 4096;
+    double idle_timeout_s = 60.0;
+    uint32_t top_n = 5; // 0 keeps the table but prints nothing
+  };
+
+  // Optional "shedding" section. Under sustained overload impairment is
+  // bypassed for the links in shed_order, first entry first, one more link
+  // per overload_ms of overload and one less per recover_ms of calm.
+  struct Shedding {
+    bool enabled = true;
+    std::vector<uint32_t> shed_order; // link types, resolved from names
+    double backlog_watermark = 0.75;  // pipeline slots in flight
+    double overload_ms = 200.0;
+    double recover_ms = 2000.0;
+  };
+
+  // Optional "runtime" section. "profile" picks a preset ("default" or
+  // "low_jitter"), keys set next to it override the preset. Cpus are -1
+  // (unpinned) unless given.
+  struct Runtime {
+    std::string profile = "default";
+    int receive_cpu = -1;
+    std::vector<int> worker_cpus; // one per pipeline worker, cycled if short
+    int verdict_cpu = -1;
+    int timer_cpu = -1;          // PeriodicTasks thread
+    int realtime_priority = 0;   // SCHED_FIFO priority, 0 keeps SCHED_OTHER
+    bool lock_memory = false;    // mlockall and pre-fault buffers
+    uint32_t busy_poll_us = 0;   // SO_BUSY_POLL on the queue socket
+    uint32_t spin_us = 0;        // receive spins this long before blocking
+    double jitter_probe_ms = 0;  // extra timer wakeups to sample jitter
+  };
+
+  // Optional "admin" section, the JSON lines control socket (see
+  // AdminServer). Read once at startup.
+  struct Admin {
+    bool enabled = true;
+    std::string socket_path = "/run/lunar-network-daemon.sock";
+  };
+
+  // Optional "decision_log" section, a binary record of every impairment
+  // decision (see DecisionLog). Each processing thread writes its own
+  // preallocated segment_mb files in directory, only the newest
+  // max_segments per thread are kept (0 keeps all). Read once at startup.
+  struct DecisionLog {
+    bool enabled = false;
+    std::string directory = "decision-log";
+    uint32_t segment_mb = 16;
+    uint32_t max_segments = 0;
+  };
+
+  // Optional "fidelity" section. Every processing thread measures the bit
+  // error rate, burst loss, burst rate and burst duration it applied per
+  // link (see FidelityMonitor), the stats line shows them next to their
+  // targets. A figure more than tolerance (relative) off its target warns
+  // once it rests on min_samples flips or bursts. Read once at startup.
+  struct Fidelity {
+    bool enabled = true;
+    double tolerance = 0.25;
+    uint32_t min_samples = 30;
+  };
+
+  // Optional "shards" section, count > 0 runs the daemon as a coordinator
+  // and count shard processes (see ShardSupervisor). Shard i owns NFQUEUE
+  // number queue + i of every interface, all of them share state through the
+  // POSIX shared memory segment shm_name (see SharedState). A shard that
+  // exits is restarted after restart_delay_ms. Read once at startup.
+  struct Shards {
+    uint32_t count = 0;
+    std::string shm_name = "/lunar-network-daemon";
+    uint32_t restart_delay_ms = 1000;
+  };
+
+  // One entry of the optional "interfaces" list, a tunnel interface whose
+  // traffic is impaired, e.g. one WireGuard interface per ground station.
+  // Each gets its own NFQUEUE number and tc tree, its "links" overrides
+  // change link section fields for its traffic only (node_a and node_b are
+  // NO_NODE). Without the list the daemon runs on WG_INTERFACE and
+  // QUEUE_NUM. Names and queues are read once at startup.
+  struct Interface {
+    std::string name;
+    uint16_t queue;
+    std::vector<ProfileOverride> overrides;
+  };
+
+  // Optional "xdp" section. enabled takes packets off the two ports with an
+  // XDP program and AF_XDP sockets instead of NFQUEUE (see XdpBridge): what
+  // arrives on one port leaves through the other, impaired and delayed in
+  // userspace, so iptables and tc are not involved. Both ports share frames
+  // UMEM frames of frame_size bytes, which bound the traffic the delay can
+  // hold. mode "generic" works on any device (veth included), "native"
+  // needs driver support, zero_copy additionally needs it for AF_XDP.
+  // Read once at startup.
+  struct Xdp {
+    bool enabled = false;
+    std::vector<std::string> ports; // exactly two when enabled
+    uint32_t queue_id = 0;
+    uint32_t frames = 16384;
+    uint32_t frame_size = 2048; // 2048 or 4096
+    uint32_t ring_size = 2048;  // every ring of both sockets
+    std::string mode = "generic";
+    bool zero_copy = false;
+    uint32_t batch = 64; // descriptors moved per ring operation
+  };
+
+  // Optional "offload" section. The links in "links" are impaired by tc
+  // netem alone, bursts as a Gilbert-Elliott loss model, bit errors as
+  // netem corrupt and jitter from a distribution table, fitted for traffic
+  // of packet_rate_pps packets of packet_bytes (see NetemFit). Their packets
+  // never reach the queue, which needs queue.kernel_bypass. Node overrides
+  // and scenario events other than latency don't apply to them. Read once
+  // at startup.
+  struct Offload {
+    uint32_t link_mask = 0; // LINK_* bits, resolved from names
+    std::string distribution = "normal"; // or "pareto", "paretonormal"
+    double packet_rate_pps = 1000.0;
+    uint32_t packet_bytes = 1420;
+  };
+
+  // Optional "impairment" section, picks the stage chain every packet runs
+  // through (see PacketProcessor). "full" applies everything, "loss_only"
+  // drops but never writes packet data, "mark_only" only classifies and
+  // marks so tc netem still adds the delay. Read once at startup.
+  struct Impairment {
+    enum class Chain : uint8_t { FULL, LOSS_ONLY, MARK_ONLY };
+    Chain chain = Chain::FULL;
+  };
+
+  // What the packet path needs of one profile, compiled with the profile so
+  // nothing is derived per packet. One cache line per profile.
+  struct alignas(64) FaultPlan {
+    // The bit error rate of each segment is max(0, N(ber_mean, ber_stddev)),
+    // flipped bits are ber_log1m geometric gaps apart when ber_stddev is 0
+    double ber_mean;
+    double ber_stddev;
+    double ber_log1m; // log(1 - ber_mean)
+    double rate_bps;    // throughput limit, 0 => unlimited
+    double bucket_bits; // token bucket depth at rate_bps
+    bool corrupts;
+    bool bursts;
+
+    static FaultPlan compile(const LinkProperties &props);
+  };
+
+  // One entry of the scenario file (see "scenario" below). Applies from
+  // at_s for duration_s simulated seconds to the links in link_mask, and
+  // only to traffic of node unless that is NO_NODE. field_mask/values work
+  // like ProfileOverride, outage drops all matching traffic.
+  struct ScenarioEvent {
+    std::string name;
+    double at_s;
+    double duration_s; // infinity lasts until the end of the run
+    uint32_t link_mask;
+    uint32_t node;
+    uint32_t field_mask;
+    LinkProperties values;
+    bool outage;
+  };
+
+  // Optional "scenario" section, names a JSON file with a timeline of
+  // events. Times are simulated seconds since start, so
+  // simulation.time_scale compresses a replay.
+  struct Scenario {
+    std::string file; // empty => no scenario
+    std::vector<ScenarioEvent> events;
+  };
+
   LinkProperties earth_to_earth;
   LinkProperties earth_to_moon;
   LinkProperties moon_to_earth;
   LinkProperties moon_to_moon;
+
+  std::vector<ProfileOverride> overrides;
+  Simulation simulation;
+  Ephemeris ephemeris;
+  Pipeline pipeline;
+  Queue queue;
+  Flows flows;
+  Shedding shedding;
+  Runtime runtime;
+  Admin admin;
+  Impairment impairment;
+  DecisionLog decision_log;
+  Fidelity fidelity;
+  Shards shards;
+  std::vector<Interface> interfaces; // at least one once loaded
+  Xdp xdp;
+  Offload offload;
+  Scenario scenario;
+  LogLevel log_level = LogLevel::INFO;
+  double stats_interval_s = 10.0; // 0 disables the periodic stats line
+
+  // Burst state forced from the admin socket, one per link type (LINK_*
+  // index). Never read from the file, so a reload resets it to AUTO.
+  enum class BurstForce : uint8_t { AUTO, ON, OFF };
+  std::array<BurstForce, 4> forced_bursts{};
+
+  // Resolved by ConfigManager on every load
+  std::vector<LinkProperties> profiles;
+  std::vector<FaultPlan> plans; // plans[i] is compiled from profiles[i]
+  // One NODE_SLOTS * NODE_SLOTS plane per interface,
+  // profile_index[(interface * NODE_SLOTS + src_node) * NODE_SLOTS +
+  // dst_node] => index into profiles
+  std::vector<uint16_t> profile_index;
+  // scenario events compiled into epochs, nullptr without events
+  std::shared_ptr<const ScenarioTimeline> timeline;
+
+  // One indexed load, ips are in host byte order. interface indexes
+  // interfaces, one that a reload removed falls back to the first.
+  uint16_t profileFor(uint32_t src_ip, uint32_t dst_ip,
+                      uint32_t interface = 0) const;
+  size_t profileCell(uint32_t src_ip, uint32_t dst_ip,
+                     uint32_t interface) const;
+
+  // Link section by LINK_* index with the overrides of one interface
+  // applied, what its tc tree is set up from
+  LinkProperties interfaceLink(uint32_t interface, uint32_t index) const;
+
+  // Link section by LINK_* index, throws std::out_of_range for others
+  LinkProperties &link(uint32_t index);
+  const LinkProperties &link(uint32_t index) const;
+
+  // Bit per LINK_* index whose packets need the userspace chain: bit
+  // errors, bursts, a throughput limit, outages, ephemeris BER or a forced
+  // burst for any node pair of any interface. The others only need their
+  // mark, see queue.kernel_bypass. Offloaded links are never included.
+  uint32_t userspaceLinks() const;
+};
+
+// Field table shared by the override parser, the profile resolver and the
+// admin socket. The position in this table is the bit in
+// ProfileOverride::field_mask.
+struct LinkField {
+  const char *name;
+  double Config::LinkProperties::*member;
 };
 
+inline constexpr LinkField LINK_FIELDS[] = {
+    {"base_latency_ms", &Config::LinkProperties::base_latency_ms},
+    {"latency_jitter_ms", &Config::LinkProperties::latency_jitter_ms},
+    {"latency_jitter_stddev", &Config::LinkProperties::latency_jitter_stddev},
+    {"base_bit_error_rate", &Config::LinkProperties::base_bit_error_rate},
+    {"bit_error_rate_stddev", &Config::LinkProperties::bit_error_rate_stddev},
+    {"base_packet_loss_burst_freq_per_minute",
+     &Config::LinkProperties::base_packet_loss_burst_freq_per_minute},
+    {"packet_loss_burst_freq_stddev",
+     &Config::LinkProperties::packet_loss_burst_freq_stddev},
+    {"base_packet_loss_burst_duration_ms",
+     &Config::LinkProperties::base_packet_loss_burst_duration_ms},
+    {"base_packet_loss_burst_duration_stddev",
+     &Config::LinkProperties::base_packet_loss_burst_duration_stddev},
+    {"throughput_limit_mbps", &Config::LinkProperties::throughput_limit_mbps},
+};
+
+// config.json section name of each link type, in LINK_* order
+inline constexpr const char *LINK_SECTIONS[] = {
+    "earth_to_earth", "earth_to_moon", "moon_to_earth", "moon_to_moon"};
+
+// Names of Config::Impairment::Chain values, in enum order
+inline constexpr const char *IMPAIRMENT_CHAINS[] = {"full", "loss_only",
+                                                    "mark_only"};
+
 class ConfigManager {
 public:
-  ConfigManager(const std::string &config_file);
+  ConfigManager(const std::string &config_file,
+                const std::string &runtime_profile = "");
 
   Config getConfig() const;
+  std::shared_ptr<const Config> getSnapshot() const;
+  uint64_t version() const;
   Config::LinkProperties getEToEConfig();
   Config::LinkProperties getEToMConfig();
   Config::LinkProperties getMToEConfig();
   Config::LinkProperties getMToMConfig();
 
   // updates config_ with values from config file
-  void reloadConfig();
+  bool reloadConfig();
+
+  // applies change to a copy of the current config and installs it
+  void update(const std::function<void(Config &)> &change);
 
 private:
   std::string config_file_;
-  Config config_;
+  std::string runtime_profile_;
+
+  // Replaced as a whole on reload so readers holding a snapshot never see a
+  // half-updated config
+  std::shared_ptr<const Config> config_;
+  std::atomic<uint64_t> version_{0};
 
   // Shared mutex allows multiple readers but exclusive write access
   mutable std::shared_mutex config_mutex_;
 
-  void loadConfig();
-  void loadDefaultConfig();
+  // Serialises reloads and updates, so neither loses the other's change
+  std::mutex update_mutex_;
+
+  void install(std::shared_ptr<const Config> config);
+
+  std::shared_ptr<const Config> loadConfig() const;
+  std::shared_ptr<const Config> loadDefaultConfig() const;
 };
@@ -2,27 +2,64 @@
 #include "configs.hpp"
 #include <iostream>
 
-IptablesManager::IptablesManager() {
-  std::cout << "Setting up iptables rules for " << WG_INTERFACE << ".\n";
+namespace {
+std::string ipText(uint32_t ip) {
+  return std::to_string(ip >> 24) + "." + std::to_string(ip >> 16 & 0xFF) +
+         "." + std::to_string(ip >> 8 & 0xFF) + "." +
+         std::to_string(ip & 0xFF);
+}
 
-  // Forward wireguard traffic to nfqueue
-  // -A FORWARD: Append a rule to the FORWARD chain (ie. packets being routed
-  // through this host) -i wg0: Match packets whose incoming (-i meaning
-  // incoming) interface is wg0 -j NFQUEUE: "Jump" to the NFQUEUE target (ie.
-  // hand off to NFQUEUE instead of dropping or accepting)
-  // --queue-num 0: Put packets into queue number 0.
-  executeCommand("iptables -I FORWARD 1 -i " + WG_INTERFACE +
-                 " -j NFQUEUE --queue-num " + std::to_string(QUEUE_NUM));
+// Address range of the nodes on one end of a link, what classifyPacket()
+// tells apart
+std::string nodeRange(bool rover) {
+  return rover ? ipText(ROVER_IP_MIN) + "-" + ipText(ROVER_IP_MAX)
+               : ipText(BASE_IP_MIN) + "-" + ipText(BASE_IP_MAX);
+}
+} // namespace
 
-  try {
-    // Forward outgoing wireguard traffic to nfqueue
-    executeCommand("iptables -I FORWARD 2 -o " + WG_INTERFACE +
-                   " -j NFQUEUE --queue-num " + std::to_string(QUEUE_NUM));
-  } catch (const std::exception &error) {
-    // Clean up if second rule fails
-    executeCommand("iptables -D FORWARD -i " + WG_INTERFACE +
-                   " -j NFQUEUE --queue-num " + std::to_string(QUEUE_NUM));
-    throw;
+IptablesManager::IptablesManager(
+    const std::vector<Config::Interface> &interfaces, uint32_t queues,
+    bool bypass) {
+  for (const Config::Interface &interface : interfaces) {
+    interfaces_.push_back(interface.name);
+    std::cout << "Setting up iptables rules for " << interface.name
+              << ".\n";
+
+    // --queue-balance hashes each flow onto one queue of the range, so a
+    // flow always meets the same shard. --queue-bypass accepts packets for a
+    // queue nobody is bound to, e.g. while a shard restarts.
+    std::string target = " -j NFQUEUE";
+    if (queues > 1) {
+      target += " --queue-balance " + std::to_string(interface.queue) + ":" +
+                std::to_string(interface.queue + queues - 1);
+    } else {
+      target += " --queue-num " + std::to_string(interface.queue);
+    }
+    if (bypass) {
+      target += " --queue-bypass";
+    }
+
+    // Forward wireguard traffic to nfqueue
+    // -A FORWARD: Append a rule to the FORWARD chain (ie. packets being
+    // routed through this host) -i wg0: Match packets whose incoming (-i
+    // meaning incoming) interface is wg0 -j NFQUEUE: "Jump" to the NFQUEUE
+    // target (ie. hand off to NFQUEUE instead of dropping or accepting)
+    // --queue-num 0: Put packets into queue number 0.
+    // Forward outgoing wireguard traffic to nfqueue with -o
+    for (const char *direction : {" -i ", " -o "}) {
+      std::string rule = direction + interface.name + target;
+      try {
+        executeCommand("iptables -I FORWARD " +
+                       std::to_string(rules_.size() + 1) + rule);
+      } catch (const std::exception &error) {
+        // Clean up the rules already added
+        for (const std::string &added : rules_) {
+          executeCommand("iptables -D FORWARD" + added);
+        }
+        throw;
+      }
+      rules_.push_back(rule);
+    }
   }
 }
 
@@ -31,25 +68,21 @@ IptablesManager::~IptablesManager() {
     std::cout << "Tearing down iptables rules..." << "\n";
 
     bool success = true;
-
-    // Remove incoming rule
     try {
-      executeCommand("iptables -D FORWARD -i " + WG_INTERFACE +
-                     " -j NFQUEUE --queue-num " + std::to_string(QUEUE_NUM));
+      setKernelBypass(0);
     } catch (const std::exception &error) {
-      std::cerr << "Warning: Failed to remove incoming iptables rules: "
+      std::cerr << "Warning: Failed to remove kernel bypass rules: "
                 << error.what() << "\n";
       success = false;
     }
-
-    // Remove outgoing rule
-    try {
-      executeCommand("iptables -D FORWARD -o " + WG_INTERFACE +
-                     " -j NFQUEUE --queue-num " + std::to_string(QUEUE_NUM));
-    } catch (const std::exception &error) {
-      std::cerr << "Warning: Failed to remove outgoing iptables rules: "
-                << error.what() << "\n";
-      success = false;
+    for (const std::string &rule : rules_) {
+      try {
+        executeCommand("iptables -D FORWARD" + rule);
+      } catch (const std::exception &error) {
+        std::cerr << "Warning: Failed to remove iptables rule: "
+                  << error.what() << "\n";
+        success = false;
+      }
     }
 
     if (success) {
@@ -60,10 +93,65 @@ IptablesManager::~IptablesManager() {
   }
 }
 
+void IptablesManager::setKernelBypass(uint32_t links) {
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    uint32_t bit = 1u << link;
+    if ((links & bit) == (bypassed_ & bit)) {
+      continue;
+    }
+    std::vector<std::string> rules = bypassRules(link);
+
+    if (!(links & bit)) {
+      std::cout << "Queueing " << LINK_SECTIONS[link] << " packets again.\n";
+      bypassed_ &= ~bit;
+      for (const std::string &rule : rules) {
+        executeCommand("iptables -D FORWARD" + rule);
+      }
+      continue;
+    }
+
+    // Inserted last to first at the top of FORWARD, so each MARK ends up
+    // right in front of its ACCEPT and both in front of the NFQUEUE rules
+    std::cout << "Marking " << LINK_SECTIONS[link]
+              << " packets in the kernel, they skip the queue.\n";
+    size_t added = 0;
+    try {
+      for (auto rule = rules.rbegin(); rule != rules.rend(); ++rule) {
+        executeCommand("iptables -I FORWARD 1" + *rule);
+        ++added;
+      }
+    } catch (const std::exception &error) {
+      for (size_t i = rules.size() - added; i < rules.size(); ++i) {
+        executeCommand("iptables -D FORWARD" + rules[i]);
+      }
+      throw;
+    }
+    bypassed_ |= bit;
+  }
+}
+
+std::vector<std::string> IptablesManager::bypassRules(uint32_t link) const {
+  bool src_rover = link == LINK_MOON_TO_EARTH || link == LINK_MOON_TO_MOON;
+  bool dst_rover = link == LINK_EARTH_TO_MOON || link == LINK_MOON_TO_MOON;
+  std::string match = " -m iprange --src-range " + nodeRange(src_rover) +
+                      " --dst-range " + nodeRange(dst_rover);
+
+  std::vector<std::string> rules;
+  for (const std::string &interface : interfaces_) {
+    for (const char *direction : {" -i ", " -o "}) {
+      std::string head = direction + interface + match;
+      rules.push_back(head + " -j MARK --set-mark " +
+                      std::to_string(LINK_MARKS[link]));
+      rules.push_back(head + " -j ACCEPT");
+    }
+  }
+  return rules;
+}
+
 void IptablesManager::executeCommand(const std::string &command) {
   int result = system(command.c_str());
   if (result != 0) {
     throw std::runtime_error("Command failed: " + command +
                              " (exit code: " + std::to_string(result) + ")");
   }
-}
\ No newline at end of file
+}
@@ -7,14 +7,25 @@
 
 // Example:
 // {
-//    IptablesManager iptables;
+//    IptablesManager iptables(config->interfaces);
 //    // rules are now active
 // } // rules are automatically removed when iptables goes out of scope
 
-// the class creates two forwarding rules
-// one for incoming and one for outgoing traffic on wg0
+// the class creates two forwarding rules per interface
+// one for incoming and one for outgoing traffic on it
 
-// both rules redirect matching packets to the NFQUEUE
+// both rules redirect matching packets to the interface's NFQUEUE
+
+// a sharded daemon spreads each interface's flows over several queues
+// instead, one per shard, with bypass packets pass unimpaired while no
+// shard listens on their queue
+// IptablesManager iptables(config->interfaces, shards, true);
+
+// links that need no userspace work can skip the queue: their packets are
+// marked and accepted by rules in front of the NFQUEUE ones, matched on the
+// rover and base station address ranges. Calling it again only changes the
+// rules of links that moved in or out of the mask.
+// iptables.setKernelBypass(~config->userspaceLinks() & ALL_LINKS_MASK);
 
 // if any rule setup fails, it will clean up the partial config
 // and throw an exception
@@ -23,13 +34,33 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
+
+#include "configs.hpp"
 
 class IptablesManager {
 public:
-  IptablesManager();
+  // queues > 1 balances each interface's flows over queues queue.. by
+  // flow hash
+  explicit IptablesManager(const std::vector<Config::Interface> &interfaces,
+                           uint32_t queues = 1, bool bypass = false);
   ~IptablesManager();
 
+  // Bit per LINK_* index whose packets get their mark and are accepted
+  // without being queued, 0 queues everything again. Not thread safe.
+  void setKernelBypass(uint32_t links);
+
 private:
   void executeCommand(const std::string &command);
+
+  // MARK and ACCEPT rule pairs of one link, per interface and direction
+  std::vector<std::string> bypassRules(uint32_t link) const;
+
+  std::vector<std::string> interfaces_;
+  uint32_t bypassed_ = 0;
+
+  // FORWARD rules in place, in insertion order
+  std::vector<std::string> rules_;
 };
\ No newline at end of file
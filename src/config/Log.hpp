@@ -0,0 +1,57 @@
+// src/config/Log.hpp
+
+// ---- Log Usage ---- //
+
+// Process wide log level so per-packet debug output can stay in the code
+// without costing anything in normal runs.
+
+// Example:
+// if (logEnabled(LogLevel::DEBUG)) {
+//   std::cout << "Packet received!\n";
+// }
+
+// The level comes from "log_level" in config.json and can be changed at
+// runtime with setLogLevel().
+
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+enum class LogLevel { ERROR, WARN, INFO, DEBUG };
+
+inline std::atomic<LogLevel> g_log_level{LogLevel::INFO};
+
+inline bool logEnabled(LogLevel level) {
+  return level <= g_log_level.load(std::memory_order_relaxed);
+}
+
+inline void setLogLevel(LogLevel level) {
+  g_log_level.store(level, std::memory_order_relaxed);
+}
+
+inline LogLevel parseLogLevel(const std::string &name) {
+  if (name == "error")
+    return LogLevel::ERROR;
+  if (name == "warn")
+    return LogLevel::WARN;
+  if (name == "info")
+    return LogLevel::INFO;
+  if (name == "debug")
+    return LogLevel::DEBUG;
+  throw std::runtime_error("Unknown log level '" + name + "'.");
+}
+
+inline const char *logLevelName(LogLevel level) {
+  switch (level) {
+  case LogLevel::ERROR:
+    return "error";
+  case LogLevel::WARN:
+    return "warn";
+  case LogLevel::INFO:
+    return "info";
+  default:
+    return "debug";
+  }
+}
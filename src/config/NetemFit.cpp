@@ -0,0 +1,113 @@
+// src/config/NetemFit.cpp
+
+#include "NetemFit.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+// netem takes percentages, tiny per packet chances need the digits
+std::string percent(double chance) {
+  std::ostringstream text;
+  text.precision(9);
+  text << chance * 100.0 << "%";
+  return text.str();
+}
+
+// Mean packets in a period of ms at rate pps, at least one
+double packetsIn(double ms, double pps) {
+  return std::max(ms * pps / 1000.0, 1.0);
+}
+
+// Spread of a geometric period with per packet exit chance q, in ms
+double geometricStddevMs(double q, double pps) {
+  return std::sqrt(1.0 - q) / q * 1000.0 / pps;
+}
+} // namespace
+
+double NetemFit::Deviation::error() const {
+  return target != 0 ? std::abs(fitted - target) / std::abs(target)
+                     : std::abs(fitted);
+}
+
+NetemFit NetemFit::fit(const Config::LinkProperties &props,
+                       const Config::Offload &offload) {
+  NetemFit fit;
+  double pps = offload.packet_rate_pps;
+
+  if (props.latency_jitter_stddev > 0) {
+    fit.jitter_ms = props.latency_jitter_stddev;
+    fit.distribution = offload.distribution;
+    // the NFQUEUE path never leaves +-latency_jitter_ms
+    if (fit.distribution == "normal" && props.latency_jitter_ms > 0) {
+      double outside =
+          std::erfc(props.latency_jitter_ms / (fit.jitter_ms * std::sqrt(2.0)));
+      fit.deviations.push_back({"delay beyond jitter (share)", 0.0, outside});
+    }
+  } else {
+    fit.jitter_ms = props.latency_jitter_ms;
+  }
+
+  // Mean good and bad periods as BurstModel samples them
+  double freq = props.base_packet_loss_burst_freq_per_minute;
+  double bad_ms = props.base_packet_loss_burst_duration_ms;
+  if (freq > 0 && bad_ms > 0) {
+    double good_ms = 60.0 * 1000.0 / freq;
+    fit.loss = true;
+    fit.loss_p = 1.0 / packetsIn(good_ms, pps);
+    fit.loss_r = 1.0 / packetsIn(bad_ms, pps);
+
+    double cycle_packets = 1.0 / fit.loss_p + 1.0 / fit.loss_r;
+    fit.deviations.push_back({"loss ratio", bad_ms / (good_ms + bad_ms),
+                              fit.loss_p / (fit.loss_p + fit.loss_r)});
+    fit.deviations.push_back({"bursts per minute",
+                              60.0 * 1000.0 / (good_ms + bad_ms),
+                              60.0 * pps / cycle_packets});
+    fit.deviations.push_back(
+        {"burst duration ms", bad_ms, 1000.0 / (fit.loss_r * pps)});
+    fit.deviations.push_back(
+        {"burst duration stddev ms",
+         props.base_packet_loss_burst_duration_stddev,
+         geometricStddevMs(fit.loss_r, pps)});
+    // 60000 / N(freq, stddev) spreads by about 60000 * stddev / freq^2
+    fit.deviations.push_back(
+        {"burst gap stddev ms",
+         good_ms * props.packet_loss_burst_freq_stddev / freq,
+         geometricStddevMs(fit.loss_p, pps)});
+  }
+
+  double ber = props.base_bit_error_rate;
+  if (ber > 0) {
+    double bits = 8.0 * offload.packet_bytes;
+    fit.corrupt = -std::expm1(bits * std::log1p(-std::min(ber, 1.0)));
+    fit.deviations.push_back({"bit error rate", ber, fit.corrupt / bits});
+    fit.deviations.push_back(
+        {"bit error rate stddev", props.bit_error_rate_stddev, 0.0});
+  }
+  return fit;
+}
+
+std::string NetemFit::options(double delay_ms) const {
+  std::string text = "delay " + std::to_string(delay_ms) + "ms " +
+                     std::to_string(jitter_ms) + "ms 0%";
+  if (!distribution.empty()) {
+    text += " distribution " + distribution;
+  }
+  if (loss) {
+    text += " loss gemodel " + percent(loss_p) + " " + percent(loss_r) +
+            " 100% 0%";
+  }
+  if (corrupt > 0) {
+    text += " corrupt " + percent(corrupt);
+  }
+  return text;
+}
+
+double NetemFit::worstError() const {
+  double worst = 0;
+  for (const Deviation &deviation : deviations) {
+    worst = std::max(worst, deviation.error());
+  }
+  return worst;
+}
@@ -0,0 +1,79 @@
+// src/config/NetemFit.hpp
+
+// ---- NetemFit Usage ---- //
+
+// NetemFit turns one link's LinkProperties into tc netem parameters that
+// give the same statistics without the daemon, for links in
+// "offload.links". It also reports how far the kernel model is from ours.
+// Example:
+// NetemFit fit = NetemFit::fit(config->interfaceLink(0, link),
+//                              config->offload);
+// tc_command += " netem " + fit.options(delay_ms);
+// for (const NetemFit::Deviation &d : fit.deviations) {
+//   std::cout << d.name << ": " << d.target << " vs " << d.fitted << "\n";
+// }
+
+// Bursts: our BurstModel alternates good and bad periods in time, netem's
+// Gilbert-Elliott model ("loss gemodel p r 1-h 1-k") changes state per
+// packet. At offload.packet_rate_pps the mean period lengths in packets give
+// p = 1 / good packets and r = 1 / bad packets, every packet of a burst is
+// lost (1-h = 100%) and none outside (1-k = 0%). The loss ratio and the mean
+// burst length match, but the periods become geometric, so their spread is
+// netem's and not the configured stddev, and a link that carries more or
+// fewer packets than packet_rate_pps gets shorter or longer bursts.
+
+// Bit errors: netem's "corrupt" flips one bit in a share of the packets, we
+// flip every bit with base_bit_error_rate. corrupt is the chance of at
+// least one flip in a packet of offload.packet_bytes, so the share of
+// damaged packets matches while the bit error rate comes out lower by the
+// packets that would have had more than one flip. bit_error_rate_stddev
+// has no netem equivalent.
+
+// Jitter: with latency_jitter_stddev > 0 the delay varies by that sigma
+// from netem's distribution table (offload.distribution), otherwise it
+// stays uniform within +-latency_jitter_ms like on the NFQUEUE path.
+
+// Every Deviation is a figure of our model next to what the netem
+// parameters give, error() is relative to the target (absolute when the
+// target is 0).
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ConfigManager.hpp"
+
+struct NetemFit {
+  struct Deviation {
+    std::string name;
+    double target;
+    double fitted;
+
+    double error() const;
+  };
+
+  // jitter_ms is the sigma of distribution, or the uniform half width
+  // without one
+  double jitter_ms = 0;
+  std::string distribution; // empty => netem's uniform jitter
+
+  // Gilbert-Elliott transition chances per packet, 0..1, bursts only when
+  // loss is set
+  bool loss = false;
+  double loss_p = 0;
+  double loss_r = 0;
+
+  double corrupt = 0; // chance a packet gets a flipped bit, 0..1
+
+  std::vector<Deviation> deviations;
+
+  static NetemFit fit(const Config::LinkProperties &props,
+                      const Config::Offload &offload);
+
+  // netem options after "netem", delay_ms replaces the link's latency so
+  // ephemeris and scenario updates keep working
+  std::string options(double delay_ms) const;
+
+  double worstError() const;
+};
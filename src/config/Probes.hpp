@@ -0,0 +1,50 @@
+// src/config/Probes.hpp
+
+// ---- Probes Usage ---- //
+
+// USDT (user space statically defined tracing) probes on the packet path.
+// A probe compiles to a single nop plus an ELF note that bpftrace, perf and
+// systemtap find it by, so it costs nothing until a tracer attaches and
+// tracing a production build needs no rebuild.
+
+// Example:
+// LND_PROBE3(burst_drop, packet.id, packet.link, packet.length);
+// sudo bpftrace -e 'usdt:./build/src/lunar-network-daemon:lnd:burst_drop
+//                   { @drops[arg1] = count(); }'
+
+// Probes of provider "lnd" and their arguments:
+// packet_received   id, length, residency_ns (-1 without kernel timestamp)
+// packet_classified id, link, length, profile_id
+// burst_drop        id, link, length
+// outage_drop       id, link, length
+// rate_drop         id, link, length
+// bits_flipped      id, link, length, flips
+// verdict_sent      id, verdict, mark, length (0 unless the data changed)
+// burst_state       link, profile_id, in_burst
+// config_reloaded   version
+// link is a LINK_* index, NUM_LINKS for unclassified traffic. The packet
+// probes fire on whichever thread handles the packet, use tid to tell the
+// pipeline threads apart.
+
+// <sys/sdt.h> (systemtap-sdt-dev) is only needed at build time, there is no
+// runtime dependency. Without it, or with -DLND_USDT_PROBES=OFF, every
+// LND_PROBE* expands to nothing. tools/*.bt are bpftrace scripts built on
+// these probes.
+
+// Arguments are evaluated even when nothing is attached, only pass values
+// the code has at hand anyway.
+
+#pragma once
+
+#if defined(LND_USDT_PROBES) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define LND_PROBE1(name, a) DTRACE_PROBE1(lnd, name, a)
+#define LND_PROBE3(name, a, b, c) DTRACE_PROBE3(lnd, name, a, b, c)
+#define LND_PROBE4(name, a, b, c, d) DTRACE_PROBE4(lnd, name, a, b, c, d)
+#else
+// arguments are still used, a variable only kept for a probe isn't unused
+#define LND_PROBE1(name, a) ((void)(a))
+#define LND_PROBE3(name, a, b, c) ((void)(a), (void)(b), (void)(c))
+#define LND_PROBE4(name, a, b, c, d)                                           \
+  ((void)(a), (void)(b), (void)(c), (void)(d))
+#endif
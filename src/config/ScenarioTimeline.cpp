@@ -0,0 +1,42 @@
+// src/config/ScenarioTimeline.cpp
+
+#include "ScenarioTimeline.hpp"
+#include "configs.hpp"
+
+#include <algorithm>
+
+uint16_t ScenarioTimeline::Epoch::profileFor(const Config &base,
+                                             uint32_t src_ip, uint32_t dst_ip,
+                                             uint32_t interface) const {
+  // same planes as the base index, compiled from the same interfaces
+  size_t cell = base.profileCell(src_ip, dst_ip, interface);
+  return profile_index.empty() ? base.profile_index[cell]
+                               : profile_index[cell];
+}
+
+bool ScenarioTimeline::Epoch::isOutage(uint32_t link, uint32_t src_ip,
+                                       uint32_t dst_ip) const {
+  uint32_t links = outage_links;
+  if (!outage_nodes.empty()) {
+    links |= outage_nodes[nodeIndex(src_ip)] | outage_nodes[nodeIndex(dst_ip)];
+  }
+  return links >> link & 1u;
+}
+
+size_t ScenarioTimeline::find(int64_t t_ns, size_t hint) const {
+  // Usually still the same epoch or the next one
+  if (hint < epochs_.size() && start(hint) <= t_ns) {
+    if (t_ns < end(hint)) {
+      return hint;
+    }
+    if (hint + 1 < epochs_.size() && t_ns < end(hint + 1)) {
+      return hint + 1;
+    }
+  }
+
+  // Jumped, e.g. a manual clock moved backwards
+  auto it = std::upper_bound(
+      epochs_.begin(), epochs_.end(), t_ns,
+      [](int64_t t, const Epoch &epoch) { return t < epoch.start_ns; });
+  return it == epochs_.begin() ? 0 : (it - epochs_.begin()) - 1;
+}
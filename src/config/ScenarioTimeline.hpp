@@ -0,0 +1,80 @@
+// src/config/ScenarioTimeline.hpp
+
+// ---- ScenarioTimeline Usage ---- //
+
+// ScenarioTimeline is the compiled form of the scenario file: the run is
+// cut into epochs at every event start and end, and each epoch holds what
+// the packet path needs while it lasts, with every event active in it
+// already applied. Nothing is merged or parsed per packet.
+
+// ConfigManager compiles the timeline on every load, reload and update, so
+// it always matches the link properties of the snapshot it belongs to.
+// Example:
+// auto config = config_manager.getSnapshot();
+// if (config->timeline) {
+//   size_t i = config->timeline->find(now_ns, last_index);
+//   const ScenarioTimeline::Epoch &epoch = config->timeline->epoch(i);
+//   uint16_t profile = epoch.profileFor(*config, src_ip, dst_ip);
+//   if (epoch.isOutage(link, src_ip, dst_ip)) { /* drop */ }
+// }
+
+// Time is simulated nanoseconds since SimClock::origin(). find() starts at
+// the caller's last index, so moving forward costs O(1); callers that cache
+// start() and end() of their epoch only call it when they leave it.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ConfigManager.hpp"
+
+class ScenarioTimeline {
+public:
+  struct Epoch {
+    int64_t start_ns;
+    std::vector<std::string> active; // names of the events in effect
+
+    // Resolved like Config::profiles/profile_index, empty when no event of
+    // this epoch changes link properties. Profiles of the base config keep
+    // their ids, combinations only events create are numbered after them.
+    std::vector<Config::LinkProperties> profiles;
+    std::vector<Config::FaultPlan> plans;
+    std::vector<uint16_t> profile_index;
+    uint32_t override_links = 0; // links whose properties may differ
+
+    uint32_t outage_links = 0; // every node
+    std::vector<uint8_t> outage_nodes; // link mask per node, may be empty
+
+    uint16_t profileFor(const Config &base, uint32_t src_ip, uint32_t dst_ip,
+                        uint32_t interface = 0) const;
+    const Config::LinkProperties &profile(const Config &base,
+                                          uint16_t id) const {
+      return profiles.empty() ? base.profiles[id] : profiles[id];
+    }
+    const Config::FaultPlan &plan(const Config &base, uint16_t id) const {
+      return plans.empty() ? base.plans[id] : plans[id];
+    }
+    bool isOutage(uint32_t link, uint32_t src_ip, uint32_t dst_ip) const;
+  };
+
+  // epochs sorted by start_ns, the first one starts at INT64_MIN
+  explicit ScenarioTimeline(std::vector<Epoch> epochs)
+      : epochs_(std::move(epochs)) {}
+
+  size_t find(int64_t t_ns, size_t hint) const;
+
+  const Epoch &epoch(size_t index) const { return epochs_[index]; }
+  int64_t start(size_t index) const { return epochs_[index].start_ns; }
+  int64_t end(size_t index) const {
+    return index + 1 < epochs_.size() ? epochs_[index + 1].start_ns
+                                      : INT64_MAX;
+  }
+  size_t size() const { return epochs_.size(); }
+
+private:
+  std::vector<Epoch> epochs_;
+};
@@ -2,14 +2,65 @@
 
 #include "TcNetemManager.hpp"
 #include "configs.hpp"
+#include <algorithm>
+#include <cmath>
 #include <exception>
 #include <iostream>
 #include <string>
 
 TcNetemManager::TcNetemManager(const ConfigManager &config_manager) {
-  std::cout << "Setting up TC/Netem rules for " << WG_INTERFACE << ".\n";
+  Config config = config_manager.getConfig();
+  offloaded_links_ = config.offload.link_mask;
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    if (!(offloaded_links_ >> link & 1u)) {
+      continue;
+    }
+    for (const auto &entry : config.overrides) {
+      if (entry.link == link) {
+        std::cerr << "Warning: Node overrides of " << LINK_SECTIONS[link]
+                  << " are not offloaded, netem applies the link section.\n";
+        break;
+      }
+    }
+    for (const auto &event : config.scenario.events) {
+      if ((event.link_mask >> link & 1u) &&
+          (event.outage || (event.field_mask & ~LATENCY_FIELD_MASK) != 0)) {
+        std::cerr << "Warning: Scenario events only move the latency of "
+                  << "offloaded " << LINK_SECTIONS[link] << ".\n";
+        break;
+      }
+    }
+  }
+
   try {
-    setupTcRules(config_manager);
+    // make sure netem is running
+    executeCommand("modprobe sch_netem");
+
+    for (uint32_t i = 0; i < config.interfaces.size(); ++i) {
+      Tree tree;
+      tree.interface = config.interfaces[i].name;
+      for (const auto &entry : config.interfaces[i].overrides) {
+        // base_latency_ms and latency_jitter_ms, see LINK_FIELDS
+        if (entry.field_mask & 0b11u) {
+          tree.pinned_links |= 1u << entry.link;
+        }
+      }
+      for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+        Config::LinkProperties props = config.interfaceLink(i, link);
+        tree.latency_ms[link] = props.base_latency_ms;
+        tree.jitter_ms[link] = props.latency_jitter_ms;
+        if (offloaded_links_ >> link & 1u) {
+          tree.fits[link] = NetemFit::fit(props, config.offload);
+          printFit(tree, link);
+        }
+      }
+
+      // added first so a half built tree is removed as well
+      trees_.push_back(tree);
+      std::cout << "Setting up TC/Netem rules for " << tree.interface
+                << ".\n";
+      setupTcRules(tree);
+    }
   } catch (const std::exception &error) {
     std::cerr << "Error setting up TC/Netem rules: " << error.what() << "\n";
     teardownTcRules();
@@ -31,97 +82,137 @@ void TcNetemManager::executeCommand(const std::string &command) {
   }
 }
 
-void TcNetemManager::setupTcRules(const ConfigManager &config_manager) {
-  // get configurations
-  Config config = config_manager.getConfig();
-
-  // make sure netem is running
-  executeCommand("modprobe sch_netem");
+void TcNetemManager::setupTcRules(const Tree &tree) {
+  const std::string &dev = tree.interface;
 
   // In another life, we would limit the throughput on a rover by rover basis
   // But fuck that
   const std::string default_rate = "1000Mbit";
 
-  // Create the root qdisc for outgoing traffic on wg0
+  // Create the root qdisc for outgoing traffic on the interface
   // Default to class 1 (EARTH_TO_EARTH) for unclassified traffic
   // qdisc is short for queueing discipline
   // classes can be attached to the qdisc
-  executeCommand("tc qdisc add dev " + WG_INTERFACE +
-                 " root handle 1: htb default " +
+  executeCommand("tc qdisc add dev " + dev + " root handle 1: htb default " +
                  std::to_string(MARK_EARTH_TO_EARTH));
 
   // Create classes for each link type
-  executeCommand("tc class add dev " + WG_INTERFACE +
-                 " parent 1: classid 1:" + std::to_string(MARK_EARTH_TO_EARTH) +
-                 " htb rate " + default_rate + " ceil " + default_rate);
-  executeCommand("tc class add dev " + WG_INTERFACE +
-                 " parent 1: classid 1:" + std::to_string(MARK_EARTH_TO_MOON) +
-                 " htb rate " + default_rate + " ceil " + default_rate);
-  executeCommand("tc class add dev " + WG_INTERFACE +
-                 " parent 1: classid 1:" + std::to_string(MARK_MOON_TO_EARTH) +
-                 " htb rate " + default_rate + " ceil " + default_rate);
-  executeCommand("tc class add dev " + WG_INTERFACE +
-                 " parent 1: classid 1:" + std::to_string(MARK_MOON_TO_MOON) +
-                 " htb rate " + default_rate + " ceil " + default_rate);
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    executeCommand("tc class add dev " + dev + " parent 1: classid 1:" +
+                   std::to_string(LINK_MARKS[link]) + " htb rate " +
+                   default_rate + " ceil " + default_rate);
+  }
 
+  // One netem per class, handles 10:, 20:, 30:, 40: in LINK_* order
   // Example command:
   // tc qdisc add dev wg0 parent 1:1 handle 10: netem delay 1300ms 50ms 0%
-
-  // EARTH_TO_EARTH
-  executeCommand("tc qdisc add dev " + WG_INTERFACE +
-                 " parent 1:" + std::to_string(MARK_EARTH_TO_EARTH) +
-                 " handle 10: netem delay " +
-                 std::to_string(config.earth_to_earth.base_latency_ms) + "ms " +
-                 std::to_string(config.earth_to_earth.latency_jitter_ms) +
-                 "ms 0%");
-
-  // EARTH_TO_MOON
-  executeCommand("tc qdisc add dev " + WG_INTERFACE +
-                 " parent 1:" + std::to_string(MARK_EARTH_TO_MOON) +
-                 " handle 20: netem delay " +
-                 std::to_string(config.earth_to_moon.base_latency_ms) + "ms " +
-                 std::to_string(config.earth_to_moon.latency_jitter_ms) +
-                 "ms 0%");
-
-  // MOON_TO_EARTH
-  executeCommand("tc qdisc add dev " + WG_INTERFACE +
-                 " parent 1:" + std::to_string(MARK_MOON_TO_EARTH) +
-                 " handle 30: netem delay " +
-                 std::to_string(config.moon_to_earth.base_latency_ms) + "ms " +
-                 std::to_string(config.moon_to_earth.latency_jitter_ms) +
-                 "ms 0%");
-
-  // MOON_TO_MOON
-  executeCommand("tc qdisc add dev " + WG_INTERFACE +
-                 " parent 1:" + std::to_string(MARK_MOON_TO_MOON) +
-                 " handle 40: netem delay " +
-                 std::to_string(config.moon_to_moon.base_latency_ms) + "ms " +
-                 std::to_string(config.moon_to_moon.latency_jitter_ms) +
-                 "ms 0%");
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    executeCommand("tc qdisc add dev " + dev + " parent 1:" +
+                   std::to_string(LINK_MARKS[link]) + " handle " +
+                   std::to_string((link + 1) * 10) + ": netem " +
+                   netemOptions(tree, link));
+  }
 
   // Add filters to match packets based on netfilter marks
-  executeCommand("tc filter add dev " + WG_INTERFACE +
-                 " parent 1: protocol ip prio 1 handle " +
-                 std::to_string(MARK_EARTH_TO_EARTH) +
-                 " fw flowid 1:" + std::to_string(MARK_EARTH_TO_EARTH));
-  executeCommand("tc filter add dev " + WG_INTERFACE +
-                 " parent 1: protocol ip prio 1 handle " +
-                 std::to_string(MARK_EARTH_TO_MOON) +
-                 " fw flowid 1:" + std::to_string(MARK_EARTH_TO_MOON));
-  executeCommand("tc filter add dev " + WG_INTERFACE +
-                 " parent 1: protocol ip prio 1 handle " +
-                 std::to_string(MARK_MOON_TO_EARTH) +
-                 " fw flowid 1:" + std::to_string(MARK_MOON_TO_EARTH));
-  executeCommand("tc filter add dev " + WG_INTERFACE +
-                 " parent 1: protocol ip prio 1 handle " +
-                 std::to_string(MARK_MOON_TO_MOON) +
-                 " fw flowid 1:" + std::to_string(MARK_MOON_TO_MOON));
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    executeCommand("tc filter add dev " + dev +
+                   " parent 1: protocol ip prio 1 handle " +
+                   std::to_string(LINK_MARKS[link]) + " fw flowid 1:" +
+                   std::to_string(LINK_MARKS[link]));
+  }
+}
+
+void TcNetemManager::updateDelay(uint32_t link, double latency_ms,
+                                 double jitter_ms) {
+  for (Tree &tree : trees_) {
+    if (tree.pinned_links >> link & 1u) {
+      continue;
+    }
+    tree.latency_ms[link] = latency_ms;
+    tree.jitter_ms[link] = jitter_ms;
+    applyDelay(tree, link);
+  }
+}
+
+void TcNetemManager::setCompensation(uint32_t link, double compensation_ms,
+                                     double epsilon_ms) {
+  if (std::abs(compensation_ms - compensation_ms_[link]) < epsilon_ms) {
+    return;
+  }
+  compensation_ms_[link] = compensation_ms;
+  for (const Tree &tree : trees_) {
+    applyDelay(tree, link);
+  }
+}
+
+void TcNetemManager::refit(const Config &config) {
+  if (config.offload.link_mask != offloaded_links_) {
+    std::cerr << "Warning: offload.links only changes on restart.\n";
+  }
+  for (Tree &tree : trees_) {
+    // an interface a reload removed gets the plain link sections
+    auto interface = static_cast<uint32_t>(
+        std::find_if(config.interfaces.begin(), config.interfaces.end(),
+                     [&tree](const Config::Interface &entry) {
+                       return entry.name == tree.interface;
+                     }) -
+        config.interfaces.begin());
+    for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+      if (!(offloaded_links_ >> link & 1u)) {
+        continue;
+      }
+      NetemFit fit =
+          NetemFit::fit(config.interfaceLink(interface, link), config.offload);
+      if (fit.options(0) == tree.fits[link].options(0)) {
+        continue;
+      }
+      tree.fits[link] = fit;
+      printFit(tree, link);
+      applyDelay(tree, link);
+    }
+  }
+}
+
+void TcNetemManager::applyDelay(const Tree &tree, uint32_t link) {
+  // netem handles are 10:, 20:, 30:, 40: in LINK_* order, see setupTcRules
+  executeCommand("tc qdisc change dev " + tree.interface +
+                 " parent 1:" + std::to_string(LINK_MARKS[link]) +
+                 " handle " + std::to_string((link + 1) * 10) + ": netem " +
+                 netemOptions(tree, link));
+}
+
+std::string TcNetemManager::netemOptions(const Tree &tree,
+                                         uint32_t link) const {
+  double delay_ms =
+      std::max(tree.latency_ms[link] - compensation_ms_[link], 0.0);
+  // a change replaces every netem option, loss and corrupt included
+  if (offloaded_links_ >> link & 1u) {
+    return tree.fits[link].options(delay_ms);
+  }
+  return "delay " + std::to_string(delay_ms) + "ms " +
+         std::to_string(tree.jitter_ms[link]) + "ms 0%";
+}
+
+void TcNetemManager::printFit(const Tree &tree, uint32_t link) {
+  const NetemFit &fit = tree.fits[link];
+  std::cout << "Offloading " << LINK_SECTIONS[link] << " on "
+            << tree.interface << " to netem, worst fit error "
+            << fit.worstError() * 100.0 << "%\n";
+  for (const NetemFit::Deviation &deviation : fit.deviations) {
+    std::cout << "  " << deviation.name << ": configured "
+              << deviation.target << ", netem " << deviation.fitted << " ("
+              << deviation.error() * 100.0 << "% off)\n";
+  }
 }
 
 void TcNetemManager::teardownTcRules() {
-  try {
-    executeCommand("tc qdisc del dev " + WG_INTERFACE + " root");
-  } catch (const std::exception &error) {
-    std::cerr << "Warning: Failed to remove TC rules: " << error.what() << "\n";
+  for (const Tree &tree : trees_) {
+    try {
+      executeCommand("tc qdisc del dev " + tree.interface + " root");
+    } catch (const std::exception &error) {
+      std::cerr << "Warning: Failed to remove TC rules: " << error.what()
+                << "\n";
+    }
   }
-}
\ No newline at end of file
+  trees_.clear();
+}
@@ -2,15 +2,63 @@
 
 #pragma once
 
+#include <array>
+#include <string>
+#include <vector>
+
 #include "ConfigManager.hpp"
+#include "NetemFit.hpp"
+#include "configs.hpp"
 
 class TcNetemManager {
 public:
+  // Sets up one htb/netem tree per entry in "interfaces". Links in
+  // offload.links get the loss and corruption of their NetemFit as well,
+  // the fit is printed with its errors.
   TcNetemManager(const ConfigManager &config_manager);
   ~TcNetemManager();
 
+  // Changes the netem delay of one link (LINK_* index) in place, used for
+  // time-varying latency such as the ephemeris feed. latency_ms is the
+  // delay the link should have end to end, see setCompensation. Interfaces
+  // whose own link overrides set the latency keep theirs. Offloaded links
+  // keep their fitted jitter.
+  void updateDelay(uint32_t link, double latency_ms, double jitter_ms);
+
+  // Delay a link's packets already picked up before netem (kernel queue and
+  // daemon), taken off its netem delay on every interface. Reapplies the
+  // current delay when it moved by more than epsilon_ms. Not thread safe,
+  // like updateDelay.
+  void setCompensation(uint32_t link, double compensation_ms,
+                       double epsilon_ms);
+
+  // Fits the offloaded links again to the props of config, after a reload
+  // or an admin change, and changes the netem qdiscs whose loss, corruption
+  // or jitter moved. Their delay stays with updateDelay. The offloaded links
+  // themselves are fixed at startup. Not thread safe, like updateDelay.
+  void refit(const Config &config);
+
 private:
+  // The qdisc tree of one interface and the last delay asked for per link
+  struct Tree {
+    std::string interface;
+    uint32_t pinned_links = 0; // latency set by the interface's overrides
+    std::array<double, NUM_LINKS> latency_ms{};
+    std::array<double, NUM_LINKS> jitter_ms{};
+    std::array<NetemFit, NUM_LINKS> fits; // of offloaded links
+  };
+
   void executeCommand(const std::string &command);
-  void setupTcRules(const ConfigManager &config_manager);
+  void setupTcRules(const Tree &tree);
   void teardownTcRules();
-};
\ No newline at end of file
+  void applyDelay(const Tree &tree, uint32_t link);
+  // netem options of a link with its current delay
+  std::string netemOptions(const Tree &tree, uint32_t link) const;
+  static void printFit(const Tree &tree, uint32_t link);
+
+  std::vector<Tree> trees_;
+  uint32_t offloaded_links_ = 0;
+
+  // what is taken off each link's delay, the same on every interface
+  std::array<double, NUM_LINKS> compensation_ms_{};
+};
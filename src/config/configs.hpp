@@ -19,13 +19,13 @@
 // 9 => throughput_limit_mbps;
 
 constexpr const Config::LinkProperties DEFAULT_EARTH_TO_EARTH{0, 0, 0, 0, 0,
-                                                              0, 0, 0, 0};
+                                                              0, 0, 0, 0, 0};
 constexpr const Config::LinkProperties DEFAULT_EARTH_TO_MOON{
-    1280.0, 100.0, 50.0, 1e-5, 5e-6, 1.0, 0.5, 500.0, 100.0};
+    1280.0, 100.0, 50.0, 1e-5, 5e-6, 1.0, 0.5, 500.0, 100.0, 0};
 constexpr const Config::LinkProperties DEFAULT_MOON_TO_EARTH{
-    1280.0, 100.0, 50.0, 1e-5, 5e-6, 1.0, 0.5, 500.0, 100.0};
+    1280.0, 100.0, 50.0, 1e-5, 5e-6, 1.0, 0.5, 500.0, 100.0, 0};
 constexpr const Config::LinkProperties DEFAULT_MOON_TO_MOON{
-    30.0, 10.0, 5.0, 2e-6, 1e-6, 0.2, 0.1, 50.0, 10.0};
+    30.0, 10.0, 5.0, 2e-6, 1e-6, 0.2, 0.1, 50.0, 10.0, 0};
 
 constexpr uint32_t ROVER_IP_MIN =
     (10 << 24 | 237 << 16 | 0 << 8 | 2); // minimum is 10.237.0.2
@@ -36,16 +36,58 @@ constexpr uint32_t BASE_IP_MIN =
 constexpr uint32_t BASE_IP_MAX =
     (10 << 24 | 237 << 16 | 0 << 8 | 253); // maximum is 10.237.0.253
 
+// Link section indices, same order as Packet::LinkType
+// profiles[LINK_*] in a resolved Config is the plain link section
+constexpr uint32_t LINK_EARTH_TO_EARTH = 0;
+constexpr uint32_t LINK_EARTH_TO_MOON = 1;
+constexpr uint32_t LINK_MOON_TO_EARTH = 2;
+constexpr uint32_t LINK_MOON_TO_MOON = 3;
+constexpr uint32_t NUM_LINKS = 4;
+// every LINK_* bit of a link mask
+constexpr uint32_t ALL_LINKS_MASK = (1u << NUM_LINKS) - 1;
+
+// Dense node indices for per-node profiles
+// rovers come first, then base stations, anything else maps to NO_NODE
+constexpr uint32_t NUM_ROVER_NODES = ROVER_IP_MAX - ROVER_IP_MIN + 1;
+constexpr uint32_t NUM_BASE_NODES = BASE_IP_MAX - BASE_IP_MIN + 1;
+constexpr uint32_t NUM_NODES = NUM_ROVER_NODES + NUM_BASE_NODES;
+constexpr uint32_t NO_NODE = NUM_NODES;
+constexpr uint32_t NODE_SLOTS = NUM_NODES + 1; // row width of profile_index
+
+constexpr uint32_t nodeIndex(uint32_t ip) {
+  if (ip >= ROVER_IP_MIN && ip <= ROVER_IP_MAX)
+    return ip - ROVER_IP_MIN;
+  if (ip >= BASE_IP_MIN && ip <= BASE_IP_MAX)
+    return NUM_ROVER_NODES + (ip - BASE_IP_MIN);
+  return NO_NODE;
+}
+
+constexpr bool isRoverNode(uint32_t node) { return node < NUM_ROVER_NODES; }
+
 // Netfilter verdict constants
 constexpr int NF_ACCEPT = 1;
 constexpr int NF_DROP = 0;
 
 // Netfilter configurations
 constexpr int QUEUE_NUM = 0;
-constexpr int SOCKET_BUFFER_SIZE = 1024 * 1024; // 1MB socket buffer
-constexpr int MAX_PACKET_SIZE = 65536;          // 64KB max packet size
+constexpr int MAX_PACKET_SIZE = 65536; // 64KB max packet size
+// netlink header and packet attributes around each queued payload
+constexpr size_t NFQ_MESSAGE_HEADROOM = 4096;
+// shards.count limit, slots in the shared memory layout
+constexpr uint32_t MAX_SHARDS = 32;
+// "interfaces" limit, per-interface counters are fixed size arrays
+constexpr uint32_t MAX_INTERFACES = 8;
+// upper bound for the receive buffer when a message arrives truncated
+constexpr size_t MAX_RECEIVE_BUFFER_SIZE = 1024 * 1024;
+// kernel timestamps older than this are not trusted (clock step, stale
+// stamp), such packets are timed from the callback instead
+constexpr int64_t MAX_KERNEL_RESIDENCY_MS = 1000;
 
-// Interface name
+// Depth of the throughput limit token bucket, how long a link may send
+// above its limit after being idle
+constexpr double THROUGHPUT_BUCKET_MS = 50.0;
+
+// Interface impaired when the config has no "interfaces" section
 const std::string WG_INTERFACE = "wg0";
 
 // netfilter marks for each link type
@@ -53,4 +95,18 @@ const std::string WG_INTERFACE = "wg0";
 constexpr uint32_t MARK_EARTH_TO_EARTH = 1;
 constexpr uint32_t MARK_EARTH_TO_MOON = 2;
 constexpr uint32_t MARK_MOON_TO_EARTH = 3;
-constexpr uint32_t MARK_MOON_TO_MOON = 4;
\ No newline at end of file
+constexpr uint32_t MARK_MOON_TO_MOON = 4;
+
+// marks indexed by LINK_* section index
+constexpr uint32_t LINK_MARKS[NUM_LINKS] = {
+    MARK_EARTH_TO_EARTH, MARK_EARTH_TO_MOON, MARK_MOON_TO_EARTH,
+    MARK_MOON_TO_MOON};
+
+// field_mask bits (LINK_FIELDS order) of what tc netem applies on its own:
+// base_latency_ms, latency_jitter_ms and latency_jitter_stddev
+constexpr uint32_t LATENCY_FIELD_MASK = 0b111;
+
+static_assert(std::size(LINK_SECTIONS) == NUM_LINKS);
+static_assert(std::size(LINK_FIELDS) ==
+              sizeof(Config::LinkProperties) / sizeof(double));
+static_assert(std::tuple_size_v<decltype(Config::forced_bursts)> == NUM_LINKS);
\ No newline at end of file
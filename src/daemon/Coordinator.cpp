@@ -0,0 +1,140 @@
+// src/daemon/Coordinator.cpp
+
+#include "Coordinator.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include <unistd.h>
+
+#include "AdminServer.hpp"
+#include "Daemon.hpp"
+#include "EphemerisTable.hpp"
+#include "Housekeeping.hpp"
+#include "IptablesManager.hpp"
+#include "Log.hpp"
+#include "NetfilterQueue.hpp"
+#include "PeriodicTasks.hpp"
+#include "Reporting.hpp"
+#include "Shard.hpp"
+#include "ShardSupervisor.hpp"
+#include "SharedState.hpp"
+#include "SimClock.hpp"
+#include "TcNetemManager.hpp"
+
+namespace {
+// how often a coordinator reaps and restarts shards
+constexpr auto SUPERVISOR_POLL_PERIOD = std::chrono::milliseconds(100);
+
+StatsSource shardStats(SharedState &shared) {
+  return {[&shared] { return shared.total().stats; },
+          [&shared] { return shared.total().latency; },
+          nullptr,
+          {"queued", "verdict"},
+          [&shared] { return shared.total().fidelity; }};
+}
+
+void scheduleShardControl(PeriodicTasks &tasks,
+                          const ConfigManager &config_manager,
+                          SharedState &shared) {
+  // Published once before any shard starts, then whenever the config or
+  // the reload count moved
+  uint64_t generation = 0;
+  auto publish = [&config_manager, &shared, generation, version = uint64_t{0},
+                  reloads = uint64_t{0}](bool force) mutable {
+    uint64_t current = config_manager.version();
+    uint64_t reloaded = g_reloads.load(std::memory_order_relaxed);
+    if (!force && current == version && reloaded == reloads) {
+      return;
+    }
+    auto config = config_manager.getSnapshot();
+    SharedState::Control control{};
+    control.generation = ++generation;
+    control.reloads = reloaded;
+    for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+      control.links[link] = config->link(link);
+    }
+    control.forced_bursts = config->forced_bursts;
+    shared.publishControl(control);
+    version = current;
+    reloads = reloaded;
+  };
+  publish(true);
+  tasks.add("shard-control", SHARD_SYNC_PERIOD,
+            [publish]() mutable { publish(false); });
+}
+} // namespace
+
+// Owns iptables, tc and the admin socket, the shards handle the packets
+void runCoordinator(ConfigManager &config_manager,
+                    const std::vector<std::string> &args) {
+  auto config = config_manager.getSnapshot();
+  Config::Shards shards = config->shards;
+  std::cout << "Coordinating " << shards.count << " shards\n";
+  for (const Config::Interface &interface : config->interfaces) {
+    std::cout << interface.name << ": queues " << interface.queue << "-"
+              << interface.queue + shards.count - 1 << "\n";
+  }
+
+  // fail_open also covers a shard that is restarting
+  IptablesManager iptables(config->interfaces, shards.count,
+                           config->queue.fail_open);
+  TcNetemManager tc_netem(config_manager);
+  SimClock clock(config->simulation.time_scale);
+  setLogLevel(config->log_level);
+  double ephemeris_start_time = EphemerisTable::startTime(config->ephemeris);
+  std::shared_ptr<const EphemerisTable> ephemeris =
+      openEphemeris(config_manager, clock, ephemeris_start_time);
+
+  // Every shard times and seeds its impairment from here
+  SharedState::Header header{};
+  header.shards = shards.count;
+  header.interfaces = static_cast<uint32_t>(config->interfaces.size());
+  header.seed = NetfilterQueue::chooseSeed(config->simulation);
+  header.origin_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         clock.origin().time_since_epoch())
+                         .count();
+  header.time_scale = clock.timeScale();
+  header.coordinator_pid = getpid();
+  header.ephemeris_start_time = ephemeris_start_time;
+  std::unique_ptr<SharedState> shared =
+      SharedState::create(shards.shm_name, header);
+  std::cout << "Impairment RNG seed: " << header.seed << "\n";
+
+  PeriodicTasks tasks;
+  scheduleHousekeeping(tasks, config_manager, netemDelay(tc_netem), clock,
+                       ephemeris, shardStats(*shared));
+  scheduleShardControl(tasks, config_manager, *shared);
+  scheduleKernelBypass(tasks, config_manager, iptables);
+  scheduleNetemRefit(tasks, config_manager, tc_netem);
+  tasks.start();
+
+  ShardSupervisor supervisor(args, shards);
+  supervisor.start();
+
+  std::unique_ptr<AdminServer> admin =
+      startAdminServer(config_manager, [&shared, &supervisor,
+                                        interfaces = config->interfaces] {
+        AdminServer::Counters counters =
+            statsCounters(shared->total().stats, interfaces);
+        counters.push_back({"shards_running", supervisor.running()});
+        counters.push_back({"shard_restarts", supervisor.restarts()});
+        return counters;
+      });
+
+  while (!g_stop_requested) {
+    supervisor.poll();
+    std::this_thread::sleep_for(SUPERVISOR_POLL_PERIOD);
+  }
+
+  admin.reset();
+  supervisor.stop();
+  tasks.stop();
+  printJitter(tasks.jitter());
+
+  std::cout << "Shutting down.\n";
+}
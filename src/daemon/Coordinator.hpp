@@ -0,0 +1,29 @@
+// src/daemon/Coordinator.hpp
+
+// ---- Coordinator Usage ---- //
+
+// The coordinator of a sharded daemon, the mode of shards.count > 0. It
+// owns iptables, tc netem, the housekeeping tasks and the admin socket and
+// starts one shard process per queue with ShardSupervisor, the shards
+// handle the packets.
+
+// Example:
+// runCoordinator(config_manager, std::vector<std::string>(argv, argv + argc));
+
+// args are the coordinator's own command line, every shard runs it again
+// with "--shard <index>" appended. The SharedState segment at
+// shards.shm_name carries the clock origin, RNG seed and ephemeris start
+// out to the shards, config changes and reloads every SHARD_SYNC_PERIOD,
+// and the shards' counters back: stats lines and admin counters are the
+// totals of all shards.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ConfigManager.hpp"
+
+// Blocks until SIGINT or SIGTERM, then stops the shards
+void runCoordinator(ConfigManager &config_manager,
+                    const std::vector<std::string> &args);
@@ -0,0 +1,222 @@
+// src/daemon/Daemon.cpp
+
+#include "Daemon.hpp"
+
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "AdminServer.hpp"
+#include "EphemerisTable.hpp"
+#include "Housekeeping.hpp"
+#include "IptablesManager.hpp"
+#include "Log.hpp"
+#include "PeriodicTasks.hpp"
+#include "Reporting.hpp"
+#include "SimClock.hpp"
+#include "TcNetemManager.hpp"
+#include "ThreadTuning.hpp"
+
+std::unique_ptr<NetfilterQueue> g_queue;
+
+#ifdef LND_AF_XDP
+std::unique_ptr<XdpBridge> g_bridge;
+#endif
+
+std::atomic<bool> g_reload_requested{false};
+std::atomic<bool> g_stop_requested{false};
+std::atomic<uint64_t> g_reloads{0};
+
+namespace {
+void signalHandler(int signal) {
+  if (signal == SIGHUP) {
+    g_reload_requested = true;
+    return;
+  }
+  g_stop_requested = true;
+  if (g_queue) {
+    g_queue->stop();
+  }
+#ifdef LND_AF_XDP
+  if (g_bridge) {
+    g_bridge->stop();
+  }
+#endif
+}
+
+#ifdef LND_AF_XDP
+// The bridge's counters in the queue's shape, the ports stand in for the
+// interfaces and kernel drops for lost packets
+StatsSource bridgeStats(const XdpBridge &bridge) {
+  auto stats = [&bridge] {
+    XdpBridge::Stats totals = bridge.getStats();
+    NetfilterQueue::Stats stats{};
+    stats.packets = totals.packets;
+    stats.segments = totals.segments;
+    stats.bytes = totals.bytes;
+    stats.burst_drops = totals.burst_drops;
+    stats.outage_drops = totals.outage_drops;
+    stats.rate_drops = totals.rate_drops;
+    stats.corrupted_packets = totals.corrupted_packets;
+    stats.flipped_bits = totals.flipped_bits;
+    stats.in_flight = totals.delayed;
+    for (uint32_t i = 0; i < totals.ports.size(); ++i) {
+      const XdpBridge::PortStats &port = totals.ports[i];
+      stats.interfaces[i] = {port.packets, port.bytes, port.drops};
+      stats.lost_packets += port.kernel_drops;
+    }
+    return stats;
+  };
+  auto latency = [&bridge] {
+    std::array<NetfilterQueue::LinkLatency, NUM_LINKS> latency{};
+    std::array<XdpBridge::LinkTiming, NUM_LINKS> timing = bridge.linkTiming();
+    for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+      latency[link] = {timing[link].processing, timing[link].lateness};
+    }
+    return latency;
+  };
+  return {stats, latency,
+          [&bridge](size_t n) { return bridge.topFlows(n); },
+          {"processing", "release late"},
+          [&bridge] { return bridge.fidelity(); }};
+}
+#endif
+} // namespace
+
+void setupSignalHandlers() {
+  struct sigaction sa{};
+  std::memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = signalHandler;
+
+  // Register for common termination signals
+  if (sigaction(SIGINT, &sa, nullptr) < 0) { // Ctrl+C
+    std::cerr << "Warning: Failed to set SIGINT handler\n";
+  }
+  if (sigaction(SIGTERM, &sa, nullptr) < 0) { // Termination signal
+    std::cerr << "Warning: Failed to set SIGTERM handler\n";
+  }
+  if (sigaction(SIGHUP, &sa, nullptr) < 0) { // Reload config
+    std::cerr << "Warning: Failed to set SIGHUP handler\n";
+  }
+}
+
+bool reloadConfig(ConfigManager &config_manager) {
+  if (!config_manager.reloadConfig()) {
+    return false;
+  }
+  g_reloads.fetch_add(1, std::memory_order_relaxed);
+  setLogLevel(config_manager.getSnapshot()->log_level);
+  return true;
+}
+
+// One process does everything
+void runDaemon(ConfigManager &config_manager) {
+  Config::Runtime runtime = config_manager.getSnapshot()->runtime;
+  std::cout << "Runtime profile: " << runtime.profile << "\n";
+
+  // lock before the queue allocates its buffers so they stay resident
+  if (runtime.lock_memory) {
+    lockAllMemory();
+  }
+
+  // iptables class ensures teardown on destruction
+  std::vector<Config::Interface> interfaces =
+      config_manager.getSnapshot()->interfaces;
+  IptablesManager iptables(interfaces);
+
+  // Set up TC/Netem rules, torn down on destruction
+  TcNetemManager tc_netem(config_manager);
+
+  // Time source for impairment decisions, optionally compressed
+  SimClock clock(config_manager.getSnapshot()->simulation.time_scale);
+
+  setLogLevel(config_manager.getSnapshot()->log_level);
+
+  // Optional ephemeris feed for time-varying latency and BER
+  std::shared_ptr<const EphemerisTable> ephemeris =
+      openEphemeris(config_manager, clock);
+
+  g_queue = std::make_unique<NetfilterQueue>(config_manager, clock, ephemeris);
+
+  // Housekeeping off the packet path, stopped before tc_netem goes away
+  PeriodicTasks tasks;
+  scheduleHousekeeping(tasks, config_manager, netemDelay(tc_netem), clock,
+                       ephemeris, queueStats(*g_queue));
+  scheduleKernelBypass(tasks, config_manager, iptables);
+  scheduleNetemRefit(tasks, config_manager, tc_netem);
+  scheduleSocketBuffer(tasks, *g_queue);
+  tasks.start();
+
+  // Control socket, the daemon runs on without it
+  const NetfilterQueue &queue = *g_queue;
+  std::unique_ptr<AdminServer> admin =
+      startAdminServer(config_manager, [&queue, interfaces] {
+        return statsCounters(queue.getStats(), interfaces);
+      });
+
+  // blocks until stopped by signal
+  g_queue->run();
+
+  admin.reset();
+  tasks.stop();
+  printJitter(tasks.jitter());
+
+  std::cout << "Shutting down.\n";
+
+  // Clean up the queue
+  g_queue.reset();
+}
+
+// AF_XDP bridge between xdp.ports, no iptables, tc or netfilter queue
+void runXdp(ConfigManager &config_manager) {
+#ifdef LND_AF_XDP
+  auto config = config_manager.getSnapshot();
+  Config::Runtime runtime = config->runtime;
+  std::cout << "Runtime profile: " << runtime.profile << "\n";
+  std::cout << "Bridging " << config->xdp.ports[0] << " and "
+            << config->xdp.ports[1] << " over AF_XDP\n";
+  if (runtime.lock_memory) {
+    lockAllMemory();
+  }
+
+  SimClock clock(config->simulation.time_scale);
+  setLogLevel(config->log_level);
+  std::shared_ptr<const EphemerisTable> ephemeris =
+      openEphemeris(config_manager, clock);
+
+  g_bridge = std::make_unique<XdpBridge>(
+      config_manager, clock, ephemeris,
+      NetfilterQueue::chooseSeed(config->simulation));
+  XdpBridge &bridge = *g_bridge;
+
+  PeriodicTasks tasks;
+  DelayTarget delay{[&bridge](uint32_t link, double latency_ms,
+                              double jitter_ms) {
+                      bridge.updateDelay(link, latency_ms, jitter_ms);
+                    },
+                    nullptr};
+  scheduleHousekeeping(tasks, config_manager, delay, clock, ephemeris,
+                       bridgeStats(bridge));
+  tasks.start();
+
+  std::unique_ptr<AdminServer> admin =
+      startAdminServer(config_manager, [&bridge, config] {
+        return statsCounters(bridgeStats(bridge).stats(),
+                             reportedInterfaces(*config));
+      });
+
+  // blocks until stopped by signal
+  bridge.run();
+
+  admin.reset();
+  tasks.stop();
+  printJitter(tasks.jitter());
+
+  std::cout << "Shutting down.\n";
+  g_bridge.reset();
+#else
+  (void)config_manager;
+  throw std::runtime_error("xdp.enabled but built without AF_XDP support");
+#endif
+}
@@ -0,0 +1,60 @@
+// src/daemon/Daemon.hpp
+
+// ---- Daemon Usage ---- //
+
+// The run modes of the daemon and the process state they share. main()
+// loads the config and picks one mode:
+// runDaemon()       one process queues, impairs and reports
+// runXdp()          the AF_XDP bridge between xdp.ports, see XdpBridge.hpp
+// runCoordinator()  shards.count > 0, see Coordinator.hpp
+// runShard()        one queue of a sharded daemon, see Shard.hpp
+
+// Example:
+// setupSignalHandlers();
+// ConfigManager config_manager("config/config.json");
+// runDaemon(config_manager); // returns after SIGINT or SIGTERM
+
+// Every mode blocks until SIGINT or SIGTERM. The signal handler stops
+// g_queue or g_bridge, whichever runs, and sets g_stop_requested for a
+// coordinator, which has neither. SIGHUP only sets g_reload_requested, the
+// reload itself runs on the timer thread (scheduleReload() in
+// Housekeeping.hpp).
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "ConfigManager.hpp"
+#include "NetfilterQueue.hpp"
+
+#ifdef LND_AF_XDP
+#include "XdpBridge.hpp"
+#endif
+
+extern std::unique_ptr<NetfilterQueue> g_queue;
+
+#ifdef LND_AF_XDP
+extern std::unique_ptr<XdpBridge> g_bridge;
+#endif
+
+// set by SIGHUP, the reload itself runs on the timer thread
+extern std::atomic<bool> g_reload_requested;
+
+// set by SIGINT/SIGTERM, a coordinator has no queue to stop
+extern std::atomic<bool> g_stop_requested;
+
+// successful config reloads, published to shards
+extern std::atomic<uint64_t> g_reloads;
+
+void setupSignalHandlers();
+
+// Reloads the config file, counts the reload in g_reloads and applies the
+// new log level. False if the file was rejected.
+bool reloadConfig(ConfigManager &config_manager);
+
+void runDaemon(ConfigManager &config_manager);
+
+// Throws when built without AF_XDP support
+void runXdp(ConfigManager &config_manager);
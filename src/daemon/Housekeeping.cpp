@@ -0,0 +1,297 @@
+// src/daemon/Housekeeping.cpp
+
+#include "Housekeeping.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <iostream>
+
+#include "Daemon.hpp"
+#include "JitterStats.hpp"
+#include "Reporting.hpp"
+#include "ScenarioTimeline.hpp"
+
+namespace {
+// smallest latency change worth a netem update
+constexpr double EPHEMERIS_DELAY_EPSILON_MS = 0.1;
+
+// how often a SIGHUP reload request is picked up
+constexpr auto RELOAD_POLL_PERIOD = std::chrono::milliseconds(200);
+
+// how often the kernel's queue counters are read and the socket buffer is
+// grown after lost queue messages
+constexpr auto SOCKET_BUFFER_POLL_PERIOD = std::chrono::seconds(1);
+
+// how often the kernel bypass rules are checked against the config
+constexpr auto BYPASS_POLL_PERIOD = std::chrono::milliseconds(200);
+
+// how often offloaded links are checked against the config
+constexpr auto REFIT_POLL_PERIOD = std::chrono::milliseconds(200);
+
+// how often netem latency is brought in line with the scenario epoch
+constexpr auto SCENARIO_POLL_PERIOD = std::chrono::milliseconds(100);
+
+// how often the measured time before netem is taken off the netem delay,
+// links with fewer packets than this in a period keep their compensation
+constexpr auto COMPENSATION_PERIOD = std::chrono::seconds(1);
+constexpr uint64_t COMPENSATION_MIN_SAMPLES = 50;
+constexpr double COMPENSATION_EPSILON_MS = 0.05;
+
+void scheduleEphemerisDelay(
+    PeriodicTasks &tasks,
+    std::function<void(uint32_t, double, double)> update_delay,
+    const ConfigManager &config_manager, const SimClock &clock,
+    std::shared_ptr<const EphemerisTable> ephemeris) {
+  auto config = config_manager.getSnapshot();
+  auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(config->ephemeris.update_interval_s));
+
+  // last latency pushed to netem per link, netem starts from the config
+  std::array<double, NUM_LINKS> applied{};
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    applied[link] = config->profiles[link].base_latency_ms;
+  }
+
+  auto update = [update_delay, &config_manager, &clock, ephemeris,
+                 applied]() mutable {
+    auto config = config_manager.getSnapshot();
+    EphemerisTable::Sample sample = ephemeris->sample(clock.now());
+    for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+      if (!ephemeris->appliesTo(link) ||
+          std::abs(sample.latency_ms - applied[link]) <
+              EPHEMERIS_DELAY_EPSILON_MS) {
+        continue;
+      }
+      update_delay(link, sample.latency_ms,
+                   config->profiles[link].latency_jitter_ms);
+      applied[link] = sample.latency_ms;
+    }
+  };
+  tasks.add("ephemeris", period, update);
+}
+
+void scheduleScenario(
+    PeriodicTasks &tasks,
+    std::function<void(uint32_t, double, double)> update_delay,
+    const ConfigManager &config_manager, const SimClock &clock,
+    uint32_t ephemeris_links) {
+  // Packet threads find their epoch themselves, this task only logs epoch
+  // changes and moves the netem delay of links the ephemeris doesn't feed
+  auto config = config_manager.getSnapshot();
+  std::array<double, NUM_LINKS> applied{};
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    applied[link] = config->profiles[link].base_latency_ms;
+  }
+  std::shared_ptr<const ScenarioTimeline> timeline;
+  size_t index = 0;
+
+  auto update = [update_delay, &config_manager, &clock, ephemeris_links,
+                 applied, timeline, index]() mutable {
+    auto config = config_manager.getSnapshot();
+    if (!config->timeline) {
+      timeline = nullptr;
+      return;
+    }
+    int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         clock.now() - clock.origin())
+                         .count();
+    size_t current = config->timeline->find(now_ns, index);
+    if (config->timeline == timeline && current == index) {
+      return;
+    }
+    timeline = config->timeline;
+    index = current;
+
+    const ScenarioTimeline::Epoch &epoch = timeline->epoch(index);
+    std::cout << "Scenario: " << now_ns / 1e9 << " s, ";
+    if (epoch.active.empty()) {
+      std::cout << "no events active\n";
+    }
+    for (size_t i = 0; i < epoch.active.size(); ++i) {
+      std::cout << (i ? ", " : "active: ") << epoch.active[i]
+                << (i + 1 == epoch.active.size() ? "\n" : "");
+    }
+
+    // profiles[link] of an epoch is the plain link section
+    for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+      const Config::LinkProperties &props = epoch.profile(*config, link);
+      if ((ephemeris_links >> link & 1u) ||
+          std::abs(props.base_latency_ms - applied[link]) <
+              EPHEMERIS_DELAY_EPSILON_MS) {
+        continue;
+      }
+      update_delay(link, props.base_latency_ms, props.latency_jitter_ms);
+      applied[link] = props.base_latency_ms;
+    }
+  };
+  tasks.add("scenario", SCENARIO_POLL_PERIOD, update);
+}
+
+void scheduleDelayCompensation(
+    PeriodicTasks &tasks,
+    std::function<void(uint32_t, double, double)> set_compensation,
+    std::function<std::array<NetfilterQueue::LinkLatency, NUM_LINKS>()>
+        latency) {
+  // The histograms only keep running sums, the mean of one period is the
+  // difference to the last sums used
+  std::array<NetfilterQueue::LinkLatency, NUM_LINKS> last{};
+  auto update = [set_compensation, latency, last]() mutable {
+    auto total_us = [](const JitterStats::Summary &summary) {
+      return summary.mean_us * static_cast<double>(summary.samples);
+    };
+    std::array<NetfilterQueue::LinkLatency, NUM_LINKS> current = latency();
+    for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+      const NetfilterQueue::LinkLatency &now = current[link];
+      const NetfilterQueue::LinkLatency &before = last[link];
+      uint64_t samples = now.residency.samples - before.residency.samples;
+      if (samples < COMPENSATION_MIN_SAMPLES) {
+        continue;
+      }
+      double mean_us = (total_us(now.residency) + total_us(now.verdict) -
+                        total_us(before.residency) - total_us(before.verdict)) /
+                       static_cast<double>(samples);
+      set_compensation(link, mean_us / 1000.0, COMPENSATION_EPSILON_MS);
+      last[link] = now;
+    }
+  };
+  tasks.add("delay-compensation", COMPENSATION_PERIOD, update);
+}
+} // namespace
+
+std::shared_ptr<const EphemerisTable>
+openEphemeris(const ConfigManager &config_manager, const SimClock &clock,
+              double start_time) {
+  Config::Ephemeris config = config_manager.getSnapshot()->ephemeris;
+  if (config.csv.empty()) {
+    return nullptr;
+  }
+  if (start_time > 0) {
+    config.start_time = start_time;
+  }
+  try {
+    std::shared_ptr<const EphemerisTable> ephemeris =
+        EphemerisTable::open(config, clock.origin());
+    std::cout << "Ephemeris feed loaded, " << ephemeris->size()
+              << " samples.\n";
+    return ephemeris;
+  } catch (const std::exception &error) {
+    std::cerr << "Warning: Ephemeris disabled: " << error.what()
+              << "\nUsing static link properties.\n";
+    return nullptr;
+  }
+}
+
+StatsSource queueStats(const NetfilterQueue &queue) {
+  return {[&queue] { return queue.getStats(); },
+          [&queue] { return queue.linkLatency(); },
+          [&queue](size_t n) { return queue.topFlows(n); },
+          {"queued", "verdict"},
+          [&queue] { return queue.fidelity(); }};
+}
+
+DelayTarget netemDelay(TcNetemManager &tc_netem) {
+  return {[&tc_netem](uint32_t link, double latency_ms, double jitter_ms) {
+            tc_netem.updateDelay(link, latency_ms, jitter_ms);
+          },
+          [&tc_netem](uint32_t link, double compensation_ms,
+                      double epsilon_ms) {
+            tc_netem.setCompensation(link, compensation_ms, epsilon_ms);
+          }};
+}
+
+void scheduleHousekeeping(PeriodicTasks &tasks, ConfigManager &config_manager,
+                          const DelayTarget &delay, const SimClock &clock,
+                          std::shared_ptr<const EphemerisTable> ephemeris,
+                          const StatsSource &source) {
+  auto config = config_manager.getSnapshot();
+  tasks.setPlacement(
+      {config->runtime.timer_cpu, config->runtime.realtime_priority});
+  scheduleJitterProbe(tasks, config->runtime);
+  if (ephemeris) {
+    scheduleEphemerisDelay(tasks, delay.update_delay, config_manager, clock,
+                           ephemeris);
+  }
+  scheduleStatsReport(tasks, config_manager, source);
+  scheduleScenario(tasks, delay.update_delay, config_manager, clock,
+                   ephemeris ? config->ephemeris.link_mask : 0);
+  if (config->queue.compensate_delay && delay.set_compensation) {
+    scheduleDelayCompensation(tasks, delay.set_compensation, source.latency);
+  }
+  scheduleReload(tasks, config_manager);
+}
+
+void scheduleJitterProbe(PeriodicTasks &tasks,
+                         const Config::Runtime &runtime) {
+  if (runtime.jitter_probe_ms <= 0) {
+    return;
+  }
+  // frequent no-op wakeups so the jitter report has enough samples
+  auto probe_period =
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double, std::milli>(runtime.jitter_probe_ms));
+  tasks.add("jitter-probe", probe_period, [] {});
+}
+
+void scheduleReload(PeriodicTasks &tasks, ConfigManager &config_manager) {
+  tasks.add("reload", RELOAD_POLL_PERIOD, [&config_manager] {
+    if (g_reload_requested.exchange(false)) {
+      std::cout << "SIGHUP, reloading config.\n";
+      reloadConfig(config_manager);
+    }
+  });
+}
+
+void scheduleSocketBuffer(PeriodicTasks &tasks, NetfilterQueue &queue) {
+  tasks.add("socket-buffer", SOCKET_BUFFER_POLL_PERIOD,
+            [&queue] { queue.tuneSocketBuffer(); });
+}
+
+void scheduleKernelBypass(PeriodicTasks &tasks,
+                          const ConfigManager &config_manager,
+                          IptablesManager &iptables) {
+  // Applied once before the queue sees traffic, then whenever a reload, the
+  // admin socket or a shard control message installs a new config
+  auto apply = [&config_manager, &iptables,
+                version = uint64_t{0}](bool force) mutable {
+    uint64_t current = config_manager.version();
+    if (!force && current == version) {
+      return;
+    }
+    version = current;
+    auto config = config_manager.getSnapshot();
+    uint32_t links = config->queue.kernel_bypass
+                         ? ~config->userspaceLinks() & ALL_LINKS_MASK
+                         : 0;
+    try {
+      iptables.setKernelBypass(links);
+    } catch (const std::exception &error) {
+      std::cerr << "Warning: Kernel bypass rules not updated: "
+                << error.what() << "\n";
+    }
+  };
+  apply(true);
+  tasks.add("kernel-bypass", BYPASS_POLL_PERIOD,
+            [apply]() mutable { apply(false); });
+}
+
+void scheduleNetemRefit(PeriodicTasks &tasks,
+                        const ConfigManager &config_manager,
+                        TcNetemManager &tc_netem) {
+  if (config_manager.getSnapshot()->offload.link_mask == 0) {
+    return;
+  }
+  // Offloaded links see no packet of the daemon, a reload, the admin socket
+  // or a shard control message only reaches them through netem. Fitted at
+  // startup, then whenever a new config is installed.
+  tasks.add("netem-refit", REFIT_POLL_PERIOD,
+            [&config_manager, &tc_netem,
+             version = config_manager.version()]() mutable {
+              uint64_t current = config_manager.version();
+              if (current == version) {
+                return;
+              }
+              version = current;
+              tc_netem.refit(*config_manager.getSnapshot());
+            });
+}
@@ -0,0 +1,96 @@
+// src/daemon/Housekeeping.hpp
+
+// ---- Housekeeping Usage ---- //
+
+// The periodic tasks every run mode schedules on its PeriodicTasks timer
+// thread, off the packet path: ephemeris and scenario latency pushed to
+// netem (or the bridge's delay line), delay compensation, stats lines,
+// SIGHUP reloads, socket buffer growth, kernel bypass rules and the netem
+// fit of offloaded links.
+
+// Example:
+// PeriodicTasks tasks;
+// scheduleHousekeeping(tasks, config_manager, netemDelay(tc_netem), clock,
+//                      ephemeris, queueStats(queue));
+// scheduleKernelBypass(tasks, config_manager, iptables);
+// scheduleSocketBuffer(tasks, queue);
+// tasks.start();
+// ...
+// tasks.stop(); // before anything the tasks reference goes away
+
+// The tasks keep references to what they are given, it has to outlive
+// tasks.stop(). Tasks that follow the config poll ConfigManager::version()
+// and only act when a reload, the admin socket or a shard control message
+// installed a new config.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ConfigManager.hpp"
+#include "EphemerisTable.hpp"
+#include "FidelityMonitor.hpp"
+#include "FlowTable.hpp"
+#include "IptablesManager.hpp"
+#include "NetfilterQueue.hpp"
+#include "PeriodicTasks.hpp"
+#include "SimClock.hpp"
+#include "TcNetemManager.hpp"
+#include "configs.hpp"
+
+// What the stats line, the admin counters and delay compensation read: the
+// local queue, or the totals of all shards in a coordinator
+struct StatsSource {
+  std::function<NetfilterQueue::Stats()> stats;
+  std::function<std::array<NetfilterQueue::LinkLatency, NUM_LINKS>()> latency;
+  // unset in a coordinator, flow tables stay in the shards
+  std::function<std::vector<FlowTable::FlowStats>(size_t)> top_flows;
+  // what the two latency summaries measure, for the stats line
+  std::array<std::string, 2> latency_names{"queued", "verdict"};
+  // realized against configured impairment, all threads (and shards)
+  std::function<std::array<FidelityMonitor::Link, NUM_LINKS>()> fidelity;
+};
+
+// Where latency changes go: tc netem on the NFQUEUE path, the delay line of
+// the AF_XDP bridge
+struct DelayTarget {
+  std::function<void(uint32_t, double, double)> update_delay;
+  // unset for the bridge, nothing is held before its delay line
+  std::function<void(uint32_t, double, double)> set_compensation;
+};
+
+// start_time > 0 replaces ephemeris.start_time, a shard takes the one its
+// coordinator resolved. nullptr without a feed or if it doesn't load.
+std::shared_ptr<const EphemerisTable>
+openEphemeris(const ConfigManager &config_manager, const SimClock &clock,
+              double start_time = 0);
+
+StatsSource queueStats(const NetfilterQueue &queue);
+DelayTarget netemDelay(TcNetemManager &tc_netem);
+
+// Timer placement, jitter probe, ephemeris, scenario, stats line, delay
+// compensation and reload, the tasks every mode but a shard runs
+void scheduleHousekeeping(PeriodicTasks &tasks, ConfigManager &config_manager,
+                          const DelayTarget &delay, const SimClock &clock,
+                          std::shared_ptr<const EphemerisTable> ephemeris,
+                          const StatsSource &source);
+
+void scheduleJitterProbe(PeriodicTasks &tasks, const Config::Runtime &runtime);
+void scheduleReload(PeriodicTasks &tasks, ConfigManager &config_manager);
+void scheduleSocketBuffer(PeriodicTasks &tasks, NetfilterQueue &queue);
+
+// Also applies the rules once before returning
+void scheduleKernelBypass(PeriodicTasks &tasks,
+                          const ConfigManager &config_manager,
+                          IptablesManager &iptables);
+
+// Nothing to schedule without offload.link_mask
+void scheduleNetemRefit(PeriodicTasks &tasks,
+                        const ConfigManager &config_manager,
+                        TcNetemManager &tc_netem);
@@ -0,0 +1,263 @@
+// src/daemon/Reporting.cpp
+
+#include "Reporting.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include "Daemon.hpp"
+#include "FidelityMonitor.hpp"
+#include "FlowTable.hpp"
+#include "Log.hpp"
+#include "configs.hpp"
+
+namespace {
+void printLinkLatency(
+    const std::array<NetfilterQueue::LinkLatency, NUM_LINKS> &latency,
+    const std::array<std::string, 2> &names) {
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    const NetfilterQueue::LinkLatency &times = latency[link];
+    if (times.residency.samples == 0) {
+      continue;
+    }
+    std::cout << "Latency " << LINK_SECTIONS[link] << ": " << names[0]
+              << " mean " << times.residency.mean_us << " us, p99 <= "
+              << times.residency.p99_us << " us, " << names[1] << " mean "
+              << times.verdict.mean_us << " us, p99 <= "
+              << times.verdict.p99_us << " us over "
+              << times.residency.samples << " packets\n";
+  }
+}
+
+void printInterfaces(const NetfilterQueue::Stats &stats,
+                     const NetfilterQueue::Stats &last,
+                     const std::vector<Config::Interface> &interfaces,
+                     double interval_s) {
+  std::cout << "Interfaces:";
+  for (uint32_t i = 0; i < interfaces.size(); ++i) {
+    const NetfilterQueue::InterfaceStats &now = stats.interfaces[i];
+    const NetfilterQueue::InterfaceStats &before = last.interfaces[i];
+    std::cout << (i ? ", " : " ") << interfaces[i].name << " "
+              << (now.packets - before.packets) / interval_s << " pps "
+              << (now.bytes - before.bytes) * 8.0 / interval_s / 1e6
+              << " Mbit/s " << (now.drops - before.drops) << " drops";
+  }
+  std::cout << "\n";
+}
+
+void printTopFlows(const std::vector<FlowTable::FlowStats> &flows) {
+  auto address = [](uint32_t ip, uint16_t port) {
+    std::string text = std::to_string(ip >> 24) + "." +
+                       std::to_string(ip >> 16 & 0xFF) + "." +
+                       std::to_string(ip >> 8 & 0xFF) + "." +
+                       std::to_string(ip & 0xFF);
+    return port ? text + ":" + std::to_string(port) : text;
+  };
+
+  // Only impaired flows are interesting here
+  for (const FlowTable::FlowStats &flow : flows) {
+    if (flow.drops == 0 && flow.flips == 0) {
+      break;
+    }
+    std::cout << "Flow " << address(flow.key.src_ip, flow.key.src_port)
+              << " > " << address(flow.key.dst_ip, flow.key.dst_port)
+              << " proto " << static_cast<int>(flow.key.protocol) << ": "
+              << flow.packets << " packets, " << flow.drops
+              << " dropped segments, " << flow.flips << " flipped bits\n";
+  }
+}
+
+void printFidelity(const std::array<FidelityMonitor::Link, NUM_LINKS> &links,
+                   const Config::Fidelity &config,
+                   std::array<uint32_t, NUM_LINKS> &drifting) {
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    std::vector<FidelityMonitor::Figure> figures =
+        FidelityMonitor::compare(links[link]);
+    if (figures.empty()) {
+      continue;
+    }
+
+    // realized/configured, then one warning per figure that drifted off
+    std::cout << "Fidelity " << LINK_SECTIONS[link] << ":";
+    for (size_t i = 0; i < figures.size(); ++i) {
+      const FidelityMonitor::Figure &figure = figures[i];
+      std::cout << (i > 0 ? ", " : " ") << figure.name << " "
+                << figure.realized << "/" << figure.target;
+    }
+    if (links[link].burst_ms.count > 1) {
+      std::cout << ", burst duration stddev ms "
+                << links[link].burst_ms.stddev();
+    }
+    std::cout << "\n";
+
+    for (size_t i = 0; i < figures.size(); ++i) {
+      const FidelityMonitor::Figure &figure = figures[i];
+      uint32_t bit = 1u << figure.index;
+      bool drifts = figure.samples >= config.min_samples &&
+                    figure.error() > config.tolerance;
+      if (drifts && !(drifting[link] & bit)) {
+        std::cerr << "Warning: " << LINK_SECTIONS[link] << " " << figure.name
+                  << " is " << figure.realized << ", "
+                  << figure.error() * 100.0 << "% off the configured "
+                  << figure.target << ".\n";
+      }
+      drifting[link] = drifts ? drifting[link] | bit : drifting[link] & ~bit;
+    }
+  }
+}
+} // namespace
+
+void scheduleStatsReport(PeriodicTasks &tasks,
+                         const ConfigManager &config_manager,
+                         StatsSource source) {
+  double interval_s = config_manager.getSnapshot()->stats_interval_s;
+  if (interval_s <= 0) {
+    return;
+  }
+  auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(interval_s));
+
+  NetfilterQueue::Stats last{};
+  size_t top_n = config_manager.getSnapshot()->flows.top_n;
+  Config::Fidelity fidelity = config_manager.getSnapshot()->fidelity;
+  std::array<uint32_t, NUM_LINKS> drifting{};
+  std::vector<Config::Interface> interfaces =
+      reportedInterfaces(*config_manager.getSnapshot());
+  auto report = [&tasks, source, interval_s, top_n, interfaces, fidelity,
+                 drifting, last]() mutable {
+    if (!logEnabled(LogLevel::INFO)) {
+      return;
+    }
+    NetfilterQueue::Stats stats = source.stats();
+    double mbps = (stats.bytes - last.bytes) * 8.0 / interval_s / 1e6;
+    std::cout << "Stats: "
+              << (stats.packets - last.packets) / interval_s << " queued pps, "
+              << (stats.segments - last.segments) / interval_s
+              << " segment pps, " << mbps << " Mbit/s, "
+              << (stats.gso_packets - last.gso_packets) << " GSO packets, "
+              << (stats.burst_drops - last.burst_drops) << " burst drops, "
+              << (stats.outage_drops - last.outage_drops) << " outage drops, "
+              << (stats.rate_drops - last.rate_drops) << " rate drops, "
+              << (stats.corrupted_packets - last.corrupted_packets)
+              << " corrupted, " << stats.in_flight << " in flight, "
+              << (stats.backpressure_waits - last.backpressure_waits)
+              << " backpressure waits\n";
+    uint64_t lost = stats.lost_packets - last.lost_packets;
+    uint64_t shed = stats.shed_packets - last.shed_packets;
+    uint64_t kernel_drops = stats.queue_dropped + stats.user_dropped -
+                            last.queue_dropped - last.user_dropped;
+    if (lost > 0 || shed > 0 || stats.shed_level > 0 || kernel_drops > 0) {
+      std::cout << "Overload: " << (stats.overflows - last.overflows)
+                << " overflows, " << lost << " lost, " << shed
+                << " shed packets, " << stats.shed_level
+                << " links bypassed, "
+                << (stats.queue_dropped - last.queue_dropped)
+                << " queue full drops, "
+                << (stats.user_dropped - last.user_dropped)
+                << " socket full drops, " << stats.queue_total
+                << " queued in kernel, " << stats.socket_buffer
+                << " bytes socket buffer\n";
+    }
+    if (stats.untimestamped > last.untimestamped) {
+      std::cout << "Timestamps: "
+                << (stats.untimestamped - last.untimestamped)
+                << " packets without a kernel timestamp\n";
+    }
+    if (interfaces.size() > 1) {
+      printInterfaces(stats, last, interfaces, interval_s);
+    }
+    printLinkLatency(source.latency(), source.latency_names);
+    printJitter(tasks.jitter());
+    if (source.top_flows && top_n > 0) {
+      printTopFlows(source.top_flows(top_n));
+    }
+    if (fidelity.enabled) {
+      printFidelity(source.fidelity(), fidelity, drifting);
+    }
+    last = stats;
+  };
+  tasks.add("stats", period, report);
+}
+
+std::vector<Config::Interface> reportedInterfaces(const Config &config) {
+  if (!config.xdp.enabled) {
+    return config.interfaces;
+  }
+  std::vector<Config::Interface> ports;
+  for (const std::string &port : config.xdp.ports) {
+    ports.push_back({port, 0, {}});
+  }
+  return ports;
+}
+
+AdminServer::Counters
+statsCounters(const NetfilterQueue::Stats &stats,
+              const std::vector<Config::Interface> &interfaces) {
+  AdminServer::Counters counters{
+      {"packets", stats.packets},
+      {"segments", stats.segments},
+      {"gso_packets", stats.gso_packets},
+      {"bytes", stats.bytes},
+      {"burst_drops", stats.burst_drops},
+      {"outage_drops", stats.outage_drops},
+      {"rate_drops", stats.rate_drops},
+      {"corrupted_packets", stats.corrupted_packets},
+      {"flipped_bits", stats.flipped_bits},
+      {"backpressure_waits", stats.backpressure_waits},
+      {"in_flight", stats.in_flight},
+      {"truncated_messages", stats.truncated_messages},
+      {"overflows", stats.overflows},
+      {"lost_packets", stats.lost_packets},
+      {"shed_packets", stats.shed_packets},
+      {"shed_level", stats.shed_level},
+      {"untimestamped", stats.untimestamped},
+      {"queue_total", stats.queue_total},
+      {"queue_dropped", stats.queue_dropped},
+      {"user_dropped", stats.user_dropped},
+      {"socket_buffer", stats.socket_buffer}};
+  for (uint32_t i = 0; i < interfaces.size(); ++i) {
+    const NetfilterQueue::InterfaceStats &interface = stats.interfaces[i];
+    counters.push_back({interfaces[i].name + "_packets", interface.packets});
+    counters.push_back({interfaces[i].name + "_bytes", interface.bytes});
+    counters.push_back({interfaces[i].name + "_drops", interface.drops});
+  }
+  return counters;
+}
+
+std::unique_ptr<AdminServer>
+startAdminServer(ConfigManager &config_manager,
+                 std::function<AdminServer::Counters()> counters) {
+  Config::Admin config = config_manager.getSnapshot()->admin;
+  if (!config.enabled) {
+    return nullptr;
+  }
+
+  AdminServer::Hooks hooks;
+  hooks.reload = [&config_manager] { return reloadConfig(config_manager); };
+  hooks.counters = std::move(counters);
+
+  try {
+    auto admin = std::make_unique<AdminServer>(config_manager,
+                                               config.socket_path, hooks);
+    admin->start();
+    std::cout << "Admin socket listening on " << config.socket_path << "\n";
+    return admin;
+  } catch (const std::exception &error) {
+    std::cerr << "Warning: Admin socket disabled: " << error.what() << "\n";
+    return nullptr;
+  }
+}
+
+void printJitter(const JitterStats::Summary &jitter) {
+  if (jitter.samples == 0) {
+    return;
+  }
+  std::cout << "Timer jitter: mean " << jitter.mean_us << " us, p99 <= "
+            << jitter.p99_us << " us, max " << jitter.max_us << " us over "
+            << jitter.samples << " wakeups\n";
+}
@@ -0,0 +1,54 @@
+// src/daemon/Reporting.hpp
+
+// ---- Reporting Usage ---- //
+
+// What the daemon tells its operator: the periodic stats lines (rates,
+// overload, per interface and per link latency, timer jitter, top flows
+// and impairment fidelity) and the counters of the admin socket.
+
+// Example:
+// scheduleStatsReport(tasks, config_manager, queueStats(queue));
+// std::unique_ptr<AdminServer> admin =
+//     startAdminServer(config_manager, [&queue, interfaces] {
+//       return statsCounters(queue.getStats(), interfaces);
+//     });
+// ...
+// printJitter(tasks.jitter()); // once more on shutdown
+
+// Stats lines go to stdout every stats_interval_s when the log level is
+// info or lower, rates are over the last interval. A fidelity figure that
+// drifts off its target by more than fidelity.tolerance is warned about on
+// stderr once, and again only after it came back in line.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "AdminServer.hpp"
+#include "ConfigManager.hpp"
+#include "Housekeeping.hpp"
+#include "JitterStats.hpp"
+#include "NetfilterQueue.hpp"
+#include "PeriodicTasks.hpp"
+
+// Nothing to schedule when stats_interval_s is 0
+void scheduleStatsReport(PeriodicTasks &tasks,
+                         const ConfigManager &config_manager,
+                         StatsSource source);
+
+// The bridge's ports when it runs, the queued interfaces otherwise
+std::vector<Config::Interface> reportedInterfaces(const Config &config);
+
+AdminServer::Counters
+statsCounters(const NetfilterQueue::Stats &stats,
+              const std::vector<Config::Interface> &interfaces);
+
+// nullptr when admin.enabled is off or the socket can't be opened, the
+// daemon runs on without it
+std::unique_ptr<AdminServer>
+startAdminServer(ConfigManager &config_manager,
+                 std::function<AdminServer::Counters()> counters);
+
+void printJitter(const JitterStats::Summary &jitter);
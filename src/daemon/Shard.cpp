@@ -0,0 +1,134 @@
+// src/daemon/Shard.cpp
+
+#include "Shard.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <sys/prctl.h>
+
+#include "Daemon.hpp"
+#include "EphemerisTable.hpp"
+#include "Housekeeping.hpp"
+#include "Log.hpp"
+#include "NetfilterQueue.hpp"
+#include "PeriodicTasks.hpp"
+#include "SharedState.hpp"
+#include "SimClock.hpp"
+#include "ThreadTuning.hpp"
+
+namespace {
+void applyControl(ConfigManager &config_manager,
+                  const SharedState::Control &control) {
+  config_manager.update([&control](Config &config) {
+    for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+      config.link(link) = control.links[link];
+    }
+    config.forced_bursts = control.forced_bursts;
+  });
+}
+
+void scheduleShardSync(PeriodicTasks &tasks, ConfigManager &config_manager,
+                       SharedState &shared, uint32_t shard,
+                       const NetfilterQueue &queue) {
+  // A restarted shard carries on from the totals its slot already has,
+  // gauges start from zero again
+  SharedState::Counters base{};
+  shared.counters(shard, base);
+  base.stats.in_flight = 0;
+  base.stats.shed_level = 0;
+  base.stats.queue_total = 0;
+  base.stats.socket_buffer = 0;
+
+  // The file was just loaded, only changes made since need applying
+  SharedState::Control control{};
+  uint64_t generation = 0;
+  uint64_t reloads = 0;
+  if (shared.control(control)) {
+    applyControl(config_manager, control);
+    generation = control.generation;
+    reloads = control.reloads;
+  }
+
+  auto sync = [&config_manager, &shared, &queue, shard, base, generation,
+               reloads]() mutable {
+    SharedState::Counters counters{queue.getStats(), queue.linkLatency(),
+                                   queue.fidelity()};
+    SharedState::add(counters, base);
+    shared.publishCounters(shard, counters);
+
+    SharedState::Control control{};
+    if (!shared.control(control) || control.generation == generation) {
+      return;
+    }
+    if (control.reloads != reloads) {
+      reloadConfig(config_manager);
+    }
+    applyControl(config_manager, control);
+    generation = control.generation;
+    reloads = control.reloads;
+  };
+  tasks.add("shard-sync", SHARD_SYNC_PERIOD, sync);
+}
+} // namespace
+
+// One queue of a sharded daemon, everything else is the coordinator's
+void runShard(ConfigManager &config_manager, uint32_t shard) {
+  // a shard has no business outliving its coordinator
+  prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+  auto config = config_manager.getSnapshot();
+  std::unique_ptr<SharedState> shared =
+      SharedState::attach(config->shards.shm_name);
+  const SharedState::Header &header = shared->header();
+  if (shard >= header.shards) {
+    throw std::runtime_error("Shard " + std::to_string(shard) +
+                             " out of range, the coordinator runs " +
+                             std::to_string(header.shards));
+  }
+  if (config->interfaces.size() != header.interfaces) {
+    throw std::runtime_error("Shard " + std::to_string(shard) + " has " +
+                             std::to_string(config->interfaces.size()) +
+                             " interfaces, the coordinator " +
+                             std::to_string(header.interfaces));
+  }
+
+  Config::Runtime runtime = config->runtime;
+  std::cout << "Shard " << shard << ", runtime profile: " << runtime.profile
+            << "\n";
+  if (runtime.lock_memory) {
+    lockAllMemory();
+  }
+
+  // same origin as every other shard, so burst timelines line up
+  SimClock clock(header.time_scale,
+                 SimClock::time_point(
+                     std::chrono::duration_cast<SimClock::time_point::duration>(
+                         std::chrono::nanoseconds(header.origin_ns))));
+  setLogLevel(config->log_level);
+  std::shared_ptr<const EphemerisTable> ephemeris =
+      openEphemeris(config_manager, clock, header.ephemeris_start_time);
+
+  g_queue = std::make_unique<NetfilterQueue>(
+      config_manager, clock, ephemeris, static_cast<uint16_t>(shard),
+      header.seed);
+
+  // The coordinator prints the stats and runs the admin socket
+  PeriodicTasks tasks;
+  tasks.setPlacement({runtime.timer_cpu, runtime.realtime_priority});
+  scheduleJitterProbe(tasks, runtime);
+  scheduleShardSync(tasks, config_manager, *shared, shard, *g_queue);
+  scheduleReload(tasks, config_manager);
+  scheduleSocketBuffer(tasks, *g_queue);
+  tasks.start();
+
+  g_queue->run();
+
+  tasks.stop();
+  std::cout << "Shard " << shard << " shutting down.\n";
+  g_queue.reset();
+}
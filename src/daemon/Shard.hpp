@@ -0,0 +1,31 @@
+// src/daemon/Shard.hpp
+
+// ---- Shard Usage ---- //
+
+// One shard of a sharded daemon, started by its coordinator as
+// "lunar-network-daemon --shard <index>". It runs the NetfilterQueue of
+// queue + index on every interface, everything else (iptables, tc, stats
+// lines, the admin socket) is the coordinator's, see Coordinator.hpp.
+
+// Example:
+// runShard(config_manager, 2); // returns after SIGTERM
+
+// The shard attaches to the coordinator's SharedState and takes its clock
+// origin, RNG seed and ephemeris start from there, so burst timelines of
+// all shards line up. Every SHARD_SYNC_PERIOD it publishes its counters and
+// applies the link changes and reloads the coordinator published. A shard
+// gets SIGTERM when its coordinator dies.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "ConfigManager.hpp"
+
+// how often a coordinator publishes config changes and a shard publishes
+// its counters and picks the changes up
+constexpr auto SHARD_SYNC_PERIOD = std::chrono::milliseconds(100);
+
+// Throws if the coordinator's segment doesn't match the config
+void runShard(ConfigManager &config_manager, uint32_t shard);
@@ -0,0 +1,103 @@
+// src/impairment/BurstModel.cpp
+
+#include "BurstModel.hpp"
+
+#include <algorithm>
+
+bool BurstModel::inBurst(State &state, const Config::LinkProperties &props,
+                         std::chrono::steady_clock::time_point now,
+                         uint64_t seed, uint32_t stream) {
+  // Profiles without bursts never leave the good state
+  if (props.base_packet_loss_burst_freq_per_minute <= 0) {
+    return false;
+  }
+
+  // The timeline starts good at the origin, a packet back-dated to its
+  // kernel timestamp can be older. Left alone, the state would still hold
+  // the burst that ends at the origin.
+  if (now < state.origin) {
+    return false;
+  }
+
+  // Common case, nothing is due
+  if (now < state.next_transition) {
+    return state.in_burst;
+  }
+
+  // A transition clamped to the end of its slot, a slot length changed by a
+  // reload or a long idle period all land in another slot
+  auto slot_length = std::max<std::chrono::steady_clock::duration>(
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double, std::milli>(
+              SLOT_CYCLES * (meanGoodMs(props) + meanBadMs(props)))),
+      std::chrono::microseconds(1));
+  uint64_t slot = static_cast<uint64_t>((now - state.origin) / slot_length);
+  if (slot != state.slot || slot_length != state.slot_length) {
+    restart(state, props, slot, slot_length, seed, stream);
+  }
+
+  // Replay the transitions that happened since the last packet, the slot
+  // end bounds the work
+  auto slot_end = state.origin + slot_length * static_cast<int64_t>(slot + 1);
+  while (now >= state.next_transition) {
+    CounterRng rng(seed, stream, slot << 32 | state.transitions++);
+    state.in_burst = !state.in_burst;
+    state.next_transition = std::min(
+        state.next_transition + sampleSojourn(state.in_burst, props, rng),
+        slot_end);
+  }
+  return state.in_burst;
+}
+
+void BurstModel::restart(State &state, const Config::LinkProperties &props,
+                         uint64_t slot,
+                         std::chrono::steady_clock::duration slot_length,
+                         uint64_t seed, uint32_t stream) {
+  auto slot_start = state.origin + slot_length * static_cast<int64_t>(slot);
+  CounterRng rng(seed, stream, slot << 32);
+  if (slot == 0) {
+    // the run starts in the good state
+    state.in_burst = false;
+  } else {
+    double good_ms = meanGoodMs(props);
+    double bad_ms = meanBadMs(props);
+    state.in_burst = rng.uniform() * (good_ms + bad_ms) < bad_ms;
+  }
+  state.slot = slot;
+  state.slot_length = slot_length;
+  state.transitions = 1;
+  state.next_transition =
+      std::min(slot_start + sampleSojourn(state.in_burst, props, rng),
+               slot_start + slot_length);
+}
+
+double BurstModel::meanGoodMs(const Config::LinkProperties &props) {
+  // ms/burst error = 60s * 1000ms / (burst error/min)
+  return (60.0 * 1000.0) / props.base_packet_loss_burst_freq_per_minute;
+}
+
+double BurstModel::meanBadMs(const Config::LinkProperties &props) {
+  return std::max(props.base_packet_loss_burst_duration_ms, 0.0);
+}
+
+std::chrono::steady_clock::duration
+BurstModel::sampleSojourn(bool in_burst, const Config::LinkProperties &props,
+                          CounterRng &rng) {
+  double ms;
+  if (in_burst) {
+    ms = std::max(rng.normal(props.base_packet_loss_burst_duration_ms,
+                             props.base_packet_loss_burst_duration_stddev),
+                  0.0);
+  } else {
+    // a non-positive frequency sample means no burst this minute
+    double freq = rng.normal(props.base_packet_loss_burst_freq_per_minute,
+                             props.packet_loss_burst_freq_stddev);
+    ms = freq > 0 ? (60.0 * 1000.0) / freq : 60.0 * 1000.0;
+  }
+
+  // Never return a zero sojourn, the replay loop must make progress
+  return std::max<std::chrono::steady_clock::duration>(
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double, std::milli>(ms)),
+      std::chrono::microseconds(1));
+}
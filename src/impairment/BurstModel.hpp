@@ -0,0 +1,88 @@
+// src/impairment/BurstModel.hpp
+
+// ---- BurstModel Usage ---- //
+
+// BurstModel is a two-state Gilbert-Elliott style packet loss model that is
+// evaluated lazily when a packet arrives, there are no timer threads.
+
+// Each link profile keeps a small State, the model compares the packet
+// timestamp against the sampled time of the next good <-> bad transition and
+// only does work when that time has passed.
+// Example:
+// BurstModel::State state(clock.origin());
+// bool drop = BurstModel::inBurst(state, props, pkt.getTimeReceived(), seed,
+//                                 rngStream(RNG_BURST, profile_id));
+
+// Sojourn times follow the config parameters:
+// good state => 60000 / N(base_packet_loss_burst_freq_per_minute, stddev) ms
+// bad state  => N(base_packet_loss_burst_duration_ms, stddev) ms
+// Only future sojourns are sampled from props, so passing the props of the
+// current config snapshot picks up a reload at the next transition.
+
+// Time since the origin is cut into slots of SLOT_CYCLES mean good + bad
+// cycles. Packets before the origin are never in a burst. Slot 0 starts in the
+// good state at the origin, every later slot restarts the process at its start
+// from the stationary distribution. The n-th draw of slot k comes from
+// CounterRng(seed, stream, k << 32 | n), so the burst timeline is a pure
+// function of the seed, the stream, the origin and the props. Two states of the
+// same profile evaluated at different packets, on different threads or in
+// different processes agree on when bursts happen, whenever they were created.
+// A state that falls behind by more than a slot jumps straight to the slot of
+// the packet, so a packet never replays more than one slot of transitions.
+
+// A reload that changes the mean cycle changes the slot length, each state
+// replays its slot with the new props at its next transition and agrees
+// with the others again once they saw the reload too. One that only changes
+// a spread is picked up at the next transition, states that saw it at
+// different packets may disagree until the next slot starts.
+
+// The state itself is not thread safe, each packet thread owns its states.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "ConfigManager.hpp"
+#include "CounterRng.hpp"
+
+class BurstModel {
+public:
+  struct State {
+    // Starts as a burst ending at origin, the first transition enters the
+    // good state at origin
+    explicit State(std::chrono::steady_clock::time_point origin = {})
+        : in_burst(true), transitions(0), next_transition(origin),
+          origin(origin), slot(0), slot_length(0) {}
+
+    bool in_burst;
+    uint64_t transitions; // draws taken in the current slot
+    std::chrono::steady_clock::time_point next_transition;
+    std::chrono::steady_clock::time_point origin;
+    uint64_t slot;
+    std::chrono::steady_clock::duration slot_length; // 0 before the first
+  };
+
+  // Mean good + bad cycles per slot
+  static constexpr double SLOT_CYCLES = 256;
+
+  // Advances state to now and returns whether the link is inside a burst
+  static bool inBurst(State &state, const Config::LinkProperties &props,
+                      std::chrono::steady_clock::time_point now, uint64_t seed,
+                      uint32_t stream);
+
+  // Mean sojourn times in ms, used to restart at slot boundaries
+  static double meanGoodMs(const Config::LinkProperties &props);
+  static double meanBadMs(const Config::LinkProperties &props);
+
+private:
+  // Jumps to the start of slot and replays its first draw
+  static void restart(State &state, const Config::LinkProperties &props,
+                      uint64_t slot,
+                      std::chrono::steady_clock::duration slot_length,
+                      uint64_t seed, uint32_t stream);
+
+  static std::chrono::steady_clock::duration
+  sampleSojourn(bool in_burst, const Config::LinkProperties &props,
+                CounterRng &rng);
+};
@@ -0,0 +1,138 @@
+// src/impairment/CounterRng.hpp
+
+// ---- CounterRng Usage ---- //
+
+// CounterRng is a counter-based random number generator (Philox4x32-10).
+// Instead of carrying state between calls, every draw is a pure function of
+// (seed, stream, index), so the same packet or burst transition always gets
+// the same random numbers regardless of thread count or scheduling.
+
+// Example:
+// CounterRng rng(seed, rngStream(RNG_BIT_ERRORS, profile_id), packet_id);
+// double u = rng.uniform();          // [0, 1)
+// double x = rng.normal(mean, sd);   // Box-Muller
+// double y = rng.tableNormal(mean, sd); // one draw, quantile table
+// uint64_t gap = rng.geometric(std::log1p(-p)); // failures before a hit
+// uint32_t raw = rng();              // satisfies UniformRandomBitGenerator
+
+// Streams separate independent uses of the same index, e.g. bit errors and
+// burst transitions of one profile never share random numbers.
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+
+// Purpose of a stream, combined with a profile id by rngStream()
+constexpr uint32_t RNG_BURST = 1;
+constexpr uint32_t RNG_BIT_ERRORS = 2;
+constexpr uint32_t RNG_DELAY = 3;
+
+constexpr uint32_t rngStream(uint32_t purpose, uint32_t profile) {
+  return purpose << 16 | (profile & 0xFFFF);
+}
+
+// Standard normal quantiles at the centres of 2^NORMAL_TABLE_BITS equally
+// likely bins, built once at startup. The tails end at about 3.6 sigma.
+constexpr int NORMAL_TABLE_BITS = 12;
+
+inline const std::array<double, size_t{1} << NORMAL_TABLE_BITS>
+    NORMAL_QUANTILES = [] {
+      std::array<double, size_t{1} << NORMAL_TABLE_BITS> table{};
+      for (size_t i = 0; i < table.size(); ++i) {
+        double p = (static_cast<double>(i) + 0.5) / table.size();
+        // bisection on the CDF, 0.5 * erfc(-x / sqrt(2))
+        double low = -10.0;
+        double high = 10.0;
+        for (int step = 0; step < 64; ++step) {
+          double mid = (low + high) / 2;
+          if (0.5 * std::erfc(-mid / std::numbers::sqrt2) < p) {
+            low = mid;
+          } else {
+            high = mid;
+          }
+        }
+        table[i] = (low + high) / 2;
+      }
+      return table;
+    }();
+
+class CounterRng {
+public:
+  using result_type = uint32_t;
+  using Block = std::array<uint32_t, 4>;
+  using Key = std::array<uint32_t, 2>;
+
+  CounterRng(uint64_t seed, uint32_t stream, uint64_t index)
+      : counter_{static_cast<uint32_t>(index),
+                 static_cast<uint32_t>(index >> 32), stream, 0},
+        key_{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+        block_{}, used_(4) {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT32_MAX; }
+
+  result_type operator()() {
+    if (used_ == 4) {
+      block_ = philox(counter_, key_);
+      ++counter_[3];
+      used_ = 0;
+    }
+    return block_[used_++];
+  }
+
+  // 53 random bits scaled into [0, 1)
+  double uniform() {
+    uint64_t bits = (static_cast<uint64_t>((*this)()) << 32 | (*this)()) >> 11;
+    return static_cast<double>(bits) * 0x1.0p-53;
+  }
+
+  double normal(double mean, double stddev) {
+    // 1 - uniform() is in (0, 1] so the log is finite
+    double radius = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+    double angle = 2.0 * std::numbers::pi * uniform();
+    return mean + stddev * radius * std::cos(angle);
+  }
+
+  // Normal sample from NORMAL_QUANTILES, a single 32-bit draw instead of a
+  // log, sqrt and cos
+  double tableNormal(double mean, double stddev) {
+    return mean +
+           stddev * NORMAL_QUANTILES[(*this)() >> (32 - NORMAL_TABLE_BITS)];
+  }
+
+  // Failures before the first success of independent trials that succeed
+  // with probability p > 0, given log1m_p = log(1 - p). Saturates at
+  // UINT64_MAX, so a tiny p never overflows.
+  uint64_t geometric(double log1m_p) {
+    double gap = std::floor(std::log(1.0 - uniform()) / log1m_p);
+    return gap < 0x1.0p63 ? static_cast<uint64_t>(gap) : UINT64_MAX;
+  }
+
+  // Philox4x32 with 10 rounds, as in Salmon et al. "Parallel random numbers:
+  // as easy as 1, 2, 3" (Random123)
+  static constexpr Block philox(Block counter, Key key) {
+    for (int round = 0; round < 10; ++round) {
+      if (round > 0) {
+        key[0] += 0x9E3779B9;
+        key[1] += 0xBB67AE85;
+      }
+      uint64_t product0 = uint64_t{0xD2511F53} * counter[0];
+      uint64_t product1 = uint64_t{0xCD9E8D57} * counter[2];
+      counter = {static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                 static_cast<uint32_t>(product1),
+                 static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                 static_cast<uint32_t>(product0)};
+    }
+    return counter;
+  }
+
+private:
+  Block counter_;
+  Key key_;
+  Block block_;
+  int used_;
+};
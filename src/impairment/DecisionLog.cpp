@@ -0,0 +1,200 @@
+// src/impairment/DecisionLog.cpp
+
+#include "DecisionLog.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::atomic<uint32_t> DecisionLog::next_writer_{0};
+
+DecisionLog::DecisionLog(const Config::DecisionLog &config)
+    : config_(config),
+      writer_(next_writer_.fetch_add(1, std::memory_order_relaxed)) {
+  std::error_code error;
+  std::filesystem::create_directories(config_.directory, error);
+  if (error) {
+    throw std::runtime_error("Error creating decision log directory " +
+                             config_.directory + ": " + error.message());
+  }
+  current_ = createSegment(0);
+  header_ = static_cast<Header *>(current_.mapping);
+  records_ = reinterpret_cast<Record *>(header_ + 1);
+  prepared_ = std::async(std::launch::async,
+                         [this] { return createSegment(1); });
+}
+
+DecisionLog::~DecisionLog() {
+  closeSegment(current_);
+  // the prepared segment never got a record
+  if (prepared_.valid()) {
+    try {
+      Segment unused = prepared_.get();
+      closeSegment(unused);
+      ::unlink(unused.path.c_str());
+    } catch (const std::exception &) {
+      // already reported when it would have been used
+    }
+  }
+}
+
+bool DecisionLog::rotate() {
+  if (stopped_) {
+    return false;
+  }
+  Segment full = std::move(current_);
+  current_ = Segment{};
+  try {
+    current_ = prepared_.get();
+  } catch (const std::exception &error) {
+    std::cerr << "Warning: Decision log stopped: " << error.what() << "\n";
+    stopped_ = true;
+    closeSegment(full);
+    return false;
+  }
+  ++segment_;
+  header_ = static_cast<Header *>(current_.mapping);
+  records_ = reinterpret_cast<Record *>(header_ + 1);
+  next_ = 0;
+
+  // Trimming the full segment and creating the next one are both slow,
+  // neither happens on the packet thread
+  uint32_t index = segment_ + 1;
+  prepared_ = std::async(std::launch::async,
+                         [this, full = std::move(full), index]() mutable {
+                           closeSegment(full);
+                           return createSegment(index);
+                         });
+  return true;
+}
+
+DecisionLog::Segment DecisionLog::createSegment(uint32_t index) {
+  char name[64];
+  std::snprintf(name, sizeof(name), "decisions-%d-%u-%06u.lndlog",
+                static_cast<int>(getpid()), writer_, index);
+  Segment segment;
+  segment.path = config_.directory + "/" + name;
+  segment.capacity =
+      (uint64_t{config_.segment_mb} * 1024 * 1024 - sizeof(Header)) /
+      sizeof(Record);
+  segment.size = sizeof(Header) + segment.capacity * sizeof(Record);
+  const std::string &path = segment.path;
+
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Error creating decision log segment " + path +
+                             ": " + std::strerror(errno));
+  }
+  // Blocks are allocated now, so a full disk fails here and not with a
+  // SIGBUS on the packet path
+  int allocated = posix_fallocate(fd, 0, static_cast<off_t>(segment.size));
+  if (allocated != 0) {
+    ::close(fd);
+    ::unlink(path.c_str());
+    throw std::runtime_error("Error allocating decision log segment " + path +
+                             ": " + std::strerror(allocated));
+  }
+  // MAP_POPULATE faults every page in up front, appends never fault
+  void *mapping = mmap(nullptr, segment.size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, 0);
+  if (mapping == MAP_FAILED) {
+    ::close(fd);
+    ::unlink(path.c_str());
+    throw std::runtime_error("Error mapping decision log segment " + path);
+  }
+  segment.fd = fd;
+  segment.mapping = mapping;
+
+  auto *header = static_cast<Header *>(mapping);
+  std::memset(header, 0, sizeof(Header));
+  std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+  header->version = VERSION;
+  header->record_size = sizeof(Record);
+  header->writer = writer_;
+  header->segment = index;
+  header->capacity = segment.capacity;
+  header->created_unix_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+
+  // max_segments counts the segments that were started, not this one
+  segments_.push_back(path);
+  while (config_.max_segments > 0 &&
+         segments_.size() > config_.max_segments + 1) {
+    ::unlink(segments_.front().c_str());
+    segments_.pop_front();
+  }
+  return segment;
+}
+
+void DecisionLog::closeSegment(Segment &segment) {
+  if (!segment.mapping) {
+    return;
+  }
+  uint64_t records = static_cast<Header *>(segment.mapping)->records;
+  munmap(segment.mapping, segment.size);
+  // the unused tail of the preallocation goes back to the file system
+  if (ftruncate(segment.fd, static_cast<off_t>(sizeof(Header) +
+                                               records * sizeof(Record))) !=
+      0) {
+    std::cerr << "Warning: Could not trim decision log segment "
+              << segment.path << ".\n";
+  }
+  ::close(segment.fd);
+  segment.fd = -1;
+  segment.mapping = nullptr;
+  segment.capacity = 0;
+}
+
+DecisionLog::Reader::Reader(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Error opening decision log segment: " + path);
+  }
+  struct stat st{};
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+    ::close(fd);
+    throw std::runtime_error("Decision log segment too short: " + path);
+  }
+  void *mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                       MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Error mapping decision log segment: " + path);
+  }
+  mapping_ = mapping;
+  mapping_size_ = static_cast<size_t>(st.st_size);
+
+  header_ = static_cast<const Header *>(mapping);
+  if (std::memcmp(header_->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header_->version != VERSION || header_->record_size != sizeof(Record)) {
+    munmap(mapping_, mapping_size_);
+    throw std::runtime_error("Not a decision log segment: " + path);
+  }
+
+  // The segment may still be written to, or be cut short by a crash before
+  // it was trimmed. Only whole records both the count and the file cover.
+  uint64_t records =
+      std::atomic_ref<uint64_t>(const_cast<uint64_t &>(header_->records))
+          .load(std::memory_order_acquire);
+  uint64_t fits = (mapping_size_ - sizeof(Header)) / sizeof(Record);
+  records_ = std::span<const Record>(
+      reinterpret_cast<const Record *>(header_ + 1), std::min(records, fits));
+}
+
+DecisionLog::Reader::~Reader() {
+  if (mapping_) {
+    munmap(mapping_, mapping_size_);
+  }
+}
@@ -0,0 +1,155 @@
+// src/impairment/DecisionLog.hpp
+
+// ---- DecisionLog Usage ---- //
+
+// DecisionLog is an append-only binary record of impairment decisions, one
+// fixed size Record per packet, for offline analysis of long campaigns.
+
+// Example:
+// DecisionLog log(config->decision_log); // throws std::runtime_error
+// log.append({now_ns, id, length, flips, mark, profile_id, link, verdict,
+//             in_burst, modified});
+//
+// DecisionLog::Reader segment("decision-log/decisions-1234-0-000000.lndlog");
+// for (const DecisionLog::Record &record : segment.records()) { ... }
+
+// Every writer (one per PacketProcessor, i.e. per processing thread) fills
+// its own segment files, preallocated and memory mapped, so append() is a
+// 32 byte store and a counter update with no lock and no system call. The
+// next segment is created and faulted in by a background task while the
+// current one fills, a full segment is swapped for it and trimmed to its
+// records in the background as well. With max_segments the oldest
+// segments of a writer are deleted as new ones are started.
+
+// Files are named decisions-<pid>-<writer>-<segment>.lndlog. Each starts
+// with a Header whose records count is updated with every append, so the
+// segment of a crashed daemon is still readable up to its last record.
+// tools/decision_log_csv turns segments into CSV.
+
+// A writer is owned by one thread. If a new segment can't be created the
+// log stops recording with a warning, the packet path carries on.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <span>
+#include <string>
+
+#include "ConfigManager.hpp"
+
+class DecisionLog {
+public:
+  // One impairment decision, layout is part of the file format
+  struct Record {
+    int64_t time_ns; // simulated time since start
+    uint32_t id;     // netfilter packet id
+    uint32_t length;
+    uint32_t flips; // bits flipped in this packet
+    uint32_t mark;
+    uint16_t profile_id;
+    uint8_t link; // LINK_* index, NUM_LINKS if unclassified
+    uint8_t verdict;
+    uint8_t in_burst;
+    uint8_t modified;
+    uint16_t reserved;
+  };
+  static_assert(sizeof(Record) == 32);
+
+  struct Header {
+    char magic[8]; // MAGIC
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t writer;
+    uint32_t segment;
+    uint64_t capacity; // records that fit the preallocated file
+    uint64_t records;  // records written, updated after each one
+    int64_t created_unix_ns;
+    uint8_t reserved[16];
+  };
+  static_assert(sizeof(Header) == 64);
+
+  static constexpr char MAGIC[8] = {'L', 'N', 'D', 'D', 'L', 'O', 'G', '\0'};
+  static constexpr uint32_t VERSION = 1;
+
+  // Creates the directory if needed and the first segment
+  explicit DecisionLog(const Config::DecisionLog &config);
+  ~DecisionLog();
+
+  DecisionLog(const DecisionLog &) = delete;
+  DecisionLog &operator=(const DecisionLog &) = delete;
+
+  void append(const Record &record) {
+    if (next_ == current_.capacity && !rotate()) {
+      return;
+    }
+    records_[next_++] = record;
+    // readers of a live segment see whole records only
+    std::atomic_ref<uint64_t>(header_->records)
+        .store(next_, std::memory_order_release);
+  }
+
+  uint32_t writer() const { return writer_; }
+  const std::string &path() const { return current_.path; }
+
+  // Maps one segment read-only, throws std::runtime_error if it is not a
+  // decision log segment
+  class Reader {
+  public:
+    explicit Reader(const std::string &path);
+    ~Reader();
+
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    const Header &header() const { return *header_; }
+    std::span<const Record> records() const { return records_; }
+
+  private:
+    void *mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    const Header *header_ = nullptr;
+    std::span<const Record> records_;
+  };
+
+private:
+  struct Segment {
+    std::string path;
+    int fd = -1;
+    void *mapping = nullptr;
+    size_t size = 0;
+    uint64_t capacity = 0; // 0 without a segment, append() then rotates
+  };
+
+  // Swaps in the prepared segment and starts preparing the one after it,
+  // false once the log had to stop
+  bool rotate();
+
+  // Creates, allocates and maps segment number index, throws
+  // std::runtime_error. Deletes segments beyond max_segments.
+  Segment createSegment(uint32_t index);
+
+  // Trims the segment to its records and unmaps it
+  static void closeSegment(Segment &segment);
+
+  Config::DecisionLog config_;
+  uint32_t writer_;
+  uint32_t segment_ = 0;             // index of current_
+  std::deque<std::string> segments_; // oldest first, the prepared one last
+
+  Segment current_;
+  Header *header_ = nullptr;
+  Record *records_ = nullptr;
+  uint64_t next_ = 0;
+
+  // The segment after current_, created in the background. Only one task
+  // runs at a time, segments_ is only touched by it or before it starts.
+  std::future<Segment> prepared_;
+
+  bool stopped_ = false;
+
+  static std::atomic<uint32_t> next_writer_;
+};
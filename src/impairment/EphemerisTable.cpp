@@ -0,0 +1,291 @@
+// src/impairment/EphemerisTable.cpp
+
+#include "EphemerisTable.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char EPHEMERIS_MAGIC[8] = {'L', 'N', 'D', 'E', 'P', 'H', 'E', 'M'};
+constexpr uint32_t EPHEMERIS_VERSION = 2;
+constexpr double SPEED_OF_LIGHT_KM_S = 299792.458;
+
+// On-disk layout, followed by count Sample records
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  double t0;
+  double step;
+  uint64_t fingerprint;
+  // the CSV the table was compiled from
+  uint64_t csv_size;
+  int64_t csv_mtime_ns;
+};
+
+struct Row {
+  double time;
+  double range_km;
+  double elevation_deg;
+};
+
+// Helper function: FNV-1a over the link budget parameters, a table compiled
+// with different parameters is rebuilt
+uint64_t fingerprint(const Config::Ephemeris &e) {
+  const double params[] = {e.step_s,
+                           e.reference_range_km,
+                           e.reference_ebn0_db,
+                           e.zenith_loss_db,
+                           e.min_elevation_deg,
+                           e.processing_delay_ms,
+                           e.max_bit_error_rate};
+  uint64_t hash = 0xcbf29ce484222325;
+  const auto *bytes = reinterpret_cast<const unsigned char *>(params);
+  for (size_t i = 0; i < sizeof(params); ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3;
+  }
+  return hash;
+}
+
+// Helper function: Modification time in nanoseconds, a CSV rewritten within
+// the second of the last compile still counts as changed
+int64_t mtimeNs(const struct stat &st) {
+  return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+         st.st_mtim.tv_nsec;
+}
+
+// Helper function: Read and sort the CSV rows, a non-numeric first line is
+// treated as a header
+std::vector<Row> readCsv(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("Error opening ephemeris file: " + path);
+  }
+
+  std::vector<Row> rows;
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream fields(line);
+    Row row;
+    if (!(fields >> row.time >> row.range_km >> row.elevation_deg)) {
+      if (rows.empty() && line_number == 1)
+        continue;
+      throw std::runtime_error("Bad ephemeris row " +
+                               std::to_string(line_number) + " in " + path);
+    }
+    rows.push_back(row);
+  }
+
+  std::sort(rows.begin(), rows.end(),
+            [](const Row &a, const Row &b) { return a.time < b.time; });
+  if (rows.size() < 2) {
+    throw std::runtime_error("Ephemeris file needs at least two rows: " +
+                             path);
+  }
+  return rows;
+}
+
+// Helper function: Link budget for one geometry sample
+EphemerisTable::Sample linkBudget(const Config::Ephemeris &e, double range_km,
+                                  double elevation_deg) {
+  EphemerisTable::Sample sample;
+  sample.latency_ms = static_cast<float>(
+      range_km / SPEED_OF_LIGHT_KM_S * 1000.0 + e.processing_delay_ms);
+
+  if (elevation_deg < e.min_elevation_deg || range_km <= 0) {
+    sample.bit_error_rate = static_cast<float>(e.max_bit_error_rate);
+    return sample;
+  }
+
+  double elevation_rad = elevation_deg * M_PI / 180.0;
+  double ebn0_db = e.reference_ebn0_db -
+                   20.0 * std::log10(range_km / e.reference_range_km) -
+                   e.zenith_loss_db / std::sin(elevation_rad);
+  double ebn0 = std::pow(10.0, ebn0_db / 10.0);
+  double ber = 0.5 * std::erfc(std::sqrt(ebn0));
+  sample.bit_error_rate =
+      static_cast<float>(std::min(ber, e.max_bit_error_rate));
+  return sample;
+}
+
+// Helper function: Binary table is stale if missing, older than the CSV,
+// compiled from a CSV of another size or mtime or built with other parameters
+bool needsCompile(const Config::Ephemeris &e, const std::string &bin_path) {
+  struct stat csv_stat{}, bin_stat{};
+  if (stat(bin_path.c_str(), &bin_stat) != 0)
+    return true;
+  bool have_csv = stat(e.csv.c_str(), &csv_stat) == 0;
+  if (have_csv && mtimeNs(csv_stat) > mtimeNs(bin_stat))
+    return true;
+
+  std::ifstream in(bin_path, std::ios::binary);
+  Header header{};
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    return true;
+  if (have_csv &&
+      (header.csv_size != static_cast<uint64_t>(csv_stat.st_size) ||
+       header.csv_mtime_ns != mtimeNs(csv_stat)))
+    return true;
+  return std::memcmp(header.magic, EPHEMERIS_MAGIC, sizeof(header.magic)) !=
+             0 ||
+         header.version != EPHEMERIS_VERSION ||
+         header.fingerprint != fingerprint(e);
+}
+} // namespace
+
+void EphemerisTable::compile(const Config::Ephemeris &ephemeris,
+                             const std::string &bin_path) {
+  if (ephemeris.step_s <= 0) {
+    throw std::runtime_error("ephemeris.step_s must be positive.");
+  }
+  // taken before reading, a CSV rewritten meanwhile is compiled again
+  struct stat csv_stat{};
+  stat(ephemeris.csv.c_str(), &csv_stat);
+  std::vector<Row> rows = readCsv(ephemeris.csv);
+
+  double t0 = rows.front().time;
+  double span = rows.back().time - t0;
+  size_t count = static_cast<size_t>(span / ephemeris.step_s) + 1;
+  if (count > UINT32_MAX) {
+    throw std::runtime_error("Ephemeris table too large, increase step_s.");
+  }
+
+  std::vector<Sample> samples;
+  samples.reserve(count);
+  size_t row = 0;
+  for (size_t i = 0; i < count; ++i) {
+    double t = t0 + static_cast<double>(i) * ephemeris.step_s;
+    while (row + 2 < rows.size() && rows[row + 1].time <= t)
+      ++row;
+    // interpolate the geometry, not the derived values
+    const Row &a = rows[row];
+    const Row &b = rows[row + 1];
+    double frac = b.time > a.time ? (t - a.time) / (b.time - a.time) : 0.0;
+    frac = std::clamp(frac, 0.0, 1.0);
+    samples.push_back(
+        linkBudget(ephemeris, a.range_km + frac * (b.range_km - a.range_km),
+                   a.elevation_deg +
+                       frac * (b.elevation_deg - a.elevation_deg)));
+  }
+
+  Header header{};
+  std::memcpy(header.magic, EPHEMERIS_MAGIC, sizeof(header.magic));
+  header.version = EPHEMERIS_VERSION;
+  header.count = static_cast<uint32_t>(count);
+  header.t0 = t0;
+  header.step = ephemeris.step_s;
+  header.fingerprint = fingerprint(ephemeris);
+  header.csv_size = static_cast<uint64_t>(csv_stat.st_size);
+  header.csv_mtime_ns = mtimeNs(csv_stat);
+
+  // write to a temporary file and rename so a running daemon never maps a
+  // half-written table
+  std::string tmp_path = bin_path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(samples.data()),
+              static_cast<std::streamsize>(samples.size() * sizeof(Sample)));
+    if (!out) {
+      throw std::runtime_error("Error writing ephemeris table: " + tmp_path);
+    }
+  }
+  if (std::rename(tmp_path.c_str(), bin_path.c_str()) != 0) {
+    throw std::runtime_error("Error replacing ephemeris table: " + bin_path);
+  }
+}
+
+double EphemerisTable::startTime(const Config::Ephemeris &ephemeris) {
+  return ephemeris.start_time > 0 ? ephemeris.start_time
+                                  : static_cast<double>(time(nullptr));
+}
+
+std::shared_ptr<const EphemerisTable>
+EphemerisTable::open(const Config::Ephemeris &ephemeris,
+                     std::chrono::steady_clock::time_point origin) {
+  std::string bin_path = ephemeris.csv + ".bin";
+  if (needsCompile(ephemeris, bin_path)) {
+    std::cout << "Compiling ephemeris table " << bin_path << ".\n";
+    compile(ephemeris, bin_path);
+  }
+
+  int fd = ::open(bin_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Error opening ephemeris table: " + bin_path);
+  }
+  struct stat st{};
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+    ::close(fd);
+    throw std::runtime_error("Ephemeris table too short: " + bin_path);
+  }
+  void *mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                       MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Error mapping ephemeris table: " + bin_path);
+  }
+
+  std::shared_ptr<EphemerisTable> table(new EphemerisTable());
+  table->mapping_ = mapping;
+  table->mapping_size_ = static_cast<size_t>(st.st_size);
+
+  const auto *header = static_cast<const Header *>(mapping);
+  if (sizeof(Header) + header->count * sizeof(Sample) > table->mapping_size_ ||
+      header->count == 0 || header->step <= 0) {
+    throw std::runtime_error("Corrupt ephemeris table: " + bin_path);
+  }
+
+  table->samples_ = reinterpret_cast<const Sample *>(header + 1);
+  table->count_ = header->count;
+  table->t0_ = header->t0;
+  table->inv_step_ = 1.0 / header->step;
+  table->start_time_ = startTime(ephemeris);
+  table->origin_ = origin;
+  table->link_mask_ = ephemeris.link_mask;
+  return table;
+}
+
+EphemerisTable::~EphemerisTable() {
+  if (mapping_) {
+    munmap(mapping_, mapping_size_);
+  }
+}
+
+EphemerisTable::Sample
+EphemerisTable::sample(std::chrono::steady_clock::time_point now) const {
+  return sampleAt(start_time_ +
+                  std::chrono::duration<double>(now - origin_).count());
+}
+
+EphemerisTable::Sample EphemerisTable::sampleAt(double unix_seconds) const {
+  double position = (unix_seconds - t0_) * inv_step_;
+  if (position <= 0)
+    return samples_[0];
+  if (position >= static_cast<double>(count_ - 1))
+    return samples_[count_ - 1];
+
+  size_t index = static_cast<size_t>(position);
+  float frac = static_cast<float>(position - static_cast<double>(index));
+  const Sample &a = samples_[index];
+  const Sample &b = samples_[index + 1];
+  return {a.latency_ms + frac * (b.latency_ms - a.latency_ms),
+          a.bit_error_rate + frac * (b.bit_error_rate - a.bit_error_rate)};
+}
@@ -0,0 +1,88 @@
+// src/impairment/EphemerisTable.hpp
+
+// ---- EphemerisTable Usage ---- //
+
+// EphemerisTable turns a precomputed ephemeris / link budget time series into
+// time-varying latency and bit error rate for the Earth-Moon links.
+
+// The input is a CSV of "timestamp_s,range_km,elevation_deg" rows (unix
+// seconds, ground station elevation of the Moon). On load it is resampled to
+// a fixed step, run through the link budget once, and written as a compact
+// binary table next to the CSV ("<csv>.bin"). The binary table is memory
+// mapped and reused by later runs as long as the CSV (its size and
+// nanosecond mtime) and the link budget parameters are unchanged.
+
+// Example:
+// auto table = EphemerisTable::open(config->ephemeris, clock.origin());
+// if (table->appliesTo(LINK_EARTH_TO_MOON)) {
+//   EphemerisTable::Sample s = table->sample(clock.now());
+//   // s.latency_ms, s.bit_error_rate
+// }
+
+// sample() is O(1), an index computation and one linear interpolation, so
+// no orbital math happens on the packet path.
+
+// Link budget used when compiling:
+// latency  = range / c + processing_delay_ms
+// Eb/N0    = reference_ebn0_db - 20 log10(range / reference_range_km)
+//            - zenith_loss_db / sin(elevation)
+// BER      = 0.5 erfc(sqrt(Eb/N0)) (BPSK), capped at max_bit_error_rate
+// Below min_elevation_deg the link is treated as lost and gets the cap.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "ConfigManager.hpp"
+
+class EphemerisTable {
+public:
+  struct Sample {
+    float latency_ms;
+    float bit_error_rate;
+  };
+
+  // Compiles the CSV if needed and maps the binary table, throws
+  // std::runtime_error on bad input. origin is the SimClock time that
+  // corresponds to ephemeris.start_time.
+  static std::shared_ptr<const EphemerisTable>
+  open(const Config::Ephemeris &ephemeris,
+       std::chrono::steady_clock::time_point origin);
+
+  // ephemeris.start_time, or now when it is 0. A sharded daemon resolves it
+  // once in the coordinator and hands it to every shard.
+  static double startTime(const Config::Ephemeris &ephemeris);
+
+  // Resamples the CSV and writes the binary table
+  static void compile(const Config::Ephemeris &ephemeris,
+                      const std::string &bin_path);
+
+  ~EphemerisTable();
+  EphemerisTable(const EphemerisTable &) = delete;
+  EphemerisTable &operator=(const EphemerisTable &) = delete;
+
+  Sample sample(std::chrono::steady_clock::time_point now) const;
+  Sample sampleAt(double unix_seconds) const;
+
+  bool appliesTo(uint32_t link) const { return link_mask_ & (1u << link); }
+  size_t size() const { return count_; }
+
+private:
+  EphemerisTable() = default;
+
+  void *mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+
+  const Sample *samples_ = nullptr;
+  size_t count_ = 0;
+  double t0_ = 0;
+  double inv_step_ = 0;
+
+  double start_time_ = 0;
+  std::chrono::steady_clock::time_point origin_;
+  uint32_t link_mask_ = 0;
+};
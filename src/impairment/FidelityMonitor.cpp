@@ -0,0 +1,130 @@
+// src/impairment/FidelityMonitor.cpp
+
+#include "FidelityMonitor.hpp"
+
+#include "BurstModel.hpp"
+
+void FidelityMonitor::Welford::merge(const Welford &other) {
+  if (other.count == 0) {
+    return;
+  }
+  double n = static_cast<double>(count);
+  double m = static_cast<double>(other.count);
+  double delta = other.mean - mean;
+  count += other.count;
+  mean += delta * m / (n + m);
+  m2 += other.m2 + delta * delta * n * m / (n + m);
+}
+
+void FidelityMonitor::record(const Observation &packet) {
+  Link &link = links_[packet.link];
+
+  if (packet.error_bits > 0) {
+    double bits = static_cast<double>(packet.error_bits);
+    link.bits += bits;
+    link.flips += packet.flips;
+    link.expected_flips += packet.ber_mean * bits;
+    link.ber.add(packet.flips / bits);
+  }
+
+  if (packet.burst_checked) {
+    const Config::LinkProperties &props = *packet.props;
+    double good_ms = BurstModel::meanGoodMs(props);
+    double bad_ms = BurstModel::meanBadMs(props);
+    double segments = static_cast<double>(packet.segments);
+    link.segments += packet.segments;
+    link.expected_burst_segments += segments * bad_ms / (good_ms + bad_ms);
+    if (packet.in_burst) {
+      link.burst_segments += packet.segments;
+    }
+
+    // a gap longer than a burst could have hidden one, it isn't observed.
+    // Bursts start at the model's cycle rate, like NetemFit assumes.
+    bool observed = false;
+    if (link.last_ns >= 0) {
+      double gap_ms = static_cast<double>(packet.now_ns - link.last_ns) / 1e6;
+      if (gap_ms >= 0 && gap_ms < bad_ms) {
+        observed = true;
+        link.observed_ms += gap_ms;
+        link.expected_bursts += gap_ms / (good_ms + bad_ms);
+      }
+    }
+    link.last_ns = packet.now_ns;
+
+    // A run is counted when it starts right after an observed gap and timed
+    // when no unobserved gap lies between its ends, a run found after an
+    // unobserved gap may have started (or ended and restarted) anywhere in it
+    if (!observed) {
+      link.run_timed = false;
+    }
+    if (packet.in_burst && !link.in_run) {
+      link.in_run = true;
+      link.run_timed = observed;
+      link.run_start_ns = packet.now_ns;
+      link.run_target_ms = bad_ms;
+      if (observed) {
+        ++link.bursts;
+      }
+    } else if (!packet.in_burst && link.in_run) {
+      link.in_run = false;
+      if (link.run_timed) {
+        link.burst_ms.add(
+            static_cast<double>(packet.now_ns - link.run_start_ns) / 1e6);
+        link.expected_burst_ms += link.run_target_ms;
+      }
+    }
+  }
+
+  published_[packet.link].store(link);
+}
+
+void FidelityMonitor::addTo(std::array<Link, NUM_LINKS> &totals) const {
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    merge(totals[link], published_[link].load());
+  }
+}
+
+void FidelityMonitor::merge(Link &total, const Link &part) {
+  total.bits += part.bits;
+  total.flips += part.flips;
+  total.expected_flips += part.expected_flips;
+  total.ber.merge(part.ber);
+  total.segments += part.segments;
+  total.burst_segments += part.burst_segments;
+  total.expected_burst_segments += part.expected_burst_segments;
+  total.bursts += part.bursts;
+  total.expected_bursts += part.expected_bursts;
+  total.observed_ms += part.observed_ms;
+  total.burst_ms.merge(part.burst_ms);
+  total.expected_burst_ms += part.expected_burst_ms;
+}
+
+std::vector<FidelityMonitor::Figure>
+FidelityMonitor::compare(const Link &link) {
+  std::vector<Figure> figures;
+  if (link.expected_flips > 0) {
+    figures.push_back({0, "bit error rate", link.flips / link.bits,
+                       link.expected_flips / link.bits, link.flips});
+  }
+  if (link.expected_burst_segments > 0) {
+    double segments = static_cast<double>(link.segments);
+    figures.push_back(
+        {1, "burst drop ratio",
+         static_cast<double>(link.burst_segments) / segments,
+         link.expected_burst_segments / segments,
+         static_cast<double>(link.bursts)});
+  }
+  if (link.expected_bursts > 0) {
+    double minutes = link.observed_ms / 60000.0;
+    figures.push_back({2, "bursts per minute",
+                       static_cast<double>(link.bursts) / minutes,
+                       link.expected_bursts / minutes,
+                       static_cast<double>(link.bursts)});
+  }
+  if (link.expected_burst_ms > 0) {
+    double count = static_cast<double>(link.burst_ms.count);
+    figures.push_back({3, "burst duration ms", link.burst_ms.mean,
+                       link.expected_burst_ms / count, count});
+  }
+  return figures;
+}
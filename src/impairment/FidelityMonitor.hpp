@@ -0,0 +1,143 @@
+// src/impairment/FidelityMonitor.hpp
+
+// ---- FidelityMonitor Usage ---- //
+
+// FidelityMonitor measures the impairment a PacketProcessor actually
+// applied, per link, next to what the config asked for: bit error rate,
+// share of segments lost to bursts, bursts per minute and burst duration.
+// Every packet updates a handful of running sums in O(1), nothing is kept
+// per packet.
+
+// Example:
+// FidelityMonitor monitor;                  // one per processing thread
+// monitor.record({link, now_ns, segments, props, true, in_burst, bits,
+//                 flips, ber_mean});
+// ...
+// std::array<FidelityMonitor::Link, NUM_LINKS> links{};
+// monitor.addTo(links);                     // any thread, sums processors
+// for (const auto &figure : FidelityMonitor::compare(links[link])) {
+//   std::cout << figure.name << " " << figure.realized << " vs "
+//             << figure.target << "\n";
+// }
+
+// Targets are summed up from the props and bit error rate each packet was
+// impaired with, so they follow reloads, scenario epochs and the ephemeris:
+// expected flips are ber_mean times the bits bit errors could hit, expected
+// burst drops the segments times the configured share of time in bursts.
+
+// Bursts are followed as runs of packets in a burst, a run is one burst
+// from its first dropped packet to the first packet that passes again. Only
+// gaps between packets closer together than a burst lasts are observed:
+// only observed time counts towards bursts per minute, whose target is the
+// model's cycle rate 60000 / (mean good + mean bad ms), and only runs that
+// start after an observed gap are counted, so idle links and gappy traffic
+// neither look burst free nor find a burst in every gap. Runs with no
+// unobserved gap between their ends are timed, durations are up to one
+// packet gap long.
+// Packets of a link with a forced burst state are left out.
+
+// Realized figures come with Welford running means and variances, merged
+// across threads with Chan's parallel update. The per packet bit error
+// rate spread includes the binomial noise of short packets.
+
+// record() is owner only, every Link it touched is published through a
+// SeqLock, so addTo() is safe from any thread.
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "ConfigManager.hpp"
+#include "SeqLock.hpp"
+#include "configs.hpp"
+
+class FidelityMonitor {
+public:
+  // Running mean and variance
+  struct Welford {
+    uint64_t count = 0;
+    double mean = 0;
+    double m2 = 0; // sum of squared differences from the mean
+
+    void add(double x) {
+      ++count;
+      double delta = x - mean;
+      mean += delta / static_cast<double>(count);
+      m2 += delta * (x - mean);
+    }
+    void merge(const Welford &other);
+    double stddev() const {
+      return count > 1 ? std::sqrt(m2 / static_cast<double>(count - 1)) : 0;
+    }
+  };
+
+  // Running totals of one link since start
+  struct Link {
+    // Bit errors, packets that reached Corrupt with payload to hit
+    double bits = 0;
+    double flips = 0;
+    double expected_flips = 0;
+    Welford ber; // flips / bits of each packet
+
+    // Burst loss, segments that reached BurstDrop on a bursty profile
+    uint64_t segments = 0;
+    uint64_t burst_segments = 0;
+    double expected_burst_segments = 0;
+    uint64_t bursts = 0;
+    double expected_bursts = 0;
+    double observed_ms = 0;
+    Welford burst_ms;
+    double expected_burst_ms = 0; // sum over the bursts in burst_ms
+
+    // Run tracking of the owning thread
+    bool in_run = false;
+    bool run_timed = false; // no unobserved gap since the run started
+    int64_t run_start_ns = 0;
+    int64_t last_ns = -1;
+    double run_target_ms = 0;
+  };
+
+  // What the chain did to one packet
+  struct Observation {
+    uint32_t link; // LINK_* index
+    int64_t now_ns;
+    uint64_t segments;
+    const Config::LinkProperties *props;
+    bool burst_checked; // reached BurstDrop on a bursty, unforced profile
+    bool in_burst;
+    uint64_t error_bits; // payload bits bit errors could hit, 0 if none
+    uint32_t flips;
+    double ber_mean;
+  };
+
+  // One realized figure next to its target, samples are the independent
+  // events behind it (flips or bursts)
+  struct Figure {
+    uint32_t index; // position in the fixed order of compare()
+    const char *name;
+    double realized;
+    double target;
+    double samples;
+
+    // Relative to the target
+    double error() const { return std::abs(realized - target) / target; }
+  };
+
+  void record(const Observation &packet);
+
+  // Merges this thread's links into totals
+  void addTo(std::array<Link, NUM_LINKS> &totals) const;
+
+  static void merge(Link &total, const Link &part);
+
+  // Figures with a target, in a fixed order: bit error rate (index 0),
+  // burst drop ratio, bursts per minute, burst duration ms (index 3)
+  static std::vector<Figure> compare(const Link &link);
+
+private:
+  std::array<Link, NUM_LINKS> links_{};
+  std::array<SeqLock<Link>, NUM_LINKS> published_;
+};
@@ -0,0 +1,194 @@
+// src/impairment/FlowTable.cpp
+
+#include "FlowTable.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+namespace {
+// Entries probed before a flow is placed or an old one evicted, a few cache
+// lines so a lookup stays cheap even in a full table
+constexpr size_t PROBE_LIMIT = 8;
+
+// Tries a snapshot of a replaced entry a few times before skipping it
+constexpr int SNAPSHOT_RETRIES = 4;
+
+void pack(const FlowKey &key, uint64_t packed[2]) {
+  packed[0] = static_cast<uint64_t>(key.src_ip) << 32 | key.dst_ip;
+  packed[1] = static_cast<uint64_t>(key.src_port) << 48 |
+              static_cast<uint64_t>(key.dst_port) << 32 | key.protocol;
+}
+
+FlowKey unpack(uint64_t first, uint64_t second) {
+  FlowKey key{};
+  key.src_ip = static_cast<uint32_t>(first >> 32);
+  key.dst_ip = static_cast<uint32_t>(first);
+  key.src_port = static_cast<uint16_t>(second >> 48);
+  key.dst_port = static_cast<uint16_t>(second >> 32);
+  key.protocol = static_cast<uint8_t>(second);
+  return key;
+}
+
+// 64-bit finalizer mix of both key words
+size_t hashKey(const uint64_t packed[2]) {
+  uint64_t h = packed[0] ^ (packed[1] * 0x9E3779B97F4A7C15ull);
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return static_cast<size_t>(h);
+}
+} // namespace
+
+bool FlowKey::fromMeta(const PacketMeta &meta, FlowKey &key) {
+  if (!meta.isIPv4()) {
+    return false;
+  }
+  key.src_ip = meta.src_ip;
+  key.dst_ip = meta.dst_ip;
+  key.protocol = meta.protocol;
+  // PacketMeta leaves them 0 for later fragments and portless protocols
+  key.src_port = meta.src_port;
+  key.dst_port = meta.dst_port;
+  return true;
+}
+
+FlowTable::FlowTable(uint32_t capacity, double idle_timeout_s)
+    : idle_timeout_ns_(static_cast<uint64_t>(idle_timeout_s * 1e9)) {
+  size_t size = PROBE_LIMIT;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  entries_ = std::make_unique<Entry[]>(size);
+  mask_ = size - 1;
+}
+
+FlowTable::Entry *FlowTable::touch(const FlowKey &key, uint64_t now_ns,
+                                   size_t length) {
+  uint64_t packed[2];
+  pack(key, packed);
+  size_t start = hashKey(packed);
+
+  // Entries are never emptied again, so a key is always found before the
+  // first unused entry of its window
+  Entry *reusable = nullptr;
+  Entry *oldest = nullptr;
+  uint64_t oldest_seen = UINT64_MAX;
+  for (size_t i = 0; i < PROBE_LIMIT; ++i) {
+    Entry &entry = entries_[(start + i) & mask_];
+    if (entry.sequence.load(std::memory_order_relaxed) == 0) {
+      if (!reusable) {
+        reusable = &entry;
+      }
+      break;
+    }
+    if (entry.key[0].load(std::memory_order_relaxed) == packed[0] &&
+        entry.key[1].load(std::memory_order_relaxed) == packed[1]) {
+      entry.last_seen_ns.store(now_ns, std::memory_order_relaxed);
+      bump(entry.packets);
+      bump(entry.bytes, length);
+      return &entry;
+    }
+    uint64_t seen = entry.last_seen_ns.load(std::memory_order_relaxed);
+    if (!reusable && now_ns > seen && now_ns - seen > idle_timeout_ns_) {
+      reusable = &entry;
+    }
+    if (seen < oldest_seen) {
+      oldest_seen = seen;
+      oldest = &entry;
+    }
+  }
+
+  if (!reusable) {
+    bump(forced_evictions_);
+    reusable = oldest;
+  }
+  claim(*reusable, packed, now_ns);
+  bump(reusable->packets);
+  bump(reusable->bytes, length);
+  return reusable;
+}
+
+void FlowTable::claim(Entry &entry, const uint64_t packed[2],
+                      uint64_t now_ns) {
+  uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+  entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  entry.key[0].store(packed[0], std::memory_order_relaxed);
+  entry.key[1].store(packed[1], std::memory_order_relaxed);
+  entry.last_seen_ns.store(now_ns, std::memory_order_relaxed);
+  entry.packets.store(0, std::memory_order_relaxed);
+  entry.bytes.store(0, std::memory_order_relaxed);
+  entry.drops.store(0, std::memory_order_relaxed);
+  entry.flips.store(0, std::memory_order_relaxed);
+
+  // only the owner writes, so sequence is even here
+  entry.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void FlowTable::snapshot(std::vector<FlowStats> &out) const {
+  for (size_t i = 0; i <= mask_; ++i) {
+    const Entry &entry = entries_[i];
+    for (int attempt = 0; attempt < SNAPSHOT_RETRIES; ++attempt) {
+      uint32_t before = entry.sequence.load(std::memory_order_acquire);
+      if (before == 0) {
+        break;
+      }
+      if (before % 2 != 0) {
+        continue;
+      }
+
+      FlowStats stats;
+      stats.key = unpack(entry.key[0].load(std::memory_order_relaxed),
+                         entry.key[1].load(std::memory_order_relaxed));
+      stats.last_seen_ns = entry.last_seen_ns.load(std::memory_order_relaxed);
+      stats.packets = entry.packets.load(std::memory_order_relaxed);
+      stats.bytes = entry.bytes.load(std::memory_order_relaxed);
+      stats.drops = entry.drops.load(std::memory_order_relaxed);
+      stats.flips = entry.flips.load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (entry.sequence.load(std::memory_order_relaxed) == before) {
+        out.push_back(stats);
+        break;
+      }
+    }
+  }
+}
+
+std::vector<FlowTable::FlowStats>
+FlowTable::top(std::vector<FlowStats> flows, size_t n) {
+  // A flow handled by several threads shows up once per table
+  auto order = [](const FlowKey &key) {
+    return std::make_tuple(key.src_ip, key.dst_ip, key.src_port, key.dst_port,
+                           key.protocol);
+  };
+  std::sort(flows.begin(), flows.end(),
+            [&order](const FlowStats &a, const FlowStats &b) {
+              return order(a.key) < order(b.key);
+            });
+  std::vector<FlowStats> merged;
+  for (const FlowStats &flow : flows) {
+    if (!merged.empty() && merged.back().key == flow.key) {
+      FlowStats &total = merged.back();
+      total.last_seen_ns = std::max(total.last_seen_ns, flow.last_seen_ns);
+      total.packets += flow.packets;
+      total.bytes += flow.bytes;
+      total.drops += flow.drops;
+      total.flips += flow.flips;
+    } else {
+      merged.push_back(flow);
+    }
+  }
+
+  n = std::min(n, merged.size());
+  std::partial_sort(merged.begin(), merged.begin() + n, merged.end(),
+                    [](const FlowStats &a, const FlowStats &b) {
+                      return std::tie(a.drops, a.flips, a.packets) >
+                             std::tie(b.drops, b.flips, b.packets);
+                    });
+  merged.resize(n);
+  return merged;
+}
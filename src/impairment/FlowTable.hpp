@@ -0,0 +1,123 @@
+// src/impairment/FlowTable.hpp
+
+// ---- FlowTable Usage ---- //
+
+// FlowTable keeps per 5-tuple counters (packets, bytes, dropped segments,
+// flipped bits) so drops can be traced back to the sessions they hit, e.g.
+// which rover TCP connection lost the most packets in the last burst.
+
+// Example:
+// FlowTable flows(config->flows.capacity, config->flows.idle_timeout_s);
+// FlowKey key;
+// if (FlowKey::fromMeta(meta, key)) {
+//   FlowTable::Entry *flow = flows.touch(key, now_ns, length);
+//   FlowTable::addDrops(*flow, segments);
+// }
+// std::vector<FlowTable::FlowStats> all;
+// flows.snapshot(all);                        // from any thread
+// auto worst = FlowTable::top(std::move(all), 5);
+
+// The table is a fixed array of cache line sized entries with linear
+// probing over a short window, allocated once in the constructor. A flow
+// that was idle for idle_timeout_s is replaced in place by the next new flow
+// probing over it; when the whole window is busy the least recently seen
+// flow is evicted and counted in forcedEvictions().
+
+// One table per processing thread (its shard): touch() and the add*()
+// helpers belong to that thread and take no locks. snapshot() may run on
+// any thread, a per entry sequence number makes it skip entries that are
+// being replaced at that moment.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "PacketMeta.hpp"
+
+// IPv4 5-tuple, addresses and ports in host byte order. Ports are 0 for
+// protocols without them and for non-first fragments.
+struct FlowKey {
+  uint32_t src_ip;
+  uint32_t dst_ip;
+  uint16_t src_port;
+  uint16_t dst_port;
+  uint8_t protocol;
+
+  // false if the packet is not IPv4
+  static bool fromMeta(const PacketMeta &meta, FlowKey &key);
+  static bool parse(const uint8_t *data, size_t length, FlowKey &key) {
+    return fromMeta(PacketMeta::parse(data, length), key);
+  }
+
+  bool operator==(const FlowKey &other) const {
+    return src_ip == other.src_ip && dst_ip == other.dst_ip &&
+           src_port == other.src_port && dst_port == other.dst_port &&
+           protocol == other.protocol;
+  }
+};
+
+class FlowTable {
+public:
+  // One cache line per flow, the key is packed into two words
+  struct alignas(64) Entry {
+    std::atomic<uint32_t> sequence{0}; // 0 unused, odd while replaced
+    std::atomic<uint64_t> key[2]{};
+    std::atomic<uint64_t> last_seen_ns{0};
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> drops{0}; // segments
+    std::atomic<uint64_t> flips{0};
+  };
+
+  // Copy of one entry for reporting
+  struct FlowStats {
+    FlowKey key;
+    uint64_t last_seen_ns;
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t drops;
+    uint64_t flips;
+  };
+
+  FlowTable(uint32_t capacity, double idle_timeout_s);
+
+  // Finds or inserts the flow and counts one packet of length bytes. now_ns
+  // is any monotonic nanosecond clock that is never 0.
+  Entry *touch(const FlowKey &key, uint64_t now_ns, size_t length);
+
+  static void addDrops(Entry &flow, uint64_t segments) {
+    bump(flow.drops, segments);
+  }
+  static void addFlips(Entry &flow, uint64_t bits) { bump(flow.flips, bits); }
+
+  // Appends every flow in the table to out
+  void snapshot(std::vector<FlowStats> &out) const;
+
+  // Sums flows that appear in several snapshots and returns the n with the
+  // most drops, then flipped bits, then packets
+  static std::vector<FlowStats> top(std::vector<FlowStats> flows, size_t n);
+
+  size_t capacity() const { return mask_ + 1; }
+  uint64_t forcedEvictions() const {
+    return forced_evictions_.load(std::memory_order_relaxed);
+  }
+
+private:
+  // Owner-only increment, cheaper than fetch_add and still safe to read
+  static void bump(std::atomic<uint64_t> &counter, uint64_t n = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  }
+
+  // Replaces whatever flow entry held with key
+  void claim(Entry &entry, const uint64_t packed[2], uint64_t now_ns);
+
+  std::unique_ptr<Entry[]> entries_;
+  size_t mask_;
+  uint64_t idle_timeout_ns_;
+  std::atomic<uint64_t> forced_evictions_{0};
+};
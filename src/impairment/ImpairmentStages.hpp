@@ -0,0 +1,328 @@
+// src/impairment/ImpairmentStages.hpp
+
+// ---- ImpairmentStages Usage ---- //
+
+// The steps of PacketProcessor::process(), one type per stage: Classify,
+// Mark, Outage, BurstDrop, RateLimit and Corrupt. Every stage has
+//   static bool run(PacketProcessor &p, PacketProcessor::Context &packet);
+// and returns false once the verdict is final, i.e. the packet was dropped.
+
+// Chain<Stages...> runs its stages in order and stops at the first false.
+// A chain is a single function the compiler can inline end to end, a stage
+// that is not part of a chain costs nothing, not even a branch.
+// Example:
+// using LossOnly = Chain<Classify, Mark, Outage, BurstDrop, RateLimit>;
+// PacketProcessor::Verdict v = LossOnly::run(processor, packet);
+
+// The chains are instantiated in PacketProcessor.cpp and one of them is
+// picked per processor from impairment.chain. The stages are private to
+// PacketProcessor, only PacketProcessor.cpp includes this header.
+
+#pragma once
+
+#include "CounterRng.hpp"
+#include "Packet.hpp"
+#include "PacketProcessor.hpp"
+#include "Probes.hpp"
+#include "configs.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// One packet on its way through a chain
+struct PacketProcessor::Context {
+  // As queued
+  uint32_t id;
+  uint8_t *data;
+  size_t length;
+  std::chrono::steady_clock::time_point received;
+  const Config *config;
+  uint32_t interface; // Config::interfaces index
+
+  // Filled in by Classify
+  PacketMeta meta; // headers, parsed once
+  size_t segment_payload = 0;
+  uint64_t segments = 1;
+  int64_t now_ns = 0; // simulated time since start
+  FlowTable::Entry *flow = nullptr;
+  uint32_t src_ip = 0;
+  uint32_t dst_ip = 0;
+  uint32_t link = NUM_LINKS; // LINK_* index, NUM_LINKS if unclassified
+  const ScenarioTimeline::Epoch *epoch = nullptr;
+  uint16_t profile_id = 0;
+  const Config::LinkProperties *props = nullptr;
+  const Config::FaultPlan *plan = nullptr;
+  // bit error rate of the plan, or of the ephemeris when it feeds the link
+  double ber_mean = 0;
+  double ber_stddev = 0;
+  double ber_log1m = 0;
+
+  // Filled in by BurstDrop and Corrupt, for the decision log and the
+  // fidelity monitor
+  bool in_burst = false;
+  bool burst_checked = false; // the burst model decided, not the admin
+  uint32_t flips = 0;
+  uint64_t error_bits = 0;
+
+  Verdict verdict{NF_ACCEPT, 0, false};
+
+  bool drop(PacketProcessor &p, std::atomic<uint64_t> &counter) {
+    PacketProcessor::bump(counter, segments);
+    PacketProcessor::bump(p.stats_.interface_drops[interface], segments);
+    if (flow) {
+      FlowTable::addDrops(*flow, segments);
+    }
+    verdict.verdict = NF_DROP;
+    return false;
+  }
+};
+
+// Counts the packet and resolves everything the other stages look at:
+// segments, flow, link, profile (scenario and ephemeris applied)
+struct PacketProcessor::Classify {
+  static bool run(PacketProcessor &p, Context &packet) {
+    const Config &config = *packet.config;
+
+    // The one header parse of the packet, every later stage reads meta
+    packet.meta = PacketMeta::parse(packet.data, packet.length);
+    const PacketMeta &meta = packet.meta;
+
+    // A GSO packet stands for as many segments as the kernel will cut it
+    // into
+    packet.segment_payload = packet.length;
+    if (meta.payload_offset < packet.length &&
+        packet.length > config.queue.segment_mtu &&
+        config.queue.segment_mtu > meta.payload_offset) {
+      packet.segment_payload = config.queue.segment_mtu - meta.payload_offset;
+      packet.segments = (packet.length - meta.payload_offset +
+                         packet.segment_payload - 1) /
+                        packet.segment_payload;
+    }
+    bump(p.stats_.packets);
+    bump(p.stats_.segments, packet.segments);
+    bump(p.stats_.bytes, packet.length);
+
+    // Simulated time since start, the scenario and flow clock
+    packet.now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        packet.received - p.origin_)
+                        .count();
+
+    // Per flow accounting, the clock is shifted so a timestamp is never 0
+    FlowKey flow_key;
+    if (p.flows_ && FlowKey::fromMeta(meta, flow_key)) {
+      packet.flow = p.flows_->touch(
+          flow_key, static_cast<uint64_t>(packet.now_ns) + 1, packet.length);
+    }
+
+    // Resolve the link profile and its fault plan, indexed loads into the
+    // flat tables of the config or of the scenario epoch in effect
+    packet.link =
+        static_cast<uint32_t>(PacketClassifier::classifyPacket(meta));
+    packet.src_ip = meta.src_ip;
+    packet.dst_ip = meta.dst_ip;
+    if (config.timeline) {
+      packet.epoch = &p.currentEpoch(*config.timeline, packet.now_ns);
+      packet.profile_id =
+          packet.epoch->profileFor(config, packet.src_ip, packet.dst_ip,
+                                   packet.interface);
+      packet.props = &packet.epoch->profile(config, packet.profile_id);
+      packet.plan = &packet.epoch->plan(config, packet.profile_id);
+    } else {
+      packet.profile_id =
+          config.profileFor(packet.src_ip, packet.dst_ip, packet.interface);
+      packet.props = &config.profiles[packet.profile_id];
+      packet.plan = &config.plans[packet.profile_id];
+    }
+    packet.ber_mean = packet.plan->ber_mean;
+    packet.ber_stddev = packet.plan->ber_stddev;
+    packet.ber_log1m = packet.plan->ber_log1m;
+
+    // Ephemeris feed replaces the static BER, the spread scales with it.
+    // Scenario events that change a link take precedence.
+    uint32_t link = packet.link;
+    bool scripted = packet.epoch && link < NUM_LINKS &&
+                    (packet.epoch->override_links >> link & 1u);
+    if (p.ephemeris_ && link < NUM_LINKS && p.ephemeris_->appliesTo(link) &&
+        !scripted) {
+      const Config::FaultPlan &plan = *packet.plan;
+      double ber = p.ephemeris_->sample(packet.received).bit_error_rate;
+      packet.ber_stddev = plan.ber_mean > 0
+                              ? plan.ber_stddev * ber / plan.ber_mean
+                              : 0.0;
+      packet.ber_mean = ber;
+      packet.ber_log1m = std::log1p(-std::min(ber, 1.0));
+    }
+    LND_PROBE4(packet_classified, packet.id, packet.link, packet.length,
+               packet.profile_id);
+    return true;
+  }
+};
+
+// Mark based on link type, unclassified traffic gets no mark. Runs before
+// the drop stages so the debug output shows every packet.
+struct PacketProcessor::Mark {
+  static bool run(PacketProcessor &, Context &packet) {
+    packet.verdict.mark =
+        packet.link < NUM_LINKS ? LINK_MARKS[packet.link] : 0;
+
+    // Some debugging output
+    if (logEnabled(LogLevel::DEBUG)) {
+      std::cout << "Packet received!\n";
+      std::cout << "ID: " << packet.id;
+      std::cout << "\nClassification: "
+                << (packet.link < NUM_LINKS ? LINK_SECTIONS[packet.link]
+                                            : "other");
+      std::cout << "\nProfile: " << packet.profile_id;
+      std::cout << "\nSize: " << packet.length << " bytes";
+      std::cout << "\nSegments: " << packet.segments;
+      std::cout << "\nApplying mark: " << packet.verdict.mark << "\n";
+    }
+    return true;
+  }
+};
+
+// Scripted outages drop everything on the link or node
+struct PacketProcessor::Outage {
+  static bool run(PacketProcessor &p, Context &packet) {
+    if (packet.epoch && packet.link < NUM_LINKS &&
+        packet.epoch->isOutage(packet.link, packet.src_ip, packet.dst_ip)) {
+      LND_PROBE3(outage_drop, packet.id, packet.link, packet.length);
+      return packet.drop(p, p.stats_.outage_drops);
+    }
+    return true;
+  }
+};
+
+// Gilbert-Elliott burst loss, or the burst state forced from the admin
+// socket
+struct PacketProcessor::BurstDrop {
+  static bool run(PacketProcessor &p, Context &packet) {
+    // Burst state is evaluated against the packet timestamp, a reload that
+    // adds profiles just grows the state table
+    uint16_t profile_id = packet.profile_id;
+    bool is_in_burst_error = false;
+    if (packet.plan->bursts) {
+      if (profile_id >= p.burst_states_.size()) {
+        p.burst_states_.resize(profile_id + 1, BurstModel::State(p.origin_));
+      }
+      BurstModel::State &state = p.burst_states_[profile_id];
+      bool was_in_burst = state.in_burst;
+      is_in_burst_error =
+          BurstModel::inBurst(state, *packet.props, packet.received, p.seed_,
+                              rngStream(RNG_BURST, profile_id));
+      // as this thread sees it, transitions between its packets are skipped
+      if (is_in_burst_error != was_in_burst) {
+        LND_PROBE3(burst_state, packet.link, profile_id, is_in_burst_error);
+      }
+    }
+
+    // A burst forced from the admin socket overrides the model
+    packet.burst_checked = packet.plan->bursts;
+    if (packet.link < NUM_LINKS) {
+      Config::BurstForce force = packet.config->forced_bursts[packet.link];
+      if (force == Config::BurstForce::ON) {
+        is_in_burst_error = true;
+        packet.burst_checked = false;
+      } else if (force == Config::BurstForce::OFF) {
+        is_in_burst_error = false;
+        packet.burst_checked = false;
+      }
+    }
+
+    // Segments of a GSO packet share its arrival time, so they would all be
+    // dropped too
+    packet.in_burst = is_in_burst_error;
+    if (is_in_burst_error) {
+      if (logEnabled(LogLevel::DEBUG)) {
+        std::cout << "Dropped packet due to burst error mode activated.\n";
+      }
+      LND_PROBE3(burst_drop, packet.id, packet.link, packet.length);
+      return packet.drop(p, p.stats_.burst_drops);
+    }
+    return true;
+  }
+};
+
+// Token bucket per link profile, filled at throughput_limit_mbps and
+// THROUGHPUT_BUCKET_MS deep. Packets that find it short are dropped.
+struct PacketProcessor::RateLimit {
+  static bool run(PacketProcessor &p, Context &packet) {
+    double rate_bps = packet.plan->rate_bps;
+    if (rate_bps <= 0) {
+      return true;
+    }
+    uint16_t profile_id = packet.profile_id;
+    if (profile_id >= p.buckets_.size()) {
+      p.buckets_.resize(profile_id + 1);
+    }
+    TokenBucket &bucket = p.buckets_[profile_id];
+
+    // Deep enough for the packet at hand, so a GSO packet larger than the
+    // bucket still passes once it is full
+    double bits = 8.0 * static_cast<double>(packet.length);
+    double depth = std::max(packet.plan->bucket_bits, bits);
+    double elapsed_s =
+        static_cast<double>(std::max<int64_t>(packet.now_ns - bucket.last_ns,
+                                              0)) /
+        1e9;
+    bucket.bits = std::min(depth, bucket.bits + rate_bps * elapsed_s);
+    bucket.last_ns = packet.now_ns;
+
+    if (bucket.bits < bits) {
+      LND_PROBE3(rate_drop, packet.id, packet.link, packet.length);
+      return packet.drop(p, p.stats_.rate_drops);
+    }
+    bucket.bits -= bits;
+    return true;
+  }
+};
+
+// Bit errors in the payload of each segment
+struct PacketProcessor::Corrupt {
+  static bool run(PacketProcessor &p, Context &packet) {
+    if (packet.ber_mean <= 0) {
+      return true;
+    }
+    uint32_t flips = p.applyBitErrors(packet);
+    packet.flips = flips;
+    if (flips > 0) {
+      LND_PROBE4(bits_flipped, packet.id, packet.link, packet.length, flips);
+      // the UDP checksum covers the whole datagram, clear it so the
+      // corrupted datagram still arrives
+      if (uint32_t checksum = packet.meta.udp_checksum_offset) {
+        packet.data[checksum] = 0;
+        packet.data[checksum + 1] = 0;
+      }
+      bump(p.stats_.corrupted_packets);
+      bump(p.stats_.flipped_bits, flips);
+      if (packet.flow) {
+        FlowTable::addFlips(*packet.flow, flips);
+      }
+      packet.verdict.modified = true;
+    }
+    return true;
+  }
+};
+
+template <typename... Stages> struct PacketProcessor::Chain {
+  static Verdict run(PacketProcessor &p, Context &packet) {
+    // && stops at the first stage that settled the verdict
+    (Stages::run(p, packet) && ...);
+    if (p.decisions_) {
+      p.decisions_->append(
+          {packet.now_ns, packet.id, static_cast<uint32_t>(packet.length),
+           packet.flips, packet.verdict.mark, packet.profile_id,
+           static_cast<uint8_t>(packet.link),
+           static_cast<uint8_t>(packet.verdict.verdict), packet.in_burst,
+           packet.verdict.modified, 0});
+    }
+    if (p.fidelity_ && packet.link < NUM_LINKS) {
+      p.fidelity_->record({packet.link, packet.now_ns, packet.segments,
+                           packet.props, packet.burst_checked,
+                           packet.in_burst, packet.error_bits, packet.flips,
+                           packet.ber_mean});
+    }
+    return packet.verdict;
+  }
+};
@@ -0,0 +1,65 @@
+// src/impairment/LoadShedder.cpp
+
+#include "LoadShedder.hpp"
+#include "configs.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+std::chrono::steady_clock::duration fromMs(double ms) {
+  return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double, std::milli>(ms));
+}
+} // namespace
+
+LoadShedder::LoadShedder(const Config::Shedding &config)
+    : config_(config), overload_(fromMs(config.overload_ms)),
+      recover_(fromMs(config.recover_ms)) {}
+
+void LoadShedder::reportOverflow(std::chrono::steady_clock::time_point now) {
+  overflow_until_ = now + overload_;
+}
+
+void LoadShedder::update(std::chrono::steady_clock::time_point now,
+                         bool backlog) {
+  if (!config_.enabled) {
+    return;
+  }
+
+  bool overloaded = backlog || now < overflow_until_;
+  if (overloaded != overloaded_) {
+    overloaded_ = overloaded;
+    since_ = now;
+    return;
+  }
+
+  uint32_t level = level_.load(std::memory_order_relaxed);
+  if (overloaded && now - since_ >= overload_ &&
+      level < config_.shed_order.size()) {
+    setLevel(level + 1);
+    since_ = now;
+  } else if (!overloaded && now - since_ >= recover_ && level > 0) {
+    setLevel(level - 1);
+    since_ = now;
+  }
+}
+
+void LoadShedder::setLevel(uint32_t level) {
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < level; ++i) {
+    mask |= 1u << config_.shed_order[i];
+  }
+  uint32_t previous = level_.exchange(level, std::memory_order_relaxed);
+  bypass_mask_.store(mask, std::memory_order_relaxed);
+
+  // one line per change, not per packet
+  uint32_t link = config_.shed_order[std::min(level, previous)];
+  if (level > previous) {
+    std::cerr << "Warning: Overloaded, bypassing impairment for "
+              << LINK_SECTIONS[link] << " traffic.\n";
+  } else {
+    std::cerr << "Load recovered, impairing " << LINK_SECTIONS[link]
+              << " traffic again.\n";
+  }
+}
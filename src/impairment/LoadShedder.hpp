@@ -0,0 +1,57 @@
+// src/impairment/LoadShedder.hpp
+
+// ---- LoadShedder Usage ---- //
+
+// LoadShedder decides which link types skip impairment while the daemon is
+// overloaded, so the Moon links stay accurate when it cannot keep up with
+// everything. Packets of a shed link are accepted with their mark straight
+// away, without burst or bit error processing.
+
+// Example:
+// LoadShedder shedder(config->shedding);
+// shedder.reportOverflow(now);          // ENOBUFS or lost packet ids
+// shedder.update(now, backlog_is_high); // once per packet
+// if (shedder.bypasses(link)) { /* accept with LINK_MARKS[link] */ }
+
+// Overload is either a high backlog or an overflow within the last
+// overload_ms. Every overload_ms of continuous overload sheds the next link
+// of shed_order, every recover_ms without overload restores the last one.
+
+// update() and reportOverflow() belong to the receive thread, bypasses() and
+// level() may be called from anywhere.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "ConfigManager.hpp"
+
+class LoadShedder {
+public:
+  explicit LoadShedder(const Config::Shedding &config);
+
+  void reportOverflow(std::chrono::steady_clock::time_point now);
+  void update(std::chrono::steady_clock::time_point now, bool backlog);
+
+  bool bypasses(uint32_t link) const {
+    return bypass_mask_.load(std::memory_order_relaxed) >> link & 1u;
+  }
+  uint32_t level() const { return level_.load(std::memory_order_relaxed); }
+
+private:
+  void setLevel(uint32_t level);
+
+  Config::Shedding config_;
+  std::chrono::steady_clock::duration overload_;
+  std::chrono::steady_clock::duration recover_;
+
+  // start of the current overloaded or calm stretch
+  std::chrono::steady_clock::time_point since_;
+  bool overloaded_ = false;
+  std::chrono::steady_clock::time_point overflow_until_;
+
+  std::atomic<uint32_t> level_{0};
+  std::atomic<uint32_t> bypass_mask_{0};
+};
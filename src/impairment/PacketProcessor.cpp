@@ -0,0 +1,139 @@
+// src/impairment/PacketProcessor.cpp
+
+#include "PacketProcessor.hpp"
+#include "ImpairmentStages.hpp"
+
+PacketProcessor::ChainFn
+PacketProcessor::chainFor(Config::Impairment::Chain chain) {
+  switch (chain) {
+  case Config::Impairment::Chain::LOSS_ONLY:
+    return &Chain<Classify, Mark, Outage, BurstDrop, RateLimit>::run;
+  case Config::Impairment::Chain::MARK_ONLY:
+    return &Chain<Classify, Mark>::run;
+  case Config::Impairment::Chain::FULL:
+  default:
+    return &Chain<Classify, Mark, Outage, BurstDrop, RateLimit, Corrupt>::run;
+  }
+}
+
+PacketProcessor::PacketProcessor(
+    ConfigManager &config_manager, uint64_t seed,
+    std::chrono::steady_clock::time_point origin,
+    std::shared_ptr<const EphemerisTable> ephemeris)
+    : config_manager_(config_manager), config_version_(0), seed_(seed),
+      origin_(origin), ephemeris_(std::move(ephemeris)) {
+  config_version_ = config_manager_.version();
+  config_ = config_manager_.getSnapshot();
+  chain_ = chainFor(config_->impairment.chain);
+  if (config_->flows.enabled) {
+    flows_ = std::make_unique<FlowTable>(config_->flows.capacity,
+                                         config_->flows.idle_timeout_s);
+  }
+  if (config_->fidelity.enabled) {
+    fidelity_ = std::make_unique<FidelityMonitor>();
+  }
+  if (config_->decision_log.enabled) {
+    try {
+      decisions_ = std::make_unique<DecisionLog>(config_->decision_log);
+    } catch (const std::exception &error) {
+      std::cerr << "Warning: Decision log disabled: " << error.what() << "\n";
+    }
+  }
+}
+
+const Config &PacketProcessor::currentConfig() {
+  uint64_t version = config_manager_.version();
+  if (version != config_version_) {
+    config_version_ = version;
+    config_ = config_manager_.getSnapshot();
+    // a new snapshot brings a new timeline, look the epoch up again
+    epoch_start_ns_ = INT64_MAX;
+    epoch_end_ns_ = INT64_MIN;
+  }
+  return *config_;
+}
+
+const ScenarioTimeline::Epoch &
+PacketProcessor::currentEpoch(const ScenarioTimeline &timeline,
+                              int64_t now_ns) {
+  if (now_ns < epoch_start_ns_ || now_ns >= epoch_end_ns_) {
+    epoch_index_ = timeline.find(now_ns, epoch_index_);
+    epoch_start_ns_ = timeline.start(epoch_index_);
+    epoch_end_ns_ = timeline.end(epoch_index_);
+  }
+  return timeline.epoch(epoch_index_);
+}
+
+PacketProcessor::Verdict
+PacketProcessor::process(uint32_t id, uint8_t *data, size_t length,
+                         uint32_t /*mark*/,
+                         std::chrono::steady_clock::time_point received,
+                         uint32_t interface) {
+  Context packet{id, data, length, received, &currentConfig(),
+                 std::min(interface, MAX_INTERFACES - 1)};
+  return chain_(*this, packet);
+}
+
+uint32_t PacketProcessor::applyBitErrors(Context &packet) {
+  uint8_t *data = packet.data;
+  size_t length = packet.length;
+
+  // Not IPv4, headers cut short, or nothing behind the headers
+  if (packet.meta.payload_offset >= length) {
+    return 0;
+  }
+
+  // A copy shorter than the IP total length (or a BIG TCP packet with total
+  // length 0) must not be written back, the kernel would cut the packet
+  size_t total_length = packet.meta.total_length;
+  if (total_length == 0 || total_length > length) {
+    return 0;
+  }
+
+  packet.error_bits =
+      static_cast<uint64_t>(length - packet.meta.payload_offset) * 8;
+  uint32_t flips = 0;
+  uint64_t segment = 0;
+  for (size_t start = packet.meta.payload_offset; start < length;
+       start += packet.segment_payload, ++segment) {
+    size_t end = std::min(length, start + packet.segment_payload);
+
+    // Random stream for this segment on this profile, independent of which
+    // thread handles it or when. Segment 0 keeps the plain packet index.
+    CounterRng rng(seed_, rngStream(RNG_BIT_ERRORS, packet.profile_id),
+                   static_cast<uint64_t>(packet.id) | segment << 32);
+
+    // Bit error rate of this segment, drawn from the normal distribution of
+    // the profile unless it has no spread
+    double log1m = packet.ber_log1m;
+    if (packet.ber_stddev > 0) {
+      double ber = std::max(
+          0.0, rng.tableNormal(packet.ber_mean, packet.ber_stddev));
+      if (ber <= 0) {
+        continue;
+      }
+      log1m = std::log1p(-std::min(ber, 1.0));
+    }
+
+    // Jump from flipped bit to flipped bit, the gaps between errors of
+    // independent bits are geometric
+    uint64_t bits = static_cast<uint64_t>(end - start) * 8;
+    uint64_t bit = rng.geometric(log1m);
+    while (bit < bits) {
+      data[start + bit / 8] ^= static_cast<uint8_t>(1 << (bit % 8));
+      ++flips;
+      uint64_t gap = rng.geometric(log1m);
+      if (gap >= bits) {
+        break;
+      }
+      bit += gap + 1;
+    }
+  }
+
+  if (flips > 0 && logEnabled(LogLevel::DEBUG)) {
+    std::cout << "Flipped " << flips << " bits over " << segment
+              << " segments!\n";
+  }
+
+  return flips;
+}
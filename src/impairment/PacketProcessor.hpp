@@ -0,0 +1,176 @@
+// src/impairment/PacketProcessor.hpp
+
+// ---- PacketProcessor Usage ---- //
+
+// PacketProcessor holds the impairment logic that used to live in
+// NetfilterQueue::packetCallback: classification, profile lookup, burst drop,
+// throughput limit and bit errors. It knows nothing about netfilter, so the
+// inline path, the pipeline workers and other packet I/O backends share it.
+
+// The logic is split into stage types (see ImpairmentStages.hpp) composed
+// into a few chains at compile time. impairment.chain picks one when the
+// processor is created: "full", "loss_only" (no bit errors, packet data is
+// never written) or "mark_only" (classification and marks only).
+
+// Example:
+// PacketProcessor processor(config_manager, seed, clock.origin(), ephemeris);
+// PacketProcessor::Verdict v =
+//     processor.process(id, data, length, mark, clock.now());
+// // v.verdict is NF_ACCEPT or NF_DROP, v.mark the new netfilter mark,
+// // v.modified tells whether data was changed in place
+
+// Bit errors are applied in place, so data must be writable and stay valid
+// until the verdict is sent. Headers are parsed once into a PacketMeta, bit
+// errors only hit the bytes behind every header it found.
+
+// GSO packets (longer than queue.segment_mtu) count as the segments the
+// kernel will cut them into. Burst drops are decided at the arrival time,
+// which all segments share, and bit errors are drawn per segment, each
+// segment with its own error rate sample and random stream.
+
+// Scenario events (see ScenarioTimeline) are looked up by simulated time:
+// outages drop the packet, parameter changes replace its link profile.
+
+// Every processor keeps its own FlowTable (when flows.enabled), the flow of
+// each packet is counted together with the drops and bit flips it got.
+
+// With decision_log.enabled every processor also writes its own DecisionLog,
+// one record per packet with the verdict, burst state and flipped bits.
+
+// With fidelity.enabled every processor feeds its own FidelityMonitor with
+// the burst state and bit errors of each packet.
+
+// A processor is owned by one thread. Burst states are per processor, but
+// the burst timeline is a pure function of the seed, the origin and the
+// props (see BurstModel), so all processors agree on when bursts happen.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "BurstModel.hpp"
+#include "ConfigManager.hpp"
+#include "DecisionLog.hpp"
+#include "EphemerisTable.hpp"
+#include "FidelityMonitor.hpp"
+#include "FlowTable.hpp"
+#include "ScenarioTimeline.hpp"
+#include "configs.hpp"
+
+class PacketProcessor {
+public:
+  struct Verdict {
+    uint32_t verdict;
+    uint32_t mark;
+    bool modified;
+  };
+
+  // Monotonic counters, written by the owning thread and readable anywhere
+  struct Stats {
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> segments{0}; // logical packets, 1 unless GSO
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> burst_drops{0}; // in segments
+    std::atomic<uint64_t> outage_drops{0}; // scenario outages, in segments
+    std::atomic<uint64_t> rate_drops{0};   // throughput limit, in segments
+    std::atomic<uint64_t> corrupted_packets{0};
+    std::atomic<uint64_t> flipped_bits{0};
+    // dropped segments per Config::interfaces index
+    std::array<std::atomic<uint64_t>, MAX_INTERFACES> interface_drops{};
+  };
+
+  PacketProcessor(ConfigManager &config_manager, uint64_t seed,
+                  std::chrono::steady_clock::time_point origin,
+                  std::shared_ptr<const EphemerisTable> ephemeris);
+
+  // interface is the Config::interfaces index the packet was queued on, it
+  // picks the interface's link profiles
+  Verdict process(uint32_t id, uint8_t *data, size_t length, uint32_t mark,
+                  std::chrono::steady_clock::time_point received,
+                  uint32_t interface = 0);
+
+  const Stats &stats() const { return stats_; }
+
+  // nullptr when flows are disabled
+  const FlowTable *flows() const { return flows_.get(); }
+
+  // nullptr when fidelity is disabled
+  const FidelityMonitor *fidelity() const { return fidelity_.get(); }
+
+private:
+  // Stage types and the chain template, see ImpairmentStages.hpp
+  struct Context;
+  struct Classify;
+  struct Mark;
+  struct Outage;
+  struct BurstDrop;
+  struct RateLimit;
+  struct Corrupt;
+  template <typename... Stages> struct Chain;
+
+  using ChainFn = Verdict (*)(PacketProcessor &, Context &);
+  static ChainFn chainFor(Config::Impairment::Chain chain);
+
+  // Bit budget of one profile's throughput limit
+  struct TokenBucket {
+    int64_t last_ns = 0;
+    double bits = HUGE_VAL; // starts full
+  };
+
+  // Owner-only increment, cheaper than fetch_add and still safe to read
+  static void bump(std::atomic<uint64_t> &counter, uint64_t n = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  }
+
+  // Applies bit errors to the packet data in place, segment by segment,
+  // returns flipped bits and sets error_bits
+  uint32_t applyBitErrors(Context &packet);
+
+  // Only fetches a new snapshot when the config version moved
+  const Config &currentConfig();
+
+  // Scenario epoch at now_ns, only searches when the packet left the
+  // cached epoch
+  const ScenarioTimeline::Epoch &currentEpoch(const ScenarioTimeline &timeline,
+                                              int64_t now_ns);
+
+  ChainFn chain_;
+
+  ConfigManager &config_manager_;
+  std::shared_ptr<const Config> config_;
+  uint64_t config_version_;
+
+  // Cached scenario epoch, [start, end) in simulated ns
+  size_t epoch_index_ = 0;
+  int64_t epoch_start_ns_ = INT64_MAX;
+  int64_t epoch_end_ns_ = INT64_MIN;
+
+  uint64_t seed_;
+  std::chrono::steady_clock::time_point origin_;
+  std::shared_ptr<const EphemerisTable> ephemeris_;
+
+  // Lazily evaluated burst state, one per link profile
+  std::vector<BurstModel::State> burst_states_;
+
+  // Throughput limit state, one per link profile
+  std::vector<TokenBucket> buckets_;
+
+  // This thread's shard of the flow table, sized at startup
+  std::unique_ptr<FlowTable> flows_;
+
+  // This thread's decision log, nullptr when disabled
+  std::unique_ptr<DecisionLog> decisions_;
+
+  // Realized against configured impairment, nullptr when disabled
+  std::unique_ptr<FidelityMonitor> fidelity_;
+
+  Stats stats_;
+};
@@ -0,0 +1,39 @@
+// src/impairment/SimClock.cpp
+
+#include "SimClock.hpp"
+
+SimClock::SimClock(double time_scale)
+    : SimClock(time_scale, std::chrono::steady_clock::now()) {}
+
+SimClock::SimClock(double time_scale, time_point origin)
+    : origin_(origin), time_scale_(time_scale > 0 ? time_scale : 1.0),
+      manual_(false), manual_ticks_(0) {}
+
+SimClock::time_point SimClock::now() const {
+  return at(std::chrono::steady_clock::now());
+}
+
+SimClock::time_point
+SimClock::at(std::chrono::steady_clock::time_point steady) const {
+  if (manual_.load(std::memory_order_acquire)) {
+    return time_point(std::chrono::steady_clock::duration(
+        manual_ticks_.load(std::memory_order_relaxed)));
+  }
+
+  if (time_scale_ == 1.0) {
+    return steady;
+  }
+  auto elapsed = std::chrono::duration<double>(steady - origin_) * time_scale_;
+  return origin_ +
+         std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+             elapsed);
+}
+
+SimClock::time_point SimClock::origin() const { return origin_; }
+
+double SimClock::timeScale() const { return time_scale_; }
+
+void SimClock::setManualTime(time_point t) {
+  manual_ticks_.store(t.time_since_epoch().count(), std::memory_order_relaxed);
+  manual_.store(true, std::memory_order_release);
+}
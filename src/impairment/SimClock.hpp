@@ -0,0 +1,55 @@
+// src/impairment/SimClock.hpp
+
+// ---- SimClock Usage ---- //
+
+// SimClock is the injectable time source for impairment decisions.
+// Packet timestamps and burst transitions are all taken from it, so a replay
+// harness can drive it directly and get identical decisions at any speed.
+
+// Real time (the default) follows std::chrono::steady_clock:
+// SimClock clock;
+// auto now = clock.now();
+
+// A time scale compresses simulated time, 60.0 makes one wall-clock second
+// count as one simulated minute:
+// SimClock clock(60.0);
+
+// Manual mode is for replays and tests, time only moves when told to:
+// clock.setManualTime(clock.origin() + std::chrono::seconds(5));
+
+// origin() is simulated time zero, burst timelines are anchored to it.
+// Processes that must agree on burst timelines (see SharedState) pass the
+// same origin, steady_clock is the system-wide CLOCK_MONOTONIC:
+// SimClock clock(time_scale, shared_origin);
+
+// at() maps an earlier steady_clock instant, such as the kernel timestamp of
+// a queued packet, to simulated time. In manual mode it is the manual time.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+class SimClock {
+public:
+  using time_point = std::chrono::steady_clock::time_point;
+
+  explicit SimClock(double time_scale = 1.0);
+  SimClock(double time_scale, time_point origin);
+
+  time_point now() const;
+  time_point at(std::chrono::steady_clock::time_point steady) const;
+  time_point origin() const;
+  double timeScale() const;
+
+  // Switches to manual mode, now() returns t until the next call
+  void setManualTime(time_point t);
+
+private:
+  time_point origin_;
+  double time_scale_;
+
+  std::atomic<bool> manual_;
+  std::atomic<int64_t> manual_ticks_;
+};
@@ -1,52 +1,39 @@
 // src/main.cpp
 
-#include <csignal>
-#include <cstring>
 #include <exception>
 #include <iostream>
-
-// netfilter includes
-#include <asm-generic/socket.h>
-#include <libnetfilter_queue/libnetfilter_queue.h>
-#include <libnetfilter_queue/linux_nfnetlink_queue.h>
-#include <netinet/in.h>
-#include <sys/socket.h>
+#include <string>
+#include <vector>
 
 #include "ConfigManager.hpp"
-#include "IptablesManager.hpp"
-#include "NetfilterQueue.hpp"
-#include "TcNetemManager.hpp"
-#include "configs.hpp"
-
-void signalHandler(int signal);
-void setupSignalHandlers();
+#include "Coordinator.hpp"
+#include "Daemon.hpp"
+#include "Shard.hpp"
 
-std::unique_ptr<NetfilterQueue> g_queue;
+std::string parseOption(int argc, char *argv[], const std::string &flag);
 
-int main() {
-  std::cout << "Starting packet interception on " << WG_INTERFACE << "\n";
+int main(int argc, char *argv[]) {
+  std::cout << "Starting packet interception\n";
 
   try {
     setupSignalHandlers();
 
-    // create config manager
-    ConfigManager config_manager("config/config.json");
-
-    // iptables class ensures teardown on destruction
-    IptablesManager iptables;
-
-    // Set up TC/Netem rules, torn down on destruction
-    TcNetemManager tc_netem(config_manager);
-
-    g_queue = std::make_unique<NetfilterQueue>(config_manager);
-
-    // blocks until stopped by signal
-    g_queue->run();
-
-    std::cout << "Shutting down.\n";
-
-    // Clean up the queue
-    g_queue.reset();
+    // create config manager, --runtime-profile overrides the file
+    ConfigManager config_manager(
+        "config/config.json", parseOption(argc, argv, "--runtime-profile"));
+
+    // --shard <index> is how a coordinator starts its shards
+    std::string shard = parseOption(argc, argv, "--shard");
+    if (!shard.empty()) {
+      runShard(config_manager, static_cast<uint32_t>(std::stoul(shard)));
+    } else if (config_manager.getSnapshot()->xdp.enabled) {
+      runXdp(config_manager);
+    } else if (config_manager.getSnapshot()->shards.count > 0) {
+      runCoordinator(config_manager,
+                     std::vector<std::string>(argv, argv + argc));
+    } else {
+      runDaemon(config_manager);
+    }
 
   } catch (const std::exception &error) {
     std::cout << "Fatal error: " << error.what() << "\n";
@@ -56,25 +43,15 @@ int main() {
   return 0;
 }
 
-void signalHandler(int signal) {
-  if (g_queue) {
-    g_queue->stop();
+std::string parseOption(int argc, char *argv[], const std::string &flag) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == flag && i + 1 < argc) {
+      return argv[i + 1];
+    }
+    if (arg.rfind(flag + "=", 0) == 0) {
+      return arg.substr(flag.size() + 1);
+    }
   }
+  return "";
 }
-
-void setupSignalHandlers() {
-  struct sigaction sa{};
-  std::memset(&sa, 0, sizeof(sa));
-  sa.sa_handler = signalHandler;
-
-  // Register for common termination signals
-  if (sigaction(SIGINT, &sa, nullptr) < 0) { // Ctrl+C
-    std::cerr << "Warning: Failed to set SIGINT handler\n";
-  }
-  if (sigaction(SIGTERM, &sa, nullptr) < 0) { // Termination signal
-    std::cerr << "Warning: Failed to set SIGTERM handler\n";
-  }
-  if (sigaction(SIGHUP, &sa, nullptr) < 0) { // Terminal closed
-    std::cerr << "Warning: Failed to set SIGHUP handler\n";
-  }
-}
\ No newline at end of file
@@ -6,33 +6,69 @@
 // it captures packets that have been directed to NFQUEUE by iptables rules
 
 // Example:
-// NetfilterQueue queue;
+// SimClock clock;
+// NetfilterQueue queue(config_manager, clock);
 // queue.run(); // this blocks until queue.stop() is called from a signal
 
+// All impairment randomness comes from CounterRng streams keyed by link
+// profile and packet id, seeded from the "simulation" config section, and
+// packet timestamps come from the injected SimClock
+
+// The impairment logic itself lives in PacketProcessor. With
+// "pipeline.workers" > 0 the callback only copies packets into a
+// PacketPipeline and a separate verdict thread answers the kernel, otherwise
+// packets are processed inline in the callback.
+
+// Packets are timed from the kernel timestamp of their skb (NFQA_TIMESTAMP),
+// so impairment decisions see when a packet arrived rather than when the
+// daemon got to it. Per link, the time from that timestamp to the callback
+// (residency) and from the callback to the verdict are kept as histograms,
+// see linkLatency(). Packets without a usable stamp are timed from the
+// callback and counted as untimestamped.
+
+// Every entry of Config::interfaces has its own NFQUEUE, all of them are
+// bound to the one socket run() reads from and share the processors. The
+// queue a packet arrived on selects its interface's link profiles and
+// counters, its verdict goes back to that queue.
+
+// A shard of a sharded daemon (see SharedState) binds queue + its shard
+// index of every interface and takes the seed all shards share instead of
+// picking one:
+// NetfilterQueue queue(config_manager, clock, ephemeris, 2, seed);
+
 // in main, queue is a global pointer, instantiate using std::make_unique
 
 // the run() method has an internal loop processing packets as they arrive
-// Each packet triggers the packetCallback method, this is where the processing
-// pipeline will be called
+// Each packet triggers the packetCallback method, which hands it to the
+// processing pipeline
 
 // if modifying this class:
 // - packetCallbackStatic is needed for C++ to C callback conversion
 // - smart pointers should handle resource cleanup automatically
-// - the socket buffer size is configurable in configs.hpp
+// - the socket buffer starts at queue.socket_buffer, see SocketBuffer
 
 #pragma once
 
+#include <array>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
 #include <csignal>
 #include <functional>
 #include <memory>
-#include <mutex>
-#include <thread>
+#include <optional>
+#include <vector>
 
 #include <libnetfilter_queue/libnetfilter_queue.h>
+#include <sys/types.h>
 
-#include "Packet.hpp"
+#include "EphemerisTable.hpp"
+#include "JitterStats.hpp"
+#include "LoadShedder.hpp"
+#include "NfqSocket.hpp"
+#include "PacketPipeline.hpp"
+#include "PacketProcessor.hpp"
+#include "SimClock.hpp"
+#include "SocketBuffer.hpp"
 #include "configs.hpp"
 
 class NetfilterQueue {
@@ -40,31 +76,158 @@ class NetfilterQueue {
   // convenience (easier to follow examples), I've explained it all (mostly) at
   // the bottom
 public:
-  NetfilterQueue(ConfigManager &config_manager);
+  // Per Config::interfaces index, how the load spreads over the interfaces
+  struct InterfaceStats {
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t drops; // segments, like the drop counters below
+  };
+
+  // Totals over all processing threads
+  struct Stats {
+    uint64_t packets;
+    uint64_t segments; // packets after GSO segmentation
+    uint64_t gso_packets;
+    uint64_t bytes;
+    uint64_t burst_drops;
+    uint64_t outage_drops;
+    uint64_t rate_drops;
+    uint64_t corrupted_packets;
+    uint64_t flipped_bits;
+    uint64_t backpressure_waits;
+    uint64_t in_flight;
+    uint64_t truncated_messages;
+    uint64_t overflows;    // ENOBUFS reports from the socket
+    uint64_t lost_packets; // packet ids that never reached us
+    uint64_t shed_packets; // accepted without impairment under overload
+    uint32_t shed_level;   // links currently bypassed
+    uint64_t untimestamped; // no kernel timestamp, timed from the callback
+    // /proc/net/netfilter/nfnetlink_queue of our queues, see SocketBuffer
+    uint64_t queue_total;   // packets waiting for a verdict
+    uint64_t queue_dropped; // turned away by a full queue
+    uint64_t user_dropped;  // no room in the socket buffer
+    uint64_t socket_buffer; // bytes, as the kernel reports it
+    std::array<InterfaceStats, MAX_INTERFACES> interfaces;
+  };
+
+  // Where a packet's time goes before the verdict, per link
+  struct LinkLatency {
+    JitterStats::Summary residency; // kernel timestamp to callback
+    JitterStats::Summary verdict;   // callback to verdict sent
+  };
+
+  // ephemeris is an optional time-varying BER source, without a seed one
+  // is chosen by chooseSeed(). queue_offset is added to the queue number of
+  // every interface.
+  NetfilterQueue(ConfigManager &config_manager, SimClock &clock,
+                 std::shared_ptr<const EphemerisTable> ephemeris = nullptr,
+                 uint16_t queue_offset = 0,
+                 std::optional<uint64_t> seed = std::nullopt);
+  ~NetfilterQueue();
   void run();
   void stop();
   bool isRunning() const;
 
+  // Safe to call from any thread
+  Stats getStats() const;
+
+  // Reads the kernel's queue counters and grows the socket buffer after
+  // lost queue messages, call periodically from one thread
+  void tuneSocketBuffer();
+
+  // The n flows with the most drops over all processing threads, safe to
+  // call from any thread
+  std::vector<FlowTable::FlowStats> topFlows(size_t n) const;
+
+  // Indexed by LINK_*, safe to call from any thread
+  std::array<LinkLatency, NUM_LINKS> linkLatency() const;
+
+  // Realized impairment over all processing threads, indexed by LINK_*,
+  // safe to call from any thread
+  std::array<FidelityMonitor::Link, NUM_LINKS> fidelity() const;
+
+  // Deterministic runs take the seed from config, others pick a fresh one
+  static uint64_t chooseSeed(const Config::Simulation &simulation);
+
 private:
+  static void destroyQueueHandle(struct nfq_q_handle *qh);
+
+  // The NFQUEUE of one interface
+  struct BoundQueue {
+    NetfilterQueue *owner;
+    uint32_t interface; // Config::interfaces index
+    uint16_t queue_num;
+
+    // Packet ids are sequential per queue, a gap means the kernel dropped
+    // messages for us. 0 until the first packet and after an overflow.
+    uint32_t next_packet_id = 0;
+
+    // Receive thread counters
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> bytes{0};
+
+    // library backend only
+    std::unique_ptr<struct nfq_q_handle, void (*)(struct nfq_q_handle *)>
+        handle{nullptr, &destroyQueueHandle};
+  };
+
   // this is a "static bridge" pattern which is required for interfacing C++
   // logic with C libraries that use callbacks
   // The static callback has the exact signature the C libary expects, it
-  // receives the "this" pointer through the data parameter,
-  // Acting as a bridge to the actual instance method
+  // receives the BoundQueue (and through it "this") through the data
+  // parameter, Acting as a bridge to the actual instance method
   static int packetCallbackStatic(struct nfq_q_handle *qh,
                                   struct nfgenmsg *nfmsg, struct nfq_data *nfa,
                                   void *data);
 
   // The actual callback method has access to all the object's members and state
-  int packetCallback(struct nfq_q_handle *qh, struct nfgenmsg *nfmsg,
-                     struct nfq_data *nfa);
+  int packetCallback(BoundQueue &queue, struct nfq_data *nfa);
 
-  // Applies bit errors to the packet data
-  std::vector<uint8_t> applyBitErrors(Packet &packet,
-                                      const Config::LinkProperties &link_type);
+  // Queue setup for queue.backend "library" and "netlink"
+  void openLibraryQueue(const Config &config);
+  void openNetlinkQueue(const Config &config);
 
-  // This method will be called in a separate thread to simulate burst errors
-  void burstErrorSimulation(const Packet::LinkType link_type);
+  // Raw netlink backend: parses the received messages in place, then drains
+  // what is already queued and flushes all verdicts at once
+  void handleMessages(size_t length);
+
+  // NFQUEUE only passes skb timestamps on when the stack takes them, which
+  // it does while any socket asks for receive timestamps
+  void enableKernelTimestamps();
+
+  // Raw netlink backend, the bound queue a packet arrived on. nullptr for
+  // others, their packets are accepted unimpaired.
+  BoundQueue *findQueue(uint16_t queue_num);
+
+  // Shared by both backends, runs on the receive thread. timestamp_ns is
+  // the kernel's CLOCK_REALTIME stamp, 0 if the message had none.
+  int handlePacket(BoundQueue &queue, uint32_t id, uint32_t mark,
+                   uint32_t skbinfo, uint8_t *packet_data,
+                   uint32_t payload_len, int64_t timestamp_ns);
+
+  // Adds one packet to the histograms of the link its mark selects
+  void recordLatency(uint32_t mark,
+                     std::chrono::steady_clock::time_point queued,
+                     std::chrono::steady_clock::time_point callback);
+
+  // recv() into receive_buffer_ that optionally spins for runtime.spin_us
+  // before blocking. A truncated message returns 0.
+  ssize_t receive();
+
+  // A received length (MSG_TRUNC) larger than the buffer: counts the
+  // message as truncated, accepts its packet unimpaired and grows the buffer
+  // for the next one. False if the message fit.
+  bool truncated(ssize_t received);
+
+  // ENOBUFS: queue messages were lost, the socket stays usable. Resyncs the
+  // packet id sequence and tells the shedder we are behind.
+  void noteOverflow();
+
+  // Sends the verdict of one packet, with the payload only if it changed.
+  // batch is the sending thread's netlink batch, nullptr with the library.
+  int sendVerdict(NfqVerdictBatch *batch, const BoundQueue &queue,
+                  uint32_t id, const PacketProcessor::Verdict &verdict,
+                  uint32_t length, const uint8_t *data);
 
   // file descriptor for netlink socket
   int fd_;
@@ -72,31 +235,63 @@ private:
   // ConfigManager instance for accessing config values
   ConfigManager &config_manager_;
 
-  // Threads for timing burst errors given the config parameters
-  std::thread moon_to_earth_burst_thread_, earth_to_moon_burst_thread_,
-      moon_to_moon_burst_thread_;
+  // Source of packet timestamps
+  SimClock &clock_;
+
+  // Seed of every CounterRng stream, fixed for the lifetime of the queue
+  uint64_t seed_;
+
+  // Thread placement and receive strategy, fixed at startup
+  Config::Runtime runtime_;
 
-  // thread safe flags for controlling burst-error simulation
-  std::atomic<bool> burst_error_moon_to_earth_, burst_error_earth_to_moon_,
-      burst_error_moon_to_moon_;
+  // Sized for a full 64KB GSO payload plus netlink overhead
+  std::vector<char> receive_buffer_;
 
-  // Burst error simulation mutexes and condition variables
-  std::mutex moon_to_earth_cv_mutex_, earth_to_moon_cv_mutex_,
-      moon_to_moon_cv_mutex_;
-  std::condition_variable moon_to_earth_cv_, earth_to_moon_cv_,
-      moon_to_moon_cv_;
+  // Receive thread counters
+  std::atomic<uint64_t> gso_packets_{0};
+  std::atomic<uint64_t> truncated_messages_{0};
+  std::atomic<uint64_t> overflows_{0};
+  std::atomic<uint64_t> lost_packets_{0};
+  std::atomic<uint64_t> shed_packets_{0};
+  std::atomic<uint64_t> untimestamped_{0};
+
+  // Recorded by whichever thread sent the verdict
+  std::array<JitterStats, NUM_LINKS> residency_;
+  std::array<JitterStats, NUM_LINKS> verdict_time_;
+
+  // Receive buffer size and the kernel's drop counters
+  std::unique_ptr<SocketBuffer> socket_buffer_;
+
+  // Only held open so the kernel keeps timestamping, -1 if disabled
+  int timestamp_fd_ = -1;
+
+  // Bypasses impairment of low priority links under overload
+  LoadShedder shedder_;
+  uint32_t backlog_watermark_ = 0; // pipeline slots, 0 without pipeline
+
+  // Impairment logic for packets handled on the receive thread
+  std::unique_ptr<PacketProcessor> inline_processor_;
 
   // thread safe flag for controlling the processing loop
   std::atomic<bool> running_;
 
-  // flag for controlling burst error simulation threads
-  std::atomic<bool> burst_threads_running_{true};
-
   // smart pointers for resource management
   std::unique_ptr<struct nfq_handle, decltype(&nfq_close)> handle_;
-  std::unique_ptr<struct nfq_q_handle,
-                  std::function<void(struct nfq_q_handle *)>>
-      queue_handle_;
+
+  // One per interface, in Config::interfaces order. Declared after handle_
+  // so the queue handles are destroyed before it is closed.
+  std::vector<std::unique_ptr<BoundQueue>> queues_;
+
+  // Raw netlink backend, unset with the library backend. The receive and
+  // verdict threads each batch their own verdicts.
+  std::unique_ptr<NfqSocket> nfq_socket_;
+  std::unique_ptr<NfqVerdictBatch> receive_batch_;
+  std::unique_ptr<NfqVerdictBatch> pipeline_batch_;
+  size_t receive_batch_max_ = 0;
+
+  // Worker threads, only created when pipeline.workers > 0
+  // declared last so it is stopped before the handles above are closed
+  std::unique_ptr<PacketPipeline> pipeline_;
 };
 
 // netfilter
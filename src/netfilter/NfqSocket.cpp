@@ -0,0 +1,340 @@
+// src/netfilter/NfqSocket.cpp
+
+#include "NfqSocket.hpp"
+#include "configs.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+// Space of one verdict message without payload
+constexpr size_t VERDICT_SPACE =
+    NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(nfgenmsg)) +
+    NLA_HDRLEN + NLA_ALIGN(sizeof(nfqnl_msg_verdict_hdr)) + NLA_HDRLEN +
+    NLA_ALIGN(sizeof(uint32_t));
+
+// Appends netlink messages and attributes to a caller provided buffer
+class MessageWriter {
+public:
+  MessageWriter(uint8_t *buffer, size_t capacity)
+      : buffer_(buffer), capacity_(capacity) {}
+
+  bool begin(uint16_t type, uint16_t flags, uint32_t seq, uint16_t queue_num) {
+    size_t start = NLMSG_ALIGN(used_);
+    if (start + NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(nfgenmsg)) > capacity_) {
+      return false;
+    }
+    message_ = reinterpret_cast<nlmsghdr *>(buffer_ + start);
+    message_->nlmsg_type = type;
+    message_->nlmsg_flags = flags;
+    message_->nlmsg_seq = seq;
+    message_->nlmsg_pid = 0;
+
+    auto *header = static_cast<nfgenmsg *>(NLMSG_DATA(message_));
+    header->nfgen_family = AF_UNSPEC;
+    header->version = NFNETLINK_V0;
+    header->res_id = htons(queue_num);
+
+    used_ = start + NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(nfgenmsg));
+    message_->nlmsg_len = static_cast<uint32_t>(used_ - start);
+    return true;
+  }
+
+  bool attr(uint16_t type, const void *data, size_t length) {
+    if (NLA_HDRLEN + length > UINT16_MAX ||
+        used_ + NLA_HDRLEN + NLA_ALIGN(length) > capacity_) {
+      return false;
+    }
+    auto *attr = reinterpret_cast<nlattr *>(buffer_ + used_);
+    attr->nla_type = type;
+    attr->nla_len = static_cast<uint16_t>(NLA_HDRLEN + length);
+    if (length > 0) {
+      std::memcpy(buffer_ + used_ + NLA_HDRLEN, data, length);
+    }
+    // zero the alignment padding, it is sent to the kernel
+    std::memset(buffer_ + used_ + NLA_HDRLEN + length, 0,
+                NLA_ALIGN(length) - length);
+    used_ += NLA_HDRLEN + NLA_ALIGN(length);
+    message_->nlmsg_len = static_cast<uint32_t>(
+        buffer_ + used_ - reinterpret_cast<uint8_t *>(message_));
+    return true;
+  }
+
+  size_t used() const { return used_; }
+  void reset(size_t used) { used_ = used; }
+
+private:
+  uint8_t *buffer_;
+  size_t capacity_;
+  size_t used_ = 0;
+  nlmsghdr *message_ = nullptr;
+};
+} // namespace
+
+NfqSocket::NfqSocket(uint16_t queue_num) : fd_(-1) {
+  fd_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_NETFILTER);
+  if (fd_ < 0) {
+    throw std::runtime_error("Failed to open netlink socket: " +
+                             std::string(std::strerror(errno)));
+  }
+
+  sockaddr_nl address{};
+  address.nl_family = AF_NETLINK;
+  if (bind(fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+    close(fd_);
+    throw std::runtime_error("Failed to bind netlink socket: " +
+                             std::string(std::strerror(errno)));
+  }
+
+  try {
+    bindQueue(queue_num);
+  } catch (...) {
+    close(fd_);
+    throw;
+  }
+}
+
+NfqSocket::~NfqSocket() {
+  if (fd_ >= 0) {
+    for (uint16_t queue_num : queues_) {
+      nfqnl_msg_config_cmd command{};
+      command.command = NFQNL_CFG_CMD_UNBIND;
+      configure(queue_num, NFQA_CFG_CMD, &command, sizeof(command));
+    }
+    close(fd_);
+  }
+}
+
+void NfqSocket::bindQueue(uint16_t queue_num) {
+  nfqnl_msg_config_cmd command{};
+  command.command = NFQNL_CFG_CMD_BIND;
+  int error = configure(queue_num, NFQA_CFG_CMD, &command, sizeof(command));
+  if (error != 0) {
+    throw std::runtime_error("Failed to bind netfilter queue " +
+                             std::to_string(queue_num) + ": " +
+                             std::string(std::strerror(error)));
+  }
+  queues_.push_back(queue_num);
+}
+
+void NfqSocket::setCopyMode(uint8_t mode, uint32_t range) {
+  nfqnl_msg_config_params params{};
+  params.copy_range = htonl(range);
+  params.copy_mode = mode;
+  for (uint16_t queue_num : queues_) {
+    int error = configure(queue_num, NFQA_CFG_PARAMS, &params, sizeof(params));
+    if (error != 0) {
+      throw std::runtime_error("Failed to set netfilter queue copy mode: " +
+                               std::string(std::strerror(error)));
+    }
+  }
+}
+
+bool NfqSocket::setFlags(uint32_t mask, uint32_t flags) {
+  uint32_t mask_be = htonl(mask);
+  uint32_t flags_be = htonl(flags);
+  bool all = true;
+  for (uint16_t queue_num : queues_) {
+    all &= configure(queue_num, NFQA_CFG_MASK, &mask_be, sizeof(mask_be),
+                     NFQA_CFG_FLAGS, &flags_be, sizeof(flags_be)) == 0;
+  }
+  return all;
+}
+
+bool NfqSocket::setMaxLen(uint32_t max_len) {
+  uint32_t max_len_be = htonl(max_len);
+  bool all = true;
+  for (uint16_t queue_num : queues_) {
+    all &= configure(queue_num, NFQA_CFG_QUEUE_MAXLEN, &max_len_be,
+                     sizeof(max_len_be)) == 0;
+  }
+  return all;
+}
+
+int NfqSocket::configure(uint16_t queue_num, uint16_t attr_type,
+                         const void *attr, size_t attr_length,
+                         uint16_t attr_type2, const void *attr2,
+                         size_t attr2_length) {
+  uint8_t request[256];
+  uint32_t seq = ++seq_;
+  MessageWriter writer(request, sizeof(request));
+  writer.begin(NFNL_SUBSYS_QUEUE << 8 | NFQNL_MSG_CONFIG,
+               NLM_F_REQUEST | NLM_F_ACK, seq, queue_num);
+  writer.attr(attr_type, attr, attr_length);
+  if (attr2) {
+    writer.attr(attr_type2, attr2, attr2_length);
+  }
+  if (send(fd_, request, writer.used(), 0) < 0) {
+    return errno;
+  }
+
+  // Packets may already be queued once the queue is bound, they are passed
+  // through unimpaired rather than left waiting for a verdict
+  std::vector<uint8_t> reply(MAX_PACKET_SIZE + NFQ_MESSAGE_HEADROOM);
+  NfqVerdictBatch passthrough(fd_, queue_num, 64);
+  while (true) {
+    ssize_t received = recv(fd_, reply.data(), reply.size(), 0);
+    if (received < 0) {
+      if (errno == EINTR || errno == ENOBUFS) {
+        continue;
+      }
+      return errno;
+    }
+
+    int remaining = static_cast<int>(received);
+    for (auto *msg = reinterpret_cast<nlmsghdr *>(reply.data());
+         NLMSG_OK(msg, remaining); msg = NLMSG_NEXT(msg, remaining)) {
+      if (msg->nlmsg_type == NLMSG_ERROR && msg->nlmsg_seq == seq) {
+        passthrough.flush();
+        return -static_cast<nlmsgerr *>(NLMSG_DATA(msg))->error;
+      }
+    }
+    parse(reply.data(), static_cast<size_t>(received),
+          [&passthrough](const PacketView &packet) {
+            passthrough.add(packet.queue_num, packet.id, NF_ACCEPT,
+                            packet.mark, nullptr, 0);
+          });
+    passthrough.flush();
+  }
+}
+
+bool NfqSocket::parseTruncated(uint8_t *buffer, size_t length,
+                               PacketView &packet) {
+  constexpr uint16_t PACKET_TYPE = NFNL_SUBSYS_QUEUE << 8 | NFQNL_MSG_PACKET;
+  constexpr size_t ATTRS_OFFSET = NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(nfgenmsg));
+  auto *msg = reinterpret_cast<nlmsghdr *>(buffer);
+  if (length < ATTRS_OFFSET || msg->nlmsg_type != PACKET_TYPE) {
+    return false;
+  }
+
+  packet = {};
+  packet.queue_num = ntohs(static_cast<nfgenmsg *>(NLMSG_DATA(msg))->res_id);
+  bool has_header = false;
+  size_t end = std::min<size_t>(length, msg->nlmsg_len);
+  for (size_t offset = ATTRS_OFFSET; offset + NLA_HDRLEN <= end;) {
+    auto *attr = reinterpret_cast<nlattr *>(buffer + offset);
+    if (attr->nla_len < NLA_HDRLEN) {
+      break;
+    }
+    // the attribute the read stopped in is cut short
+    uint8_t *value = buffer + offset + NLA_HDRLEN;
+    auto value_length = static_cast<uint32_t>(std::min<size_t>(
+        attr->nla_len - NLA_HDRLEN, end - offset - NLA_HDRLEN));
+    uint32_t word = 0;
+    if (value_length >= sizeof(word)) {
+      std::memcpy(&word, value, sizeof(word));
+    }
+
+    switch (attr->nla_type & NLA_TYPE_MASK) {
+    case NFQA_PACKET_HDR:
+      has_header = value_length >= sizeof(nfqnl_msg_packet_hdr);
+      packet.id = ntohl(word);
+      break;
+    case NFQA_MARK:
+      packet.mark = value_length >= sizeof(word) ? ntohl(word) : 0;
+      break;
+    case NFQA_PAYLOAD:
+      packet.payload = value;
+      packet.length = value_length;
+      break;
+    default:
+      break;
+    }
+    offset += NLA_ALIGN(attr->nla_len);
+  }
+  return has_header;
+}
+
+size_t NfqSocket::encodePacket(uint8_t *buffer, size_t capacity,
+                               uint16_t queue_num, uint32_t id, uint32_t mark,
+                               const uint8_t *payload, uint32_t length,
+                               int64_t timestamp_ns) {
+  MessageWriter writer(buffer, capacity);
+  nfqnl_msg_packet_hdr header{};
+  header.packet_id = htonl(id);
+  header.hw_protocol = htons(0x0800);
+  uint32_t mark_be = htonl(mark);
+  if (!writer.begin(NFNL_SUBSYS_QUEUE << 8 | NFQNL_MSG_PACKET, 0, 0,
+                    queue_num) ||
+      !writer.attr(NFQA_PACKET_HDR, &header, sizeof(header)) ||
+      !writer.attr(NFQA_MARK, &mark_be, sizeof(mark_be))) {
+    return 0;
+  }
+  // the kernel sends microseconds, like nfq_get_timestamp() returns them
+  if (timestamp_ns != 0) {
+    nfqnl_msg_packet_timestamp stamp{};
+    stamp.sec = htobe64(static_cast<uint64_t>(timestamp_ns / 1000000000));
+    stamp.usec =
+        htobe64(static_cast<uint64_t>(timestamp_ns % 1000000000 / 1000));
+    if (!writer.attr(NFQA_TIMESTAMP, &stamp, sizeof(stamp))) {
+      return 0;
+    }
+  }
+  if (!writer.attr(NFQA_PAYLOAD, payload, length)) {
+    return 0;
+  }
+  return writer.used();
+}
+
+NfqVerdictBatch::NfqVerdictBatch(int fd, uint16_t queue_num, size_t max_batch)
+    : fd_(fd), queue_num_(queue_num), max_batch_(max_batch),
+      buffer_(max_batch * VERDICT_SPACE + NLA_HDRLEN + MAX_PACKET_SIZE) {}
+
+int NfqVerdictBatch::add(uint32_t id, uint32_t verdict, uint32_t mark,
+                         const uint8_t *payload, uint32_t length) {
+  return add(queue_num_, id, verdict, mark, payload, length);
+}
+
+int NfqVerdictBatch::add(uint16_t queue_num, uint32_t id, uint32_t verdict,
+                         uint32_t mark, const uint8_t *payload,
+                         uint32_t length) {
+  size_t payload_space = payload ? NLA_HDRLEN + NLA_ALIGN(length) : 0;
+  size_t needed = VERDICT_SPACE + payload_space;
+  if (needed > buffer_.size() || NLA_HDRLEN + length > UINT16_MAX) {
+    return -1;
+  }
+  if (pending_ >= max_batch_ || used_ + needed > buffer_.size()) {
+    if (flush() < 0) {
+      return -1;
+    }
+  }
+
+  nfqnl_msg_verdict_hdr header{};
+  header.verdict = htonl(verdict);
+  header.id = htonl(id);
+  uint32_t mark_be = htonl(mark);
+
+  MessageWriter writer(buffer_.data(), buffer_.size());
+  writer.reset(used_);
+  writer.begin(NFNL_SUBSYS_QUEUE << 8 | NFQNL_MSG_VERDICT, NLM_F_REQUEST, 0,
+               queue_num);
+  writer.attr(NFQA_VERDICT_HDR, &header, sizeof(header));
+  writer.attr(NFQA_MARK, &mark_be, sizeof(mark_be));
+  if (payload) {
+    writer.attr(NFQA_PAYLOAD, payload, length);
+  }
+  used_ = writer.used();
+  ++pending_;
+  return 0;
+}
+
+int NfqVerdictBatch::flush() {
+  if (pending_ == 0) {
+    return 0;
+  }
+  ssize_t sent;
+  do {
+    sent = send(fd_, buffer_.data(), used_, 0);
+  } while (sent < 0 && errno == EINTR);
+
+  used_ = 0;
+  pending_ = 0;
+  ++sends_;
+  return sent < 0 ? -1 : 0;
+}
@@ -0,0 +1,207 @@
+// src/netfilter/NfqSocket.hpp
+
+// ---- NfqSocket Usage ---- //
+
+// NfqSocket talks NFQUEUE directly over a raw netlink socket, without
+// libnetfilter_queue. Packet attributes are read in place from the receive
+// buffer and verdicts are encoded into a preallocated send buffer, so the
+// packet path does no allocation and no callback dispatch.
+
+// Example:
+// NfqSocket socket(QUEUE_NUM);
+// socket.setCopyMode(NFQNL_COPY_PACKET, 0xffff);
+// ssize_t n = recv(socket.fd(), buffer, size, 0);
+// NfqSocket::parse(buffer, n, [&](const NfqSocket::PacketView &packet) {
+//   batch.add(packet.id, NF_ACCEPT, mark, nullptr, 0);
+// });
+// batch.flush(); // all verdicts of this round in one send()
+
+// One socket can serve several queues, e.g. one per tunnel interface:
+// socket.bindQueue(1); // before the setters, they apply to every queue
+// A packet's queue_num tells which queue it came from, its verdict has to
+// go back to the same one.
+
+// NfqVerdictBatch is the sending half. Each thread that sends verdicts owns
+// its own batch; several batches may share one socket.
+
+// Setup errors throw std::runtime_error, optional features (flags the
+// kernel doesn't know, ...) return false so the caller can warn.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <endian.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_queue.h>
+#include <linux/netlink.h>
+
+class NfqSocket {
+public:
+  // Points into the receive buffer, valid until the next recv()
+  struct PacketView {
+    uint32_t id;
+    uint32_t mark;
+    uint32_t skbinfo; // NFQA_SKB_* flags
+    uint8_t *payload;
+    uint32_t length;
+    int64_t timestamp_ns; // kernel CLOCK_REALTIME stamp, 0 if not sent
+    uint16_t queue_num;
+  };
+
+  explicit NfqSocket(uint16_t queue_num);
+  ~NfqSocket();
+
+  NfqSocket(const NfqSocket &) = delete;
+  NfqSocket &operator=(const NfqSocket &) = delete;
+
+  int fd() const { return fd_; }
+  uint16_t queueNum() const { return queues_.front(); }
+
+  // Binds one more queue to this socket
+  void bindQueue(uint16_t queue_num);
+
+  // Apply to every queue bound so far
+  void setCopyMode(uint8_t mode, uint32_t range);
+  bool setFlags(uint32_t mask, uint32_t flags);
+  bool setMaxLen(uint32_t max_len);
+
+  // Calls on_packet for every queued packet in the buffer and returns how
+  // many kernel errors (e.g. verdicts for unknown ids) it contained
+  template <typename OnPacket>
+  static size_t parse(uint8_t *buffer, size_t length, OnPacket &&on_packet);
+
+  // Reads the first packet message of a buffer that holds only its start,
+  // what a recv() with MSG_TRUNC left of a message too large for it. The
+  // payload, if any of it was read, is cut short. False without a complete
+  // packet header.
+  static bool parseTruncated(uint8_t *buffer, size_t length,
+                             PacketView &packet);
+
+  // Encodes a packet message the way the kernel does, for benchmarks and
+  // tests that have no queue to read from. Returns the bytes written. A
+  // timestamp_ns of 0 leaves NFQA_TIMESTAMP out, like an unstamped skb.
+  static size_t encodePacket(uint8_t *buffer, size_t capacity,
+                             uint16_t queue_num, uint32_t id, uint32_t mark,
+                             const uint8_t *payload, uint32_t length,
+                             int64_t timestamp_ns = 0);
+
+private:
+  // Sends one config message and waits for the kernel's answer, returns the
+  // kernel error (0 on success)
+  int configure(uint16_t queue_num, uint16_t attr_type, const void *attr,
+                size_t attr_length, uint16_t attr_type2 = 0,
+                const void *attr2 = nullptr, size_t attr2_length = 0);
+
+  int fd_;
+  std::vector<uint16_t> queues_; // bound, the first one by the constructor
+  uint32_t seq_ = 0;
+};
+
+class NfqVerdictBatch {
+public:
+  NfqVerdictBatch(int fd, uint16_t queue_num, size_t max_batch);
+
+  // Queues one verdict, payload is copied and only needed if modified.
+  // Flushes first when the batch or the buffer is full. Returns -1 if a
+  // flush failed.
+  int add(uint32_t id, uint32_t verdict, uint32_t mark,
+          const uint8_t *payload, uint32_t length);
+  // Same for a packet of another queue bound to the socket
+  int add(uint16_t queue_num, uint32_t id, uint32_t verdict, uint32_t mark,
+          const uint8_t *payload, uint32_t length);
+
+  // Sends all queued verdicts in one datagram
+  int flush();
+
+  size_t pending() const { return pending_; }
+  uint64_t sends() const { return sends_; }
+
+private:
+  int fd_;
+  uint16_t queue_num_;
+  size_t max_batch_;
+  std::vector<uint8_t> buffer_;
+  size_t used_ = 0;
+  size_t pending_ = 0;
+  uint64_t sends_ = 0;
+};
+
+template <typename OnPacket>
+size_t NfqSocket::parse(uint8_t *buffer, size_t length, OnPacket &&on_packet) {
+  constexpr uint16_t PACKET_TYPE = NFNL_SUBSYS_QUEUE << 8 | NFQNL_MSG_PACKET;
+  size_t errors = 0;
+  int remaining = static_cast<int>(length);
+
+  for (auto *msg = reinterpret_cast<nlmsghdr *>(buffer);
+       NLMSG_OK(msg, remaining); msg = NLMSG_NEXT(msg, remaining)) {
+    if (msg->nlmsg_type == NLMSG_ERROR) {
+      auto *error = static_cast<nlmsgerr *>(NLMSG_DATA(msg));
+      errors += error->error != 0;
+      continue;
+    }
+    if (msg->nlmsg_type != PACKET_TYPE) {
+      continue;
+    }
+
+    PacketView packet{};
+    bool has_header = false;
+    packet.queue_num =
+        ntohs(static_cast<nfgenmsg *>(NLMSG_DATA(msg))->res_id);
+    auto *attrs = static_cast<uint8_t *>(NLMSG_DATA(msg)) +
+                  NLMSG_ALIGN(sizeof(nfgenmsg));
+    auto *end = reinterpret_cast<uint8_t *>(msg) + msg->nlmsg_len;
+
+    for (auto *attr = reinterpret_cast<nlattr *>(attrs);
+         reinterpret_cast<uint8_t *>(attr) + NLA_HDRLEN <= end &&
+         attr->nla_len >= NLA_HDRLEN &&
+         reinterpret_cast<uint8_t *>(attr) + attr->nla_len <= end;
+         attr = reinterpret_cast<nlattr *>(reinterpret_cast<uint8_t *>(attr) +
+                                           NLA_ALIGN(attr->nla_len))) {
+      uint8_t *value = reinterpret_cast<uint8_t *>(attr) + NLA_HDRLEN;
+      uint32_t value_length = attr->nla_len - NLA_HDRLEN;
+      uint32_t word = 0;
+      if (value_length >= sizeof(word)) {
+        std::memcpy(&word, value, sizeof(word));
+      }
+
+      switch (attr->nla_type & NLA_TYPE_MASK) {
+      case NFQA_PACKET_HDR:
+        // packet_id is the first field of nfqnl_msg_packet_hdr
+        has_header = value_length >= sizeof(nfqnl_msg_packet_hdr);
+        packet.id = ntohl(word);
+        break;
+      case NFQA_MARK:
+        packet.mark = ntohl(word);
+        break;
+      case NFQA_SKB_INFO:
+        packet.skbinfo = ntohl(word);
+        break;
+      case NFQA_PAYLOAD:
+        packet.payload = value;
+        packet.length = value_length;
+        break;
+      case NFQA_TIMESTAMP:
+        if (value_length >= sizeof(nfqnl_msg_packet_timestamp)) {
+          nfqnl_msg_packet_timestamp stamp;
+          std::memcpy(&stamp, value, sizeof(stamp));
+          packet.timestamp_ns =
+              static_cast<int64_t>(be64toh(stamp.sec)) * 1000000000 +
+              static_cast<int64_t>(be64toh(stamp.usec)) * 1000;
+        }
+        break;
+      default:
+        break;
+      }
+    }
+
+    if (has_header) {
+      on_packet(packet);
+    }
+  }
+  return errors;
+}
@@ -0,0 +1,220 @@
+// src/netfilter/PacketPipeline.cpp
+
+#include "PacketPipeline.hpp"
+#include "Backoff.hpp"
+#include "BlockedSignals.hpp"
+#include "ThreadTuning.hpp"
+#include "configs.hpp"
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// spare bytes after each slot, the verdict path may read up to the next
+// netlink alignment boundary past the payload
+constexpr size_t SLOT_PADDING = 8;
+
+// slots a worker takes from its ring at once
+constexpr size_t WORKER_BATCH = 32;
+
+PacketPipeline::PacketPipeline(
+    const Config::Pipeline &config, const Config::Runtime &runtime,
+    std::vector<std::unique_ptr<PacketProcessor>> processors, VerdictSink sink)
+    : config_(config), runtime_(runtime), processors_(std::move(processors)),
+      sink_(std::move(sink)), free_ring_(config.ring_size) {
+  if (processors_.empty()) {
+    throw std::invalid_argument("Pipeline needs at least one worker.");
+  }
+
+  size_t stride = config_.slot_size + SLOT_PADDING;
+  slab_ = std::make_unique<uint8_t[]>(stride * config_.ring_size);
+  slots_.resize(config_.ring_size);
+  for (uint32_t i = 0; i < config_.ring_size; ++i) {
+    slots_[i].data = slab_.get() + i * stride;
+    free_ring_.tryPush(i);
+  }
+
+  for (size_t i = 0; i < processors_.size(); ++i) {
+    work_rings_.push_back(
+        std::make_unique<SpscRing<uint32_t>>(config_.ring_size));
+    done_rings_.push_back(
+        std::make_unique<SpscRing<uint32_t>>(config_.ring_size));
+  }
+}
+
+PacketPipeline::~PacketPipeline() { stop(); }
+
+void PacketPipeline::start() {
+  if (verdict_running_)
+    return;
+
+  workers_running_ = true;
+  verdict_running_ = true;
+
+  // helper threads must leave termination signals to the receive thread
+  BlockedSignals guard;
+  for (size_t i = 0; i < processors_.size(); ++i) {
+    workers_.emplace_back(&PacketPipeline::workerLoop, this, i);
+  }
+  verdict_thread_ = std::thread(&PacketPipeline::verdictLoop, this);
+  std::cout << "Packet pipeline started with " << processors_.size()
+            << " workers.\n";
+}
+
+void PacketPipeline::stop() {
+  // workers drain their rings before exiting, then the verdict thread drains
+  // what the workers produced, so every packet gets a verdict
+  workers_running_ = false;
+  for (auto &worker : workers_) {
+    if (worker.joinable())
+      worker.join();
+  }
+  workers_.clear();
+
+  verdict_running_ = false;
+  if (verdict_thread_.joinable())
+    verdict_thread_.join();
+}
+
+bool PacketPipeline::submit(uint32_t id, uint32_t mark, const uint8_t *data,
+                            size_t length,
+                            std::chrono::steady_clock::time_point received,
+                            std::chrono::steady_clock::time_point queued,
+                            std::chrono::steady_clock::time_point callback,
+                            uint32_t interface) {
+  // no worker would pick the slot up
+  if (length > config_.slot_size || !workers_running_)
+    return false;
+
+  uint32_t index;
+  if (!free_ring_.tryPop(index)) {
+    stats_.backpressure_waits.fetch_add(1, std::memory_order_relaxed);
+    Backoff backoff;
+    while (!free_ring_.tryPop(index)) {
+      if (!workers_running_)
+        return false;
+      backoff.idle();
+    }
+  }
+
+  Slot &slot = slots_[index];
+  slot.id = id;
+  slot.mark = mark;
+  slot.interface = interface;
+  slot.length = static_cast<uint32_t>(length);
+  slot.received = received;
+  slot.queued = queued;
+  slot.callback = callback;
+  std::memcpy(slot.data, data, length);
+
+  work_rings_[pickWorker(data, length)]->tryPush(index);
+  return true;
+}
+
+size_t PacketPipeline::inFlight() const {
+  return slots_.size() - free_ring_.size();
+}
+
+size_t PacketPipeline::pickWorker(const uint8_t *data, size_t length) const {
+  if (length < 20 || (data[0] >> 4) != 4)
+    return 0;
+
+  // hash of the IPv4 source and destination, keeps a src/dst pair together
+  uint32_t src, dst;
+  std::memcpy(&src, data + 12, sizeof(src));
+  std::memcpy(&dst, data + 16, sizeof(dst));
+  uint32_t hash = (src * 0x9E3779B1u) ^ (dst * 0x85EBCA77u);
+  hash ^= hash >> 15;
+  return hash % processors_.size();
+}
+
+void PacketPipeline::workerLoop(size_t worker) {
+  ThreadPlacement placement{-1, runtime_.realtime_priority};
+  if (!runtime_.worker_cpus.empty()) {
+    placement.cpu = runtime_.worker_cpus[worker % runtime_.worker_cpus.size()];
+  }
+  std::string name = "lnd-worker-" + std::to_string(worker);
+  placeCurrentThread(name.c_str(), placement);
+  if (runtime_.lock_memory) {
+    prefaultStack();
+  }
+
+  PacketProcessor &processor = *processors_[worker];
+  SpscRing<uint32_t> &in = *work_rings_[worker];
+  SpscRing<uint32_t> &out = *done_rings_[worker];
+  uint32_t batch[WORKER_BATCH];
+  Backoff backoff;
+
+  while (true) {
+    // the flag is read before the ring, an empty pop after stop() was seen
+    // means the receive thread has nothing left to push
+    bool running = workers_running_;
+    size_t count = in.tryPopBatch(batch, WORKER_BATCH);
+    if (count == 0) {
+      if (!running)
+        break;
+      backoff.idle();
+      continue;
+    }
+    backoff.reset();
+
+    for (size_t i = 0; i < count; ++i) {
+      Slot &slot = slots_[batch[i]];
+      try {
+        slot.verdict =
+            processor.process(slot.id, slot.data, slot.length, slot.mark,
+                              slot.received, slot.interface);
+      } catch (const std::exception &error) {
+        std::cerr << "Error processing packet: " << error.what() << "\n";
+        slot.verdict = {NF_ACCEPT, MARK_EARTH_TO_EARTH, false};
+      }
+      out.tryPush(batch[i]);
+    }
+  }
+}
+
+void PacketPipeline::verdictLoop() {
+  placeCurrentThread("lnd-verdict",
+                     {runtime_.verdict_cpu, runtime_.realtime_priority});
+  if (runtime_.lock_memory) {
+    prefaultStack();
+  }
+
+  std::vector<uint32_t> indices(config_.verdict_batch);
+  std::vector<Slot *> batch(config_.verdict_batch);
+  Backoff backoff;
+  size_t next_ring = 0;
+
+  while (true) {
+    // read before polling, workers may push until stop() joined them
+    bool running = verdict_running_;
+
+    // round robin over the workers until the batch is full
+    size_t count = 0;
+    for (size_t i = 0; i < done_rings_.size() && count < indices.size();
+         ++i) {
+      SpscRing<uint32_t> &ring = *done_rings_[next_ring];
+      next_ring = (next_ring + 1) % done_rings_.size();
+      count += ring.tryPopBatch(indices.data() + count, indices.size() - count);
+    }
+
+    if (count == 0) {
+      if (!running)
+        break;
+      backoff.idle();
+      continue;
+    }
+    backoff.reset();
+
+    for (size_t i = 0; i < count; ++i) {
+      batch[i] = &slots_[indices[i]];
+    }
+    sink_(batch.data(), count);
+    stats_.verdict_batches.fetch_add(1, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < count; ++i) {
+      free_ring_.tryPush(indices[i]);
+    }
+  }
+}
@@ -0,0 +1,127 @@
+// src/netfilter/PacketPipeline.hpp
+
+// ---- PacketPipeline Usage ---- //
+
+// PacketPipeline spreads packet processing over several threads:
+//
+//   receive thread --SPSC--> N impairment workers --SPSC--> verdict thread
+//        ^                                                       |
+//        +------------------------ free slots -------------------+
+//
+// The receive thread only copies each packet into a preallocated slot and
+// hands the slot index to a worker. Workers run a PacketProcessor each and
+// pass the slot on to the verdict thread, which sends verdicts in batches
+// through the sink and recycles the slots.
+
+// Example:
+// PacketPipeline pipeline(config->pipeline, config->runtime,
+//                         std::move(processors),
+//                         [](PacketPipeline::Slot *const *slots, size_t n) {
+//                           // send n verdicts
+//                         });
+// pipeline.start();
+// // receive thread only
+// pipeline.submit(id, mark, data, length, now, queued, callback);
+// pipeline.stop(); // drains in-flight packets, then joins all threads
+
+// Packets of one src/dst pair always go to the same worker, so a flow is
+// never reordered by the pipeline. The workers are shared by all tunnel
+// interfaces, each slot remembers which one its packet came from.
+
+// Worker and verdict threads place themselves according to the runtime
+// section (cpu pinning, SCHED_FIFO) when they start.
+
+// Backpressure: when every slot is in flight, submit() waits for the verdict
+// thread to free one instead of reading more packets, the kernel queue then
+// absorbs the burst.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ConfigManager.hpp"
+#include "PacketProcessor.hpp"
+#include "SpscRing.hpp"
+
+class PacketPipeline {
+public:
+  struct Slot {
+    uint32_t id;
+    uint32_t mark;
+    uint32_t interface; // index into Config::interfaces
+    uint32_t length;
+    std::chrono::steady_clock::time_point received; // simulated time
+    // wall clock, when the kernel queued the packet and when we got it
+    std::chrono::steady_clock::time_point queued;
+    std::chrono::steady_clock::time_point callback;
+    PacketProcessor::Verdict verdict;
+    uint8_t *data; // slot_size bytes (plus padding) inside the slab
+  };
+
+  // Called on the verdict thread with up to verdict_batch finished slots
+  using VerdictSink = std::function<void(Slot *const *slots, size_t count)>;
+
+  struct Stats {
+    std::atomic<uint64_t> backpressure_waits{0};
+    std::atomic<uint64_t> verdict_batches{0};
+  };
+
+  PacketPipeline(const Config::Pipeline &config,
+                 const Config::Runtime &runtime,
+                 std::vector<std::unique_ptr<PacketProcessor>> processors,
+                 VerdictSink sink);
+  ~PacketPipeline();
+
+  PacketPipeline(const PacketPipeline &) = delete;
+  PacketPipeline &operator=(const PacketPipeline &) = delete;
+
+  void start();
+  void stop();
+
+  // Receive thread only. Returns false if the packet is larger than a slot
+  // or the pipeline is not running, the caller then handles it inline.
+  // interface is the Config::interfaces index the packet was queued on.
+  bool submit(uint32_t id, uint32_t mark, const uint8_t *data, size_t length,
+              std::chrono::steady_clock::time_point received,
+              std::chrono::steady_clock::time_point queued,
+              std::chrono::steady_clock::time_point callback,
+              uint32_t interface = 0);
+
+  size_t inFlight() const;
+  const Stats &stats() const { return stats_; }
+  const std::vector<std::unique_ptr<PacketProcessor>> &processors() const {
+    return processors_;
+  }
+
+private:
+  void workerLoop(size_t worker);
+  void verdictLoop();
+  size_t pickWorker(const uint8_t *data, size_t length) const;
+
+  Config::Pipeline config_;
+  Config::Runtime runtime_;
+  std::vector<std::unique_ptr<PacketProcessor>> processors_;
+  VerdictSink sink_;
+
+  std::unique_ptr<uint8_t[]> slab_;
+  std::vector<Slot> slots_;
+
+  // Every ring can hold all slots, so only the free ring can ever run dry
+  SpscRing<uint32_t> free_ring_; // verdict thread -> receive thread
+  std::vector<std::unique_ptr<SpscRing<uint32_t>>> work_rings_; // -> worker
+  std::vector<std::unique_ptr<SpscRing<uint32_t>>> done_rings_; // -> verdict
+
+  std::vector<std::thread> workers_;
+  std::thread verdict_thread_;
+  std::atomic<bool> workers_running_{false};
+  std::atomic<bool> verdict_running_{false};
+
+  Stats stats_;
+};
@@ -0,0 +1,112 @@
+// src/netfilter/SocketBuffer.cpp
+
+#include "SocketBuffer.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+#include <sys/socket.h>
+
+SocketBuffer::SocketBuffer(int fd, const Config::Queue &queue,
+                           std::string proc_path)
+    : fd_(fd), max_bytes_(queue.max_socket_buffer),
+      requested_(queue.socket_buffer), proc_path_(std::move(proc_path)) {
+  if (!apply(requested_)) {
+    std::cerr << "Warning: Could not set the socket buffer to " << requested_
+              << " bytes.\n";
+  }
+}
+
+bool SocketBuffer::apply(uint32_t bytes) {
+  int value = static_cast<int>(bytes);
+  bool set = false;
+  if (forced_) {
+    set = setsockopt(fd_, SOL_SOCKET, SO_RCVBUFFORCE, &value,
+                     sizeof(value)) == 0;
+    if (!set) {
+      forced_ = false;
+      std::cerr << "Warning: SO_RCVBUFFORCE not permitted, the socket buffer "
+                   "is capped by net.core.rmem_max.\n";
+    }
+  }
+  if (!set &&
+      setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &value, sizeof(value)) < 0) {
+    return false;
+  }
+
+  int actual = 0;
+  socklen_t length = sizeof(actual);
+  if (getsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &actual, &length) == 0) {
+    size_.store(static_cast<uint64_t>(actual), std::memory_order_relaxed);
+  }
+  return true;
+}
+
+bool SocketBuffer::poll(const std::vector<uint16_t> &queue_nums,
+                        uint64_t overflows) {
+  // without the nfnetlink_queue module loaded there is no file, the
+  // overflows still count
+  std::ifstream file(proc_path_);
+  Counters totals{};
+  for (const QueueCounters &queue : parse(file)) {
+    if (std::find(queue_nums.begin(), queue_nums.end(), queue.queue_num) !=
+        queue_nums.end()) {
+      totals.queue_total += queue.queue_total;
+      totals.queue_dropped += queue.queue_dropped;
+      totals.user_dropped += queue.user_dropped;
+    }
+  }
+  queue_total_.store(totals.queue_total, std::memory_order_relaxed);
+  queue_dropped_.store(totals.queue_dropped, std::memory_order_relaxed);
+  user_dropped_.store(totals.user_dropped, std::memory_order_relaxed);
+
+  uint64_t drops = totals.user_dropped + overflows;
+  uint64_t new_drops = drops > last_drops_ ? drops - last_drops_ : 0;
+  last_drops_ = drops;
+  if (new_drops == 0 || requested_ >= max_bytes_) {
+    return false;
+  }
+
+  uint32_t bytes = static_cast<uint32_t>(
+      std::min<uint64_t>(uint64_t{requested_} * 2, max_bytes_));
+  if (!apply(bytes)) {
+    std::cerr << "Warning: Could not grow the socket buffer to " << bytes
+              << " bytes.\n";
+    return false;
+  }
+  requested_ = bytes;
+  std::cout << "Socket buffer grown to " << bytes << " bytes after "
+            << new_drops << " lost queue messages.\n";
+  return true;
+}
+
+SocketBuffer::Counters SocketBuffer::counters() const {
+  return {queue_total_.load(std::memory_order_relaxed),
+          queue_dropped_.load(std::memory_order_relaxed),
+          user_dropped_.load(std::memory_order_relaxed)};
+}
+
+std::vector<SocketBuffer::QueueCounters>
+SocketBuffer::parse(std::istream &in) {
+  // queue_num portid queue_total copy_mode copy_range queue_dropped
+  // user_dropped id_sequence 1
+  std::vector<QueueCounters> queues;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    QueueCounters queue{};
+    uint32_t queue_num = 0;
+    uint32_t copy_mode = 0;
+    uint32_t copy_range = 0;
+    if (fields >> queue_num >> queue.portid >> queue.queue_total >>
+        copy_mode >> copy_range >> queue.queue_dropped >>
+        queue.user_dropped) {
+      queue.queue_num = static_cast<uint16_t>(queue_num);
+      queues.push_back(queue);
+    }
+  }
+  return queues;
+}
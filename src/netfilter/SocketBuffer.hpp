@@ -0,0 +1,92 @@
+// src/netfilter/SocketBuffer.hpp
+
+// ---- SocketBuffer Usage ---- //
+
+// SocketBuffer sizes the receive buffer of the NFQUEUE netlink socket and
+// grows it when packets are lost on the way to the daemon. It also keeps
+// the kernel's counters of our queues from /proc/net/netfilter/
+// nfnetlink_queue.
+
+// Example:
+// SocketBuffer buffer(fd, config->queue); // starts at queue.socket_buffer
+// ...
+// // once a second, off the packet path
+// buffer.poll({0, 1}, overflows);
+// std::cout << buffer.size() << " bytes, " << buffer.counters().user_dropped
+//           << " dropped\n";
+
+// A message the socket had no room for is counted by the kernel as
+// user_dropped (or passed unimpaired with queue.fail_open) and reported to
+// the daemon as ENOBUFS, the overflows poll() takes. When either moved since
+// the last poll the buffer doubles, up to queue.max_socket_buffer, and
+// keeps that size from then on. queue_dropped counts packets the full queue
+// (queue.max_len) turned away, a bigger buffer does not help with those.
+// Gaps in the packet ids are left out as well, they also follow from
+// queue_dropped.
+
+// Sizes are set with SO_RCVBUFFORCE, which needs CAP_NET_ADMIN, falling
+// back to SO_RCVBUF, which the kernel caps at net.core.rmem_max. size() is
+// what the kernel reports back, twice the bytes asked for since it counts
+// its bookkeeping as well.
+
+// poll() runs on one thread, size() and counters() are safe from any.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "ConfigManager.hpp"
+
+class SocketBuffer {
+public:
+  // One line of /proc/net/netfilter/nfnetlink_queue
+  struct QueueCounters {
+    uint16_t queue_num;
+    uint32_t portid;
+    uint32_t queue_total; // packets waiting for a verdict
+    uint64_t queue_dropped;
+    uint64_t user_dropped;
+  };
+
+  // Sums over the queues passed to poll()
+  struct Counters {
+    uint64_t queue_total;
+    uint64_t queue_dropped;
+    uint64_t user_dropped;
+  };
+
+  SocketBuffer(int fd, const Config::Queue &queue,
+               std::string proc_path = "/proc/net/netfilter/nfnetlink_queue");
+
+  // Reads the counters of queue_nums and grows the buffer if user_dropped
+  // or overflows (a running total of ENOBUFS) went up. Returns true if it
+  // grew.
+  bool poll(const std::vector<uint16_t> &queue_nums, uint64_t overflows);
+
+  uint64_t size() const { return size_.load(std::memory_order_relaxed); }
+  uint32_t requested() const { return requested_; }
+  Counters counters() const;
+
+  // Lines that don't parse are skipped
+  static std::vector<QueueCounters> parse(std::istream &in);
+
+private:
+  // Sets bytes and reads the size back, false if neither option worked
+  bool apply(uint32_t bytes);
+
+  int fd_;
+  uint32_t max_bytes_;
+  uint32_t requested_ = 0;
+  std::string proc_path_;
+  bool forced_ = true; // SO_RCVBUFFORCE worked so far
+  uint64_t last_drops_ = 0;
+
+  std::atomic<uint64_t> size_{0};
+  std::atomic<uint64_t> queue_total_{0};
+  std::atomic<uint64_t> queue_dropped_{0};
+  std::atomic<uint64_t> user_dropped_{0};
+};
@@ -4,14 +4,13 @@
 #include "configs.hpp"
 
 #include <cstring>      // memcpy
-#include <netinet/in.h> // ntohl
 #include <stdexcept>
 
 // constructor that takes ownership by copying
 Packet::Packet(uint32_t id, uint8_t *data, size_t length, uint32_t mark,
                std::chrono::steady_clock::time_point time_received)
-    : id(id), data(nullptr), length(length), owns_data(true), mark(mark),
-      time_received(time_received) {
+    : id(id), data(nullptr), length(length), owns_data(true), src_ip(0),
+      dst_ip(0), mark(mark), time_received(time_received) {
   if (data && length > 0) {
     // Copy data to take ownership with exception handling
     try {
@@ -25,8 +24,8 @@ Packet::Packet(uint32_t id, uint8_t *data, size_t length, uint32_t mark,
 
   // Only classify if we have valid data
   if (this->data && this->length > 0) {
-    this->link_type =
-        PacketClassifier::classifyPacket(this->data, this->length);
+    this->link_type = PacketClassifier::classifyPacket(
+        this->data, this->length, this->src_ip, this->dst_ip);
   } else {
     this->link_type = LinkType::OTHER;
   }
@@ -36,8 +35,8 @@ Packet::Packet(uint32_t id, uint8_t *data, size_t length, uint32_t mark,
 Packet::Packet(uint32_t id, const uint8_t *data, size_t length, uint32_t mark,
                std::chrono::steady_clock::time_point time_received,
                bool copy_data)
-    : id(id), data(nullptr), length(length), owns_data(copy_data), mark(mark),
-      time_received(time_received) {
+    : id(id), data(nullptr), length(length), owns_data(copy_data), src_ip(0),
+      dst_ip(0), mark(mark), time_received(time_received) {
   if (data && length > 0) {
     if (copy_data) {
       // Copy data to take ownership with exception handling
@@ -56,8 +55,8 @@ Packet::Packet(uint32_t id, const uint8_t *data, size_t length, uint32_t mark,
 
   // Only classify if we have valid data
   if (this->data && this->length > 0) {
-    this->link_type =
-        PacketClassifier::classifyPacket(this->data, this->length);
+    this->link_type = PacketClassifier::classifyPacket(
+        this->data, this->length, this->src_ip, this->dst_ip);
   } else {
     this->link_type = LinkType::OTHER;
   }
@@ -66,7 +65,8 @@ Packet::Packet(uint32_t id, const uint8_t *data, size_t length, uint32_t mark,
 // copy constructor
 Packet::Packet(const Packet &other)
     : id(other.id), data(nullptr), length(other.length),
-      owns_data(other.owns_data), link_type(other.link_type), mark(other.mark),
+      owns_data(other.owns_data), link_type(other.link_type),
+      src_ip(other.src_ip), dst_ip(other.dst_ip), mark(other.mark),
       time_received(other.time_received) {
   if (other.data && other.length > 0) {
     if (owns_data) {
@@ -111,6 +111,8 @@ Packet &Packet::operator=(const Packet &other) {
     mark = other.mark;
     time_received = other.time_received;
     link_type = other.link_type;
+    src_ip = other.src_ip;
+    dst_ip = other.dst_ip;
     owns_data = other.owns_data;
 
     // Assign the data pointer
@@ -127,7 +129,8 @@ Packet &Packet::operator=(const Packet &other) {
 // move constructor
 Packet::Packet(Packet &&other) noexcept
     : id(other.id), data(other.data), length(other.length),
-      owns_data(other.owns_data), link_type(other.link_type), mark(other.mark),
+      owns_data(other.owns_data), link_type(other.link_type),
+      src_ip(other.src_ip), dst_ip(other.dst_ip), mark(other.mark),
       time_received(other.time_received) {
   other.data = nullptr;
   other.length = 0;
@@ -146,6 +149,8 @@ Packet &Packet::operator=(Packet &&other) noexcept {
     mark = other.mark;
     time_received = other.time_received;
     link_type = other.link_type;
+    src_ip = other.src_ip;
+    dst_ip = other.dst_ip;
     data = other.data;
     owns_data = other.owns_data;
 
@@ -206,19 +211,36 @@ std::chrono::steady_clock::time_point Packet::getTimeReceived() const {
 
 Packet::LinkType Packet::getLinkType() const { return link_type; }
 
+uint32_t Packet::getSrcIP() const { return src_ip; }
+
+uint32_t Packet::getDstIP() const { return dst_ip; }
+
 // PacketClassifier implementation
 Packet::LinkType PacketClassifier::classifyPacket(const uint8_t *data,
                                                   size_t length) {
   uint32_t src_ip, dst_ip;
+  return classifyPacket(data, length, src_ip, dst_ip);
+}
 
-  if (!extractIPs(data, length, src_ip, dst_ip)) {
+Packet::LinkType PacketClassifier::classifyPacket(const uint8_t *data,
+                                                  size_t length,
+                                                  uint32_t &src_ip,
+                                                  uint32_t &dst_ip) {
+  PacketMeta meta = PacketMeta::parse(data, length);
+  src_ip = meta.src_ip;
+  dst_ip = meta.dst_ip;
+  return classifyPacket(meta);
+}
+
+Packet::LinkType PacketClassifier::classifyPacket(const PacketMeta &meta) {
+  // if ipv6 (or too short for IPv4) then it's not part of our project
+  if (!meta.isIPv4())
     return Packet::LinkType::OTHER;
-  }
 
-  bool is_src_rover = isRoverIP(src_ip);
-  bool is_src_base = isBaseIP(src_ip);
-  bool is_dst_rover = isRoverIP(dst_ip);
-  bool is_dst_base = isBaseIP(dst_ip);
+  bool is_src_rover = isRoverIP(meta.src_ip);
+  bool is_src_base = isBaseIP(meta.src_ip);
+  bool is_dst_rover = isRoverIP(meta.dst_ip);
+  bool is_dst_base = isBaseIP(meta.dst_ip);
 
   if (is_src_rover && is_dst_rover)
     return Packet::LinkType::MOON_TO_MOON;
@@ -240,29 +262,6 @@ bool PacketClassifier::isBaseIP(uint32_t ip) {
   return (ip >= BASE_IP_MIN && ip <= BASE_IP_MAX);
 }
 
-bool PacketClassifier::extractIPs(const uint8_t *data, size_t length,
-                                  uint32_t &src_ip, uint32_t &dst_ip) {
-  // check if long enough to contain IP header
-  // should always be longer than 20 but just in case
-  if (length < 20 || !data)
-    return false;
-
-  uint8_t ip_version = (data[0] >> 4) & 0xF; // first half byte
-
-  // if ipv6 then it's not part of our project
-  if (ip_version != 4)
-    return false;
-
-  std::memcpy(&src_ip, data + 12, sizeof(uint32_t));
-  std::memcpy(&dst_ip, data + 16, sizeof(uint32_t));
-
-  // ntohl == network to host long (big endian to host endianness)
-  src_ip = ntohl(src_ip);
-  dst_ip = ntohl(dst_ip);
-
-  return true;
-}
-
 const std::string Packet::getLinkTypeName(Packet::LinkType type) {
   switch (type) {
   case Packet::LinkType::EARTH_TO_EARTH:
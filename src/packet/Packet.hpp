@@ -27,6 +27,10 @@
 // constructor. Example: Packet::LinkType link = pkt.getLinkType(); // returns
 // EARTH_TO_MOON, MOON_TO_MOON, etc.
 
+// The addresses found during classification are kept for profile lookup
+// Example:
+// uint16_t profile = config->profileFor(pkt.getSrcIP(), pkt.getDstIP());
+
 // For read-only access to packet data, use getData()
 // Example:
 // const uint8_t *data = pkt.getData();
@@ -69,6 +73,8 @@
 #include <cstdint> // uint32_t
 #include <string>
 
+#include "PacketMeta.hpp"
+
 // Forward declaration
 class PacketClassifier;
 
@@ -111,6 +117,8 @@ public:
   void setMark(uint32_t new_mark);
   std::chrono::steady_clock::time_point getTimeReceived() const;
   LinkType getLinkType() const;
+  uint32_t getSrcIP() const; // host byte order, 0 if not IPv4
+  uint32_t getDstIP() const; // host byte order, 0 if not IPv4
   const std::string getLinkTypeName();
   const std::string getLinkTypeName(Packet::LinkType type);
 
@@ -124,6 +132,10 @@ private:
 
   LinkType link_type;
 
+  // addresses extracted by the classifier
+  uint32_t src_ip;
+  uint32_t dst_ip;
+
   // netfilter mark to classify the packet link type
   uint32_t mark;
 
@@ -136,10 +148,12 @@ private:
 class PacketClassifier {
 public:
   static Packet::LinkType classifyPacket(const uint8_t *data, size_t length);
+  static Packet::LinkType classifyPacket(const uint8_t *data, size_t length,
+                                         uint32_t &src_ip, uint32_t &dst_ip);
+  // for a packet that was already parsed
+  static Packet::LinkType classifyPacket(const PacketMeta &meta);
 
 private:
   static bool isRoverIP(uint32_t ip);
   static bool isBaseIP(uint32_t ip);
-  static bool extractIPs(const uint8_t *data, size_t length, uint32_t &src_ip,
-                         uint32_t &dst_ip);
 };
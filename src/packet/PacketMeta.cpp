@@ -0,0 +1,152 @@
+// src/packet/PacketMeta.cpp
+
+#include "PacketMeta.hpp"
+
+namespace {
+constexpr uint8_t PROTO_ICMP = 1;
+constexpr uint8_t PROTO_IPIP = 4;
+constexpr uint8_t PROTO_TCP = 6;
+constexpr uint8_t PROTO_UDP = 17;
+constexpr uint8_t PROTO_GRE = 47;
+constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+
+// ICMP and UDP headers are 8 bytes, TCP at least 20
+constexpr size_t SHORT_L4_HEADER = 8;
+constexpr size_t MIN_IPV4_HEADER = 20;
+constexpr size_t MIN_TCP_HEADER = 20;
+
+uint16_t read16(const uint8_t *data) {
+  return static_cast<uint16_t>(data[0] << 8 | data[1]);
+}
+
+uint32_t read32(const uint8_t *data) {
+  return static_cast<uint32_t>(data[0]) << 24 | data[1] << 16 |
+         data[2] << 8 | data[3];
+}
+
+// Length of the IPv4 header at data[offset], 0 if it is not one that fits
+size_t ipv4HeaderLength(const uint8_t *data, size_t length, size_t offset) {
+  if (length - offset < MIN_IPV4_HEADER || (data[offset] >> 4) != 4) {
+    return 0;
+  }
+  size_t ihl = (data[offset] & 0x0F) * 4u;
+  return ihl >= MIN_IPV4_HEADER && ihl <= length - offset ? ihl : 0;
+}
+
+// Length of the GRE header at data[offset] if it carries IPv4, 0 otherwise
+size_t greHeaderLength(const uint8_t *data, size_t length, size_t offset) {
+  if (length - offset < 4 || (data[offset + 1] & 0x07) != 0 ||
+      read16(data + offset + 2) != ETHERTYPE_IPV4) {
+    return 0;
+  }
+  // checksum, key and sequence number each add 4 bytes
+  uint8_t present = data[offset];
+  size_t header = 4 + ((present & 0x80) ? 4 : 0) + ((present & 0x20) ? 4 : 0) +
+                  ((present & 0x10) ? 4 : 0);
+  return header <= length - offset ? header : 0;
+}
+} // namespace
+
+PacketMeta PacketMeta::parse(const uint8_t *data, size_t length) {
+  PacketMeta meta;
+  meta.payload_offset = static_cast<uint32_t>(length);
+  if (!data || length < MIN_IPV4_HEADER || (data[0] >> 4) != 4) {
+    return meta;
+  }
+  meta.flags = IPV4;
+  meta.src_ip = read32(data + 12);
+  meta.dst_ip = read32(data + 16);
+  meta.protocol = data[9];
+  meta.total_length = read16(data + 2);
+
+  size_t ihl = ipv4HeaderLength(data, length, 0);
+  if (ihl == 0) {
+    meta.flags |= MALFORMED;
+    return meta;
+  }
+  meta.l4_offset = static_cast<uint32_t>(ihl);
+  if (ihl > MIN_IPV4_HEADER) {
+    meta.flags |= OPTIONS;
+  }
+
+  uint16_t fragment = read16(data + 6);
+  if (fragment & 0x3FFF) {
+    meta.flags |= FRAGMENT;
+  }
+  if (fragment & 0x1FFF) {
+    meta.flags |= LATER_FRAGMENT;
+    meta.payload_offset = static_cast<uint32_t>(ihl);
+    return meta;
+  }
+
+  // Outer ports, also for a transport header cut short behind them
+  if ((meta.protocol == PROTO_TCP || meta.protocol == PROTO_UDP) &&
+      length - ihl >= 4) {
+    meta.src_port = read16(data + ihl);
+    meta.dst_port = read16(data + ihl + 2);
+  }
+
+  // One level of IP-in-IP or GRE, the inner header replaces the outer one
+  size_t offset = ihl;
+  uint8_t protocol = meta.protocol;
+  if (protocol == PROTO_IPIP || protocol == PROTO_GRE) {
+    size_t inner = offset;
+    if (protocol == PROTO_GRE) {
+      size_t gre = greHeaderLength(data, length, offset);
+      inner = gre > 0 ? offset + gre : 0;
+    }
+    size_t inner_ihl = inner > 0 ? ipv4HeaderLength(data, length, inner) : 0;
+    if (inner_ihl > 0) {
+      meta.flags |= TUNNEL;
+      meta.inner_protocol = data[inner + 9];
+      offset = inner + inner_ihl;
+      protocol = meta.inner_protocol;
+      if (read16(data + inner + 6) & 0x1FFF) {
+        // a later inner fragment, nothing behind its IP header to parse
+        meta.payload_offset = static_cast<uint32_t>(offset);
+        return meta;
+      }
+    }
+  }
+
+  size_t available = length - offset;
+  size_t payload = offset;
+  switch (protocol) {
+  case PROTO_TCP: {
+    if (available < MIN_TCP_HEADER) {
+      meta.flags |= TRUNCATED;
+      break;
+    }
+    size_t header = ((data[offset + 12] >> 4) & 0x0F) * 4u;
+    if (header < MIN_TCP_HEADER) {
+      meta.flags |= MALFORMED;
+    } else if (header > available) {
+      meta.flags |= TRUNCATED;
+    }
+    payload = offset + header;
+    break;
+  }
+  case PROTO_UDP:
+    if (available < SHORT_L4_HEADER) {
+      meta.flags |= TRUNCATED;
+      break;
+    }
+    meta.udp_checksum_offset = static_cast<uint32_t>(offset + 6);
+    payload = offset + SHORT_L4_HEADER;
+    break;
+  case PROTO_ICMP:
+    if (available < SHORT_L4_HEADER) {
+      meta.flags |= TRUNCATED;
+      break;
+    }
+    payload = offset + SHORT_L4_HEADER;
+    break;
+  default:
+    break;
+  }
+
+  if (!(meta.flags & (MALFORMED | TRUNCATED))) {
+    meta.payload_offset = static_cast<uint32_t>(payload);
+  }
+  return meta;
+}
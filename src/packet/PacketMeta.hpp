@@ -0,0 +1,64 @@
+// src/packet/PacketMeta.hpp
+
+// ---- PacketMeta Usage ---- //
+
+// PacketMeta is the header parse of one packet, done once when it arrives.
+// Classification, flow keys, the protected header size for bit errors and
+// the UDP checksum fix-up all read it instead of going back to the bytes.
+
+// Example:
+// PacketMeta meta = PacketMeta::parse(data, length);
+// Packet::LinkType link = PacketClassifier::classifyPacket(meta);
+// if (meta.payload_offset < length) {
+//   // data[meta.payload_offset..length) may be corrupted
+// }
+
+// Every offset is checked against length before it is read, so any byte
+// string is safe to parse. What is understood:
+// - IPv4 options, l4_offset follows IHL. An IHL below 5 or past the end of
+//   the data makes the packet MALFORMED.
+// - Fragments, only the first one carries a transport header. Later
+//   fragments only protect the IP header.
+// - TCP (with its options), UDP and ICMP headers.
+// - IP-in-IP and GRE carrying IPv4, one level deep. The inner IPv4 and
+//   transport headers are protected as well so bit errors land in the inner
+//   payload. Addresses and ports stay the outer ones, those are what the
+//   routing, the marks and the profiles see.
+// Other protocols only protect the IP header.
+
+// When nothing may be corrupted (not IPv4, MALFORMED, or a header that ends
+// past length, TRUNCATED) payload_offset is length.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct PacketMeta {
+  enum Flag : uint16_t {
+    IPV4 = 1 << 0,           // version 4 with both addresses present
+    MALFORMED = 1 << 1,      // bad IHL or TCP data offset
+    TRUNCATED = 1 << 2,      // a header ends past length
+    OPTIONS = 1 << 3,        // outer IPv4 header has options
+    FRAGMENT = 1 << 4,       // more fragments or a fragment offset
+    LATER_FRAGMENT = 1 << 5, // fragment offset, no transport header
+    TUNNEL = 1 << 6,         // IP-in-IP or GRE with an inner IPv4 header
+  };
+
+  uint32_t src_ip = 0; // host byte order, 0 if not IPv4
+  uint32_t dst_ip = 0;
+  uint32_t total_length = 0; // IPv4 total length field, 0 for BIG TCP
+  uint32_t l4_offset = 0;    // end of the outer IPv4 header
+  uint32_t payload_offset = 0; // first byte behind every parsed header
+  uint32_t udp_checksum_offset = 0; // innermost UDP checksum, 0 if none
+  uint16_t src_port = 0; // outer TCP/UDP, 0 otherwise
+  uint16_t dst_port = 0;
+  uint8_t protocol = 0;       // outer IPv4 protocol
+  uint8_t inner_protocol = 0; // protocol inside a tunnel
+  uint16_t flags = 0;
+
+  static PacketMeta parse(const uint8_t *data, size_t length);
+
+  bool has(Flag flag) const { return (flags & flag) != 0; }
+  bool isIPv4() const { return has(IPV4); }
+};
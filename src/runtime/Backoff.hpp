@@ -0,0 +1,52 @@
+// src/runtime/Backoff.hpp
+
+// ---- Backoff Usage ---- //
+
+// Idle strategy for polling pipeline threads: spin for a while, then yield,
+// then sleep in short naps so an idle daemon does not burn a core.
+
+// Example:
+// Backoff backoff;
+// while (running) {
+//   if (ring.tryPop(slot)) { backoff.reset(); handle(slot); continue; }
+//   backoff.idle();
+// }
+
+#pragma once
+
+#include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+class Backoff {
+public:
+  explicit Backoff(unsigned spins = 1024, unsigned yields = 64,
+                   std::chrono::microseconds nap = std::chrono::microseconds(
+                       50))
+      : spins_(spins), yields_(yields), nap_(nap) {}
+
+  void idle() {
+    if (count_ < spins_) {
+#if defined(__x86_64__) || defined(__i386__)
+      _mm_pause();
+#endif
+    } else if (count_ < spins_ + yields_) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(nap_);
+      return;
+    }
+    ++count_;
+  }
+
+  void reset() { count_ = 0; }
+
+private:
+  unsigned spins_;
+  unsigned yields_;
+  std::chrono::microseconds nap_;
+  unsigned count_ = 0;
+};
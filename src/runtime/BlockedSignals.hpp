@@ -0,0 +1,39 @@
+// src/runtime/BlockedSignals.hpp
+
+// ---- BlockedSignals Usage ---- //
+
+// Helper threads must not receive the termination signals, otherwise the
+// handler may run on a helper while the packet thread stays blocked in recv().
+// Threads inherit the signal mask of their creator, so spawn them while a
+// BlockedSignals guard is alive.
+
+// Example:
+// {
+//   BlockedSignals guard;
+//   worker = std::thread(...); // never receives SIGINT/SIGTERM/SIGHUP
+// } // the calling thread's mask is restored
+
+#pragma once
+
+#include <csignal>
+#include <pthread.h>
+
+class BlockedSignals {
+public:
+  BlockedSignals() {
+    sigset_t blocked;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    sigaddset(&blocked, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous_);
+  }
+
+  ~BlockedSignals() { pthread_sigmask(SIG_SETMASK, &previous_, nullptr); }
+
+  BlockedSignals(const BlockedSignals &) = delete;
+  BlockedSignals &operator=(const BlockedSignals &) = delete;
+
+private:
+  sigset_t previous_;
+};
@@ -0,0 +1,79 @@
+// src/runtime/JitterStats.hpp
+
+// ---- JitterStats Usage ---- //
+
+// JitterStats collects how late a thread woke up compared to when it asked
+// to, which is the timing precision the simulation can actually deliver.
+// One thread records, any thread may read a summary.
+
+// Example:
+// JitterStats jitter;
+// jitter.record(std::chrono::steady_clock::now() - deadline);
+// JitterStats::Summary summary = jitter.summary();
+// std::cout << summary.p99_us << "\n";
+
+// Samples go into power-of-two microsecond buckets, so percentiles are upper
+// bounds accurate to a factor of two while recording stays a few adds.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+class JitterStats {
+public:
+  struct Summary {
+    uint64_t samples = 0;
+    double mean_us = 0.0;
+    double p99_us = 0.0;
+    double max_us = 0.0;
+  };
+
+  void record(std::chrono::nanoseconds lateness) {
+    uint64_t ns = lateness.count() > 0 ? lateness.count() : 0;
+    uint64_t us = ns / 1000;
+    size_t bucket = std::min<size_t>(std::bit_width(us), BUCKETS - 1);
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+    if (ns > max_ns_.load(std::memory_order_relaxed)) {
+      max_ns_.store(ns, std::memory_order_relaxed);
+    }
+    samples_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Summary summary() const {
+    Summary summary;
+    summary.samples = samples_.load(std::memory_order_relaxed);
+    if (summary.samples == 0) {
+      return summary;
+    }
+    summary.mean_us = sum_ns_.load(std::memory_order_relaxed) / 1000.0 /
+                      static_cast<double>(summary.samples);
+    summary.max_us = max_ns_.load(std::memory_order_relaxed) / 1000.0;
+
+    // bucket b holds [2^(b-1), 2^b) us, report its upper edge
+    uint64_t target = summary.samples - summary.samples / 100;
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+      seen += buckets_[bucket].load(std::memory_order_relaxed);
+      if (seen >= target) {
+        summary.p99_us = std::min(static_cast<double>(uint64_t{1} << bucket),
+                                  summary.max_us);
+        break;
+      }
+    }
+    return summary;
+  }
+
+private:
+  static constexpr size_t BUCKETS = 32;
+
+  std::atomic<uint64_t> buckets_[BUCKETS] = {};
+  std::atomic<uint64_t> samples_{0};
+  std::atomic<uint64_t> sum_ns_{0};
+  std::atomic<uint64_t> max_ns_{0};
+};
@@ -0,0 +1,72 @@
+// src/runtime/PeriodicTasks.cpp
+
+#include "PeriodicTasks.hpp"
+#include "BlockedSignals.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+PeriodicTasks::~PeriodicTasks() { stop(); }
+
+void PeriodicTasks::add(const std::string &name,
+                        std::chrono::steady_clock::duration period,
+                        std::function<void()> task) {
+  tasks_.push_back({name, period, std::move(task),
+                    std::chrono::steady_clock::now() + period});
+}
+
+void PeriodicTasks::setPlacement(const ThreadPlacement &placement) {
+  placement_ = placement;
+}
+
+void PeriodicTasks::start() {
+  if (running_ || tasks_.empty())
+    return;
+  running_ = true;
+  BlockedSignals guard;
+  thread_ = std::thread(&PeriodicTasks::loop, this);
+}
+
+void PeriodicTasks::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void PeriodicTasks::loop() {
+  placeCurrentThread("lnd-tasks", placement_);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    auto next = std::min_element(tasks_.begin(), tasks_.end(),
+                                 [](const Task &a, const Task &b) {
+                                   return a.next_run < b.next_run;
+                                 });
+
+    // Sleep until the next task is due or until interrupted
+    if (cv_.wait_until(lock, next->next_run, [this] { return !running_; })) {
+      break;
+    }
+    jitter_.record(std::chrono::steady_clock::now() - next->next_run);
+
+    // run without the lock so stop() is never blocked by a slow task
+    lock.unlock();
+    try {
+      next->run();
+    } catch (const std::exception &error) {
+      std::cerr << "Periodic task '" << next->name
+                << "' failed: " << error.what() << "\n";
+    }
+    lock.lock();
+
+    // keep the cadence, but don't try to catch up on missed runs
+    next->next_run = std::max(next->next_run + next->period,
+                              std::chrono::steady_clock::now());
+  }
+}
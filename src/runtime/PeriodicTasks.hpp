@@ -0,0 +1,68 @@
+// src/runtime/PeriodicTasks.hpp
+
+// ---- PeriodicTasks Usage ---- //
+
+// PeriodicTasks runs housekeeping work (netem updates, stats, ...) on one
+// background thread, away from the packet path.
+
+// Example:
+// PeriodicTasks tasks;
+// tasks.add("ephemeris", std::chrono::seconds(1), [&] { updateDelay(); });
+// tasks.start();
+// ...
+// tasks.stop(); // also called by the destructor
+
+// Tasks run in the order they are due, a task that throws is logged and
+// keeps its schedule. Tasks must be added before start().
+
+// setPlacement() pins the thread and optionally makes it SCHED_FIFO, and
+// jitter() reports how late the thread woke up for its tasks.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JitterStats.hpp"
+#include "ThreadTuning.hpp"
+
+class PeriodicTasks {
+public:
+  PeriodicTasks() = default;
+  ~PeriodicTasks();
+
+  PeriodicTasks(const PeriodicTasks &) = delete;
+  PeriodicTasks &operator=(const PeriodicTasks &) = delete;
+
+  void add(const std::string &name, std::chrono::steady_clock::duration period,
+           std::function<void()> task);
+  void setPlacement(const ThreadPlacement &placement);
+  void start();
+  void stop();
+
+  JitterStats::Summary jitter() const { return jitter_.summary(); }
+
+private:
+  struct Task {
+    std::string name;
+    std::chrono::steady_clock::duration period;
+    std::function<void()> run;
+    std::chrono::steady_clock::time_point next_run;
+  };
+
+  void loop();
+
+  std::vector<Task> tasks_;
+  ThreadPlacement placement_;
+  JitterStats jitter_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::atomic<bool> running_{false};
+};
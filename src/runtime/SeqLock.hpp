@@ -0,0 +1,95 @@
+// src/runtime/SeqLock.hpp
+
+// ---- SeqLock Usage ---- //
+
+// Single-writer sequence lock around a small trivially copyable value.
+// Readers never block the writer and never write anything themselves, so a
+// SeqLock works in memory shared between processes where readers may only
+// map the memory read-only or die at any point.
+
+// Example:
+// SeqLock<Counters> counters;
+// counters.store(latest);            // one writer
+// Counters copy = counters.load();   // any number of readers
+
+// The value is kept as 64-bit atomic words, a reader racing the writer
+// copies torn words but notices the sequence moved and copies again. A
+// SeqLock holds no pointers and is usable at any address, including a
+// mapping of the same shared memory at different addresses.
+
+// store() must only ever be called by one thread (or process) at a time.
+// A writer process that dies inside store() leaves the value unreadable
+// until the next store, readers in other processes should use tryLoad()
+// with a bounded number of attempts rather than load().
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+template <typename T> class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "shared memory needs address-free atomics");
+
+public:
+  SeqLock() = default;
+
+  SeqLock(const SeqLock &) = delete;
+  SeqLock &operator=(const SeqLock &) = delete;
+
+  // Writer side
+  void store(const T &value) {
+    uint64_t words[WORDS] = {};
+    std::memcpy(words, &value, sizeof(T));
+    // odd while the words are being written, a writer that died half way
+    // left it odd and the next one starts over from there
+    uint64_t sequence = sequence_.load(std::memory_order_relaxed) & ~1ull;
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; ++i) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  // Reader side, retries until it copied a value no store overlapped
+  T load() const {
+    T value;
+    while (!tryLoad(value)) {
+    }
+    return value;
+  }
+
+  // One attempt, false if a store was in progress or overlapped
+  bool tryLoad(T &value) const {
+    uint64_t before = sequence_.load(std::memory_order_acquire);
+    if (before & 1) {
+      return false;
+    }
+    uint64_t words[WORDS];
+    for (size_t i = 0; i < WORDS; ++i) {
+      words[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) != before) {
+      return false;
+    }
+    std::memcpy(&value, words, sizeof(T));
+    return true;
+  }
+
+  // Number of completed stores
+  uint64_t version() const {
+    return sequence_.load(std::memory_order_acquire) / 2;
+  }
+
+private:
+  static constexpr size_t WORDS = (sizeof(T) + 7) / 8;
+
+  std::atomic<uint64_t> sequence_{0};
+  std::atomic<uint64_t> words_[WORDS]{};
+};
@@ -0,0 +1,99 @@
+// src/runtime/SpscRing.hpp
+
+// ---- SpscRing Usage ---- //
+
+// Bounded lock-free single-producer single-consumer ring, used to connect
+// the stages of the packet pipeline. Exactly one thread may push and exactly
+// one (other) thread may pop.
+
+// Example:
+// SpscRing<uint32_t> ring(1024); // capacity is rounded up to a power of two
+// if (!ring.tryPush(slot)) { /* full, apply backpressure */ }
+// uint32_t slot;
+// if (ring.tryPop(slot)) { ... }
+
+// head and tail live on separate cache lines, and each side caches the other
+// side's index so the common case touches only its own line.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+template <typename T> class SpscRing {
+public:
+  explicit SpscRing(size_t capacity)
+      : mask_(roundUp(capacity) - 1),
+        buffer_(std::make_unique<T[]>(mask_ + 1)) {}
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  // Producer side
+  bool tryPush(const T &value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_)
+        return false;
+    }
+    buffer_[tail & mask_] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  bool tryPop(T &value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_)
+        return false;
+    }
+    value = buffer_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side, pops up to max values, returns how many were popped
+  size_t tryPopBatch(T *values, size_t max) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_)
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    size_t count = std::min(cached_tail_ - head, max);
+    for (size_t i = 0; i < count; ++i) {
+      values[i] = buffer_[(head + i) & mask_];
+    }
+    if (count > 0)
+      head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  // Approximate, safe to call from any thread
+  size_t size() const {
+    return tail_.load(std::memory_order_relaxed) -
+           head_.load(std::memory_order_relaxed);
+  }
+  size_t capacity() const { return mask_ + 1; }
+
+private:
+  static size_t roundUp(size_t n) {
+    size_t capacity = 2;
+    while (capacity < n)
+      capacity <<= 1;
+    return capacity;
+  }
+
+  static constexpr size_t CACHE_LINE = 64;
+
+  const size_t mask_;
+  std::unique_ptr<T[]> buffer_;
+
+  alignas(CACHE_LINE) std::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0; // consumer's copy of tail_
+  alignas(CACHE_LINE) std::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0; // producer's copy of head_
+};
@@ -0,0 +1,64 @@
+// src/runtime/ThreadTuning.cpp
+
+#include "ThreadTuning.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+void placeCurrentThread(const char *name, const ThreadPlacement &placement) {
+  pthread_t self = pthread_self();
+
+  // thread names are limited to 15 characters, longer ones are rejected
+  char short_name[16] = {};
+  std::strncpy(short_name, name, sizeof(short_name) - 1);
+  pthread_setname_np(self, short_name);
+
+  if (placement.cpu >= 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(placement.cpu, &cpus);
+    int error = pthread_setaffinity_np(self, sizeof(cpus), &cpus);
+    if (error != 0) {
+      std::cerr << "Warning: Could not pin " << name << " to cpu "
+                << placement.cpu << ": " << std::strerror(error) << "\n";
+    }
+  }
+
+  if (placement.realtime_priority > 0) {
+    sched_param param{};
+    param.sched_priority = placement.realtime_priority;
+    int error = pthread_setschedparam(self, SCHED_FIFO, &param);
+    if (error != 0) {
+      std::cerr << "Warning: Could not switch " << name
+                << " to SCHED_FIFO: " << std::strerror(error) << "\n";
+    }
+  }
+}
+
+void lockAllMemory() {
+  // keep freed heap memory mapped, otherwise returning it to the kernel and
+  // faulting it back in later defeats the lock
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+    std::cerr << "Warning: Could not lock memory: " << std::strerror(errno)
+              << "\n";
+  }
+}
+
+void prefaultStack(size_t bytes) {
+  // volatile so the compiler cannot drop the writes
+  volatile unsigned char *stack =
+      static_cast<volatile unsigned char *>(alloca(bytes));
+  for (size_t offset = 0; offset < bytes; offset += 4096) {
+    stack[offset] = 0;
+  }
+}
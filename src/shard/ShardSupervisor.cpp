@@ -0,0 +1,126 @@
+// src/shard/ShardSupervisor.cpp
+
+#include "ShardSupervisor.hpp"
+
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+// how long shards get to shut down cleanly before they are killed
+constexpr auto SHARD_STOP_TIMEOUT = std::chrono::seconds(5);
+constexpr auto SHARD_STOP_POLL = std::chrono::milliseconds(50);
+
+ShardSupervisor::ShardSupervisor(std::vector<std::string> args,
+                                 const Config::Shards &config)
+    : args_(std::move(args)),
+      restart_delay_(config.restart_delay_ms), shards_(config.count) {}
+
+ShardSupervisor::~ShardSupervisor() { stop(); }
+
+void ShardSupervisor::start() {
+  for (uint32_t index = 0; index < shards_.size(); ++index) {
+    spawn(index);
+  }
+}
+
+void ShardSupervisor::spawn(uint32_t index) {
+  std::vector<std::string> args = args_;
+  args.push_back("--shard");
+  args.push_back(std::to_string(index));
+  std::vector<char *> argv;
+  for (std::string &arg : args) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+
+  // own process group, no blocked signals inherited from this thread
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setflags(&attr,
+                           POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK);
+  posix_spawnattr_setpgroup(&attr, 0);
+  sigset_t none;
+  sigemptyset(&none);
+  posix_spawnattr_setsigmask(&attr, &none);
+
+  Shard &shard = shards_[index];
+  pid_t pid = -1;
+  int error = posix_spawn(&pid, "/proc/self/exe", nullptr, &attr, argv.data(),
+                          environ);
+  posix_spawnattr_destroy(&attr);
+  if (error != 0) {
+    std::cerr << "Warning: Could not start shard " << index << ": "
+              << std::strerror(error) << ", retrying in "
+              << restart_delay_.count() << " ms.\n";
+    shard.restart_at = std::chrono::steady_clock::now() + restart_delay_;
+    return;
+  }
+  shard.pid = pid;
+  running_.fetch_add(1, std::memory_order_relaxed);
+  std::cout << "Shard " << index << " started, pid " << pid << ".\n";
+}
+
+void ShardSupervisor::poll() {
+  auto now = std::chrono::steady_clock::now();
+  for (uint32_t index = 0; index < shards_.size(); ++index) {
+    Shard &shard = shards_[index];
+    if (shard.pid > 0) {
+      int status = 0;
+      if (waitpid(shard.pid, &status, WNOHANG) != shard.pid) {
+        continue;
+      }
+      std::cerr << "Warning: Shard " << index << " (pid " << shard.pid << ") ";
+      if (WIFSIGNALED(status)) {
+        std::cerr << "was killed by signal " << WTERMSIG(status);
+      } else {
+        std::cerr << "exited with status " << WEXITSTATUS(status);
+      }
+      std::cerr << ", restarting in " << restart_delay_.count() << " ms.\n";
+      shard.pid = -1;
+      shard.restart_at = now + restart_delay_;
+      running_.fetch_sub(1, std::memory_order_relaxed);
+    } else if (!stopped_ && now >= shard.restart_at) {
+      spawn(index);
+      restarts_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+void ShardSupervisor::stop() {
+  if (stopped_) {
+    return;
+  }
+  stopped_ = true;
+  for (const Shard &shard : shards_) {
+    if (shard.pid > 0) {
+      kill(shard.pid, SIGTERM);
+    }
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + SHARD_STOP_TIMEOUT;
+  for (uint32_t index = 0; index < shards_.size(); ++index) {
+    Shard &shard = shards_[index];
+    while (shard.pid > 0 && waitpid(shard.pid, nullptr, WNOHANG) == 0) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        std::cerr << "Warning: Shard " << index
+                  << " did not stop, killing it.\n";
+        kill(shard.pid, SIGKILL);
+        waitpid(shard.pid, nullptr, 0);
+        break;
+      }
+      std::this_thread::sleep_for(SHARD_STOP_POLL);
+    }
+    if (shard.pid > 0) {
+      shard.pid = -1;
+      running_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+  std::cout << "All shards stopped.\n";
+}
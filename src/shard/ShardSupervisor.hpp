@@ -0,0 +1,73 @@
+// src/shard/ShardSupervisor.hpp
+
+// ---- ShardSupervisor Usage ---- //
+
+// ShardSupervisor starts the shard processes of a sharded daemon and
+// restarts them when they exit. Every shard runs the daemon binary itself
+// with the coordinator's arguments plus "--shard <index>".
+
+// Example:
+// ShardSupervisor supervisor(args, config->shards);
+// supervisor.start();
+// while (running) {
+//   supervisor.poll(); // reaps exited shards, restarts them when due
+//   std::this_thread::sleep_for(std::chrono::milliseconds(100));
+// }
+// supervisor.stop(); // also done by the destructor
+
+// A shard that exits for any reason is restarted after restart_delay_ms
+// while the others keep running, so one shard can also be restarted on
+// purpose with a plain kill. Shards get their own process group, a Ctrl+C
+// in the terminal only reaches the coordinator, which then stops them.
+
+// start(), poll() and stop() belong to one thread, running() and
+// restarts() can be read from any.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "ConfigManager.hpp"
+
+class ShardSupervisor {
+public:
+  ShardSupervisor(std::vector<std::string> args, const Config::Shards &config);
+  ~ShardSupervisor();
+
+  ShardSupervisor(const ShardSupervisor &) = delete;
+  ShardSupervisor &operator=(const ShardSupervisor &) = delete;
+
+  void start();
+  void poll();
+
+  // SIGTERM to every shard, SIGKILL to those still running after
+  // SHARD_STOP_TIMEOUT
+  void stop();
+
+  uint32_t running() const { return running_.load(std::memory_order_relaxed); }
+  uint64_t restarts() const {
+    return restarts_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Shard {
+    pid_t pid = -1; // -1 while waiting for a restart
+    std::chrono::steady_clock::time_point restart_at;
+  };
+
+  void spawn(uint32_t index);
+
+  std::vector<std::string> args_;
+  std::chrono::milliseconds restart_delay_;
+  std::vector<Shard> shards_;
+  bool stopped_ = false;
+
+  std::atomic<uint32_t> running_{0};
+  std::atomic<uint64_t> restarts_{0};
+};
@@ -0,0 +1,195 @@
+// src/shard/SharedState.cpp
+
+#include "SharedState.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A writer is only ever inside store() for a few hundred nanoseconds, a
+// sequence that stays odd this long belongs to a writer that died
+constexpr int SEQLOCK_READ_ATTEMPTS = 1000;
+
+struct SharedState::Layout {
+  Header header;
+  alignas(64) SeqLock<Control> control;
+  struct alignas(64) Slot {
+    SeqLock<Counters> counters;
+  };
+  Slot slots[MAX_SHARDS];
+};
+
+namespace {
+template <typename T>
+bool readSeqLock(const SeqLock<T> &lock, T &value) {
+  for (int attempt = 0; attempt < SEQLOCK_READ_ATTEMPTS; ++attempt) {
+    if (lock.tryLoad(value)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Merges b into a, weighted by sample count
+void addLatency(JitterStats::Summary &a, const JitterStats::Summary &b) {
+  uint64_t samples = a.samples + b.samples;
+  if (samples == 0) {
+    return;
+  }
+  a.mean_us = (a.mean_us * static_cast<double>(a.samples) +
+               b.mean_us * static_cast<double>(b.samples)) /
+              static_cast<double>(samples);
+  // an upper bound, the histograms themselves are not shared
+  a.p99_us = std::max(a.p99_us, b.p99_us);
+  a.max_us = std::max(a.max_us, b.max_us);
+  a.samples = samples;
+}
+} // namespace
+
+std::unique_ptr<SharedState> SharedState::create(const std::string &name,
+                                                 Header header) {
+  // left behind by a coordinator that didn't get to clean up
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    throw std::runtime_error("Error creating shared memory " + name + ": " +
+                             std::strerror(errno));
+  }
+  if (ftruncate(fd, sizeof(Layout)) != 0) {
+    int error = errno;
+    ::close(fd);
+    shm_unlink(name.c_str());
+    throw std::runtime_error("Error sizing shared memory " + name + ": " +
+                             std::strerror(error));
+  }
+  void *mapping = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    throw std::runtime_error("Error mapping shared memory " + name);
+  }
+
+  // ftruncate zero fills, the seqlocks start out empty and even
+  auto *layout = new (mapping) Layout{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.layout_version = LAYOUT_VERSION;
+  header.layout_size = sizeof(Layout);
+  layout->header = header;
+  return std::unique_ptr<SharedState>(new SharedState(name, layout, true));
+}
+
+std::unique_ptr<SharedState> SharedState::attach(const std::string &name) {
+  int fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+  if (fd < 0) {
+    throw std::runtime_error("Error opening shared memory " + name + ": " +
+                             std::strerror(errno));
+  }
+  struct stat st{};
+  if (fstat(fd, &st) != 0 || st.st_size != sizeof(Layout)) {
+    ::close(fd);
+    throw std::runtime_error("Shared memory " + name +
+                             " has a different layout");
+  }
+  void *mapping = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Error mapping shared memory " + name);
+  }
+
+  auto *layout = static_cast<Layout *>(mapping);
+  const Header &header = layout->header;
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.layout_version != LAYOUT_VERSION ||
+      header.layout_size != sizeof(Layout) || header.shards > MAX_SHARDS) {
+    munmap(mapping, sizeof(Layout));
+    throw std::runtime_error("Shared memory " + name +
+                             " has a different layout");
+  }
+  return std::unique_ptr<SharedState>(new SharedState(name, layout, false));
+}
+
+SharedState::SharedState(std::string name, Layout *layout, bool owner)
+    : name_(std::move(name)), layout_(layout), owner_(owner) {}
+
+SharedState::~SharedState() {
+  munmap(layout_, sizeof(Layout));
+  if (owner_) {
+    shm_unlink(name_.c_str());
+  }
+}
+
+const SharedState::Header &SharedState::header() const {
+  return layout_->header;
+}
+
+void SharedState::publishControl(const Control &control) {
+  layout_->control.store(control);
+}
+
+bool SharedState::control(Control &control) const {
+  return readSeqLock(layout_->control, control);
+}
+
+void SharedState::publishCounters(uint32_t shard, const Counters &counters) {
+  layout_->slots[shard].counters.store(counters);
+}
+
+bool SharedState::counters(uint32_t shard, Counters &counters) const {
+  return readSeqLock(layout_->slots[shard].counters, counters);
+}
+
+SharedState::Counters SharedState::total() {
+  Counters total{};
+  std::lock_guard<std::mutex> lock(last_mutex_);
+  for (uint32_t shard = 0; shard < layout_->header.shards; ++shard) {
+    counters(shard, last_[shard]);
+    add(total, last_[shard]);
+  }
+  return total;
+}
+
+void SharedState::add(Counters &total, const Counters &part) {
+  NetfilterQueue::Stats &a = total.stats;
+  const NetfilterQueue::Stats &b = part.stats;
+  a.packets += b.packets;
+  a.segments += b.segments;
+  a.gso_packets += b.gso_packets;
+  a.bytes += b.bytes;
+  a.burst_drops += b.burst_drops;
+  a.outage_drops += b.outage_drops;
+  a.rate_drops += b.rate_drops;
+  a.corrupted_packets += b.corrupted_packets;
+  a.flipped_bits += b.flipped_bits;
+  a.backpressure_waits += b.backpressure_waits;
+  a.in_flight += b.in_flight;
+  a.truncated_messages += b.truncated_messages;
+  a.overflows += b.overflows;
+  a.lost_packets += b.lost_packets;
+  a.shed_packets += b.shed_packets;
+  a.shed_level = std::max(a.shed_level, b.shed_level);
+  a.untimestamped += b.untimestamped;
+  a.queue_total += b.queue_total;
+  a.queue_dropped += b.queue_dropped;
+  a.user_dropped += b.user_dropped;
+  a.socket_buffer += b.socket_buffer;
+  for (uint32_t i = 0; i < MAX_INTERFACES; ++i) {
+    a.interfaces[i].packets += b.interfaces[i].packets;
+    a.interfaces[i].bytes += b.interfaces[i].bytes;
+    a.interfaces[i].drops += b.interfaces[i].drops;
+  }
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    addLatency(total.latency[link].residency, part.latency[link].residency);
+    addLatency(total.latency[link].verdict, part.latency[link].verdict);
+    FidelityMonitor::merge(total.fidelity[link], part.fidelity[link]);
+  }
+}
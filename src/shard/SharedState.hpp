@@ -0,0 +1,128 @@
+// src/shard/SharedState.hpp
+
+// ---- SharedState Usage ---- //
+
+// SharedState is the POSIX shared memory segment the processes of a sharded
+// daemon (shards.count > 0) share. The coordinator creates it before it
+// starts any shard, shards attach to it by name.
+
+// Example:
+// // coordinator
+// auto shared = SharedState::create(config->shards.shm_name, header);
+// shared->publishControl(control);
+// SharedState::Counters all = shared->total();
+// // shard 2
+// auto shared = SharedState::attach(config->shards.shm_name);
+// shared->publishCounters(2, counters);
+
+// The layout has a fixed size and is versioned by LAYOUT_VERSION:
+// - Header: written once before any shard starts. It carries the seed and
+//   SimClock origin every shard computes its burst timeline from (see
+//   BurstModel), so all shards agree on when bursts happen without ever
+//   talking to each other, shards restarted late included, and the unix
+//   time the ephemeris feed starts at.
+// - Control: coordinator => shards, the link sections and forced bursts of
+//   the coordinator's config and how often it reloaded the file. Admin
+//   socket changes reach the shards through it.
+// - one counter slot per shard: shard => coordinator, the shard's totals.
+// Control and the slots are SeqLocks with exactly one writer each, no lock
+// is ever taken, so a shard killed at any point leaves nothing held.
+
+// attach() throws std::runtime_error when the segment does not exist or
+// has another layout, e.g. it was created by a different build.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ConfigManager.hpp"
+#include "NetfilterQueue.hpp"
+#include "SeqLock.hpp"
+#include "configs.hpp"
+
+class SharedState {
+public:
+  static constexpr char MAGIC[8] = {'L', 'N', 'D', 'S', 'H', 'A', 'R', 'D'};
+  static constexpr uint32_t LAYOUT_VERSION = 5;
+
+  // Fixed for the lifetime of the segment
+  struct Header {
+    char magic[8];
+    uint32_t layout_version;
+    uint32_t layout_size; // of the whole segment, catches differing builds
+    uint32_t shards;
+    uint32_t interfaces; // shard i binds queue + i of each of them
+    uint64_t seed;
+    int64_t origin_ns; // SimClock origin, steady_clock ticks
+    double time_scale;
+    int32_t coordinator_pid;
+    uint32_t reserved;
+    // unix time the origin stands for in the ephemeris feed, resolved once
+    // so a restarted shard samples the same instant as everyone else
+    double ephemeris_start_time;
+  };
+
+  // Coordinator => shards
+  struct Control {
+    uint64_t generation; // moves with every publish
+    uint64_t reloads;    // config file reloads, shards then reload too
+    std::array<Config::LinkProperties, NUM_LINKS> links;
+    std::array<Config::BurstForce, NUM_LINKS> forced_bursts;
+  };
+
+  // Shard => coordinator
+  struct Counters {
+    NetfilterQueue::Stats stats;
+    std::array<NetfilterQueue::LinkLatency, NUM_LINKS> latency;
+    std::array<FidelityMonitor::Link, NUM_LINKS> fidelity;
+  };
+
+  // Replaces a segment left behind by a coordinator that crashed. magic,
+  // layout_version and layout_size of header are filled in.
+  static std::unique_ptr<SharedState> create(const std::string &name,
+                                             Header header);
+  static std::unique_ptr<SharedState> attach(const std::string &name);
+
+  // Unmaps, the creator also removes the name
+  ~SharedState();
+
+  SharedState(const SharedState &) = delete;
+  SharedState &operator=(const SharedState &) = delete;
+
+  const Header &header() const;
+
+  void publishControl(const Control &control);
+  // false if no consistent copy could be taken, keep the last one then
+  bool control(Control &control) const;
+
+  // Only the process serving shard may publish its counters
+  void publishCounters(uint32_t shard, const Counters &counters);
+  bool counters(uint32_t shard, Counters &counters) const;
+
+  // Sum over all shards, safe to call from any thread. A slot whose writer
+  // died while publishing contributes the last value read from it.
+  Counters total();
+
+  // Adds part to total: counters add up, gauges (in_flight, shed_level)
+  // add up and take the maximum respectively, latency summaries are
+  // combined weighted by their sample counts, fidelity figures merged
+  static void add(Counters &total, const Counters &part);
+
+private:
+  struct Layout;
+
+  SharedState(std::string name, Layout *layout, bool owner);
+
+  std::string name_;
+  Layout *layout_;
+  bool owner_;
+
+  // Last consistent copy of each slot, see total()
+  std::mutex last_mutex_;
+  std::array<Counters, MAX_SHARDS> last_{};
+};
@@ -0,0 +1,45 @@
+// src/xdp/DelayLine.cpp
+
+#include "DelayLine.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "CounterRng.hpp"
+
+DelayLine::DelayLine(size_t capacity, uint64_t seed)
+    : capacity_(capacity), seed_(seed) {
+  heap_.reserve(capacity);
+}
+
+void DelayLine::setDelay(uint32_t link, double latency_ms, double jitter_ms) {
+  latency_ns_[link].store(std::llround(std::max(latency_ms, 0.0) * 1e6),
+                          std::memory_order_relaxed);
+  jitter_ns_[link].store(std::llround(std::max(jitter_ms, 0.0) * 1e6),
+                         std::memory_order_relaxed);
+}
+
+bool DelayLine::push(const Entry &entry, int64_t now_ns) {
+  if (heap_.size() >= capacity_) {
+    return false;
+  }
+  uint32_t link = entry.link;
+  int64_t delay_ns = latency_ns_[link].load(std::memory_order_relaxed);
+  int64_t jitter_ns = jitter_ns_[link].load(std::memory_order_relaxed);
+  if (jitter_ns > 0) {
+    CounterRng rng(seed_, rngStream(RNG_DELAY, link), pushed_[link]);
+    double offset =
+        (2.0 * rng.uniform() - 1.0) * static_cast<double>(jitter_ns);
+    delay_ns = std::max<int64_t>(delay_ns + std::llround(offset), 0);
+  }
+  ++pushed_[link];
+
+  heap_.push_back({now_ns + delay_ns, sequence_++, entry});
+  std::push_heap(heap_.begin(), heap_.end(), later);
+  return true;
+}
+
+void DelayLine::pop() {
+  std::pop_heap(heap_.begin(), heap_.end(), later);
+  heap_.pop_back();
+}
@@ -0,0 +1,98 @@
+// src/xdp/DelayLine.hpp
+
+// ---- DelayLine Usage ---- //
+
+// DelayLine does for the AF_XDP path what tc netem's delay does for the
+// NFQUEUE path: it holds each packet until its link's latency, plus a
+// uniform jitter draw within +-jitter_ms (netem's "delay X Y" without a
+// distribution), has passed. Like netem, a jittered packet may overtake the
+// ones before it, packets leave in order of their release time.
+
+// Example:
+// DelayLine line(frames, seed);
+// line.setDelay(LINK_EARTH_TO_MOON, 1280.0, 100.0);
+// line.push({addr, length, port, LINK_EARTH_TO_MOON}, now_ns);
+// while (line.due(now_ns)) {
+//   const DelayLine::Entry &entry = line.top();
+//   // send it
+//   line.pop();
+// }
+
+// The capacity is fixed, push() returns false instead of allocating. The
+// jitter of the n-th packet of a link is a CounterRng draw keyed by the seed
+// and n, so a replay with the same seed delays packets the same way.
+
+// setDelay() may be called from any thread, everything else only from the
+// thread that owns the line.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "configs.hpp"
+
+class DelayLine {
+public:
+  // What is held, the AF_XDP frame and where it goes next
+  struct Entry {
+    uint64_t addr; // UMEM address of the packet data
+    uint32_t length;
+    uint32_t port; // index of the port it leaves through
+    uint32_t link; // LINK_* index, picks the delay
+  };
+
+  DelayLine(size_t capacity, uint64_t seed);
+
+  // Latency and jitter of a link (LINK_* index) for packets pushed from now
+  // on, packets already held keep their release time
+  void setDelay(uint32_t link, double latency_ms, double jitter_ms);
+
+  // Holds entry until its release time, false if the line is full
+  bool push(const Entry &entry, int64_t now_ns);
+
+  bool due(int64_t now_ns) const {
+    return !heap_.empty() && heap_.front().release_ns <= now_ns;
+  }
+
+  // The entry released next and when, only valid when not empty
+  const Entry &top() const { return heap_.front().entry; }
+  int64_t topRelease() const { return heap_.front().release_ns; }
+  void pop();
+
+  // INT64_MAX when empty
+  int64_t nextRelease() const {
+    return heap_.empty() ? INT64_MAX : heap_.front().release_ns;
+  }
+
+  size_t size() const { return heap_.size(); }
+  bool empty() const { return heap_.empty(); }
+
+private:
+  struct Held {
+    int64_t release_ns;
+    uint64_t sequence; // equal release times leave in push order
+    Entry entry;
+  };
+
+  // Min-heap on (release_ns, sequence)
+  static bool later(const Held &a, const Held &b) {
+    return a.release_ns != b.release_ns ? a.release_ns > b.release_ns
+                                        : a.sequence > b.sequence;
+  }
+
+  size_t capacity_;
+  uint64_t seed_;
+  uint64_t sequence_ = 0;
+  std::vector<Held> heap_;
+
+  // In nanoseconds, written by setDelay()
+  std::array<std::atomic<int64_t>, NUM_LINKS> latency_ns_{};
+  std::array<std::atomic<int64_t>, NUM_LINKS> jitter_ns_{};
+
+  // Packets pushed per link, the jitter draw index
+  std::array<uint64_t, NUM_LINKS> pushed_{};
+};
@@ -0,0 +1,332 @@
+// src/xdp/XdpBridge.cpp
+
+#include "XdpBridge.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <linux/if_arp.h>
+#include <linux/netfilter.h>
+#include <poll.h>
+#include <time.h>
+
+#include "ThreadTuning.hpp"
+
+// Longest sleep without anything due, a stop signal interrupts it anyway
+constexpr int64_t XDP_IDLE_WAIT_NS = 100'000'000;
+// Sleep while sent frames are not completed yet, zero-copy drivers complete
+// asynchronously and nothing wakes us for it
+constexpr int64_t XDP_COMPLETION_WAIT_NS = 50'000;
+// Ethernet header in front of the IP header, and its ethertype field
+constexpr uint32_t ETHERNET_HEADER_LENGTH = 14;
+constexpr uint32_t ETHERTYPE_OFFSET = 12;
+
+namespace {
+int64_t steadyNs(std::chrono::steady_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             time.time_since_epoch())
+      .count();
+}
+} // namespace
+
+XdpBridge::XdpBridge(ConfigManager &config_manager, SimClock &clock,
+                     std::shared_ptr<const EphemerisTable> ephemeris,
+                     uint64_t seed)
+    : clock_(clock) {
+  auto config = config_manager.getSnapshot();
+  const Config::Xdp &xdp = config->xdp;
+  runtime_ = config->runtime;
+  batch_ = xdp.batch;
+
+  header_length_ = linkHeaderLength(xdp.ports[0]);
+  if (linkHeaderLength(xdp.ports[1]) != header_length_) {
+    throw std::runtime_error("xdp.ports " + xdp.ports[0] + " and " +
+                             xdp.ports[1] + " have different link layers");
+  }
+
+  std::cout << "Impairment RNG seed: " << seed << "\n";
+  processor_ = std::make_unique<PacketProcessor>(config_manager, seed,
+                                                 clock_.origin(), ephemeris);
+
+  // netem would start from the same values, see TcNetemManager
+  delay_ = std::make_unique<DelayLine>(xdp.frames, seed);
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    Config::LinkProperties props = config->interfaceLink(0, link);
+    delay_->setDelay(link, props.base_latency_ms, props.latency_jitter_ms);
+  }
+
+  umem_ = std::make_unique<XdpUmem>(xdp.frames, xdp.frame_size);
+  for (uint32_t i = 0; i < ports_.size(); ++i) {
+    std::cout << "Opening AF_XDP socket on " << xdp.ports[i] << " queue "
+              << xdp.queue_id << ".\n";
+    ports_[i].name = xdp.ports[i];
+    ports_[i].socket = std::make_unique<XdpSocket>(
+        *umem_, xdp.ports[i], xdp.queue_id, xdp.ring_size, xdp.zero_copy,
+        i > 0 ? ports_[0].socket.get() : nullptr);
+  }
+  // only once both sockets exist, nothing is redirected to a missing one
+  for (Port &port : ports_) {
+    std::cout << "Attaching " << xdp.mode << " XDP program to " << port.name
+              << ".\n";
+    port.program =
+        std::make_unique<XdpProgram>(*port.socket, xdp.mode == "native");
+  }
+
+  free_frames_.reserve(xdp.frames);
+  for (uint32_t frame = xdp.frames; frame-- > 0;) {
+    free_frames_.push_back(static_cast<uint64_t>(frame) * xdp.frame_size);
+  }
+  descs_.resize(batch_);
+  addrs_.resize(batch_);
+  for (uint32_t port = 0; port < ports_.size(); ++port) {
+    while (recycle(port) && !free_frames_.empty()) {
+    }
+  }
+}
+
+XdpBridge::~XdpBridge() = default;
+
+uint32_t XdpBridge::linkHeaderLength(const std::string &port) {
+  std::ifstream file("/sys/class/net/" + port + "/type");
+  uint32_t type = 0;
+  if (!(file >> type)) {
+    throw std::runtime_error("Unknown interface " + port);
+  }
+  if (type == ARPHRD_ETHER) {
+    return ETHERNET_HEADER_LENGTH;
+  }
+  if (type == ARPHRD_NONE) {
+    return 0;
+  }
+  throw std::runtime_error("Interface " + port + " has link type " +
+                           std::to_string(type) +
+                           ", only Ethernet and raw IP are supported");
+}
+
+void XdpBridge::run() {
+  std::cout << "Starting AF_XDP packet loop.\n";
+  placeCurrentThread("lnd-xdp",
+                     {runtime_.receive_cpu, runtime_.realtime_priority});
+  if (runtime_.lock_memory) {
+    prefaultStack();
+  }
+
+  auto spin_until = std::chrono::steady_clock::now();
+  while (running_) {
+    bool busy = false;
+    for (uint32_t port = 0; port < ports_.size(); ++port) {
+      busy |= receive(port);
+    }
+    busy |= release();
+    for (uint32_t port = 0; port < ports_.size(); ++port) {
+      busy |= recycle(port);
+    }
+    delayed_.store(delay_->size(), std::memory_order_relaxed);
+
+    auto now = std::chrono::steady_clock::now();
+    if (busy) {
+      spin_until = now + std::chrono::microseconds(runtime_.spin_us);
+    } else if (now >= spin_until) {
+      wait();
+    }
+  }
+
+  // Frames still in the delay line go away with the UMEM
+  std::cout << "Exiting AF_XDP packet loop, " << delay_->size()
+            << " packets still delayed.\n";
+}
+
+void XdpBridge::stop() { running_ = false; }
+
+bool XdpBridge::isRunning() const { return running_; }
+
+void XdpBridge::updateDelay(uint32_t link, double latency_ms,
+                            double jitter_ms) {
+  delay_->setDelay(link, latency_ms, jitter_ms);
+}
+
+bool XdpBridge::receive(uint32_t port) {
+  Port &in = ports_[port];
+  uint32_t received = in.socket->receive(descs_.data(), batch_);
+  if (received == 0) {
+    return false;
+  }
+
+  // The whole batch arrived by now, it shares one timestamp
+  auto wall_now = std::chrono::steady_clock::now();
+  int64_t now_ns = steadyNs(wall_now);
+  for (uint32_t i = 0; i < received; ++i) {
+    const struct xdp_desc &desc = descs_[i];
+    uint8_t *frame = umem_->data(desc.addr);
+    bump(in.packets);
+    bump(in.bytes, desc.len);
+
+    // netem's default class for anything unclassified
+    uint32_t link = LINK_EARTH_TO_EARTH;
+    bool ipv4 = header_length_ == 0
+                    ? desc.len > 0 && frame[0] >> 4 == 4
+                    : desc.len > ETHERNET_HEADER_LENGTH &&
+                          frame[ETHERTYPE_OFFSET] == 0x08 &&
+                          frame[ETHERTYPE_OFFSET + 1] == 0x00;
+    if (ipv4) {
+      link = impair(frame + header_length_, desc.len - header_length_,
+                    wall_now);
+      if (link == NUM_LINKS) {
+        bump(in.drops);
+        free_frames_.push_back(umem_->frameOf(desc.addr));
+        continue;
+      }
+    } else {
+      bump(passed_);
+    }
+    processing_[link].record(std::chrono::steady_clock::now() - wall_now);
+
+    // never full, it has room for every frame there is
+    delay_->push({desc.addr, desc.len, port ^ 1u, link}, now_ns);
+  }
+  return true;
+}
+
+uint32_t XdpBridge::impair(uint8_t *packet, uint32_t length,
+                           std::chrono::steady_clock::time_point received) {
+  try {
+    PacketProcessor::Verdict verdict =
+        processor_->process(next_id_++, packet, length, 0,
+                            clock_.at(received));
+    if (verdict.verdict == NF_DROP) {
+      return NUM_LINKS;
+    }
+    // marks are 1-based LINK_* indices, see configs.hpp
+    uint32_t link = verdict.mark - MARK_EARTH_TO_EARTH;
+    return link < NUM_LINKS ? link : LINK_EARTH_TO_EARTH;
+  } catch (std::exception &error) {
+    std::cerr << "Error processing packet: " << error.what() << "\n";
+    return LINK_EARTH_TO_EARTH;
+  }
+}
+
+bool XdpBridge::release() {
+  int64_t now_ns = steadyNs(std::chrono::steady_clock::now());
+  bool moved = false;
+  while (delay_->due(now_ns)) {
+    const DelayLine::Entry &entry = delay_->top();
+    Port &out = ports_[entry.port];
+    struct xdp_desc desc{};
+    desc.addr = entry.addr;
+    desc.len = entry.length;
+    if (out.socket->transmit(&desc, 1) == 0) {
+      // tx ring full, the next recycle() kicks it and frees room
+      break;
+    }
+    lateness_[entry.link].record(
+        std::chrono::nanoseconds(now_ns - delay_->topRelease()));
+    bump(out.transmitted);
+    delay_->pop();
+    moved = true;
+  }
+  return moved;
+}
+
+bool XdpBridge::recycle(uint32_t port) {
+  XdpSocket &socket = *ports_[port].socket;
+  socket.kickTx();
+
+  uint32_t completed = socket.complete(addrs_.data(), batch_);
+  for (uint32_t i = 0; i < completed; ++i) {
+    free_frames_.push_back(umem_->frameOf(addrs_[i]));
+  }
+
+  // Refill from the back, the most recently freed frames are still cached
+  uint32_t offered =
+      static_cast<uint32_t>(std::min<size_t>(free_frames_.size(), batch_));
+  uint32_t filled =
+      socket.fill(free_frames_.data() + free_frames_.size() - offered,
+                  offered);
+  if (filled > 0) {
+    auto first = free_frames_.end() - offered;
+    free_frames_.erase(first, first + filled);
+    socket.kickRx();
+  }
+  return completed > 0 || filled > 0 || socket.txPending() > 0;
+}
+
+void XdpBridge::wait() {
+  int64_t timeout_ns = XDP_IDLE_WAIT_NS;
+  int64_t next = delay_->nextRelease();
+  if (next != INT64_MAX) {
+    int64_t now_ns = steadyNs(std::chrono::steady_clock::now());
+    timeout_ns = std::clamp<int64_t>(next - now_ns, 0, timeout_ns);
+  }
+  // frames out for sending come back through the completion rings
+  if (free_frames_.size() + delay_->size() < umem_->frames() / 2) {
+    timeout_ns = std::min(timeout_ns, XDP_COMPLETION_WAIT_NS);
+  }
+
+  struct pollfd fds[2] = {{ports_[0].socket->fd(), POLLIN, 0},
+                          {ports_[1].socket->fd(), POLLIN, 0}};
+  struct timespec timeout{};
+  timeout.tv_sec = timeout_ns / 1'000'000'000;
+  timeout.tv_nsec = timeout_ns % 1'000'000'000;
+  // EINTR from a stop signal ends the wait early, run() checks running_
+  if (ppoll(fds, 2, &timeout, nullptr) < 0 && errno != EINTR) {
+    throw std::runtime_error("ppoll() failed on the AF_XDP sockets");
+  }
+}
+
+XdpBridge::Stats XdpBridge::getStats() const {
+  Stats totals{};
+  const PacketProcessor::Stats &stats = processor_->stats();
+  totals.packets = stats.packets.load(std::memory_order_relaxed);
+  totals.segments = stats.segments.load(std::memory_order_relaxed);
+  totals.bytes = stats.bytes.load(std::memory_order_relaxed);
+  totals.burst_drops = stats.burst_drops.load(std::memory_order_relaxed);
+  totals.outage_drops = stats.outage_drops.load(std::memory_order_relaxed);
+  totals.rate_drops = stats.rate_drops.load(std::memory_order_relaxed);
+  totals.corrupted_packets =
+      stats.corrupted_packets.load(std::memory_order_relaxed);
+  totals.flipped_bits = stats.flipped_bits.load(std::memory_order_relaxed);
+  totals.passed = passed_.load(std::memory_order_relaxed);
+  totals.delayed = delayed_.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < ports_.size(); ++i) {
+    const Port &port = ports_[i];
+    PortStats &out = totals.ports[i];
+    out.packets = port.packets.load(std::memory_order_relaxed);
+    out.bytes = port.bytes.load(std::memory_order_relaxed);
+    out.drops = port.drops.load(std::memory_order_relaxed);
+    out.transmitted = port.transmitted.load(std::memory_order_relaxed);
+    struct xdp_statistics kernel{};
+    if (port.socket->statistics(kernel)) {
+      out.kernel_drops = kernel.rx_dropped + kernel.rx_ring_full +
+                         kernel.rx_fill_ring_empty_descs;
+    }
+  }
+  return totals;
+}
+
+std::vector<FlowTable::FlowStats> XdpBridge::topFlows(size_t n) const {
+  std::vector<FlowTable::FlowStats> flows;
+  if (processor_->flows()) {
+    processor_->flows()->snapshot(flows);
+  }
+  return FlowTable::top(std::move(flows), n);
+}
+
+std::array<FidelityMonitor::Link, NUM_LINKS> XdpBridge::fidelity() const {
+  std::array<FidelityMonitor::Link, NUM_LINKS> links{};
+  if (processor_->fidelity()) {
+    processor_->fidelity()->addTo(links);
+  }
+  return links;
+}
+
+std::array<XdpBridge::LinkTiming, NUM_LINKS> XdpBridge::linkTiming() const {
+  std::array<LinkTiming, NUM_LINKS> timing;
+  for (uint32_t link = 0; link < NUM_LINKS; ++link) {
+    timing[link] = {processing_[link].summary(), lateness_[link].summary()};
+  }
+  return timing;
+}
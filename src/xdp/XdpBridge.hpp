@@ -0,0 +1,172 @@
+// src/xdp/XdpBridge.hpp
+
+// ---- XdpBridge Usage ---- //
+
+// XdpBridge is the AF_XDP alternative to NetfilterQueue. It sits between
+// the two ports of "xdp.ports" like a wire: an XDP program on each port
+// steers every packet into an AF_XDP socket, and what arrives on one port
+// is sent out of the other. Instead of a netlink round trip per packet the
+// kernel and the daemon only exchange ring descriptors, and both sockets
+// share one UMEM, so a packet is never copied between them.
+
+// Example:
+// XdpBridge bridge(config_manager, clock, ephemeris, seed);
+// bridge.updateDelay(LINK_EARTH_TO_MOON, 1300.0, 100.0); // from any thread
+// bridge.run(); // this blocks until bridge.stop() is called from a signal
+
+// IPv4 packets go through the same PacketProcessor chain as on the NFQUEUE
+// path, classification, outages, bursts, throughput limit and bit errors
+// included, applied in place in the UMEM frame. Nothing passes tc on the
+// way out, so netem's delay is done by a DelayLine holding the frames:
+// per link latency and jitter start from the link sections and follow
+// updateDelay() like TcNetemManager. Frames that aren't IPv4 (ARP, IPv6)
+// are forwarded untouched, with earth_to_earth's delay as netem's default
+// class would give them. Ethernet ports and raw IP ports (ARPHRD_NONE,
+// e.g. WireGuard) are supported, both ports must be the same kind.
+
+// Every frame in the delay line holds a UMEM frame, xdp.frames bounds rate
+// times delay. When all frames are taken the kernel drops what arrives,
+// counted as kernel_drops of the port. Packets larger than a frame minus
+// the XDP headroom are dropped by the kernel as well, senders on a veth
+// need TSO/GSO off.
+
+// One thread runs the whole data path: receive, impairment, delay, send
+// and frame recycling. runtime.receive_cpu and realtime_priority place it,
+// runtime.spin_us keeps it polling that long before it sleeps in ppoll().
+// pipeline.workers does not apply, handing zero-copy frames to workers
+// would mean copying them.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ConfigManager.hpp"
+#include "DelayLine.hpp"
+#include "EphemerisTable.hpp"
+#include "FlowTable.hpp"
+#include "JitterStats.hpp"
+#include "PacketProcessor.hpp"
+#include "SimClock.hpp"
+#include "XdpProgram.hpp"
+#include "XdpSocket.hpp"
+#include "configs.hpp"
+
+class XdpBridge {
+public:
+  struct PortStats {
+    uint64_t packets; // received on the port
+    uint64_t bytes;
+    uint64_t drops;        // impairment drops of packets received here
+    uint64_t transmitted;  // sent out of the port
+    uint64_t kernel_drops; // no free frame or rx ring room (XDP_STATISTICS)
+  };
+
+  // Totals of the bridge, safe to read from any thread
+  struct Stats {
+    uint64_t packets; // IPv4 packets that went through impairment
+    uint64_t segments;
+    uint64_t bytes;
+    uint64_t burst_drops;
+    uint64_t outage_drops;
+    uint64_t rate_drops;
+    uint64_t corrupted_packets;
+    uint64_t flipped_bits;
+    uint64_t passed;  // not IPv4, forwarded without impairment
+    uint64_t delayed; // frames in the delay line right now
+    std::array<PortStats, 2> ports;
+  };
+
+  // Per link, how long impairment took and how late the delay line let
+  // packets go compared to their release time
+  struct LinkTiming {
+    JitterStats::Summary processing;
+    JitterStats::Summary lateness;
+  };
+
+  XdpBridge(ConfigManager &config_manager, SimClock &clock,
+            std::shared_ptr<const EphemerisTable> ephemeris, uint64_t seed);
+  ~XdpBridge();
+
+  XdpBridge(const XdpBridge &) = delete;
+  XdpBridge &operator=(const XdpBridge &) = delete;
+
+  void run();
+  void stop();
+  bool isRunning() const;
+
+  // Same as TcNetemManager::updateDelay, for packets received from now on.
+  // Safe to call from any thread.
+  void updateDelay(uint32_t link, double latency_ms, double jitter_ms);
+
+  Stats getStats() const;
+  std::vector<FlowTable::FlowStats> topFlows(size_t n) const;
+  std::array<LinkTiming, NUM_LINKS> linkTiming() const;
+  std::array<FidelityMonitor::Link, NUM_LINKS> fidelity() const;
+
+private:
+  struct Port {
+    std::string name;
+    // the program is declared last, it is detached before the socket closes
+    std::unique_ptr<XdpSocket> socket;
+    std::unique_ptr<XdpProgram> program;
+
+    // Data path thread counters
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> drops{0};
+    std::atomic<uint64_t> transmitted{0};
+  };
+
+  // Owner-only increment, like PacketProcessor's
+  static void bump(std::atomic<uint64_t> &counter, uint64_t n = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  }
+
+  // Bytes in front of the IP header: 14 on Ethernet, 0 on raw IP devices
+  static uint32_t linkHeaderLength(const std::string &port);
+
+  // One step of the loop each, true if they moved anything
+  bool receive(uint32_t port);
+  bool release();
+  bool recycle(uint32_t port);
+
+  // Sleeps until a port has packets, the next frame is due or a signal
+  void wait();
+
+  // Impairs an IPv4 packet in place, returns the LINK_* index it was
+  // classified as or NUM_LINKS if it was dropped
+  uint32_t impair(uint8_t *packet, uint32_t length,
+                  std::chrono::steady_clock::time_point received);
+
+  SimClock &clock_;
+  Config::Runtime runtime_;
+  uint32_t batch_;
+  uint32_t header_length_;
+  uint32_t next_id_ = 0;
+
+  std::unique_ptr<PacketProcessor> processor_;
+  std::unique_ptr<DelayLine> delay_;
+
+  // Declared before the ports, the sockets must be gone before the UMEM
+  std::unique_ptr<XdpUmem> umem_;
+  std::array<Port, 2> ports_;
+
+  // Frames neither in a ring nor in the delay line
+  std::vector<uint64_t> free_frames_;
+  std::vector<struct xdp_desc> descs_;
+  std::vector<uint64_t> addrs_;
+
+  std::atomic<uint64_t> passed_{0};
+  std::atomic<uint64_t> delayed_{0};
+  std::array<JitterStats, NUM_LINKS> processing_;
+  std::array<JitterStats, NUM_LINKS> lateness_;
+
+  std::atomic<bool> running_{true};
+};
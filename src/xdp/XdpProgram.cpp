@@ -0,0 +1,127 @@
+// src/xdp/XdpProgram.cpp
+
+#include "XdpProgram.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Verifier output of a rejected program, five instructions need little
+constexpr size_t BPF_LOG_SIZE = 64 * 1024;
+
+namespace {
+int bpf(int command, union bpf_attr &attr) {
+  return static_cast<int>(syscall(__NR_bpf, command, &attr, sizeof(attr)));
+}
+
+struct bpf_insn instruction(uint8_t code, uint8_t dst, uint8_t src,
+                            int16_t offset, int32_t imm) {
+  struct bpf_insn insn{};
+  insn.code = code;
+  insn.dst_reg = dst & 0xf;
+  insn.src_reg = src & 0xf;
+  insn.off = offset;
+  insn.imm = imm;
+  return insn;
+}
+
+std::runtime_error bpfError(const std::string &what) {
+  return std::runtime_error("Error " + what + ": " + std::strerror(errno));
+}
+} // namespace
+
+XdpProgram::XdpProgram(const XdpSocket &socket, bool native) {
+  try {
+    // queue id => socket, only the socket's queue has an entry
+    union bpf_attr map{};
+    map.map_type = BPF_MAP_TYPE_XSKMAP;
+    map.key_size = sizeof(uint32_t);
+    map.value_size = sizeof(uint32_t);
+    map.max_entries = socket.queueId() + 1;
+    std::strncpy(map.map_name, "lnd_xsks", sizeof(map.map_name) - 1);
+    map_fd_ = bpf(BPF_MAP_CREATE, map);
+    if (map_fd_ < 0) {
+      throw bpfError("creating the XSKMAP");
+    }
+
+    uint32_t key = socket.queueId();
+    uint32_t value = static_cast<uint32_t>(socket.fd());
+    union bpf_attr update{};
+    update.map_fd = static_cast<uint32_t>(map_fd_);
+    update.key = reinterpret_cast<uintptr_t>(&key);
+    update.value = reinterpret_cast<uintptr_t>(&value);
+    update.flags = BPF_ANY;
+    if (bpf(BPF_MAP_UPDATE_ELEM, update) < 0) {
+      throw bpfError("adding the AF_XDP socket to the XSKMAP");
+    }
+
+    // r1 is the xdp_md context. The low bits of bpf_redirect_map's flags
+    // are the action when the key has no socket (kernel 5.3+).
+    const struct bpf_insn program[] = {
+        // r2 = ctx->rx_queue_index
+        instruction(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_2, BPF_REG_1,
+                    offsetof(struct xdp_md, rx_queue_index), 0),
+        // r1 = &xsks, a 64 bit immediate over two instructions
+        instruction(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0,
+                    map_fd_),
+        instruction(0, 0, 0, 0, 0),
+        // r3 = XDP_PASS
+        instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS),
+        instruction(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map),
+        instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+    };
+
+    std::vector<char> log(BPF_LOG_SIZE);
+    static const char license[] = "GPL";
+    union bpf_attr load{};
+    load.prog_type = BPF_PROG_TYPE_XDP;
+    load.expected_attach_type = BPF_XDP;
+    load.insns = reinterpret_cast<uintptr_t>(program);
+    load.insn_cnt = sizeof(program) / sizeof(program[0]);
+    load.license = reinterpret_cast<uintptr_t>(license);
+    load.log_buf = reinterpret_cast<uintptr_t>(log.data());
+    load.log_size = static_cast<uint32_t>(log.size());
+    load.log_level = 1;
+    std::strncpy(load.prog_name, "lnd_xdp", sizeof(load.prog_name) - 1);
+    program_fd_ = bpf(BPF_PROG_LOAD, load);
+    if (program_fd_ < 0) {
+      throw std::runtime_error("Error loading the XDP program: " +
+                               std::string(std::strerror(errno)) + "\n" +
+                               log.data());
+    }
+
+    union bpf_attr link{};
+    link.link_create.prog_fd = static_cast<uint32_t>(program_fd_);
+    link.link_create.target_ifindex = socket.ifindex();
+    link.link_create.attach_type = BPF_XDP;
+    link.link_create.flags = native ? XDP_FLAGS_DRV_MODE : XDP_FLAGS_SKB_MODE;
+    link_fd_ = bpf(BPF_LINK_CREATE, link);
+    if (link_fd_ < 0) {
+      throw bpfError("attaching the XDP program to ifindex " +
+                     std::to_string(socket.ifindex()));
+    }
+  } catch (...) {
+    closeAll();
+    throw;
+  }
+}
+
+XdpProgram::~XdpProgram() { closeAll(); }
+
+void XdpProgram::closeAll() {
+  // the link first, that detaches the program
+  for (int *fd : {&link_fd_, &program_fd_, &map_fd_}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+}
@@ -0,0 +1,44 @@
+// src/xdp/XdpProgram.hpp
+
+// ---- XdpProgram Usage ---- //
+
+// XdpProgram attaches the XDP program that steers a device's packets into
+// an AF_XDP socket. The program is five hand assembled BPF instructions,
+// built and loaded through the bpf() system call without a compiler or
+// libbpf:
+//   return bpf_redirect_map(&xsks, ctx->rx_queue_index, XDP_PASS);
+// Packets on queues without a socket in the map go up the stack as usual.
+
+// Example:
+// XdpSocket socket(umem, "veth-a", 0, ring_size, false);
+// XdpProgram program(socket, false); // generic XDP, works on any device
+
+// native selects driver mode (XDP_FLAGS_DRV_MODE), which the device driver
+// has to support, otherwise generic mode (XDP_FLAGS_SKB_MODE) is used. The
+// attachment is a BPF link owned by a file descriptor, it goes away with
+// the object or with the process, so a daemon that crashes leaves nothing
+// attached. A device that already has an XDP program is refused.
+
+// Errors throw std::runtime_error, a rejected program with the verifier log.
+
+#pragma once
+
+#include <cstdint>
+
+#include "XdpSocket.hpp"
+
+class XdpProgram {
+public:
+  XdpProgram(const XdpSocket &socket, bool native);
+  ~XdpProgram();
+
+  XdpProgram(const XdpProgram &) = delete;
+  XdpProgram &operator=(const XdpProgram &) = delete;
+
+private:
+  void closeAll();
+
+  int map_fd_ = -1;
+  int program_fd_ = -1;
+  int link_fd_ = -1;
+};
@@ -0,0 +1,238 @@
+// src/xdp/XdpSocket.cpp
+
+#include "XdpSocket.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <net/if.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+namespace {
+// The kernel's side of a ring index moves under us
+uint32_t loadAcquire(uint32_t *index) {
+  return std::atomic_ref<uint32_t>(*index).load(std::memory_order_acquire);
+}
+
+void storeRelease(uint32_t *index, uint32_t value) {
+  std::atomic_ref<uint32_t>(*index).store(value, std::memory_order_release);
+}
+} // namespace
+
+XdpUmem::XdpUmem(uint32_t frames, uint32_t frame_size)
+    : frames_(frames), frame_size_(frame_size),
+      size_(static_cast<size_t>(frames) * frame_size) {
+  // page aligned, as XDP_UMEM_REG requires
+  void *area = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (area == MAP_FAILED) {
+    throw std::runtime_error("Error allocating " + std::to_string(size_) +
+                             " bytes of UMEM: " + std::strerror(errno));
+  }
+  area_ = static_cast<uint8_t *>(area);
+}
+
+XdpUmem::~XdpUmem() { munmap(area_, size_); }
+
+XdpSocket::XdpSocket(XdpUmem &umem, const std::string &interface,
+                     uint32_t queue_id, uint32_t ring_size, bool zero_copy,
+                     const XdpSocket *shared)
+    : queue_id_(queue_id) {
+  ifindex_ = if_nametoindex(interface.c_str());
+  if (ifindex_ == 0) {
+    throw std::runtime_error("Unknown interface " + interface);
+  }
+  fd_ = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) {
+    throw std::runtime_error(std::string("Error creating AF_XDP socket: ") +
+                             std::strerror(errno));
+  }
+
+  try {
+    if (!shared) {
+      struct xdp_umem_reg reg{};
+      reg.addr = reinterpret_cast<uintptr_t>(umem.area());
+      reg.len = umem.size();
+      reg.chunk_size = umem.frameSize();
+      reg.headroom = 0;
+      setOption(XDP_UMEM_REG, &reg, sizeof(reg), "XDP_UMEM_REG");
+    }
+
+    // Every socket has its own fill and completion ring, a socket sharing
+    // the UMEM of one on another device included
+    setOption(XDP_UMEM_FILL_RING, &ring_size, sizeof(ring_size),
+              "XDP_UMEM_FILL_RING");
+    setOption(XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size),
+              "XDP_UMEM_COMPLETION_RING");
+    setOption(XDP_RX_RING, &ring_size, sizeof(ring_size), "XDP_RX_RING");
+    setOption(XDP_TX_RING, &ring_size, sizeof(ring_size), "XDP_TX_RING");
+
+    struct xdp_mmap_offsets offsets{};
+    socklen_t length = sizeof(offsets);
+    if (getsockopt(fd_, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &length) < 0) {
+      throw std::runtime_error(std::string("Error reading AF_XDP ring "
+                                           "offsets: ") +
+                               std::strerror(errno));
+    }
+    mapRing(fill_, offsets.fr, XDP_UMEM_PGOFF_FILL_RING, ring_size,
+            sizeof(uint64_t));
+    mapRing(completion_, offsets.cr, XDP_UMEM_PGOFF_COMPLETION_RING,
+            ring_size, sizeof(uint64_t));
+    mapRing(rx_, offsets.rx, XDP_PGOFF_RX_RING, ring_size,
+            sizeof(struct xdp_desc));
+    mapRing(tx_, offsets.tx, XDP_PGOFF_TX_RING, ring_size,
+            sizeof(struct xdp_desc));
+
+    struct sockaddr_xdp address{};
+    address.sxdp_family = AF_XDP;
+    address.sxdp_ifindex = ifindex_;
+    address.sxdp_queue_id = queue_id;
+    if (shared) {
+      // mode and wakeup flags come from the UMEM's first socket
+      address.sxdp_flags = XDP_SHARED_UMEM;
+      address.sxdp_shared_umem_fd = static_cast<uint32_t>(shared->fd());
+    } else {
+      address.sxdp_flags =
+          (zero_copy ? XDP_ZEROCOPY : XDP_COPY) | XDP_USE_NEED_WAKEUP;
+    }
+    if (bind(fd_, reinterpret_cast<struct sockaddr *>(&address),
+             sizeof(address)) < 0) {
+      throw std::runtime_error("Error binding AF_XDP socket to " + interface +
+                               " queue " + std::to_string(queue_id) + ": " +
+                               std::strerror(errno));
+    }
+  } catch (...) {
+    unmapRings();
+    close(fd_);
+    throw;
+  }
+}
+
+XdpSocket::~XdpSocket() {
+  unmapRings();
+  close(fd_);
+}
+
+void XdpSocket::setOption(int option, const void *value, socklen_t length,
+                          const char *name) {
+  if (setsockopt(fd_, SOL_XDP, option, value, length) < 0) {
+    throw std::runtime_error(std::string("Error setting ") + name + ": " +
+                             std::strerror(errno));
+  }
+}
+
+void XdpSocket::mapRing(Ring &ring, const struct xdp_ring_offset &offsets,
+                        off_t page_offset, uint32_t size,
+                        size_t entry_size) {
+  size_t length = offsets.desc + size * entry_size;
+  void *map = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd_, page_offset);
+  if (map == MAP_FAILED) {
+    throw std::runtime_error(std::string("Error mapping AF_XDP ring: ") +
+                             std::strerror(errno));
+  }
+  auto *base = static_cast<uint8_t *>(map);
+  ring.map = map;
+  ring.map_length = length;
+  ring.producer = reinterpret_cast<uint32_t *>(base + offsets.producer);
+  ring.consumer = reinterpret_cast<uint32_t *>(base + offsets.consumer);
+  ring.flags = reinterpret_cast<uint32_t *>(base + offsets.flags);
+  ring.entries = base + offsets.desc;
+  ring.size = size;
+}
+
+void XdpSocket::unmapRings() {
+  for (Ring *ring : {&fill_, &completion_, &rx_, &tx_}) {
+    if (ring->map) {
+      munmap(ring->map, ring->map_length);
+      ring->map = nullptr;
+    }
+  }
+}
+
+uint32_t XdpSocket::freeSlots(const Ring &ring) {
+  return ring.size - (*ring.producer - loadAcquire(ring.consumer));
+}
+
+uint32_t XdpSocket::available(const Ring &ring) {
+  return loadAcquire(ring.producer) - *ring.consumer;
+}
+
+uint32_t XdpSocket::fill(const uint64_t *addrs, uint32_t count) {
+  uint32_t n = std::min(count, freeSlots(fill_));
+  uint32_t producer = *fill_.producer;
+  auto *entries = static_cast<uint64_t *>(fill_.entries);
+  for (uint32_t i = 0; i < n; ++i) {
+    entries[(producer + i) & (fill_.size - 1)] = addrs[i];
+  }
+  storeRelease(fill_.producer, producer + n);
+  return n;
+}
+
+uint32_t XdpSocket::receive(struct xdp_desc *descs, uint32_t max) {
+  uint32_t n = std::min(max, available(rx_));
+  uint32_t consumer = *rx_.consumer;
+  auto *entries = static_cast<const struct xdp_desc *>(rx_.entries);
+  for (uint32_t i = 0; i < n; ++i) {
+    descs[i] = entries[(consumer + i) & (rx_.size - 1)];
+  }
+  storeRelease(rx_.consumer, consumer + n);
+  return n;
+}
+
+uint32_t XdpSocket::transmit(const struct xdp_desc *descs, uint32_t count) {
+  uint32_t n = std::min(count, freeSlots(tx_));
+  uint32_t producer = *tx_.producer;
+  auto *entries = static_cast<struct xdp_desc *>(tx_.entries);
+  for (uint32_t i = 0; i < n; ++i) {
+    entries[(producer + i) & (tx_.size - 1)] = descs[i];
+  }
+  storeRelease(tx_.producer, producer + n);
+  return n;
+}
+
+uint32_t XdpSocket::txPending() const {
+  return *tx_.producer - loadAcquire(tx_.consumer);
+}
+
+uint32_t XdpSocket::complete(uint64_t *addrs, uint32_t max) {
+  uint32_t n = std::min(max, available(completion_));
+  uint32_t consumer = *completion_.consumer;
+  auto *entries = static_cast<const uint64_t *>(completion_.entries);
+  for (uint32_t i = 0; i < n; ++i) {
+    addrs[i] = entries[(consumer + i) & (completion_.size - 1)];
+  }
+  storeRelease(completion_.consumer, consumer + n);
+  return n;
+}
+
+void XdpSocket::kickTx() {
+  if (txPending() == 0 ||
+      !(loadAcquire(tx_.flags) & XDP_RING_NEED_WAKEUP)) {
+    return;
+  }
+  // EAGAIN, EBUSY and ENOBUFS only mean try again after the next completion
+  sendto(fd_, nullptr, 0, MSG_DONTWAIT, nullptr, 0);
+}
+
+void XdpSocket::kickRx() {
+  if (loadAcquire(fill_.flags) & XDP_RING_NEED_WAKEUP) {
+    recvfrom(fd_, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+  }
+}
+
+bool XdpSocket::statistics(struct xdp_statistics &stats) const {
+  socklen_t length = sizeof(stats);
+  return getsockopt(fd_, SOL_XDP, XDP_STATISTICS, &stats, &length) == 0;
+}
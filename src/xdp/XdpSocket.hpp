@@ -0,0 +1,147 @@
+// src/xdp/XdpSocket.hpp
+
+// ---- XdpSocket Usage ---- //
+
+// XdpSocket is one AF_XDP socket, set up through the raw kernel interface
+// (linux/if_xdp.h) without libbpf or libxdp. It is bound to one queue of one
+// device and shares four rings with the kernel:
+// - fill: free frames handed to the kernel to receive into
+// - rx: received packets, as (address, length) descriptors
+// - tx: packets to send
+// - completion: frames the kernel has finished sending
+// The frames themselves live in an XdpUmem. Sockets on different devices can
+// share one, so a packet received on one device is sent on the other
+// without being copied.
+
+// Example:
+// XdpUmem umem(frames, frame_size);
+// XdpSocket a(umem, "veth-a", 0, ring_size, false);
+// XdpSocket b(umem, "veth-b", 0, ring_size, false, &a); // shares a's UMEM
+// a.fill(free_frames, n);
+// uint32_t received = a.receive(descs, batch);
+// b.transmit(descs, received);
+// b.kickTx();
+// uint32_t done = b.complete(sent_frames, batch); // free again
+
+// The socket only receives once an XDP program redirects the device queue
+// into it, see XdpProgram.
+
+// Setup errors throw std::runtime_error. The ring operations never block or
+// allocate, they move as many entries as there is room for and return how
+// many that was. A socket is used by one thread.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <linux/if_xdp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+// The packet memory of one or more AF_XDP sockets, frames frame_size bytes
+// each. Frame addresses are offsets into the area.
+class XdpUmem {
+public:
+  XdpUmem(uint32_t frames, uint32_t frame_size);
+  ~XdpUmem();
+
+  XdpUmem(const XdpUmem &) = delete;
+  XdpUmem &operator=(const XdpUmem &) = delete;
+
+  uint8_t *data(uint64_t addr) const { return area_ + addr; }
+  void *area() const { return area_; }
+  size_t size() const { return size_; }
+  uint32_t frames() const { return frames_; }
+  uint32_t frameSize() const { return frame_size_; }
+
+  // Start of the frame an address points into, what goes back on a fill
+  // ring. frame_size is a power of two.
+  uint64_t frameOf(uint64_t addr) const {
+    return addr & ~static_cast<uint64_t>(frame_size_ - 1);
+  }
+
+private:
+  uint32_t frames_;
+  uint32_t frame_size_;
+  size_t size_;
+  uint8_t *area_;
+};
+
+class XdpSocket {
+public:
+  // Registers umem with this socket, or with shared set reuses the UMEM
+  // shared was created with. zero_copy asks the driver to receive straight
+  // into the frames, generic XDP (and with it veth) only does copy mode.
+  // A shared socket inherits the mode of the first one.
+  XdpSocket(XdpUmem &umem, const std::string &interface, uint32_t queue_id,
+            uint32_t ring_size, bool zero_copy,
+            const XdpSocket *shared = nullptr);
+  ~XdpSocket();
+
+  XdpSocket(const XdpSocket &) = delete;
+  XdpSocket &operator=(const XdpSocket &) = delete;
+
+  int fd() const { return fd_; }
+  uint32_t ifindex() const { return ifindex_; }
+  uint32_t queueId() const { return queue_id_; }
+
+  // Fill ring, hands the first count frames of addrs to the kernel
+  uint32_t fill(const uint64_t *addrs, uint32_t count);
+
+  // Rx ring, copies up to max descriptors out and frees their ring slots
+  uint32_t receive(struct xdp_desc *descs, uint32_t max);
+
+  // Tx ring, queues the first count descriptors of descs
+  uint32_t transmit(const struct xdp_desc *descs, uint32_t count);
+
+  // Tx descriptors the kernel has not picked up yet
+  uint32_t txPending() const;
+
+  // Completion ring, up to max addresses of frames that were sent
+  uint32_t complete(uint64_t *addrs, uint32_t max);
+
+  // Tell the kernel about new tx descriptors, or about refilled frames
+  // after it ran out. Only makes the system call when the kernel asked for
+  // it (XDP_USE_NEED_WAKEUP). Copy mode sends a limited number of packets
+  // per kick, call kickTx() again while txPending() > 0.
+  void kickTx();
+  void kickRx();
+
+  // The kernel's drop counters for this socket, false if unsupported
+  bool statistics(struct xdp_statistics &stats) const;
+
+private:
+  // One ring mapped from the socket. Producer and consumer run freely and
+  // index entries modulo size (a power of two), the kernel owns one of them.
+  struct Ring {
+    uint32_t *producer = nullptr;
+    uint32_t *consumer = nullptr;
+    uint32_t *flags = nullptr;
+    void *entries = nullptr;
+    uint32_t size = 0;
+    void *map = nullptr;
+    size_t map_length = 0;
+  };
+
+  void setOption(int option, const void *value, socklen_t length,
+                 const char *name);
+  void mapRing(Ring &ring, const struct xdp_ring_offset &offsets,
+               off_t page_offset, uint32_t size, size_t entry_size);
+  void unmapRings();
+
+  // Our side of a ring we produce into (fill, tx) and consume from (rx,
+  // completion)
+  static uint32_t freeSlots(const Ring &ring);
+  static uint32_t available(const Ring &ring);
+
+  int fd_ = -1;
+  uint32_t ifindex_ = 0;
+  uint32_t queue_id_ = 0;
+
+  Ring fill_;
+  Ring completion_;
+  Ring rx_;
+  Ring tx_;
+};
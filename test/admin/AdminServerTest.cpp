@@ -0,0 +1,86 @@
+#include "AdminServer.hpp"
+#include "TestPaths.hpp"
+#include "configs.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+TEST(AdminServerTests, ChangesLinksThroughConfigSwaps) {
+  ConfigManager config_manager("");
+  AdminServer admin(config_manager, testPath(".sock"), {});
+  uint64_t version = config_manager.version();
+
+  std::string response = admin.handle(
+      R"({"cmd": "set_link", "link": "earth_to_moon",
+          "values": {"base_bit_error_rate": 2e-4}})");
+  EXPECT_NE(response.find("\"ok\":true"), std::string::npos) << response;
+  EXPECT_GT(config_manager.version(), version);
+
+  auto config = config_manager.getSnapshot();
+  EXPECT_DOUBLE_EQ(config->earth_to_moon.base_bit_error_rate, 2e-4);
+  // the resolved profile table follows the link section
+  EXPECT_DOUBLE_EQ(config->profiles[LINK_EARTH_TO_MOON].base_bit_error_rate,
+                   2e-4);
+  EXPECT_EQ(config->moon_to_earth, DEFAULT_MOON_TO_EARTH);
+
+  // nothing is installed when one of the values is bad
+  version = config_manager.version();
+  response = admin.handle(
+      R"({"cmd": "set_link", "link": "earth_to_moon",
+          "values": {"base_latency_ms": 10, "nonsense": 1}})");
+  EXPECT_NE(response.find("\"ok\":false"), std::string::npos);
+  EXPECT_EQ(config_manager.version(), version);
+
+  response = admin.handle(
+      R"({"cmd": "force_burst", "link": "moon_to_moon", "mode": "on"})");
+  EXPECT_NE(response.find("\"burst\":\"on\""), std::string::npos);
+  EXPECT_EQ(config_manager.getSnapshot()->forced_bursts[LINK_MOON_TO_MOON],
+            Config::BurstForce::ON);
+
+  EXPECT_NE(admin.handle("not json").find("\"ok\":false"), std::string::npos);
+  EXPECT_NE(admin.handle(R"({"cmd": "launch"})").find("unknown command"),
+            std::string::npos);
+}
+
+TEST(AdminServerTests, AnswersJsonLinesOverTheSocket) {
+  const std::string path = testPath(".sock");
+  ConfigManager config_manager("");
+  AdminServer::Hooks hooks;
+  hooks.counters = [] { return AdminServer::Counters{{"packets", 42}}; };
+  AdminServer admin(config_manager, path, hooks);
+  admin.start();
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  ASSERT_LT(path.size(), sizeof(address.sun_path));
+  std::strcpy(address.sun_path, path.c_str());
+  ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr *>(&address),
+                    sizeof(address)),
+            0);
+
+  // two requests in one write, two response lines back
+  std::string requests =
+      "{\"cmd\": \"counters\"}\n{\"cmd\": \"log_level\"}\n";
+  ASSERT_EQ(send(fd, requests.data(), requests.size(), 0),
+            static_cast<ssize_t>(requests.size()));
+
+  std::string responses;
+  char buffer[1024];
+  while (std::count(responses.begin(), responses.end(), '\n') < 2) {
+    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    ASSERT_GT(received, 0);
+    responses.append(buffer, static_cast<size_t>(received));
+  }
+  EXPECT_EQ(responses, "{\"counters\":{\"packets\":42},\"ok\":true}\n"
+                       "{\"level\":\"info\",\"ok\":true}\n");
+
+  close(fd);
+  admin.stop();
+}
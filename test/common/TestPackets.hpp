@@ -0,0 +1,40 @@
+// test/common/TestPackets.hpp
+
+// Packets for the parser and processing chain tests, all of them from the
+// first base station to the first rover, so they classify as earth to moon.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "configs.hpp"
+
+// IPv4 header at offset with ihl 32-bit words, total length covers the rest
+inline void writeIPv4(std::vector<uint8_t> &packet, size_t offset,
+                      uint8_t protocol, size_t ihl = 5) {
+  packet[offset] = static_cast<uint8_t>(0x40 | ihl);
+  size_t total = packet.size() - offset;
+  packet[offset + 2] = static_cast<uint8_t>(total >> 8);
+  packet[offset + 3] = static_cast<uint8_t>(total);
+  packet[offset + 9] = protocol;
+  for (int i = 0; i < 4; ++i) {
+    packet[offset + 12 + i] = static_cast<uint8_t>(BASE_IP_MIN >> (24 - 8 * i));
+    packet[offset + 16 + i] =
+        static_cast<uint8_t>(ROVER_IP_MIN >> (24 - 8 * i));
+  }
+}
+
+// IPv4 + TCP from port 12345 to 80, headers of ihl and tcp_words 32-bit
+// words, zero payload up to length
+inline std::vector<uint8_t> tcpPacket(size_t length, size_t ihl = 5,
+                                      size_t tcp_words = 5) {
+  std::vector<uint8_t> packet(length, 0);
+  writeIPv4(packet, 0, 6, ihl);
+  packet[ihl * 4] = 0x30; // source port 12345
+  packet[ihl * 4 + 1] = 0x39;
+  packet[ihl * 4 + 3] = 80;
+  packet[ihl * 4 + 12] = static_cast<uint8_t>(tcp_words << 4);
+  return packet;
+}
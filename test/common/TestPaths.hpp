@@ -0,0 +1,20 @@
+// test/common/TestPaths.hpp
+
+// Unique file paths for tests. gtest_discover_tests runs every case as a
+// process of its own and ctest -j runs those side by side, so a fixed name
+// in the working directory gets written and removed under another case.
+
+#pragma once
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+// <temp dir>/lnd-<suite>-<test>-<pid><suffix>, only valid inside a test
+inline std::string testPath(const std::string &suffix) {
+  const ::testing::TestInfo *test =
+      ::testing::UnitTest::GetInstance()->current_test_info();
+  return ::testing::TempDir() + "lnd-" + test->test_suite_name() + "-" +
+         test->name() + "-" + std::to_string(getpid()) + suffix;
+}
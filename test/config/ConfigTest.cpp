@@ -1,6 +1,10 @@
 #include "ConfigManager.hpp"
+#include "ScenarioTimeline.hpp"
+#include "TestPaths.hpp"
 #include "configs.hpp"
 
+#include <cstdio>
+#include <fstream>
 #include <gtest/gtest.h>
 
 TEST(ConfigTests, LoadDefaultConfig) {
@@ -13,3 +17,299 @@ TEST(ConfigTests, LoadDefaultConfig) {
   EXPECT_EQ(config.moon_to_earth, DEFAULT_MOON_TO_EARTH);
   EXPECT_EQ(config.moon_to_moon, DEFAULT_MOON_TO_MOON);
 }
+
+TEST(ConfigTests, ResolveNodeAndPairOverrides) {
+  const std::string path = testPath(".json");
+  {
+    std::ofstream out(path);
+    out << R"({
+      "earth_to_earth": {}, "earth_to_moon": {}, "moon_to_earth": {},
+      "moon_to_moon": {},
+      "node_overrides": {
+        "10.237.0.5": { "earth_to_moon": { "base_bit_error_rate": 3e-5 } }
+      },
+      "pair_overrides": [
+        { "src": "10.237.0.130", "dst": "10.237.0.5", "base_latency_ms": 1400 }
+      ]
+    })";
+  }
+  ConfigManager test_config_manager(path);
+  std::remove(path.c_str());
+  auto config = test_config_manager.getSnapshot();
+
+  constexpr uint32_t ROVER_5 = (10 << 24 | 237 << 16 | 0 << 8 | 5);
+  constexpr uint32_t ROVER_6 = (10 << 24 | 237 << 16 | 0 << 8 | 6);
+  constexpr uint32_t BASE_131 = (10 << 24 | 237 << 16 | 0 << 8 | 131);
+
+  // Untouched pairs keep the plain link section
+  EXPECT_EQ(config->profileFor(BASE_131, ROVER_6), LINK_EARTH_TO_MOON);
+  EXPECT_EQ(config->profileFor(ROVER_5, BASE_131), LINK_MOON_TO_EARTH);
+  EXPECT_EQ(config->profileFor(0, 0), LINK_EARTH_TO_EARTH);
+
+  // Node override applies to every earth to moon pair reaching the rover
+  const auto &node = config->profiles[config->profileFor(BASE_131, ROVER_5)];
+  EXPECT_DOUBLE_EQ(node.base_bit_error_rate, 3e-5);
+  EXPECT_DOUBLE_EQ(node.base_latency_ms,
+                   DEFAULT_EARTH_TO_MOON.base_latency_ms);
+
+  // Pair override stacks on top of the node override
+  const auto &pair = config->profiles[config->profileFor(BASE_IP_MIN, ROVER_5)];
+  EXPECT_DOUBLE_EQ(pair.base_bit_error_rate, 3e-5);
+  EXPECT_DOUBLE_EQ(pair.base_latency_ms, 1400);
+}
+
+TEST(ConfigTests, InterfaceLinkOverrides) {
+  const std::string path = testPath(".json");
+  {
+    std::ofstream out(path);
+    out << R"({
+      "earth_to_earth": {}, "earth_to_moon": {}, "moon_to_earth": {},
+      "moon_to_moon": {},
+      "node_overrides": {
+        "10.237.0.5": { "earth_to_moon": { "base_bit_error_rate": 3e-5 } }
+      },
+      "shards": { "count": 2 },
+      "interfaces": [
+        { "name": "wg0" },
+        { "name": "wg1",
+          "links": { "earth_to_moon": { "base_latency_ms": 2600 } } }
+      ]
+    })";
+  }
+  ConfigManager test_config_manager(path);
+  std::remove(path.c_str());
+  auto config = test_config_manager.getSnapshot();
+
+  // Queues follow each other, shards.count per interface
+  ASSERT_EQ(config->interfaces.size(), 2u);
+  EXPECT_EQ(config->interfaces[0].queue, QUEUE_NUM);
+  EXPECT_EQ(config->interfaces[1].queue, QUEUE_NUM + 2);
+
+  constexpr uint32_t ROVER_5 = (10 << 24 | 237 << 16 | 0 << 8 | 5);
+  constexpr uint32_t ROVER_6 = (10 << 24 | 237 << 16 | 0 << 8 | 6);
+  constexpr uint32_t BASE_131 = (10 << 24 | 237 << 16 | 0 << 8 | 131);
+
+  // wg0 keeps the plain link sections
+  EXPECT_EQ(config->profileFor(BASE_131, ROVER_6, 0), LINK_EARTH_TO_MOON);
+
+  // wg1 has its own earth to moon latency, node overrides stack on it
+  const auto &link = config->profiles[config->profileFor(BASE_131, ROVER_6, 1)];
+  EXPECT_DOUBLE_EQ(link.base_latency_ms, 2600);
+  const auto &node = config->profiles[config->profileFor(BASE_131, ROVER_5, 1)];
+  EXPECT_DOUBLE_EQ(node.base_latency_ms, 2600);
+  EXPECT_DOUBLE_EQ(node.base_bit_error_rate, 3e-5);
+  EXPECT_EQ(config->profileFor(ROVER_5, BASE_131, 1), LINK_MOON_TO_EARTH);
+}
+
+TEST(ConfigTests, UserspaceLinks) {
+  const std::string path = testPath(".json");
+  {
+    std::ofstream out(path);
+    out << R"({
+      "earth_to_earth": {}, "earth_to_moon": {}, "moon_to_earth": {},
+      "moon_to_moon": { "base_latency_ms": 30, "latency_jitter_ms": 10,
+                        "base_bit_error_rate": 0,
+                        "base_packet_loss_burst_freq_per_minute": 0 },
+      "node_overrides": {
+        "10.237.0.5": { "moon_to_moon": { "throughput_limit_mbps": 10 } }
+      },
+      "offload": { "links": ["moon_to_earth"], "distribution": "pareto" }
+    })";
+  }
+  ConfigManager test_config_manager(path);
+  std::remove(path.c_str());
+
+  // earth_to_earth defaults to nothing but a mark, one rover's throughput
+  // limit keeps moon_to_moon in userspace, netem takes over moon_to_earth
+  auto config = test_config_manager.getSnapshot();
+  EXPECT_EQ(config->offload.link_mask, 1u << LINK_MOON_TO_EARTH);
+  EXPECT_EQ(config->offload.distribution, "pareto");
+  EXPECT_EQ(config->userspaceLinks(),
+            1u << LINK_EARTH_TO_MOON | 1u << LINK_MOON_TO_MOON);
+
+  test_config_manager.update([](Config &config) {
+    config.overrides.clear();
+    config.forced_bursts[LINK_EARTH_TO_EARTH] = Config::BurstForce::ON;
+  });
+  config = test_config_manager.getSnapshot();
+  EXPECT_EQ(config->userspaceLinks(),
+            1u << LINK_EARTH_TO_EARTH | 1u << LINK_EARTH_TO_MOON);
+
+  test_config_manager.update([](Config &config) {
+    config.impairment.chain = Config::Impairment::Chain::MARK_ONLY;
+  });
+  EXPECT_EQ(test_config_manager.getSnapshot()->userspaceLinks(), 0u);
+}
+
+TEST(ConfigTests, XdpPortsAndRings) {
+  const std::string path = testPath(".json");
+  auto write = [&path](const std::string &xdp) {
+    std::ofstream out(path);
+    out << R"({
+      "earth_to_earth": {}, "earth_to_moon": {}, "moon_to_earth": {},
+      "moon_to_moon": {}, "xdp": )"
+        << xdp << "}";
+  };
+
+  write(R"({ "enabled": true, "ports": ["veth0", "veth1"],
+             "frames": 1024, "ring_size": 256 })");
+  {
+    ConfigManager test_config_manager(path);
+    auto config = test_config_manager.getSnapshot();
+    EXPECT_TRUE(config->xdp.enabled);
+    ASSERT_EQ(config->xdp.ports.size(), 2u);
+    EXPECT_EQ(config->xdp.ports[1], "veth1");
+    EXPECT_EQ(config->xdp.frame_size, 2048u);
+    EXPECT_EQ(config->xdp.mode, "generic");
+  }
+
+  // Rejected files fall back to the defaults, xdp off: rings index modulo
+  // their size, the UMEM needs room for all four, a port can't be both
+  for (const char *xdp :
+       {R"({ "enabled": true, "ports": ["veth0", "veth1"],
+             "ring_size": 1000 })",
+        R"({ "enabled": true, "ports": ["veth0", "veth1"],
+             "frames": 1024, "ring_size": 512 })",
+        R"({ "enabled": true, "ports": ["veth0", "veth0"] })"}) {
+    write(xdp);
+    ConfigManager test_config_manager(path);
+    EXPECT_FALSE(test_config_manager.getSnapshot()->xdp.enabled) << xdp;
+  }
+  std::remove(path.c_str());
+}
+
+TEST(ConfigTests, RuntimeProfilePresetAndOverrides) {
+  const std::string path = testPath(".json");
+  {
+    std::ofstream out(path);
+    out << R"({
+      "earth_to_earth": {}, "earth_to_moon": {}, "moon_to_earth": {},
+      "moon_to_moon": {},
+      "runtime": { "profile": "low_jitter", "receive_cpu": 2,
+                   "worker_cpus": [3, 4], "spin_us": 0 }
+    })";
+  }
+  ConfigManager from_file(path);
+  ConfigManager from_command_line(path, "default");
+  std::remove(path.c_str());
+
+  // Preset values, with the keys given next to the profile winning
+  const auto &runtime = from_file.getSnapshot()->runtime;
+  EXPECT_EQ(runtime.profile, "low_jitter");
+  EXPECT_TRUE(runtime.lock_memory);
+  EXPECT_GT(runtime.realtime_priority, 0);
+  EXPECT_EQ(runtime.spin_us, 0u);
+  EXPECT_EQ(runtime.receive_cpu, 2);
+  EXPECT_EQ(runtime.worker_cpus, (std::vector<int>{3, 4}));
+
+  // The command line replaces the profile but keeps the placement
+  const auto &forced = from_command_line.getSnapshot()->runtime;
+  EXPECT_EQ(forced.profile, "default");
+  EXPECT_FALSE(forced.lock_memory);
+  EXPECT_EQ(forced.realtime_priority, 0);
+  EXPECT_EQ(forced.receive_cpu, 2);
+}
+
+TEST(ConfigTests, CompileScenarioIntoEpochs) {
+  const std::string path = testPath(".json");
+  const std::string events = testPath("-events.json");
+  {
+    std::ofstream out(events);
+    out << R"({"events": [
+      { "name": "solar event", "at_s": 60, "duration_s": 1200,
+        "link": "earth_to_moon", "set": { "base_bit_error_rate": 1e-4 } },
+      { "name": "lunar night", "at_s": 600, "node": "10.237.0.5",
+        "outage": true }
+    ]})";
+    std::ofstream config(path);
+    config << R"({
+      "earth_to_earth": {}, "earth_to_moon": {}, "moon_to_earth": {},
+      "moon_to_moon": {},
+      "scenario": { "file": ")"
+           << events << R"(" }
+    })";
+  }
+  ConfigManager test_config_manager(path);
+  std::remove(path.c_str());
+  std::remove(events.c_str());
+  auto config = test_config_manager.getSnapshot();
+  ASSERT_TRUE(config->timeline);
+
+  // before, solar event, both, lunar night only
+  const ScenarioTimeline &timeline = *config->timeline;
+  ASSERT_EQ(timeline.size(), 4u);
+  constexpr int64_t S = 1000000000;
+  EXPECT_EQ(timeline.find(0, 0), 0u);
+  EXPECT_EQ(timeline.find(60 * S, 0), 1u);
+  EXPECT_EQ(timeline.find(700 * S, 1), 2u);
+  EXPECT_EQ(timeline.find(2000 * S, 0), 3u);
+
+  constexpr uint32_t ROVER_5 = (10 << 24 | 237 << 16 | 0 << 8 | 5);
+  constexpr uint32_t ROVER_6 = (10 << 24 | 237 << 16 | 0 << 8 | 6);
+  const auto &solar = timeline.epoch(1);
+  uint16_t profile = solar.profileFor(*config, BASE_IP_MIN, ROVER_6);
+  EXPECT_DOUBLE_EQ(solar.profile(*config, profile).base_bit_error_rate, 1e-4);
+  EXPECT_EQ(solar.override_links, 1u << LINK_EARTH_TO_MOON);
+  EXPECT_FALSE(solar.isOutage(LINK_EARTH_TO_MOON, BASE_IP_MIN, ROVER_5));
+
+  const auto &both = timeline.epoch(2);
+  EXPECT_EQ(both.active.size(), 2u);
+  EXPECT_TRUE(both.isOutage(LINK_EARTH_TO_MOON, BASE_IP_MIN, ROVER_5));
+  EXPECT_TRUE(both.isOutage(LINK_MOON_TO_MOON, ROVER_5, ROVER_6));
+  EXPECT_FALSE(both.isOutage(LINK_EARTH_TO_MOON, BASE_IP_MIN, ROVER_6));
+
+  // the solar event is over, the link is back to the file's values
+  const auto &night = timeline.epoch(3);
+  EXPECT_TRUE(night.profiles.empty());
+  EXPECT_EQ(night.override_links, 0u);
+}
+
+// A node event between two overridden rovers adds a combination, the
+// profiles that already existed keep their ids
+TEST(ConfigTests, ScenarioEpochsKeepProfileIds) {
+  const std::string path = testPath(".json");
+  const std::string events = testPath("-events.json");
+  {
+    std::ofstream out(events);
+    out << R"({"events": [
+      { "name": "dust storm", "at_s": 60, "duration_s": 60,
+        "node": "10.237.0.6", "link": "earth_to_moon",
+        "set": { "base_bit_error_rate": 1e-4 } }
+    ]})";
+    std::ofstream config(path);
+    config << R"({
+      "earth_to_earth": {}, "earth_to_moon": {}, "moon_to_earth": {},
+      "moon_to_moon": {},
+      "node_overrides": {
+        "10.237.0.5": { "earth_to_moon": { "base_latency_ms": 5 } },
+        "10.237.0.7": { "earth_to_moon": { "base_latency_ms": 7 } }
+      },
+      "scenario": { "file": ")"
+           << events << R"(" }
+    })";
+  }
+  ConfigManager test_config_manager(path);
+  std::remove(path.c_str());
+  std::remove(events.c_str());
+  auto config = test_config_manager.getSnapshot();
+  ASSERT_TRUE(config->timeline);
+  const auto &storm = config->timeline->epoch(1);
+  ASSERT_FALSE(storm.profiles.empty());
+
+  constexpr uint32_t ROVER_5 = (10 << 24 | 237 << 16 | 0 << 8 | 5);
+  constexpr uint32_t ROVER_6 = (10 << 24 | 237 << 16 | 0 << 8 | 6);
+  constexpr uint32_t ROVER_7 = (10 << 24 | 237 << 16 | 0 << 8 | 7);
+  for (uint32_t rover : {ROVER_5, ROVER_7}) {
+    uint16_t id = config->profileFor(BASE_IP_MIN, rover);
+    EXPECT_GE(id, NUM_LINKS);
+    EXPECT_EQ(storm.profileFor(*config, BASE_IP_MIN, rover), id);
+    EXPECT_DOUBLE_EQ(storm.profile(*config, id).base_latency_ms,
+                     config->profiles[id].base_latency_ms);
+  }
+
+  // the new combination is numbered after the base profiles
+  uint16_t storm_id = storm.profileFor(*config, BASE_IP_MIN, ROVER_6);
+  EXPECT_GE(storm_id, config->profiles.size());
+  EXPECT_DOUBLE_EQ(storm.profile(*config, storm_id).base_bit_error_rate,
+                   1e-4);
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "NetemFit.hpp"
+#include "configs.hpp"
+
+namespace {
+const NetemFit::Deviation &deviation(const NetemFit &fit,
+                                     const std::string &name) {
+  for (const NetemFit::Deviation &d : fit.deviations) {
+    if (d.name == name) {
+      return d;
+    }
+  }
+  throw std::runtime_error("no deviation " + name);
+}
+} // namespace
+
+TEST(NetemFitTests, FitsBurstsAndBitErrors) {
+  Config::Offload offload;
+  offload.packet_rate_pps = 1000;
+  offload.packet_bytes = 1000;
+  NetemFit fit = NetemFit::fit(DEFAULT_EARTH_TO_MOON, offload);
+
+  // one burst a minute of 500 ms: 60000 good and 500 bad packets
+  ASSERT_TRUE(fit.loss);
+  EXPECT_DOUBLE_EQ(fit.loss_p, 1.0 / 60000);
+  EXPECT_DOUBLE_EQ(fit.loss_r, 1.0 / 500);
+  EXPECT_NEAR(deviation(fit, "loss ratio").error(), 0, 1e-12);
+  EXPECT_NEAR(deviation(fit, "burst duration ms").error(), 0, 1e-12);
+  // geometric bursts spread far more than the configured 100 ms
+  EXPECT_NEAR(deviation(fit, "burst duration stddev ms").fitted, 499.5, 0.1);
+
+  // 8000 bits at 1e-5: 7.7% of packets get one flip, BER a little low
+  EXPECT_NEAR(fit.corrupt, -std::expm1(8000 * std::log1p(-1e-5)), 1e-12);
+  EXPECT_NEAR(deviation(fit, "bit error rate").error(), 0.039, 0.001);
+  // the worst is the geometric burst spread, 5 times the configured
+  EXPECT_NEAR(fit.worstError(), 3.995, 0.001);
+
+  EXPECT_EQ(fit.distribution, "normal");
+  EXPECT_DOUBLE_EQ(fit.jitter_ms, DEFAULT_EARTH_TO_MOON.latency_jitter_stddev);
+  std::string options = fit.options(1280.0);
+  EXPECT_EQ(options.rfind("delay 1280.000000ms 50.000000ms 0% distribution "
+                          "normal loss gemodel ",
+                          0),
+            0u);
+  EXPECT_NE(options.find(" 0.2% 100% 0% corrupt "), std::string::npos);
+}
+
+TEST(NetemFitTests, ShortBurstsAreClamped) {
+  Config::LinkProperties props{};
+  props.base_latency_ms = 30;
+  props.latency_jitter_ms = 10;
+  props.base_packet_loss_burst_freq_per_minute = 60;
+  props.base_packet_loss_burst_duration_ms = 0.1;
+  Config::Offload offload;
+  offload.packet_rate_pps = 1000;
+  NetemFit fit = NetemFit::fit(props, offload);
+
+  // a burst is at least one packet long, 10 times the configured length
+  EXPECT_DOUBLE_EQ(fit.loss_r, 1.0);
+  EXPECT_NEAR(deviation(fit, "burst duration ms").fitted, 1.0, 1e-12);
+  EXPECT_GT(deviation(fit, "loss ratio").error(), 8.0);
+
+  // no jitter stddev keeps netem's uniform jitter, no bit errors no corrupt
+  EXPECT_EQ(fit.options(30.0).rfind("delay 30.000000ms 10.000000ms 0% "
+                                    "loss gemodel ",
+                                    0),
+            0u);
+  EXPECT_EQ(fit.options(30.0).find("corrupt"), std::string::npos);
+}
@@ -0,0 +1,124 @@
+#include "BurstModel.hpp"
+#include "configs.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+// one burst per second lasting 100ms, no spread
+constexpr Config::LinkProperties FIXED_BURSTS{0, 0, 0, 0, 0, 60.0, 0, 100.0, 0};
+
+constexpr uint64_t SEED = 42;
+constexpr uint32_t STREAM = rngStream(RNG_BURST, LINK_EARTH_TO_MOON);
+
+TEST(BurstModelTests, NoBurstsWithoutFrequency) {
+  auto t0 = std::chrono::steady_clock::now();
+  BurstModel::State state(t0);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_FALSE(BurstModel::inBurst(state, DEFAULT_EARTH_TO_EARTH,
+                                     t0 + i * 10ms, SEED, STREAM));
+  }
+}
+
+TEST(BurstModelTests, TransitionsFollowPacketTime) {
+  auto t0 = std::chrono::steady_clock::now();
+  BurstModel::State state(t0);
+
+  EXPECT_FALSE(BurstModel::inBurst(state, FIXED_BURSTS, t0, SEED, STREAM));
+  EXPECT_FALSE(
+      BurstModel::inBurst(state, FIXED_BURSTS, t0 + 999ms, SEED, STREAM));
+  EXPECT_TRUE(
+      BurstModel::inBurst(state, FIXED_BURSTS, t0 + 1050ms, SEED, STREAM));
+  EXPECT_FALSE(
+      BurstModel::inBurst(state, FIXED_BURSTS, t0 + 1150ms, SEED, STREAM));
+
+  // Several missed cycles are replayed in order
+  EXPECT_TRUE(
+      BurstModel::inBurst(state, FIXED_BURSTS, t0 + 3250ms, SEED, STREAM));
+}
+
+// Kernel timestamps can date a packet before the clock origin
+TEST(BurstModelTests, NoBurstBeforeTheOrigin) {
+  auto t0 = std::chrono::steady_clock::now();
+  BurstModel::State state(t0);
+
+  EXPECT_FALSE(
+      BurstModel::inBurst(state, FIXED_BURSTS, t0 - 5ms, SEED, STREAM));
+  EXPECT_EQ(state.slot_length.count(), 0); // the state was left alone
+  EXPECT_FALSE(BurstModel::inBurst(state, FIXED_BURSTS, t0, SEED, STREAM));
+
+  // also once the timeline has moved on
+  EXPECT_TRUE(
+      BurstModel::inBurst(state, FIXED_BURSTS, t0 + 1050ms, SEED, STREAM));
+  EXPECT_FALSE(
+      BurstModel::inBurst(state, FIXED_BURSTS, t0 - 1s, SEED, STREAM));
+}
+
+TEST(BurstModelTests, LongIdleRestartsProcess) {
+  auto t0 = std::chrono::steady_clock::now();
+  BurstModel::State state(t0);
+
+  BurstModel::inBurst(state, FIXED_BURSTS, t0, SEED, STREAM);
+  BurstModel::inBurst(state, FIXED_BURSTS, t0 + 24h, SEED, STREAM);
+  EXPECT_GT(state.next_transition, t0 + 24h);
+  EXPECT_LE(state.next_transition, t0 + 24h + 1s);
+}
+
+TEST(BurstModelTests, TimelineIndependentOfEvaluationPoints) {
+  auto t0 = std::chrono::steady_clock::now();
+  BurstModel::State dense(t0), sparse(t0);
+
+  // One state sees every 1ms, the other only every 7ms, they must agree
+  for (int ms = 0; ms < 60000; ++ms) {
+    bool a = BurstModel::inBurst(dense, DEFAULT_EARTH_TO_MOON,
+                                 t0 + std::chrono::milliseconds(ms), SEED,
+                                 STREAM);
+    if (ms % 7 == 0) {
+      bool b = BurstModel::inBurst(sparse, DEFAULT_EARTH_TO_MOON,
+                                   t0 + std::chrono::milliseconds(ms), SEED,
+                                   STREAM);
+      ASSERT_EQ(a, b) << "at " << ms << "ms";
+    }
+  }
+}
+
+TEST(BurstModelTests, LateStateJoinsTheTimeline) {
+  auto t0 = std::chrono::steady_clock::now();
+  BurstModel::State early(t0), late(t0);
+
+  // late first sees a packet an hour in, past many slots and well beyond
+  // what the early state replayed packet by packet
+  for (int ms = 0; ms < 3600000; ms += 5) {
+    BurstModel::inBurst(early, DEFAULT_EARTH_TO_MOON,
+                        t0 + std::chrono::milliseconds(ms), SEED, STREAM);
+  }
+  for (int ms = 3600000; ms < 3660000; ++ms) {
+    auto now = t0 + std::chrono::milliseconds(ms);
+    bool a = BurstModel::inBurst(early, DEFAULT_EARTH_TO_MOON, now, SEED,
+                                 STREAM);
+    bool b = BurstModel::inBurst(late, DEFAULT_EARTH_TO_MOON, now, SEED,
+                                 STREAM);
+    ASSERT_EQ(a, b) << "at " << ms << "ms";
+  }
+}
+
+TEST(BurstModelTests, StatesConvergeAfterAReload) {
+  auto t0 = std::chrono::steady_clock::now();
+  BurstModel::State first(t0), second(t0);
+  Config::LinkProperties reloaded = FIXED_BURSTS;
+  reloaded.base_packet_loss_burst_duration_ms = 200.0;
+
+  // first sees the reload at 10s, second only at 20s
+  for (int ms = 0; ms < 100000; ms += 3) {
+    auto now = t0 + std::chrono::milliseconds(ms);
+    bool a = BurstModel::inBurst(first, ms < 10000 ? FIXED_BURSTS : reloaded,
+                                 now, SEED, STREAM);
+    bool b = BurstModel::inBurst(second, ms < 20000 ? FIXED_BURSTS : reloaded,
+                                 now, SEED, STREAM);
+    // the new mean changed the slot length, both replay their slot at the
+    // first transition after the reload, at most one old cycle later
+    if (ms >= 21100) {
+      ASSERT_EQ(a, b) << "at " << ms << "ms";
+    }
+  }
+}
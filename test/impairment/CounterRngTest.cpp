@@ -0,0 +1,67 @@
+#include "CounterRng.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(CounterRngTests, PhiloxKnownAnswer) {
+  // Random123 known answer test for philox4x32_10, all zero input
+  auto block = CounterRng::philox({0, 0, 0, 0}, {0, 0});
+  EXPECT_EQ(block[0], 0x6627e8d5u);
+  EXPECT_EQ(block[1], 0xe169c58du);
+  EXPECT_EQ(block[2], 0xbc57ac4cu);
+  EXPECT_EQ(block[3], 0x9b00dbd8u);
+}
+
+TEST(CounterRngTests, SameKeySameSequence) {
+  CounterRng a(7, rngStream(RNG_BIT_ERRORS, 3), 1234);
+  CounterRng b(7, rngStream(RNG_BIT_ERRORS, 3), 1234);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(a(), b());
+  }
+}
+
+TEST(CounterRngTests, StreamsAreIndependent) {
+  CounterRng a(7, rngStream(RNG_BIT_ERRORS, 3), 1234);
+  CounterRng b(7, rngStream(RNG_BURST, 3), 1234);
+  CounterRng c(7, rngStream(RNG_BIT_ERRORS, 3), 1235);
+  uint32_t first = a();
+  EXPECT_NE(first, b());
+  EXPECT_NE(first, c());
+}
+
+TEST(CounterRngTests, UniformInRange) {
+  CounterRng rng(1, 0, 0);
+  double sum = 0;
+  for (int i = 0; i < 10000; ++i) {
+    double u = rng.uniform();
+    ASSERT_GE(u, 0.0);
+    ASSERT_LT(u, 1.0);
+    sum += u;
+  }
+  EXPECT_NEAR(sum / 10000, 0.5, 0.02);
+}
+
+TEST(CounterRngTests, TableNormalMatchesMoments) {
+  CounterRng rng(1, 0, 0);
+  double sum = 0;
+  double sum_sq = 0;
+  for (int i = 0; i < 100000; ++i) {
+    double x = rng.tableNormal(3.0, 2.0);
+    sum += x;
+    sum_sq += x * x;
+  }
+  double mean = sum / 100000;
+  EXPECT_NEAR(mean, 3.0, 0.03);
+  EXPECT_NEAR(std::sqrt(sum_sq / 100000 - mean * mean), 2.0, 0.03);
+}
+
+TEST(CounterRngTests, GeometricGapsMatchBitErrorRate) {
+  // mean gap before a hit is (1 - p) / p
+  const double p = 1e-3;
+  CounterRng rng(1, 0, 0);
+  double sum = 0;
+  for (int i = 0; i < 100000; ++i) {
+    sum += static_cast<double>(rng.geometric(std::log1p(-p)));
+  }
+  EXPECT_NEAR(sum / 100000, (1 - p) / p, 15.0);
+  EXPECT_EQ(rng.geometric(std::log1p(-1e-300)), UINT64_MAX);
+}
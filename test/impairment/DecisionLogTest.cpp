@@ -0,0 +1,88 @@
+#include "DecisionLog.hpp"
+#include "TestPaths.hpp"
+#include "configs.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <vector>
+
+class DecisionLogTests : public ::testing::Test {
+protected:
+  void SetUp() override {
+    config.enabled = true;
+    config.directory = testPath("");
+    config.segment_mb = 1;
+  }
+
+  void TearDown() override { std::filesystem::remove_all(config.directory); }
+
+  std::vector<std::string> segments() const {
+    std::vector<std::string> paths;
+    for (const auto &entry :
+         std::filesystem::directory_iterator(config.directory)) {
+      paths.push_back(entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+  }
+
+  Config::DecisionLog config;
+};
+
+TEST_F(DecisionLogTests, RecordsAreReadableWhileWritten) {
+  DecisionLog log(config);
+  log.append({1000, 7, 1200, 3, MARK_EARTH_TO_MOON, 1, LINK_EARTH_TO_MOON,
+              NF_ACCEPT, 0, 1, 0});
+  log.append({2000, 8, 60, 0, MARK_EARTH_TO_MOON, 1, LINK_EARTH_TO_MOON,
+              NF_DROP, 1, 0, 0});
+
+  // the live segment shows both records, not its preallocated capacity
+  DecisionLog::Reader reader(log.path());
+  EXPECT_EQ(reader.header().writer, log.writer());
+  EXPECT_EQ(reader.header().segment, 0u);
+  ASSERT_EQ(reader.records().size(), 2u);
+  EXPECT_EQ(reader.records()[0].id, 7u);
+  EXPECT_EQ(reader.records()[0].flips, 3u);
+  EXPECT_EQ(reader.records()[1].time_ns, 2000);
+  EXPECT_EQ(reader.records()[1].verdict, NF_DROP);
+  EXPECT_EQ(reader.records()[1].in_burst, 1);
+}
+
+TEST_F(DecisionLogTests, RotatesAndKeepsNewestSegments) {
+  config.max_segments = 2;
+  uint64_t per_segment =
+      (1024 * 1024 - sizeof(DecisionLog::Header)) / sizeof(DecisionLog::Record);
+  uint64_t total = per_segment * 2 + 10;
+  {
+    DecisionLog log(config);
+    for (uint64_t i = 0; i < total; ++i) {
+      log.append({static_cast<int64_t>(i), static_cast<uint32_t>(i), 100, 0,
+                  0, 0, NUM_LINKS, NF_ACCEPT, 0, 0, 0});
+    }
+  }
+
+  // the first segment was deleted, the last one trimmed to its records
+  std::vector<std::string> paths = segments();
+  ASSERT_EQ(paths.size(), 2u);
+  DecisionLog::Reader full(paths[0]);
+  DecisionLog::Reader last(paths[1]);
+  EXPECT_EQ(full.header().segment, 1u);
+  EXPECT_EQ(full.records().size(), per_segment);
+  EXPECT_EQ(full.records()[0].id, per_segment);
+  EXPECT_EQ(last.records().size(), 10u);
+  EXPECT_EQ(last.records()[9].id, total - 1);
+  EXPECT_EQ(std::filesystem::file_size(paths[1]),
+            sizeof(DecisionLog::Header) + 10 * sizeof(DecisionLog::Record));
+}
+
+TEST_F(DecisionLogTests, RejectsOtherFiles) {
+  std::filesystem::create_directories(config.directory);
+  std::string path = config.directory + "/not-a-log.lndlog";
+  std::FILE *file = std::fopen(path.c_str(), "w");
+  std::vector<char> junk(256, 'x');
+  std::fwrite(junk.data(), 1, junk.size(), file);
+  std::fclose(file);
+  EXPECT_THROW(DecisionLog::Reader reader(path), std::runtime_error);
+}
@@ -0,0 +1,74 @@
+#include "EphemerisTable.hpp"
+#include "TestPaths.hpp"
+#include "configs.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+
+class EphemerisTableTests : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ephemeris.csv = testPath(".csv");
+    ephemeris.link_mask = 1u << LINK_EARTH_TO_MOON;
+    std::ofstream out(ephemeris.csv);
+    out << "timestamp_s,range_km,elevation_deg\n"
+        << "1000,384400,45\n"
+        << "1010,404400,45\n"
+        << "1020,404400,1\n";
+  }
+
+  void TearDown() override {
+    std::remove(ephemeris.csv.c_str());
+    std::remove((ephemeris.csv + ".bin").c_str());
+  }
+
+  Config::Ephemeris ephemeris;
+};
+
+TEST_F(EphemerisTableTests, InterpolatesLatencyFromRange) {
+  auto table = EphemerisTable::open(ephemeris, {});
+  EXPECT_EQ(table->size(), 21u);
+  EXPECT_TRUE(table->appliesTo(LINK_EARTH_TO_MOON));
+  EXPECT_FALSE(table->appliesTo(LINK_MOON_TO_EARTH));
+
+  // 394400 km one way
+  EXPECT_NEAR(table->sampleAt(1005).latency_ms, 1315.57, 0.01);
+  // clamped at both ends
+  EXPECT_NEAR(table->sampleAt(0).latency_ms, 1282.22, 0.01);
+  EXPECT_NEAR(table->sampleAt(1e12).latency_ms, 1348.93, 0.01);
+}
+
+TEST_F(EphemerisTableTests, BitErrorRateFollowsLinkBudget) {
+  auto table = EphemerisTable::open(ephemeris, {});
+  float near = table->sampleAt(1000).bit_error_rate;
+  float far = table->sampleAt(1010).bit_error_rate;
+  EXPECT_GT(near, 0.0f);
+  EXPECT_GT(far, near);
+
+  // below the minimum elevation the link is lost
+  EXPECT_FLOAT_EQ(table->sampleAt(1020).bit_error_rate,
+                  static_cast<float>(ephemeris.max_bit_error_rate));
+}
+
+TEST_F(EphemerisTableTests, RecompilesWhenParametersChange) {
+  auto first = EphemerisTable::open(ephemeris, {});
+  ephemeris.processing_delay_ms = 10.0;
+  auto second = EphemerisTable::open(ephemeris, {});
+  EXPECT_NEAR(second->sampleAt(1000).latency_ms,
+              first->sampleAt(1000).latency_ms + 10.0, 0.01);
+}
+
+TEST_F(EphemerisTableTests, RecompilesACsvRewrittenInTheSameSecond) {
+  auto first = EphemerisTable::open(ephemeris, {});
+  {
+    std::ofstream out(ephemeris.csv, std::ios::trunc);
+    out << "timestamp_s,range_km,elevation_deg\n"
+        << "1000,394400,45\n"
+        << "1010,404400,45\n";
+  }
+  auto second = EphemerisTable::open(ephemeris, {});
+  EXPECT_EQ(second->size(), 11u);
+  EXPECT_NEAR(second->sampleAt(1000).latency_ms,
+              first->sampleAt(1005).latency_ms, 0.01);
+}
@@ -0,0 +1,143 @@
+#include "BurstModel.hpp"
+#include "ConfigManager.hpp"
+#include "FidelityMonitor.hpp"
+#include "PacketProcessor.hpp"
+#include "TestPackets.hpp"
+#include "TestPaths.hpp"
+#include "configs.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+TEST(FidelityMonitorTests, WelfordMergeMatchesOnePass) {
+  FidelityMonitor::Welford all;
+  FidelityMonitor::Welford first;
+  FidelityMonitor::Welford second;
+  for (int i = 0; i < 100; ++i) {
+    double x = (i * 37 % 101) / 10.0;
+    all.add(x);
+    (i < 30 ? first : second).add(x);
+  }
+  first.merge(second);
+  EXPECT_EQ(first.count, all.count);
+  EXPECT_NEAR(first.mean, all.mean, 1e-12);
+  EXPECT_NEAR(first.stddev(), all.stddev(), 1e-12);
+}
+
+TEST(FidelityMonitorTests, FollowsBurstRuns) {
+  Config::LinkProperties props{};
+  props.base_packet_loss_burst_freq_per_minute = 60;
+  props.base_packet_loss_burst_duration_ms = 100;
+  FidelityMonitor monitor;
+  auto record = [&](int64_t ms, bool in_burst) {
+    monitor.record({LINK_MOON_TO_MOON, ms * 1'000'000, 1, &props, true,
+                    in_burst, 0, 0, 0.0});
+  };
+
+  // one 50 ms burst, then a gap too long to count as observed
+  for (int64_t ms = 0; ms <= 1000; ms += 10) {
+    record(ms, ms >= 300 && ms < 350);
+  }
+  record(5000, false);
+
+  std::array<FidelityMonitor::Link, NUM_LINKS> links{};
+  monitor.addTo(links);
+  const FidelityMonitor::Link &link = links[LINK_MOON_TO_MOON];
+  EXPECT_EQ(link.bursts, 1u);
+  EXPECT_EQ(link.burst_segments, 5u);
+  EXPECT_DOUBLE_EQ(link.burst_ms.mean, 50.0);
+  EXPECT_DOUBLE_EQ(link.observed_ms, 1000.0);
+
+  std::vector<FidelityMonitor::Figure> figures =
+      FidelityMonitor::compare(link);
+  ASSERT_EQ(figures.size(), 3u);
+  EXPECT_EQ(figures[0].index, 1u);
+  EXPECT_DOUBLE_EQ(figures[1].realized, 60.0); // one burst in a second
+  EXPECT_NEAR(figures[1].target, 60000.0 / 1100.0, 1e-9);
+  EXPECT_DOUBLE_EQ(figures[2].target, 100.0);
+  EXPECT_DOUBLE_EQ(figures[2].error(), 0.5);
+}
+
+// The processing chain realizes what the config asks for
+TEST(FidelityMonitorTests, ProcessorMatchesConfiguredStatistics) {
+  const std::string path = testPath(".json");
+  {
+    std::ofstream out(path);
+    out << R"({
+      "earth_to_earth": {}, "moon_to_earth": {}, "moon_to_moon": {},
+      "earth_to_moon": { "base_bit_error_rate": 1e-3,
+                         "bit_error_rate_stddev": 0,
+                         "base_packet_loss_burst_freq_per_minute": 6,
+                         "packet_loss_burst_freq_stddev": 1,
+                         "base_packet_loss_burst_duration_ms": 500,
+                         "base_packet_loss_burst_duration_stddev": 100 },
+      "flows": { "enabled": false }
+    })";
+  }
+  ConfigManager config_manager(path);
+  std::remove(path.c_str());
+
+  auto t0 = std::chrono::steady_clock::now();
+  PacketProcessor processor(config_manager, 42, t0, nullptr);
+  ASSERT_NE(processor.fidelity(), nullptr);
+
+  // ten simulated minutes, a packet every 2 ms
+  for (uint32_t id = 0; id < 300000; ++id) {
+    std::vector<uint8_t> packet = tcpPacket(200);
+    processor.process(id, packet.data(), packet.size(), 0,
+                      t0 + std::chrono::milliseconds(2 * id));
+  }
+
+  std::array<FidelityMonitor::Link, NUM_LINKS> links{};
+  processor.fidelity()->addTo(links);
+  std::vector<FidelityMonitor::Figure> figures =
+      FidelityMonitor::compare(links[LINK_EARTH_TO_MOON]);
+  ASSERT_EQ(figures.size(), 4u);
+  EXPECT_LT(figures[0].error(), 0.02) << figures[0].realized; // BER
+  EXPECT_LT(figures[1].error(), 0.25) << figures[1].realized; // drop ratio
+  EXPECT_LT(figures[2].error(), 0.25) << figures[2].realized; // bursts/min
+  EXPECT_LT(figures[3].error(), 0.1) << figures[3].realized;  // duration
+  EXPECT_GT(links[LINK_EARTH_TO_MOON].bursts, 40u);
+}
+
+// Short trains with long silences between them, most bursts fall into the
+// silences and must not be counted when a train starts inside one
+TEST(FidelityMonitorTests, GappyTrafficCountsOnlyObservedBursts) {
+  Config::LinkProperties props{};
+  props.base_packet_loss_burst_freq_per_minute = 60;
+  props.packet_loss_burst_freq_stddev = 10; // bursts drift across trains
+  props.base_packet_loss_burst_duration_ms = 50;
+  auto t0 = std::chrono::steady_clock::now();
+  BurstModel::State state(t0);
+  FidelityMonitor monitor;
+
+  // ten packets 1 ms apart once a second, for five simulated hours
+  for (int64_t second = 0; second < 5 * 3600; ++second) {
+    for (int64_t ms = second * 1000; ms < second * 1000 + 10; ++ms) {
+      bool in_burst = BurstModel::inBurst(
+          state, props, t0 + std::chrono::milliseconds(ms), 42,
+          rngStream(RNG_BURST, 0));
+      monitor.record({LINK_MOON_TO_MOON, ms * 1'000'000, 1, &props, true,
+                      in_burst, 0, 0, 0.0});
+    }
+  }
+
+  std::array<FidelityMonitor::Link, NUM_LINKS> links{};
+  monitor.addTo(links);
+  const FidelityMonitor::Link &link = links[LINK_MOON_TO_MOON];
+  EXPECT_DOUBLE_EQ(link.observed_ms, 5 * 3600 * 9.0);
+
+  std::vector<FidelityMonitor::Figure> figures =
+      FidelityMonitor::compare(link);
+  ASSERT_EQ(figures.size(), 2u);
+  EXPECT_LT(figures[0].error(), 0.1) << figures[0].realized; // drop ratio
+  EXPECT_EQ(figures[1].index, 2u);
+  EXPECT_LT(figures[1].error(), 0.25) << figures[1].realized; // bursts/min
+  // fixed 50 ms bursts never fit into a train, none is timed
+  EXPECT_EQ(link.burst_ms.count, 0u);
+}
@@ -0,0 +1,87 @@
+#include "FlowTable.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+constexpr uint64_t SECOND = 1000000000ull;
+
+FlowKey flow(uint32_t src_ip, uint16_t src_port) {
+  return {src_ip, 0x0AED0001, src_port, 80, 6};
+}
+} // namespace
+
+TEST(FlowTableTests, ParsesTcpFiveTuple) {
+  uint8_t packet[40] = {0x45, 0, 0, 40, 0, 0, 0x40, 0, 64, 6};
+  packet[12] = 10, packet[13] = 237, packet[14] = 0, packet[15] = 5;
+  packet[16] = 10, packet[17] = 237, packet[18] = 0, packet[19] = 7;
+  packet[20] = 0x1F, packet[21] = 0x90; // 8080
+  packet[22] = 0, packet[23] = 80;
+
+  FlowKey key;
+  ASSERT_TRUE(FlowKey::parse(packet, sizeof(packet), key));
+  EXPECT_EQ(key.src_ip, 0x0AED0005u);
+  EXPECT_EQ(key.dst_ip, 0x0AED0007u);
+  EXPECT_EQ(key.src_port, 8080);
+  EXPECT_EQ(key.dst_port, 80);
+  EXPECT_EQ(key.protocol, 6);
+
+  // later fragments have no transport header
+  packet[7] = 1;
+  ASSERT_TRUE(FlowKey::parse(packet, sizeof(packet), key));
+  EXPECT_EQ(key.src_port, 0);
+
+  packet[0] = 0x60;
+  EXPECT_FALSE(FlowKey::parse(packet, sizeof(packet), key));
+}
+
+TEST(FlowTableTests, CountsPerFlowAndReportsTopDrops) {
+  FlowTable table(64, 60.0);
+  for (uint16_t port = 1; port <= 10; ++port) {
+    FlowTable::Entry *entry = table.touch(flow(0x0AED0005, port), SECOND, 100);
+    FlowTable::addDrops(*entry, port % 4);
+  }
+  FlowTable::Entry *entry = table.touch(flow(0x0AED0005, 3), 2 * SECOND, 50);
+  FlowTable::addFlips(*entry, 7);
+
+  std::vector<FlowTable::FlowStats> all;
+  table.snapshot(all);
+  EXPECT_EQ(all.size(), 10u);
+
+  auto top = FlowTable::top(all, 2);
+  ASSERT_EQ(top.size(), 2u);
+  EXPECT_EQ(top[0].key.src_port, 3); // 3 drops and the flips win the tie
+  EXPECT_EQ(top[0].packets, 2u);
+  EXPECT_EQ(top[0].bytes, 150u);
+  EXPECT_EQ(top[0].flips, 7u);
+  EXPECT_EQ(top[1].key.src_port, 7);
+
+  // the same flow seen by two threads is summed
+  all.push_back(all.front());
+  top = FlowTable::top(all, 20);
+  EXPECT_EQ(top.size(), 10u);
+}
+
+TEST(FlowTableTests, ReusesIdleFlowsAndEvictsOldestWhenFull) {
+  // smallest table is one probe window, so every flow competes
+  FlowTable table(1, 10.0);
+  ASSERT_EQ(table.capacity(), 8u);
+  for (uint16_t port = 0; port < 8; ++port) {
+    table.touch(flow(0x0AED0005, port), SECOND + port, 100);
+  }
+  EXPECT_EQ(table.forcedEvictions(), 0u);
+
+  // all busy, the least recently seen one (port 0) goes
+  table.touch(flow(0x0AED0005, 100), 2 * SECOND, 100);
+  EXPECT_EQ(table.forcedEvictions(), 1u);
+
+  // after the idle timeout new flows replace old ones without pressure
+  table.touch(flow(0x0AED0006, 1), 20 * SECOND, 100);
+  EXPECT_EQ(table.forcedEvictions(), 1u);
+
+  std::vector<FlowTable::FlowStats> all;
+  table.snapshot(all);
+  EXPECT_EQ(all.size(), 8u);
+  for (const auto &stats : all) {
+    EXPECT_NE(stats.key.src_port, 0);
+  }
+}
@@ -0,0 +1,62 @@
+#include "LoadShedder.hpp"
+#include "configs.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+Config::Shedding twoLinks() {
+  Config::Shedding config;
+  config.shed_order = {LINK_EARTH_TO_EARTH, LINK_MOON_TO_MOON};
+  config.overload_ms = 100;
+  config.recover_ms = 1000;
+  return config;
+}
+} // namespace
+
+TEST(LoadShedderTests, ShedsInOrderUnderSustainedBacklog) {
+  LoadShedder shedder(twoLinks());
+  auto t0 = std::chrono::steady_clock::now();
+
+  // a short spike does not shed anything
+  shedder.update(t0, true);
+  shedder.update(t0 + 50ms, true);
+  shedder.update(t0 + 60ms, false);
+  EXPECT_EQ(shedder.level(), 0u);
+
+  shedder.update(t0 + 100ms, true);
+  shedder.update(t0 + 200ms, true);
+  EXPECT_EQ(shedder.level(), 1u);
+  EXPECT_TRUE(shedder.bypasses(LINK_EARTH_TO_EARTH));
+  EXPECT_FALSE(shedder.bypasses(LINK_MOON_TO_MOON));
+
+  shedder.update(t0 + 300ms, true);
+  EXPECT_EQ(shedder.level(), 2u);
+  EXPECT_TRUE(shedder.bypasses(LINK_MOON_TO_MOON));
+
+  // Earth-Moon links are never in the order, so never shed
+  shedder.update(t0 + 400ms, true);
+  EXPECT_EQ(shedder.level(), 2u);
+  EXPECT_FALSE(shedder.bypasses(LINK_EARTH_TO_MOON));
+  EXPECT_FALSE(shedder.bypasses(LINK_MOON_TO_EARTH));
+}
+
+TEST(LoadShedderTests, OverflowHoldsOverloadThenRecovers) {
+  LoadShedder shedder(twoLinks());
+  auto t0 = std::chrono::steady_clock::now();
+
+  shedder.reportOverflow(t0);
+  shedder.update(t0, false);
+  shedder.reportOverflow(t0 + 90ms);
+  shedder.update(t0 + 100ms, false);
+  EXPECT_EQ(shedder.level(), 1u);
+
+  // calm once the overflow window has passed, one link back per recover_ms
+  shedder.update(t0 + 200ms, false);
+  shedder.update(t0 + 1100ms, false);
+  EXPECT_EQ(shedder.level(), 1u);
+  shedder.update(t0 + 1200ms, false);
+  EXPECT_EQ(shedder.level(), 0u);
+  EXPECT_FALSE(shedder.bypasses(LINK_EARTH_TO_EARTH));
+}
@@ -0,0 +1,151 @@
+#include "ConfigManager.hpp"
+#include "PacketProcessor.hpp"
+#include "TestPackets.hpp"
+#include "TestPaths.hpp"
+#include "configs.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+class PacketProcessorTests : public ::testing::Test {
+protected:
+  void SetUp() override {
+    const std::string path = testPath(".json");
+    {
+      std::ofstream out(path);
+      out << R"({
+        "earth_to_earth": {}, "moon_to_earth": {}, "moon_to_moon": {},
+        "earth_to_moon": { "base_bit_error_rate": 1e-3,
+                           "bit_error_rate_stddev": 0,
+                           "base_packet_loss_burst_freq_per_minute": 0 },
+        "queue": { "segment_mtu": 1420 }
+      })";
+    }
+    config_manager_ = std::make_unique<ConfigManager>(path);
+    std::remove(path.c_str());
+  }
+
+  std::unique_ptr<ConfigManager> config_manager_;
+  std::chrono::steady_clock::time_point t0_ = std::chrono::steady_clock::now();
+};
+} // namespace
+
+TEST_F(PacketProcessorTests, GsoPacketCountsAndCorruptsPerSegment) {
+  PacketProcessor processor(*config_manager_, 42, t0_, nullptr);
+
+  // 40 header bytes and 2960 payload bytes, 1380 payload bytes per segment
+  std::vector<uint8_t> packet = tcpPacket(3000);
+  const std::vector<uint8_t> original = packet;
+  PacketProcessor::Verdict verdict =
+      processor.process(7, packet.data(), packet.size(), 0, t0_);
+
+  EXPECT_EQ(verdict.verdict, static_cast<uint32_t>(NF_ACCEPT));
+  EXPECT_EQ(verdict.mark, static_cast<uint32_t>(MARK_EARTH_TO_MOON));
+  EXPECT_EQ(processor.stats().packets.load(), 1u);
+  EXPECT_EQ(processor.stats().segments.load(), 3u);
+
+  // ~24 flips expected at this rate, headers stay intact
+  ASSERT_TRUE(verdict.modified);
+  EXPECT_GT(processor.stats().flipped_bits.load(), 0u);
+  EXPECT_TRUE(std::equal(packet.begin(), packet.begin() + 40,
+                         original.begin()));
+
+  // Same seed and id, same corruption regardless of the processor
+  PacketProcessor other(*config_manager_, 42, t0_, nullptr);
+  std::vector<uint8_t> again = tcpPacket(3000);
+  other.process(7, again.data(), again.size(), 0, t0_);
+  EXPECT_EQ(again, packet);
+}
+
+TEST_F(PacketProcessorTests, TruncatedCopyIsNotModified) {
+  PacketProcessor processor(*config_manager_, 42, t0_, nullptr);
+
+  // IP total length says 3000 bytes but only 2000 were copied
+  std::vector<uint8_t> packet = tcpPacket(3000);
+  packet.resize(2000);
+  const std::vector<uint8_t> original = packet;
+  PacketProcessor::Verdict verdict =
+      processor.process(7, packet.data(), packet.size(), 0, t0_);
+
+  EXPECT_FALSE(verdict.modified);
+  EXPECT_EQ(packet, original);
+}
+
+TEST_F(PacketProcessorTests, ScenarioOutageDropsOnlyWhileActive) {
+  Config::ScenarioEvent outage{};
+  outage.name = "rover LOS";
+  outage.at_s = 10;
+  outage.duration_s = 5;
+  outage.link_mask = 1u << LINK_EARTH_TO_MOON;
+  outage.node = nodeIndex(ROVER_IP_MIN);
+  outage.outage = true;
+  config_manager_->update(
+      [&outage](Config &config) { config.scenario.events.push_back(outage); });
+
+  PacketProcessor processor(*config_manager_, 42, t0_, nullptr);
+  std::vector<uint8_t> packet = tcpPacket(100);
+  auto at = [&](int seconds) {
+    return processor
+        .process(seconds, packet.data(), packet.size(), 0,
+                 t0_ + std::chrono::seconds(seconds))
+        .verdict;
+  };
+
+  EXPECT_EQ(at(5), static_cast<uint32_t>(NF_ACCEPT));
+  EXPECT_EQ(at(10), static_cast<uint32_t>(NF_DROP));
+  EXPECT_EQ(at(14), static_cast<uint32_t>(NF_DROP));
+  EXPECT_EQ(at(15), static_cast<uint32_t>(NF_ACCEPT));
+  // a clock that jumps back finds the epoch again
+  EXPECT_EQ(at(12), static_cast<uint32_t>(NF_DROP));
+  EXPECT_EQ(processor.stats().outage_drops.load(), 3u);
+}
+
+TEST_F(PacketProcessorTests, LossOnlyChainLeavesDataIntact) {
+  config_manager_->update([](Config &config) {
+    config.impairment.chain = Config::Impairment::Chain::LOSS_ONLY;
+  });
+  PacketProcessor processor(*config_manager_, 42, t0_, nullptr);
+
+  std::vector<uint8_t> packet = tcpPacket(3000);
+  const std::vector<uint8_t> original = packet;
+  PacketProcessor::Verdict verdict =
+      processor.process(7, packet.data(), packet.size(), 0, t0_);
+
+  EXPECT_EQ(verdict.verdict, static_cast<uint32_t>(NF_ACCEPT));
+  EXPECT_EQ(verdict.mark, static_cast<uint32_t>(MARK_EARTH_TO_MOON));
+  EXPECT_FALSE(verdict.modified);
+  EXPECT_EQ(packet, original);
+  EXPECT_EQ(processor.stats().segments.load(), 3u);
+}
+
+TEST_F(PacketProcessorTests, ThroughputLimitDropsAboveRate) {
+  config_manager_->update([](Config &config) {
+    config.link(LINK_EARTH_TO_MOON).base_bit_error_rate = 0;
+    config.link(LINK_EARTH_TO_MOON).throughput_limit_mbps = 1.0;
+  });
+  PacketProcessor processor(*config_manager_, 42, t0_, nullptr);
+
+  // 1 Mbit/s over 50 ms is 6250 bytes, six 1000 byte packets
+  std::vector<uint8_t> packet = tcpPacket(1000);
+  auto send = [&](uint32_t id, std::chrono::milliseconds at) {
+    return processor.process(id, packet.data(), packet.size(), 0, t0_ + at)
+        .verdict;
+  };
+  int accepted = 0;
+  for (uint32_t id = 0; id < 10; ++id) {
+    accepted += send(id, std::chrono::milliseconds(0)) == NF_ACCEPT;
+  }
+  EXPECT_EQ(accepted, 6);
+  EXPECT_EQ(processor.stats().rate_drops.load(), 4u);
+
+  // 8 ms refill one packet
+  EXPECT_EQ(send(10, std::chrono::milliseconds(8)),
+            static_cast<uint32_t>(NF_ACCEPT));
+  EXPECT_EQ(send(11, std::chrono::milliseconds(8)),
+            static_cast<uint32_t>(NF_DROP));
+}
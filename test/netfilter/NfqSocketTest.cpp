@@ -0,0 +1,127 @@
+#include "NfqSocket.hpp"
+#include "configs.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+TEST(NfqSocketTests, ParsesPacketMessagesInPlace) {
+  std::vector<uint8_t> buffer(4096);
+  const uint8_t first[] = {0x45, 0, 0, 20};
+  const uint8_t second[] = {0x45, 1, 2, 3, 4};
+
+  size_t used = NfqSocket::encodePacket(buffer.data(), buffer.size(), 0, 7,
+                                        0x10, first, sizeof(first));
+  ASSERT_GT(used, 0u);
+  used += NfqSocket::encodePacket(buffer.data() + used, buffer.size() - used,
+                                  0, 8, 0x20, second, sizeof(second));
+
+  std::vector<NfqSocket::PacketView> packets;
+  size_t errors = NfqSocket::parse(
+      buffer.data(), used,
+      [&packets](const NfqSocket::PacketView &p) { packets.push_back(p); });
+
+  EXPECT_EQ(errors, 0u);
+  ASSERT_EQ(packets.size(), 2u);
+  EXPECT_EQ(packets[0].id, 7u);
+  EXPECT_EQ(packets[0].mark, 0x10u);
+  ASSERT_EQ(packets[0].length, sizeof(first));
+  EXPECT_EQ(packets[0].payload[3], 20);
+  EXPECT_EQ(packets[1].id, 8u);
+  EXPECT_EQ(packets[1].length, sizeof(second));
+
+  // payload is not copied, the view points into the receive buffer
+  EXPECT_GE(packets[1].payload, buffer.data());
+  EXPECT_LT(packets[1].payload, buffer.data() + used);
+
+  // a cut off message is skipped instead of read past the end
+  packets.clear();
+  NfqSocket::parse(
+      buffer.data(), used - 3,
+      [&packets](const NfqSocket::PacketView &p) { packets.push_back(p); });
+  EXPECT_EQ(packets.size(), 1u);
+}
+
+TEST(NfqSocketTests, ReadsTheStartOfATruncatedMessage) {
+  std::vector<uint8_t> buffer(4096);
+  std::vector<uint8_t> payload(1000, 0);
+  payload[0] = 0x45;
+  size_t used = NfqSocket::encodePacket(buffer.data(), buffer.size(), 3, 9,
+                                        0x30, payload.data(), payload.size());
+  ASSERT_GT(used, 200u);
+
+  // the packet header and mark come before the payload, which is cut short
+  NfqSocket::PacketView packet;
+  ASSERT_TRUE(NfqSocket::parseTruncated(buffer.data(), 200, packet));
+  EXPECT_EQ(packet.queue_num, 3u);
+  EXPECT_EQ(packet.id, 9u);
+  EXPECT_EQ(packet.mark, 0x30u);
+  EXPECT_EQ(packet.payload[0], 0x45);
+  EXPECT_LE(packet.payload + packet.length, buffer.data() + 200);
+
+  // nothing to verdict without the packet header
+  EXPECT_FALSE(NfqSocket::parseTruncated(buffer.data(), 24, packet));
+}
+
+TEST(NfqSocketTests, ReadsKernelTimestamps) {
+  std::vector<uint8_t> buffer(4096);
+  const uint8_t payload[] = {0x45, 0, 0, 20};
+  // 2026-01-01 plus 123456 us, the kernel only sends microseconds
+  const int64_t stamp_ns = 1767225600LL * 1000000000 + 123456789;
+
+  size_t used = NfqSocket::encodePacket(buffer.data(), buffer.size(), 0, 1, 0,
+                                        payload, sizeof(payload), stamp_ns);
+  used += NfqSocket::encodePacket(buffer.data() + used, buffer.size() - used,
+                                  0, 2, 0, payload, sizeof(payload));
+
+  std::vector<NfqSocket::PacketView> packets;
+  NfqSocket::parse(
+      buffer.data(), used,
+      [&packets](const NfqSocket::PacketView &p) { packets.push_back(p); });
+
+  ASSERT_EQ(packets.size(), 2u);
+  EXPECT_EQ(packets[0].timestamp_ns, stamp_ns - 789);
+  EXPECT_EQ(packets[0].payload[3], 20);
+  // an unstamped skb has no NFQA_TIMESTAMP at all
+  EXPECT_EQ(packets[1].timestamp_ns, 0);
+}
+
+TEST(NfqSocketTests, BatchesVerdictsIntoOneDatagram) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_DGRAM, 0, fds), 0);
+
+  NfqVerdictBatch batch(fds[0], 3, 2);
+  const uint8_t payload[] = {1, 2, 3};
+  EXPECT_EQ(batch.add(1, NF_ACCEPT, MARK_EARTH_TO_MOON, nullptr, 0), 0);
+  EXPECT_EQ(batch.add(2, NF_DROP, MARK_MOON_TO_EARTH, payload, 3), 0);
+  EXPECT_EQ(batch.pending(), 2u);
+  EXPECT_EQ(batch.sends(), 0u);
+
+  // the batch is full, the third verdict flushes the first two
+  EXPECT_EQ(batch.add(3, NF_ACCEPT, 0, nullptr, 0), 0);
+  EXPECT_EQ(batch.sends(), 1u);
+  EXPECT_EQ(batch.flush(), 0);
+  EXPECT_EQ(batch.sends(), 2u);
+
+  uint8_t received[4096];
+  ssize_t length = recv(fds[1], received, sizeof(received), 0);
+  ASSERT_GT(length, 0);
+
+  std::vector<uint32_t> ids;
+  int remaining = static_cast<int>(length);
+  for (auto *msg = reinterpret_cast<nlmsghdr *>(received);
+       NLMSG_OK(msg, remaining); msg = NLMSG_NEXT(msg, remaining)) {
+    EXPECT_EQ(msg->nlmsg_type, NFNL_SUBSYS_QUEUE << 8 | NFQNL_MSG_VERDICT);
+    auto *header = reinterpret_cast<nfqnl_msg_verdict_hdr *>(
+        static_cast<uint8_t *>(NLMSG_DATA(msg)) +
+        NLMSG_ALIGN(sizeof(nfgenmsg)) + NLA_HDRLEN);
+    ids.push_back(ntohl(header->id));
+  }
+  EXPECT_EQ(ids, (std::vector<uint32_t>{1, 2}));
+
+  close(fds[0]);
+  close(fds[1]);
+}
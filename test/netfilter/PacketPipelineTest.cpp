@@ -0,0 +1,196 @@
+#include "ConfigManager.hpp"
+#include "PacketPipeline.hpp"
+#include "PacketProcessor.hpp"
+#include "configs.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+// IPv4 header of flow number flow, earth to earth
+std::vector<uint8_t> ipPacket(uint32_t flow) {
+  std::vector<uint8_t> packet(40, 0);
+  packet[0] = 0x45;
+  packet[3] = 40;
+  packet[9] = 17;
+  packet[12] = 192;
+  packet[13] = 168;
+  packet[14] = static_cast<uint8_t>(flow >> 8);
+  packet[15] = static_cast<uint8_t>(flow);
+  packet[16] = 192;
+  packet[17] = 168;
+  packet[18] = 255;
+  packet[19] = 1;
+  return packet;
+}
+
+// Fake verdict sink, the verdict thread is its only writer, read after stop()
+struct VerdictLog {
+  std::vector<uint32_t> ids;
+  std::vector<size_t> batches;
+  std::atomic<bool> hold{false}; // sink waits while set
+  std::atomic<size_t> calls{0};
+
+  PacketPipeline::VerdictSink sink() {
+    return [this](PacketPipeline::Slot *const *slots, size_t count) {
+      calls.fetch_add(1);
+      while (hold.load()) {
+        std::this_thread::sleep_for(1ms);
+      }
+      batches.push_back(count);
+      for (size_t i = 0; i < count; ++i) {
+        ids.push_back(slots[i]->id);
+      }
+    };
+  }
+};
+
+class PacketPipelineTests : public ::testing::Test {
+protected:
+  std::unique_ptr<PacketPipeline> makePipeline(uint32_t workers,
+                                               uint32_t ring_size,
+                                               uint32_t verdict_batch,
+                                               VerdictLog &log) {
+    Config::Pipeline pipeline;
+    pipeline.workers = workers;
+    pipeline.ring_size = ring_size;
+    pipeline.verdict_batch = verdict_batch;
+    std::vector<std::unique_ptr<PacketProcessor>> processors;
+    for (uint32_t i = 0; i < workers; ++i) {
+      processors.push_back(std::make_unique<PacketProcessor>(
+          config_manager_, 42, origin_, nullptr));
+    }
+    return std::make_unique<PacketPipeline>(
+        pipeline, Config::Runtime{}, std::move(processors), log.sink());
+  }
+
+  bool submit(PacketPipeline &pipeline, uint32_t id, uint32_t flow) {
+    std::vector<uint8_t> packet = ipPacket(flow);
+    auto now = origin_ + std::chrono::microseconds(id);
+    return pipeline.submit(id, 0, packet.data(), packet.size(), now, now,
+                           now);
+  }
+
+  ConfigManager config_manager_{""};
+  std::chrono::steady_clock::time_point origin_ =
+      std::chrono::steady_clock::now();
+};
+} // namespace
+
+TEST_F(PacketPipelineTests, KeepsFlowsInOrderAcrossWorkers) {
+  VerdictLog log;
+  auto pipeline = makePipeline(4, 256, 16, log);
+  pipeline->start();
+
+  // ids are global, flows interleave
+  constexpr uint32_t PACKETS = 20000;
+  constexpr uint32_t FLOWS = 37;
+  for (uint32_t id = 0; id < PACKETS; ++id) {
+    ASSERT_TRUE(submit(*pipeline, id, id % FLOWS));
+  }
+  pipeline->stop();
+
+  ASSERT_EQ(log.ids.size(), PACKETS);
+  std::map<uint32_t, uint32_t> last; // flow => last id
+  for (uint32_t id : log.ids) {
+    auto [it, first] = last.try_emplace(id % FLOWS, id);
+    if (!first) {
+      EXPECT_GT(id, it->second) << "flow " << id % FLOWS;
+      it->second = id;
+    }
+  }
+}
+
+TEST_F(PacketPipelineTests, WaitsForAFreeSlot) {
+  VerdictLog log;
+  log.hold = true;
+  constexpr uint32_t RING = 8;
+  auto pipeline = makePipeline(2, RING, 4, log);
+  pipeline->start();
+
+  // the sink holds the first batch, every slot ends up in flight
+  for (uint32_t id = 0; id < RING; ++id) {
+    ASSERT_TRUE(submit(*pipeline, id, id));
+  }
+  EXPECT_EQ(pipeline->inFlight(), RING);
+  EXPECT_EQ(pipeline->stats().backpressure_waits.load(), 0u);
+
+  std::atomic<bool> submitted{false};
+  std::thread receive([&] {
+    EXPECT_TRUE(submit(*pipeline, RING, RING));
+    submitted = true;
+  });
+  std::this_thread::sleep_for(50ms);
+  EXPECT_FALSE(submitted.load());
+  EXPECT_EQ(pipeline->stats().backpressure_waits.load(), 1u);
+
+  log.hold = false;
+  receive.join();
+  EXPECT_TRUE(submitted.load());
+  pipeline->stop();
+  EXPECT_EQ(log.ids.size(), RING + 1);
+}
+
+TEST_F(PacketPipelineTests, StopDrainsEveryPacketOnce) {
+  VerdictLog log;
+  auto pipeline = makePipeline(3, 1024, 64, log);
+  pipeline->start();
+
+  constexpr uint32_t PACKETS = 5000;
+  for (uint32_t id = 0; id < PACKETS; ++id) {
+    ASSERT_TRUE(submit(*pipeline, id, id % 11));
+  }
+  // straight to stop, most packets are still in the rings
+  pipeline->stop();
+  EXPECT_EQ(pipeline->inFlight(), 0u);
+
+  std::vector<uint32_t> ids = log.ids;
+  std::sort(ids.begin(), ids.end());
+  ASSERT_EQ(ids.size(), PACKETS);
+  for (uint32_t id = 0; id < PACKETS; ++id) {
+    ASSERT_EQ(ids[id], id);
+  }
+
+  // a stopped pipeline hands packets back to the caller
+  EXPECT_FALSE(submit(*pipeline, PACKETS, 0));
+}
+
+TEST_F(PacketPipelineTests, SinkGetsBatchesOfAtMostVerdictBatch) {
+  VerdictLog log;
+  log.hold = true;
+  constexpr uint32_t BATCH = 8;
+  auto pipeline = makePipeline(2, 64, BATCH, log);
+  pipeline->start();
+
+  // while the sink holds the first batch the others pile up
+  constexpr uint32_t PACKETS = 64;
+  for (uint32_t id = 0; id < PACKETS; ++id) {
+    ASSERT_TRUE(submit(*pipeline, id, id % 5));
+  }
+  while (log.calls.load() == 0) {
+    std::this_thread::sleep_for(1ms);
+  }
+  std::this_thread::sleep_for(50ms);
+  log.hold = false;
+  pipeline->stop();
+
+  ASSERT_EQ(log.ids.size(), PACKETS);
+  EXPECT_EQ(pipeline->stats().verdict_batches.load(), log.batches.size());
+  size_t full = 0;
+  for (size_t count : log.batches) {
+    EXPECT_GE(count, 1u);
+    EXPECT_LE(count, BATCH);
+    full += count == BATCH;
+  }
+  // everything queued behind the held batch went out in full batches
+  EXPECT_GE(full, (PACKETS - BATCH) / BATCH);
+}
@@ -0,0 +1,69 @@
+#include "SocketBuffer.hpp"
+#include "TestPaths.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+TEST(SocketBufferTests, ParsesProcLines) {
+  std::istringstream proc("    0  12345     3 2 65535     7    11 42 1\n"
+                          "    1  4000     0 2 65535     0     0  1 1\n"
+                          "garbage\n"
+                          "    2  4001     0 2\n");
+  std::vector<SocketBuffer::QueueCounters> queues = SocketBuffer::parse(proc);
+  ASSERT_EQ(queues.size(), 2u);
+  EXPECT_EQ(queues[0].queue_num, 0u);
+  EXPECT_EQ(queues[0].portid, 12345u);
+  EXPECT_EQ(queues[0].queue_total, 3u);
+  EXPECT_EQ(queues[0].queue_dropped, 7u);
+  EXPECT_EQ(queues[0].user_dropped, 11u);
+  EXPECT_EQ(queues[1].queue_num, 1u);
+}
+
+TEST(SocketBufferTests, GrowsAfterDropsUpToTheLimit) {
+  const std::string path = testPath(".proc");
+  auto write = [&path](uint64_t user_dropped) {
+    std::ofstream out(path);
+    out << "    0  100     5 2 65535     2 " << user_dropped << " 9 1\n"
+        << "    1  100     1 2 65535     1 " << user_dropped << " 9 1\n"
+        << "    7  200    50 2 65535    99    99 9 1\n";
+  };
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_GE(fd, 0);
+  Config::Queue queue;
+  queue.socket_buffer = 1 << 16;
+  queue.max_socket_buffer = 1 << 18;
+  SocketBuffer buffer(fd, queue, path);
+  EXPECT_GT(buffer.size(), 0u);
+
+  // queue 7 belongs to someone else
+  write(0);
+  EXPECT_FALSE(buffer.poll({0, 1}, 0));
+  SocketBuffer::Counters counters = buffer.counters();
+  EXPECT_EQ(counters.queue_total, 6u);
+  EXPECT_EQ(counters.queue_dropped, 3u);
+  EXPECT_EQ(counters.user_dropped, 0u);
+
+  // full queue drops alone don't grow it, lost messages double it
+  EXPECT_FALSE(buffer.poll({0, 1}, 0));
+  write(4);
+  EXPECT_TRUE(buffer.poll({0, 1}, 0));
+  EXPECT_EQ(buffer.requested(), 1u << 17);
+  EXPECT_EQ(buffer.counters().user_dropped, 8u);
+  EXPECT_TRUE(buffer.poll({0, 1}, 1));
+  EXPECT_EQ(buffer.requested(), 1u << 18);
+
+  // settled at the limit
+  EXPECT_FALSE(buffer.poll({0, 1}, 2));
+  EXPECT_EQ(buffer.requested(), 1u << 18);
+
+  close(fd);
+  std::remove(path.c_str());
+}
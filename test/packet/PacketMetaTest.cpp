@@ -0,0 +1,150 @@
+#include "PacketMeta.hpp"
+#include "TestPackets.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+constexpr uint32_t SRC = BASE_IP_MIN;  // 10.237.0.130
+constexpr uint32_t DST = ROVER_IP_MIN; // 10.237.0.2
+
+// Offsets must never point past the data, whatever the input
+void expectSafe(const PacketMeta &meta, size_t length) {
+  ASSERT_LE(meta.payload_offset, length);
+  ASSERT_LE(meta.l4_offset, meta.payload_offset);
+  if (meta.udp_checksum_offset != 0) {
+    ASSERT_LE(meta.udp_checksum_offset + 2, meta.payload_offset);
+  }
+}
+} // namespace
+
+TEST(PacketMetaTests, TcpWithIpAndTcpOptions) {
+  std::vector<uint8_t> packet = tcpPacket(200, 6, 8);
+  PacketMeta meta = PacketMeta::parse(packet.data(), packet.size());
+
+  EXPECT_TRUE(meta.isIPv4());
+  EXPECT_TRUE(meta.has(PacketMeta::OPTIONS));
+  EXPECT_EQ(meta.src_ip, SRC);
+  EXPECT_EQ(meta.dst_ip, DST);
+  EXPECT_EQ(meta.l4_offset, 24u);
+  EXPECT_EQ(meta.payload_offset, 24u + 32u);
+  EXPECT_EQ(meta.src_port, 12345);
+  EXPECT_EQ(meta.dst_port, 80);
+  EXPECT_EQ(meta.total_length, 200u);
+}
+
+TEST(PacketMetaTests, FragmentsUdpAndIcmp) {
+  std::vector<uint8_t> packet(100, 0);
+  writeIPv4(packet, 0, 17);
+  packet[6] = 0x20; // more fragments, offset 0: the UDP header is here
+  PacketMeta first = PacketMeta::parse(packet.data(), packet.size());
+  EXPECT_TRUE(first.has(PacketMeta::FRAGMENT));
+  EXPECT_FALSE(first.has(PacketMeta::LATER_FRAGMENT));
+  EXPECT_EQ(first.udp_checksum_offset, 26u);
+  EXPECT_EQ(first.payload_offset, 28u);
+
+  packet[7] = 10; // offset 80 bytes, only the IP header is protected
+  PacketMeta later = PacketMeta::parse(packet.data(), packet.size());
+  EXPECT_TRUE(later.has(PacketMeta::LATER_FRAGMENT));
+  EXPECT_EQ(later.udp_checksum_offset, 0u);
+  EXPECT_EQ(later.payload_offset, 20u);
+  EXPECT_EQ(later.src_port, 0);
+
+  std::vector<uint8_t> icmp(84, 0);
+  writeIPv4(icmp, 0, 1);
+  EXPECT_EQ(PacketMeta::parse(icmp.data(), icmp.size()).payload_offset, 28u);
+}
+
+TEST(PacketMetaTests, TunnelsProtectInnerHeaders) {
+  // IP-in-IP carrying UDP
+  std::vector<uint8_t> ipip(120, 0);
+  writeIPv4(ipip, 0, 4);
+  writeIPv4(ipip, 20, 17);
+  PacketMeta meta = PacketMeta::parse(ipip.data(), ipip.size());
+  EXPECT_TRUE(meta.has(PacketMeta::TUNNEL));
+  EXPECT_EQ(meta.protocol, 4);
+  EXPECT_EQ(meta.inner_protocol, 17);
+  EXPECT_EQ(meta.udp_checksum_offset, 46u);
+  EXPECT_EQ(meta.payload_offset, 48u);
+
+  // GRE with a key carrying TCP
+  std::vector<uint8_t> gre(160, 0);
+  writeIPv4(gre, 0, 47);
+  gre[20] = 0x20; // key present
+  gre[22] = 0x08; // IPv4
+  writeIPv4(gre, 28, 6);
+  gre[48 + 12] = 5 << 4;
+  meta = PacketMeta::parse(gre.data(), gre.size());
+  EXPECT_TRUE(meta.has(PacketMeta::TUNNEL));
+  EXPECT_EQ(meta.payload_offset, 28u + 20u + 20u);
+
+  // GRE carrying something else only protects up to the GRE header
+  gre[22] = 0x86;
+  gre[23] = 0xDD;
+  meta = PacketMeta::parse(gre.data(), gre.size());
+  EXPECT_FALSE(meta.has(PacketMeta::TUNNEL));
+  EXPECT_EQ(meta.payload_offset, 20u);
+}
+
+TEST(PacketMetaTests, BadHeadersAreNotCorruptible) {
+  std::vector<uint8_t> packet = tcpPacket(200);
+  packet[0] = 0x43; // IHL 12 bytes
+  PacketMeta meta = PacketMeta::parse(packet.data(), packet.size());
+  EXPECT_TRUE(meta.has(PacketMeta::MALFORMED));
+  EXPECT_EQ(meta.src_ip, SRC); // still classifiable
+  EXPECT_EQ(meta.payload_offset, 200u);
+
+  // TCP header with options cut short by the copy range
+  packet = tcpPacket(200, 5, 8);
+  meta = PacketMeta::parse(packet.data(), 40);
+  EXPECT_TRUE(meta.has(PacketMeta::TRUNCATED));
+  EXPECT_EQ(meta.payload_offset, 40u);
+
+  packet[0] = 0x60;
+  meta = PacketMeta::parse(packet.data(), packet.size());
+  EXPECT_FALSE(meta.isIPv4());
+  EXPECT_EQ(meta.payload_offset, 200u);
+}
+
+TEST(PacketMetaTests, FuzzedInputStaysInBounds) {
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> byte(0, 255);
+
+  // Valid packets of every kind, then random bytes flipped in their headers
+  std::vector<std::vector<uint8_t>> seeds = {tcpPacket(120, 5, 8),
+                                             tcpPacket(90, 7, 8)};
+  std::vector<uint8_t> ipip(90, 0);
+  writeIPv4(ipip, 0, 4);
+  writeIPv4(ipip, 20, 17);
+  seeds.push_back(ipip);
+  std::vector<uint8_t> gre(100, 0);
+  writeIPv4(gre, 0, 47);
+  gre[22] = 0x08;
+  writeIPv4(gre, 24, 6);
+  seeds.push_back(gre);
+
+  for (int round = 0; round < 200000; ++round) {
+    std::vector<uint8_t> packet = seeds[round % seeds.size()];
+    int mutations = 1 + round % 6;
+    for (int i = 0; i < mutations; ++i) {
+      packet[byte(rng) % 64] = static_cast<uint8_t>(byte(rng));
+    }
+    // any prefix, including the empty one
+    size_t length = static_cast<size_t>(byte(rng)) % (packet.size() + 1);
+    std::vector<uint8_t> copy(packet.begin(), packet.begin() + length);
+    expectSafe(PacketMeta::parse(copy.data(), copy.size()), copy.size());
+  }
+
+  for (int round = 0; round < 20000; ++round) {
+    std::vector<uint8_t> noise(static_cast<size_t>(byte(rng)) % 96);
+    for (uint8_t &b : noise) {
+      b = static_cast<uint8_t>(byte(rng));
+    }
+    if (!noise.empty() && round % 2 == 0) {
+      noise[0] = static_cast<uint8_t>(0x40 | (noise[0] & 0x0F));
+    }
+    expectSafe(PacketMeta::parse(noise.data(), noise.size()), noise.size());
+  }
+}
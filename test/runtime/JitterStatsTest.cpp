@@ -0,0 +1,26 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "JitterStats.hpp"
+
+TEST(JitterStatsTests, SummarisesLateness) {
+  using std::chrono::microseconds;
+  JitterStats jitter;
+  EXPECT_EQ(jitter.summary().samples, 0u);
+
+  for (int i = 0; i < 99; ++i) {
+    jitter.record(microseconds(10));
+  }
+  jitter.record(microseconds(5000));
+  // waking up early counts as on time
+  jitter.record(microseconds(-3));
+
+  JitterStats::Summary summary = jitter.summary();
+  EXPECT_EQ(summary.samples, 101u);
+  EXPECT_NEAR(summary.mean_us, (99 * 10 + 5000) / 101.0, 1e-9);
+  EXPECT_DOUBLE_EQ(summary.max_us, 5000.0);
+
+  // 10 us falls in the [8, 16) bucket, the single outlier is above p99
+  EXPECT_DOUBLE_EQ(summary.p99_us, 16.0);
+}
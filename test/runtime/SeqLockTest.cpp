@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "SeqLock.hpp"
+
+namespace {
+// every word equal, a torn copy mixes two values
+struct Block {
+  uint64_t words[6];
+  uint16_t tail;
+};
+} // namespace
+
+TEST(SeqLockTests, StoresAndLoads) {
+  SeqLock<Block> lock;
+  EXPECT_EQ(lock.version(), 0u);
+
+  Block block{{1, 2, 3, 4, 5, 6}, 7};
+  lock.store(block);
+  Block copy = lock.load();
+  EXPECT_EQ(copy.words[5], 6u);
+  EXPECT_EQ(copy.tail, 7);
+  EXPECT_EQ(lock.version(), 1u);
+}
+
+TEST(SeqLockTests, ReadersNeverSeeTornValues) {
+  SeqLock<Block> lock;
+  std::atomic<bool> done{false};
+
+  std::thread writer([&lock, &done] {
+    for (uint64_t i = 1; i <= 200000; ++i) {
+      Block block;
+      for (uint64_t &word : block.words) {
+        word = i;
+      }
+      block.tail = static_cast<uint16_t>(i);
+      lock.store(block);
+    }
+    done = true;
+  });
+
+  uint64_t last = 0;
+  while (!done) {
+    Block block = lock.load();
+    for (uint64_t word : block.words) {
+      ASSERT_EQ(word, block.words[0]);
+    }
+    ASSERT_EQ(block.tail, static_cast<uint16_t>(block.words[0]));
+    // one writer, values only move forward
+    ASSERT_GE(block.words[0], last);
+    last = block.words[0];
+  }
+  writer.join();
+  EXPECT_EQ(lock.load().words[0], 200000u);
+}
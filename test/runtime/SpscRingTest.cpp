@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+
+#include "SpscRing.hpp"
+
+TEST(SpscRingTests, RoundsCapacityAndRejectsWhenFull) {
+  SpscRing<uint32_t> ring(5);
+  EXPECT_EQ(ring.capacity(), 8u);
+
+  for (uint32_t i = 0; i < 8; ++i) {
+    EXPECT_TRUE(ring.tryPush(i));
+  }
+  EXPECT_FALSE(ring.tryPush(8));
+
+  uint32_t value = 0;
+  ASSERT_TRUE(ring.tryPop(value));
+  EXPECT_EQ(value, 0u);
+  EXPECT_TRUE(ring.tryPush(8));
+}
+
+TEST(SpscRingTests, PreservesOrderAcrossThreads) {
+  constexpr uint32_t COUNT = 20000;
+  SpscRing<uint32_t> ring(64);
+
+  std::thread producer([&ring]() {
+    for (uint32_t i = 0; i < COUNT; ++i) {
+      while (!ring.tryPush(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  uint32_t batch[16];
+  while (expected < COUNT) {
+    size_t popped = ring.tryPopBatch(batch, 16);
+    if (popped == 0) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i < popped; ++i) {
+      ASSERT_EQ(batch[i], expected++);
+    }
+  }
+  producer.join();
+  EXPECT_EQ(ring.size(), 0u);
+}
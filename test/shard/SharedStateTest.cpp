@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "SharedState.hpp"
+
+namespace {
+std::string testName(const char *suffix) {
+  return "/lnd-test-" + std::to_string(getpid()) + "-" + suffix;
+}
+
+SharedState::Header testHeader(uint32_t shards) {
+  SharedState::Header header{};
+  header.shards = shards;
+  header.interfaces = 2;
+  header.seed = 1234;
+  header.origin_ns = 5678;
+  header.time_scale = 60.0;
+  header.ephemeris_start_time = 1.7e9;
+  return header;
+}
+} // namespace
+
+TEST(SharedStateTests, ShardsSeeControlAndCoordinatorSeesCounters) {
+  std::string name = testName("state");
+  auto coordinator = SharedState::create(name, testHeader(2));
+  auto shard = SharedState::attach(name);
+
+  EXPECT_EQ(shard->header().shards, 2u);
+  EXPECT_EQ(shard->header().interfaces, 2u);
+  EXPECT_EQ(shard->header().seed, 1234u);
+  EXPECT_EQ(shard->header().origin_ns, 5678);
+  EXPECT_EQ(shard->header().ephemeris_start_time, 1.7e9);
+
+  SharedState::Control control{};
+  control.generation = 3;
+  control.reloads = 1;
+  control.links[LINK_EARTH_TO_MOON].base_bit_error_rate = 1e-4;
+  control.forced_bursts[LINK_MOON_TO_MOON] = Config::BurstForce::ON;
+  coordinator->publishControl(control);
+
+  SharedState::Control seen{};
+  ASSERT_TRUE(shard->control(seen));
+  EXPECT_EQ(seen.generation, 3u);
+  EXPECT_EQ(seen.links[LINK_EARTH_TO_MOON].base_bit_error_rate, 1e-4);
+  EXPECT_EQ(seen.forced_bursts[LINK_MOON_TO_MOON], Config::BurstForce::ON);
+
+  SharedState::Counters counters{};
+  counters.stats.packets = 10;
+  counters.stats.shed_level = 1;
+  counters.stats.interfaces[1] = {4, 400, 1};
+  counters.latency[LINK_EARTH_TO_MOON].residency = {10, 100.0, 200.0, 300.0};
+  shard->publishCounters(0, counters);
+  counters.stats.packets = 5;
+  counters.stats.shed_level = 2;
+  counters.stats.interfaces[1] = {1, 100, 2};
+  counters.latency[LINK_EARTH_TO_MOON].residency = {30, 20.0, 400.0, 500.0};
+  shard->publishCounters(1, counters);
+
+  SharedState::Counters total = coordinator->total();
+  EXPECT_EQ(total.stats.packets, 15u);
+  EXPECT_EQ(total.stats.shed_level, 2u);
+  EXPECT_EQ(total.stats.interfaces[1].packets, 5u);
+  EXPECT_EQ(total.stats.interfaces[1].bytes, 500u);
+  EXPECT_EQ(total.stats.interfaces[1].drops, 3u);
+  const JitterStats::Summary &residency =
+      total.latency[LINK_EARTH_TO_MOON].residency;
+  EXPECT_EQ(residency.samples, 40u);
+  EXPECT_DOUBLE_EQ(residency.mean_us, 40.0);
+  EXPECT_DOUBLE_EQ(residency.p99_us, 400.0);
+  EXPECT_DOUBLE_EQ(residency.max_us, 500.0);
+}
+
+TEST(SharedStateTests, CreatorRemovesTheSegment) {
+  std::string name = testName("owner");
+  SharedState::create(name, testHeader(1)).reset();
+  EXPECT_THROW(SharedState::attach(name), std::runtime_error);
+
+  // a segment left behind is replaced
+  auto first = SharedState::create(name, testHeader(1));
+  auto second = SharedState::create(name, testHeader(3));
+  EXPECT_EQ(SharedState::attach(name)->header().shards, 3u);
+}
+
+TEST(SharedStateTests, RejectsOtherLayouts) {
+  std::string name = testName("layout");
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(ftruncate(fd, 4096), 0);
+  close(fd);
+  EXPECT_THROW(SharedState::attach(name), std::runtime_error);
+  shm_unlink(name.c_str());
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "DelayLine.hpp"
+#include "configs.hpp"
+
+namespace {
+std::vector<DelayLine::Entry> drain(DelayLine &line, int64_t now_ns) {
+  std::vector<DelayLine::Entry> released;
+  while (line.due(now_ns)) {
+    released.push_back(line.top());
+    line.pop();
+  }
+  return released;
+}
+} // namespace
+
+TEST(DelayLineTests, ReleasesInDelayOrder) {
+  DelayLine line(16, 1);
+  line.setDelay(LINK_EARTH_TO_EARTH, 1.0, 0.0);
+  line.setDelay(LINK_EARTH_TO_MOON, 5.0, 0.0);
+  EXPECT_EQ(line.nextRelease(), INT64_MAX);
+
+  line.push({0, 60, 1, LINK_EARTH_TO_MOON}, 0);
+  line.push({2048, 60, 1, LINK_EARTH_TO_EARTH}, 0);
+  line.push({4096, 60, 0, LINK_EARTH_TO_EARTH}, 0);
+  EXPECT_EQ(line.size(), 3u);
+  EXPECT_EQ(line.nextRelease(), 1'000'000);
+
+  EXPECT_TRUE(drain(line, 999'999).empty());
+  // equal release times leave in push order
+  std::vector<DelayLine::Entry> released = drain(line, 1'000'000);
+  ASSERT_EQ(released.size(), 2u);
+  EXPECT_EQ(released[0].addr, 2048u);
+  EXPECT_EQ(released[1].addr, 4096u);
+  EXPECT_EQ(released[1].port, 0u);
+
+  released = drain(line, 5'000'000);
+  ASSERT_EQ(released.size(), 1u);
+  EXPECT_EQ(released[0].link, LINK_EARTH_TO_MOON);
+  EXPECT_TRUE(line.empty());
+}
+
+TEST(DelayLineTests, JitterStaysWithinBoundsAndReplays) {
+  DelayLine line(1024, 42);
+  DelayLine replay(1024, 42);
+  line.setDelay(LINK_MOON_TO_EARTH, 10.0, 2.0);
+  replay.setDelay(LINK_MOON_TO_EARTH, 10.0, 2.0);
+
+  bool jittered = false;
+  for (uint64_t i = 0; i < 1000; ++i) {
+    line.push({i, 60, 0, LINK_MOON_TO_EARTH}, 0);
+    replay.push({i, 60, 0, LINK_MOON_TO_EARTH}, 0);
+  }
+  while (!line.empty()) {
+    EXPECT_GE(line.topRelease(), 8'000'000);
+    EXPECT_LE(line.topRelease(), 12'000'000);
+    jittered |= line.topRelease() != 10'000'000;
+    EXPECT_EQ(line.topRelease(), replay.topRelease());
+    EXPECT_EQ(line.top().addr, replay.top().addr);
+    line.pop();
+    replay.pop();
+  }
+  EXPECT_TRUE(jittered);
+}
+
+TEST(DelayLineTests, RefusesWhenFull) {
+  DelayLine line(2, 1);
+  EXPECT_TRUE(line.push({0, 60, 0, LINK_EARTH_TO_EARTH}, 0));
+  EXPECT_TRUE(line.push({1, 60, 0, LINK_EARTH_TO_EARTH}, 0));
+  EXPECT_FALSE(line.push({2, 60, 0, LINK_EARTH_TO_EARTH}, 0));
+  line.pop();
+  EXPECT_TRUE(line.push({2, 60, 0, LINK_EARTH_TO_EARTH}, 0));
+}
+
+TEST(DelayLineTests, NewDelayOnlyAppliesToNewPackets) {
+  DelayLine line(4, 1);
+  line.setDelay(LINK_MOON_TO_MOON, 100.0, 0.0);
+  line.push({0, 60, 0, LINK_MOON_TO_MOON}, 0);
+  line.setDelay(LINK_MOON_TO_MOON, 1.0, 0.0);
+  line.push({1, 60, 0, LINK_MOON_TO_MOON}, 0);
+
+  // the second packet overtakes the first
+  EXPECT_EQ(line.top().addr, 1u);
+  EXPECT_EQ(line.topRelease(), 1'000'000);
+  line.pop();
+  EXPECT_EQ(line.topRelease(), 100'000'000);
+}
@@ -0,0 +1,81 @@
+// tools/DecisionLogCsv.cpp
+
+// ---- decision_log_csv Usage ---- //
+
+// Turns decision log segments (see src/impairment/DecisionLog.hpp) into CSV
+// on stdout, one row per record with a header row. A directory argument
+// stands for every .lndlog segment in it.
+
+// Example:
+// ./build/tools/decision_log_csv decision-log > decisions.csv
+// ./build/tools/decision_log_csv decision-log/decisions-1234-0-*.lndlog
+
+// Segments are written per processing thread, rows come out segment by
+// segment and are only in time order within one writer. Sort by time_ns
+// when merging, e.g. duckdb -c "COPY (SELECT * FROM 'decisions.csv' ORDER
+// BY time_ns) TO 'decisions.parquet'".
+
+#include "DecisionLog.hpp"
+#include "configs.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<std::string> segmentPaths(int argc, char *argv[]) {
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    std::filesystem::path arg = argv[i];
+    if (!std::filesystem::is_directory(arg)) {
+      paths.push_back(arg.string());
+      continue;
+    }
+    // writer, then segment order, as the names sort
+    std::vector<std::string> found;
+    for (const auto &entry : std::filesystem::directory_iterator(arg)) {
+      if (entry.path().extension() == ".lndlog") {
+        found.push_back(entry.path().string());
+      }
+    }
+    std::sort(found.begin(), found.end());
+    paths.insert(paths.end(), found.begin(), found.end());
+  }
+  return paths;
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <segment or directory>...\n";
+    return 1;
+  }
+
+  std::cout << "writer,segment,time_ns,id,link,profile,length,verdict,mark,"
+               "in_burst,flips,modified\n";
+  int failed = 0;
+  for (const std::string &path : segmentPaths(argc, argv)) {
+    try {
+      DecisionLog::Reader reader(path);
+      const DecisionLog::Header &header = reader.header();
+      for (const DecisionLog::Record &record : reader.records()) {
+        std::cout << header.writer << ',' << header.segment << ','
+                  << record.time_ns << ',' << record.id << ','
+                  << (record.link < NUM_LINKS ? LINK_SECTIONS[record.link]
+                                              : "other")
+                  << ',' << record.profile_id << ',' << record.length << ','
+                  << (record.verdict == NF_ACCEPT ? "accept" : "drop") << ','
+                  << record.mark << ',' << int{record.in_burst} << ','
+                  << record.flips << ',' << int{record.modified} << '\n';
+      }
+    } catch (const std::exception &error) {
+      std::cerr << "Warning: Skipping " << path << ": " << error.what()
+                << "\n";
+      failed = 1;
+    }
+  }
+  return failed;
+}